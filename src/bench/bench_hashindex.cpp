@@ -0,0 +1,170 @@
+// Copyright (c) 2014-2019 Coin Sciences Ltd
+// MultiChain code distributed under the GPLv3 license, see COPYING file.
+
+/**
+ * Microbenchmark for keyed mc_Buffer lookups.
+ *
+ * Compares mc_Buffer in MC_BUF_MODE_MAP (backed by mc_HashIndex) with
+ * mc_MapStringIndex (std::map keyed by std::string), which mc_Buffer used before.
+ * Both indexes are filled with the same random keys, results of every lookup are
+ * cross-checked, and average Add/Seek times per key are printed.
+ *
+ * Usage: bench_hashindex [rows] [rounds] [keysize ...]
+ */
+
+#include "multichain/multichain.h"
+
+#define MC_BHI_DEFAULT_ROWS             200000
+#define MC_BHI_DEFAULT_ROUNDS           5
+#define MC_BHI_MAX_KEY_SIZES            16
+
+int mc_BenchHashIndex(int rows,int rounds,int key_size)
+{
+    unsigned char *keys;
+    unsigned char *missing;
+    mc_Buffer *buffer;
+    mc_MapStringIndex *map;
+    double time_start;
+    double map_add,map_seek,buf_add,buf_seek;
+    int r,i,j,map_row,buf_row;
+    int err;
+
+    err=MC_ERR_NOERROR;
+    keys=(unsigned char*)mc_New(rows*key_size);
+    missing=(unsigned char*)mc_New(rows*key_size);
+    buffer=new mc_Buffer;
+    map=new mc_MapStringIndex;
+
+    map_add=map_seek=buf_add=buf_seek=0;
+
+    for(r=0;r<rounds;r++)
+    {
+        for(i=0;i<rows*key_size;i++)
+        {
+            keys[i]=(unsigned char)mc_RandomInRange(0,255);
+            missing[i]=(unsigned char)mc_RandomInRange(0,255);
+        }
+
+        map->Clear();
+        buffer->Initialize(key_size,key_size+sizeof(int32_t),MC_BUF_MODE_MAP);
+
+        time_start=mc_TimeNowAsDouble();
+        for(i=0;i<rows;i++)
+        {
+            map->Add(keys+i*key_size,key_size,i);
+        }
+        map_add+=mc_TimeNowAsDouble()-time_start;
+
+        time_start=mc_TimeNowAsDouble();
+        for(i=0;i<rows;i++)
+        {
+            buffer->Add(keys+i*key_size,&i);
+        }
+        buf_add+=mc_TimeNowAsDouble()-time_start;
+
+        time_start=mc_TimeNowAsDouble();
+        for(j=0;j<2;j++)
+        {
+            for(i=0;i<rows;i++)
+            {
+                map_row=map->Get((j ? missing : keys)+i*key_size,key_size);
+            }
+        }
+        map_seek+=mc_TimeNowAsDouble()-time_start;
+
+        time_start=mc_TimeNowAsDouble();
+        for(j=0;j<2;j++)
+        {
+            for(i=0;i<rows;i++)
+            {
+                buf_row=buffer->Seek((j ? missing : keys)+i*key_size);
+            }
+        }
+        buf_seek+=mc_TimeNowAsDouble()-time_start;
+
+        for(j=0;j<2;j++)
+        {
+            for(i=0;i<rows;i++)
+            {
+                map_row=map->Get((j ? missing : keys)+i*key_size,key_size);
+                buf_row=buffer->Seek((j ? missing : keys)+i*key_size);
+                if(map_row != buf_row)
+                {
+                    printf("Mismatch: key size %d, row %d, map: %d, buffer: %d\n",key_size,i,map_row,buf_row);
+                    err=MC_ERR_INTERNAL_ERROR;
+                    goto exitlbl;
+                }
+            }
+        }
+    }
+
+    printf("%8d %8d %12.3f %12.3f %12.3f %12.3f\n",key_size,rows,
+            1000000.*map_add/(rounds*rows),1000000.*buf_add/(rounds*rows),
+            1000000.*map_seek/(2*rounds*rows),1000000.*buf_seek/(2*rounds*rows));
+
+exitlbl:
+
+    delete map;
+    delete buffer;
+    mc_Delete(missing);
+    mc_Delete(keys);
+
+    return err;
+}
+
+int main(int argc, char* argv[])
+{
+    int rows,rounds,i,count;
+    int key_sizes[MC_BHI_MAX_KEY_SIZES];
+
+    rows=MC_BHI_DEFAULT_ROWS;
+    rounds=MC_BHI_DEFAULT_ROUNDS;
+
+    if(argc > 1)
+    {
+        rows=atoi(argv[1]);
+    }
+    if(argc > 2)
+    {
+        rounds=atoi(argv[2]);
+    }
+
+    count=0;
+    for(i=3;(i<argc) && (count<MC_BHI_MAX_KEY_SIZES);i++)
+    {
+        key_sizes[count]=atoi(argv[i]);
+        if(key_sizes[count] > 0)
+        {
+            count++;
+        }
+    }
+    if(count == 0)
+    {
+        key_sizes[count]=4;count++;
+        key_sizes[count]=8;count++;
+        key_sizes[count]=32;count++;
+        key_sizes[count]=36;count++;
+        key_sizes[count]=80;count++;
+    }
+
+    if( (rows <= 0) || (rounds <= 0) )
+    {
+        printf("Usage: bench_hashindex [rows] [rounds] [keysize ...]\n");
+        return 1;
+    }
+
+    mc_RandomSeed((unsigned int)mc_TimeNowAsDouble());
+
+    printf("Average time per key, microseconds\n");
+    printf("%8s %8s %12s %12s %12s %12s\n","keysize","rows","map add","buffer add","map seek","buffer seek");
+
+    for(i=0;i<count;i++)
+    {
+        if(mc_BenchHashIndex(rows,rounds,key_sizes[i]) != MC_ERR_NOERROR)
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
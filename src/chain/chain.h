@@ -442,4 +442,60 @@ public:
     const CBlockIndex *FindFork(const CBlockIndex *pindex) const;
 };
 
+/* MCHN START */
+/** 
+ * Read-only view of the active chain pinned at a given tip. Block index entries are never freed while
+ * the node runs and their height/skip pointers are immutable, so the view stays consistent after
+ * chainActive moves on and can be used without cs_main. Lookups are O(log n) via the skip list.
+ */
+class CChainTipView {
+private:
+    CBlockIndex *pindexTip;
+
+public:
+    CChainTipView() {
+        pindexTip = NULL;
+    }
+
+    explicit CChainTipView(CBlockIndex *pindex) {
+        pindexTip = pindex;
+    }
+
+    /** Returns the index entry for the genesis block of this view, or NULL if none. */
+    CBlockIndex *Genesis() const {
+        return (*this)[0];
+    }
+
+    /** Returns the index entry for the tip of this view, or NULL if none. */
+    CBlockIndex *Tip() const {
+        return pindexTip;
+    }
+
+    /** Returns the index entry at a particular height in this view, or NULL if no such height exists. */
+    CBlockIndex *operator[](int nHeight) const {
+        if (nHeight < 0 || nHeight > Height())
+            return NULL;
+        return pindexTip->GetAncestor(nHeight);
+    }
+
+    /** Check whether a block is present in this view. */
+    bool Contains(const CBlockIndex *pindex) const {
+        return (*this)[pindex->nHeight] == pindex;
+    }
+
+    /** Find the successor of a block in this view, or NULL if the given index is not found or is the tip. */
+    CBlockIndex *Next(const CBlockIndex *pindex) const {
+        if (Contains(pindex))
+            return (*this)[pindex->nHeight + 1];
+        else
+            return NULL;
+    }
+
+    /** Return the maximal height in the view, -1 if empty. */
+    int Height() const {
+        return pindexTip ? pindexTip->nHeight : -1;
+    }
+};
+/* MCHN END */
+
 #endif // BITCOIN_CHAIN_H
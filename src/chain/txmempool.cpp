@@ -62,15 +62,17 @@ CTxMemPoolEntry::CTxMemPoolEntry(const CTxMemPoolEntry& other)
 void CTxMemPoolEntry::ResetReplayParams()
 {    
     fFullReplay=true;
+    nReplayReadSet=0;
     nPermissionsFrom=-1;
     nPermissionsTo=-1;
     nWalletFrom=-1;
     nWalletTo=-1;
 }
 
-void CTxMemPoolEntry::SetReplayNodeParams(bool replay, int from, int to)
+void CTxMemPoolEntry::SetReplayNodeParams(bool replay, int from, int to, uint32_t read_set)
 {
     fFullReplay=replay;
+    nReplayReadSet=read_set;
     nPermissionsFrom=from;
     nPermissionsTo=to;
 }
@@ -48,6 +48,7 @@ private:
     unsigned int nHeight; //! Chain height when entering the mempool
 
     bool fFullReplay;
+    uint32_t nReplayReadSet;
     int nPermissionsFrom;
     int nPermissionsTo;
     int nWalletFrom;
@@ -67,9 +68,10 @@ public:
     unsigned int GetHeight() const { return nHeight; }
     
     void ResetReplayParams();
-    void SetReplayNodeParams(bool replay, int from, int to);
+    void SetReplayNodeParams(bool replay, int from, int to, uint32_t read_set);
     void SetReplayWalletParams(int from, int to);
     bool FullReplayRequired() const { return fFullReplay; }
+    uint32_t ReplayReadSet() const { return nReplayReadSet; }
     int ReplayPermissionFrom() const { return nPermissionsFrom; }
     int ReplayPermissionTo() const { return nPermissionsTo; }
     int ReplayWalletFrom() const { return nWalletFrom; }
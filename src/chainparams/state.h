@@ -45,6 +45,7 @@
 #define MC_WMD_EXPLORER2             0x00000008
 #define MC_WMD_EXPLORER_MASK         0x0000000C
 #define MC_WMD_FLAT_DAT_FILE         0x00000100
+#define MC_WMD_PACKED_LISTS          0x00000200
 #define MC_WMD_MAP_TXS               0x00010000
 #define MC_WMD_MODE_MASK             0x000FFFFF
 #define MC_WMD_LOG_TXS               0x00100000
@@ -203,12 +203,14 @@ void Shutdown()
     StopHTTPServer();        
     
 #ifdef ENABLE_WALLET
+    StopBackgroundRescan();
     if (pwalletMain)
         bitdbwrap.Flush(false);
     GenerateBitcoins(false, NULL, 0);
 #endif
     StopNode();
     UnregisterNodeSignals(GetNodeSignals());
+    StopBlockReader();
 
     if (fFeeEstimatesInitialized)
     {
@@ -378,6 +380,10 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += "  -daemon                " + _("Run in the background as a daemon and accept commands") + "\n";
 #endif
     }
+    strUsage += "  -blockreadahead=<n>    " + strprintf(_("Number of blocks read ahead of sequential block readers (default: %u)"), MC_BRD_DEFAULT_READAHEAD) + "\n";
+    strUsage += "  -blockreadcache=<n>    " + strprintf(_("Cache of recently read blocks in megabytes, 0 - disabled (default: %u)"), MC_BRD_DEFAULT_CACHE_SIZE) + "\n";
+    strUsage += "  -blockreadfiles=<n>    " + strprintf(_("Number of block files kept open for reading (default: %u)"), MC_BRD_DEFAULT_OPEN_FILES) + "\n";
+    strUsage += "  -blockreadthreads=<n>  " + strprintf(_("Number of threads reading blocks ahead, 0 - no readahead (0-%d, default: %d)"), MC_BRD_MAX_THREADS, MC_BRD_DEFAULT_THREADS) + "\n";
     strUsage += "  -datadir=<dir>         " + _("Specify data directory") + "\n";
     strUsage += "  -dbcache=<n>           " + strprintf(_("Set database cache size in megabytes (%d to %d, default: %d)"), nMinDbCache, nMaxDbCache, nDefaultDbCache) + "\n";
     strUsage += "  -loadblock=<file>      " + _("Imports blocks from external blk000??.dat file") + " " + _("on startup") + "\n";
@@ -422,6 +428,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += "  -permitbaremultisig    " + strprintf(_("Relay non-P2SH multisig (default: %u)"), 1) + "\n";
     strUsage += "  -port=<port>           " + _("Listen for connections on <port> ") + "\n";
     strUsage += "  -proxy=<ip:port>       " + _("Connect through SOCKS5 proxy") + "\n";
+    strUsage += "  -relaymsgthreads=<n>   " + strprintf(_("Process offchain relay messages in a pool of <n> threads, 0 - in main message handler (0-%d, default: %d)"), 64, 0) + "\n";
     strUsage += "  -seednode=<ip>         " + _("Connect to a node to retrieve peer addresses, and disconnect") + "\n";
     strUsage += "  -timeout=<n>           " + strprintf(_("Specify connection timeout in milliseconds (minimum: 1, default: %d)"), DEFAULT_CONNECT_TIMEOUT) + "\n";
     strUsage += "  -retryinittime=<n>     " + _("Number of seconds during which an initial connection is retried before the node quits (default: 0)") + "\n";
@@ -466,6 +473,8 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += "  -autosubscribe=<params> " + _("Automatically subscribe to new streams and/or assets, as a comma delimited list of subscriptions.") + "\n";
     strUsage += "                         " + _("All editions: assets, streams. Enterprise Edition only: streams-items,streams-items-local,") + "\n";
     strUsage += "                         " + _("streams-keys,streams-keys-local,streams-publishers,streams-publishers-local,streams-retrieve") + "\n";
+    strUsage += "  -rescanbackground      " + _("Rescan for subscribe, importaddress and importprivkey in background thread, without blocking the chain, see getrescaninfo (default: 0)") + "\n";
+    strUsage += "  -rescanthreads=<n>     " + strprintf(_("Number of threads reading blocks ahead of the background rescan (1-%d, default: %d)"), MC_RSC_MAX_THREADS, MC_RSC_DEFAULT_THREADS) + "\n";
 /* MCHN END */    
     strUsage += "  -zapwallettxes=<mode>  " + _("Delete all wallet transactions and only recover those parts of the blockchain through -rescan on startup") + "\n";
     strUsage += "                         " + _("(1 = keep tx meta data e.g. account owner and payment request information, 2 = drop tx meta data)") + "\n";
@@ -548,6 +557,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += "                         " + _("This option can be specified multiple times") + "\n";
     strUsage += "  -rpcallowmethod=<methods> " + _("If specified, allow only comma delimited list of JSON-RPC <methods>. This option can be specified multiple times.") + "\n";
     strUsage += "  -rpcthreads=<n>        " + strprintf(_("Set the number of threads to service RPC calls (default: %d)"), 4) + "\n";
+    strUsage += "  -rpcreadtipview        " + strprintf(_("Serve block lookup calls (getblock, getblockhash, ...) from pinned chain tip without locking cs_main (default: %u)"), 1) + "\n";
     strUsage += "  -rpcservertimeout=<n>  " + strprintf(_("Timeout during HTTP requests (default: %d)"), DEFAULT_HTTP_SERVER_TIMEOUT) + "\n";
     strUsage += "  -rpcworkqueue=<n>      " + strprintf(_("Set the depth of the work queue to service RPC calls (default: %d)"), DEFAULT_HTTP_WORKQUEUE) + "\n";
 
@@ -573,6 +583,15 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += "  -purgemethod=<method>                    " + _("Overwrite data before purging. Available modes: unlink, simple(=zero, default), one, zeroone, random1-random4, dod, doe, rcmp, gutmann.") + "\n";
     strUsage += "                                           " + _("Can be followed by '-pattern' (up to 6 characters), i.e. random2-mchn makes two random pattern passes followed by 'mchn'. Enterprise Edition only.") + "\n";
     strUsage += "  -explorersupport=0|2                     " + _("Provide support for MultiChain Explorer 2, default 0") + "\n";
+    strUsage += "  -permissioncachesize=<n>                 " + strprintf(_("Number of permission database rows kept in memory, 0 - disabled, default %u"),MC_PLS_DEFAULT_CACHE_SIZE) + "\n";
+    strUsage += "  -entityledgermmap                        " + _("Read entity ledger rows from memory-mapped file, default 1") + "\n";
+    strUsage += "  -entityindexmemory=<n>                   " + strprintf(_("Memory budget for in-memory entity key index, in MB, 0 - disabled, default %u"),MC_ENT_DEFAULT_INDEX_MEMORY) + "\n";
+    strUsage += "  -walletpackedlists                       " + _("Store wallet entity lists in packed blocks of consecutive rows when wallet tx database is created, default 0") + "\n";
+    strUsage += "  -chunkfilemaps=<n>                       " + strprintf(_("Number of off-chain data files kept open and memory-mapped for reading, 0 - disabled, default %u"),MC_CDB_DEFAULT_FILE_MAPS) + "\n";
+    strUsage += "  -chunkdedup                              " + _("Store off-chain data of stream items once in shared reference-counted storage, regardless of the number of streams it appears in, default 0") + "\n";
+    strUsage += "  -filtercodecache=0|1                     " + _("Keep compiled filter and library code in filtercache subdirectory, to speed up filter loading after restart or reorg, default 1") + "\n";
+    strUsage += "  -filtercodecachesize=<n>                 " + _("Maximal size of filtercache subdirectory in MB, least recently used code is removed first, 0 - unlimited, default 64") + "\n";
+    strUsage += "  -leveldbcache=<n>                        " + strprintf(_("Block cache shared by entity, permission, wallet and off-chain databases, in MB, default %u"),MC_DCT_DB_DEFAULT_SHARED_CACHE_SIZE) + "\n";
 
     strUsage += "\n" + _("MultiChain API response parameters") + "\n";        
     strUsage += "  -hideknownopdrops      " + strprintf(_("Remove recognized MultiChain OP_DROP metadata from the responses to JSON-RPC calls (default: %u)"), 0) + "\n";
@@ -934,6 +953,15 @@ bool AppInit2(boost::thread_group& threadGroup,int OutputPipe)
         return InitError(_("Error: Unsupported argument -tor found, use -onion."));
 
     nMessageHandlerThreads=GetArg("-msghandlerversion",1) * MC_MHT_DEFAULT;
+    nRelayMessageHandlerThreads=GetArg("-relaymsgthreads",0);
+    if(nRelayMessageHandlerThreads > 64)
+    {
+        nRelayMessageHandlerThreads=64;
+    }
+    if( (nMessageHandlerThreads != MC_MHT_NONE) && (nRelayMessageHandlerThreads > 0) )
+    {
+        nMessageHandlerThreads |= MC_MHT_PROCESSRELAY;
+    }
     fAcceptOnlyRequestedTxs = ( nMessageHandlerThreads > 0 );
     OrphanHandlerVersion=GetArg("-relaymanversion",1);
     InitialNetLogTime=GetArg("-initialnetlogtime",0);
@@ -1074,6 +1102,8 @@ bool AppInit2(boost::thread_group& threadGroup,int OutputPipe)
 
     LogPrintf("Using %u threads for script verification\n", nScriptCheckThreads);
     
+    StartBlockReader();
+    
     if(!GetBoolArg("-offline",false))
     {    
         if (nScriptCheckThreads) {
@@ -2005,6 +2035,18 @@ bool AppInit2(boost::thread_group& threadGroup,int OutputPipe)
                 {
                     return InitError("Wallet tx database corrupted. Please restart multichaind with -rescan\n");                        
                 }
+                if(pwalletTxsMain->m_Database->m_DBStat.m_InitMode & MC_WMD_PACKED_LISTS)
+                {
+                    mc_gState->m_WalletMode |= MC_WMD_PACKED_LISTS;                 // Storage format is fixed when database is created
+                }
+                if(mapArgs.count("-walletpackedlists"))
+                {
+                    if( (GetBoolArg("-walletpackedlists",false) ? 1 : 0) != ((mc_gState->m_WalletMode & MC_WMD_PACKED_LISTS) ? 1 : 0) )
+                    {
+                        LogPrintf("Wallet tx database was created with -walletpackedlists=%d, ignoring current setting. To change it, please restart multichaind with -rescan\n",
+                                (mc_gState->m_WalletMode & MC_WMD_PACKED_LISTS) ? 1 : 0);
+                    }
+                }
                 if((pwalletTxsMain->m_Database->m_DBStat.m_InitMode & MC_WMD_EXPLORER_MASK) == MC_WMD_EXPLORER1)
                 {
                     return InitError("-explorersupport=1 is not supported by this version of MultiChain. To change it, please restart multichaind with -rescan -explorersupport=2\n");                                                                                
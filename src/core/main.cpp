@@ -32,6 +32,7 @@
 #include "wallet/wallettxs.h"
 #include "script/script.h"
 #include "protocol/relay.h"
+#include "crypto/common.h"
 
 
 extern mc_WalletTxs* pwalletTxsMain;
@@ -63,6 +64,7 @@ bool VerifyBlockSignatureType(CBlock *block);
 bool VerifyBlockSignature(CBlock *block,bool force);
 bool VerifyBlockMiner(CBlock *block,CBlockIndex* pindexNew);
 bool CheckBlockPermissions(const CBlock& block,CBlockIndex* prev_block,unsigned char *lpMinerAddress);
+void PrefetchBlockPermissions(const CBlock& block,const CCoinsViewCache& view);
 bool ProcessMultichainRelay(CNode* pfrom, CDataStream& vRecv, CValidationState &state);
 bool ProcessMultichainVerack(CNode* pfrom, CDataStream& vRecv,bool fIsVerackack,bool *disconnect_flag);
 bool PushMultiChainVerack(CNode* pfrom, bool fIsVerackack);
@@ -94,6 +96,10 @@ CCriticalSection cs_main;
 
 BlockMap mapBlockIndex;
 CChain chainActive;
+/* MCHN START */
+static CCriticalSection cs_tipView;
+static CBlockIndex *pindexTipView = NULL;                                       // chainActive tip published for lock-free readers, protected by cs_tipView
+/* MCHN END */
 CBlockIndex *pindexBestHeader = NULL;
 int64_t nTimeBestReceived = 0;
 CWaitableCriticalSection csBestBlock;
@@ -115,6 +121,8 @@ int nBlockTimeMeasured=0;
 double dAverageBlockTime=0;
 uint256 GenesisCoinBaseTxID=0;
 uint32_t nMessageHandlerThreads=MC_MHT_DEFAULT;
+int nRelayMessageHandlerThreads=0;
+uint32_t nUpgradedParamsVersion=0;
 CTransaction GenesisCoinBaseTx;
 
 vector<CBlockIndex*> vFirstOnThisHeight;
@@ -496,6 +504,8 @@ int MultichainNode_ApplyUpgrades(int current_height)
 {
     vector<mc_UpgradedParameter> vParams;
     int err=MC_ERR_NOERROR;
+    static uint256 last_applied_hash=0;
+    CHashWriter applied_hasher(SER_GETHASH, PROTOCOL_VERSION);
     
     err=CreateUpgradeLists(current_height,&vParams,NULL);
     
@@ -508,6 +518,8 @@ int MultichainNode_ApplyUpgrades(int current_height)
     {
         if(vParams[p].m_Skipped == MC_PSK_APPLIED)
         {
+            applied_hasher << string(vParams[p].m_Param->m_Name);               // Set of applied (name, value) pairs
+            applied_hasher << vParams[p].m_Value;
             if(strcmp(vParams[p].m_Param->m_Name,"protocolversion") == 0)
             {
                 mc_gState->m_NetworkParams->m_ProtocolVersion=(int)vParams[p].m_Value;
@@ -519,6 +531,12 @@ int MultichainNode_ApplyUpgrades(int current_height)
             }
         }
     }
+    uint256 applied_hash=applied_hasher.GetHash();
+    if(applied_hash != last_applied_hash)
+    {
+        nUpgradedParamsVersion++;                                               // Mempool should be fully rechecked
+        last_applied_hash=applied_hash;
+    }
     SetMultiChainParams();            
     if(pMultiChainFilterEngine)                                                 // Added from version 20012. 
     {
@@ -1555,7 +1573,7 @@ int TxThrottlingDelay(bool print)
     
     size_t total_memory=nTotalMempoolsSize/one_mb;
     total_memory*=3;
-    if(nMessageHandlerThreads == ( MC_MHT_GETDATA | MC_MHT_PROCESSDATA | MC_MHT_PROCESSTXDATA ) )                
+    if((nMessageHandlerThreads & MC_MHT_DEFAULT) == ( MC_MHT_GETDATA | MC_MHT_PROCESSDATA | MC_MHT_PROCESSTXDATA ) )                
     {
         total_memory+=2*nTotalNodeBuffersSize/one_mb;
     }
@@ -1912,7 +1930,7 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransa
         err=MC_ERR_NOERROR;
         
         permissions_to=mc_gState->m_Permissions->m_MempoolPermissions->GetCount();
-        entry.SetReplayNodeParams(( (replay & MC_PPL_REPLAY) != 0) ? true : false,permissions_from,permissions_to);
+        entry.SetReplayNodeParams(( (replay & MC_PPL_REPLAY) != 0) ? true : false,permissions_from,permissions_to,replay & MC_PPL_READ_MASK);
         
 /* MCHN END */    
         // Store transaction in memory
@@ -2035,10 +2053,476 @@ bool WriteBlockToDisk(CBlock& block, CDiskBlockPos& pos)
     return true;
 }
 
+/* MCHN START */
+
+/**
+ * Block reader. Keeps a small set of block files open, caches recently read blocks and reads blocks ahead of
+ * sequential readers (rescans, reorgs, VerifyDB, listblocks) in a pool of threads.
+ * Raw block data is read under file lock, deserialization and header check are done outside of it.
+ */
+
+struct CBlockReaderEntry
+{
+    CBlock *block;                                                              // NULL while block is being read by worker
+    unsigned int nSize;
+    std::list<std::pair<int,unsigned int> >::iterator itLRU;                    // Position in LRU list, valid only if block is not NULL
+};
+
+struct CBlockReader
+{
+    boost::mutex mutex;
+    boost::condition_variable cond;
+    boost::thread_group threads;
+    std::map<std::pair<int,unsigned int>,CBlockReaderEntry> mapBlocks;
+    std::list<std::pair<int,unsigned int> > lstLRU;                             // Cached blocks, least recently used first
+    std::deque<CDiskBlockPos> vQueue;
+    size_t nCacheSize;
+    size_t nMaxCacheSize;
+    int nThreads;
+    int nReadahead;
+    int nLastHeight;
+    bool fActive;
+    bool fStop;
+    
+    boost::mutex mutexFiles;
+    std::map<int,std::pair<FILE*,uint64_t> > mapFiles;                          // File number -> (file, last used)
+    uint64_t nFileCounter;
+    int nMaxOpenFiles;
+
+    CBlockReader()
+    {
+        nCacheSize=0;
+        nMaxCacheSize=0;
+        nThreads=0;
+        nReadahead=0;
+        nLastHeight=-1;
+        fActive=false;
+        fStop=false;
+        nFileCounter=0;
+        nMaxOpenFiles=1;
+    }
+    
+    void Start();
+    void Stop();
+    bool Read(const CDiskBlockPos& pos,CBlock& block);
+    void Readahead(const CBlockIndex* pindex);
+    
+    FILE *GetFile(int nFile);
+    bool ReadRaw(const CDiskBlockPos& pos,std::vector<char>& vData);
+    bool Load(const CDiskBlockPos& pos,CBlock *block_out);
+    void Store(const CDiskBlockPos& pos,CBlock *block,unsigned int size);
+    void Discard(const CDiskBlockPos& pos);
+    void Worker();
+};
+
+static CBlockReader BlockReader;
+
+void CBlockReader::Start()
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    
+    if(fActive)
+    {
+        return;
+    }
+    
+    nMaxCacheSize=(size_t)max((int64_t)0,(int64_t)GetArg("-blockreadcache",MC_BRD_DEFAULT_CACHE_SIZE)) * 1024 * 1024;
+    nReadahead=max(0,(int)GetArg("-blockreadahead",MC_BRD_DEFAULT_READAHEAD));
+    nThreads=max(0,min(MC_BRD_MAX_THREADS,(int)GetArg("-blockreadthreads",MC_BRD_DEFAULT_THREADS)));
+    if( (nMaxCacheSize == 0) || (nReadahead == 0) )                             // Nowhere to put or nothing to read ahead
+    {
+        nThreads=0;
+    }
+    {
+        boost::unique_lock<boost::mutex> lock_files(mutexFiles);
+        nMaxOpenFiles=max(1,(int)GetArg("-blockreadfiles",MC_BRD_DEFAULT_OPEN_FILES));
+    }
+    
+    nLastHeight=-1;
+    fStop=false;
+    fActive=true;
+    for(int i=0;i<nThreads;i++)
+    {
+        threads.create_thread(boost::bind(&CBlockReader::Worker, this));
+    }
+    
+    LogPrintf("Block reader: %d threads, readahead %d blocks, cache %u MB\n",nThreads,nReadahead,(unsigned int)(nMaxCacheSize/1024/1024));
+}
+
+void CBlockReader::Stop()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        fStop=true;
+        fActive=false;
+        cond.notify_all();
+    }
+    threads.interrupt_all();
+    threads.join_all();
+    
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        for(std::map<std::pair<int,unsigned int>,CBlockReaderEntry>::iterator it=mapBlocks.begin();it!=mapBlocks.end();it++)
+        {
+            if(it->second.block)
+            {
+                delete it->second.block;
+            }
+        }
+        mapBlocks.clear();
+        lstLRU.clear();
+        vQueue.clear();
+        nCacheSize=0;
+    }
+    
+    {
+        boost::unique_lock<boost::mutex> lock_files(mutexFiles);
+        for(std::map<int,std::pair<FILE*,uint64_t> >::iterator it=mapFiles.begin();it!=mapFiles.end();it++)
+        {
+            fclose(it->second.first);
+        }
+        mapFiles.clear();
+    }
+}
+
+FILE *CBlockReader::GetFile(int nFile)
+{
+    std::map<int,std::pair<FILE*,uint64_t> >::iterator it=mapFiles.find(nFile);
+    
+    nFileCounter++;
+    if(it != mapFiles.end())
+    {
+        it->second.second=nFileCounter;
+        return it->second.first;
+    }
+    
+    while((int)mapFiles.size() >= nMaxOpenFiles)                                // Closing least recently used file
+    {
+        std::map<int,std::pair<FILE*,uint64_t> >::iterator it_lru=mapFiles.begin();
+        for(it=mapFiles.begin();it!=mapFiles.end();it++)
+        {
+            if(it->second.second < it_lru->second.second)
+            {
+                it_lru=it;
+            }
+        }
+        fclose(it_lru->second.first);
+        mapFiles.erase(it_lru);
+    }
+    
+    FILE* file = fopen(GetBlockPosFilename(CDiskBlockPos(nFile,0), "blk").string().c_str(), "rb");
+    if(file)
+    {
+        mapFiles[nFile]=make_pair(file,nFileCounter);
+    }
+    
+    return file;
+}
+
+bool CBlockReader::ReadRaw(const CDiskBlockPos& pos,std::vector<char>& vData)
+{
+    unsigned char header[4];
+    unsigned int nSize;
+    
+    if(pos.IsNull() || (pos.nPos < 8))                                          // Block is preceded by message start and size
+    {
+        return false;
+    }
+    
+    boost::unique_lock<boost::mutex> lock_files(mutexFiles);
+    FILE *file=GetFile(pos.nFile);
+    if(file == NULL)
+    {
+        return false;
+    }
+    if(fseek(file, pos.nPos-4, SEEK_SET))
+    {
+        return false;
+    }
+    if(fread(header,1,4,file) != 4)
+    {
+        return false;
+    }
+    nSize=ReadLE32(header);
+    if( (nSize == 0) || (nSize > MAX_SIZE) )
+    {
+        return false;
+    }
+    vData.resize(nSize);
+    if(fread(&vData[0],1,nSize,file) != nSize)
+    {
+        return false;
+    }
+    
+    return true;
+}
+
+bool CBlockReader::Load(const CDiskBlockPos& pos,CBlock *block_out)
+{
+    std::vector<char> vData;
+    CBlock *block=new CBlock;
+    
+    if(!ReadRaw(pos,vData))
+    {
+        delete block;
+        Discard(pos);
+        return false;
+    }
+    
+    try {
+        CDataStream ss(&vData[0],&vData[0]+vData.size(),SER_DISK,CLIENT_VERSION);
+        ss >> *block;
+    }
+    catch (std::exception &e) {
+        delete block;
+        Discard(pos);
+        return false;
+    }
+    
+    if (!CheckProofOfWork(block->GetHash(), block->nBits))
+    {
+        delete block;
+        Discard(pos);
+        return false;
+    }
+    
+    if(block_out)
+    {
+        *block_out=*block;
+    }
+    Store(pos,block,vData.size());
+    
+    return true;
+}
+
+void CBlockReader::Store(const CDiskBlockPos& pos,CBlock *block,unsigned int size)
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    std::pair<int,unsigned int> key=make_pair(pos.nFile,pos.nPos);
+    std::map<std::pair<int,unsigned int>,CBlockReaderEntry>::iterator it=mapBlocks.find(key);
+    
+    if( !fActive || (nMaxCacheSize == 0) || ((it != mapBlocks.end()) && it->second.block) )
+    {
+        delete block;
+        if( (it != mapBlocks.end()) && (it->second.block == NULL) )
+        {
+            mapBlocks.erase(it);
+        }
+        cond.notify_all();
+        return;
+    }
+    
+    CBlockReaderEntry& entry=mapBlocks[key];
+    entry.block=block;
+    entry.nSize=size;
+    entry.itLRU=lstLRU.insert(lstLRU.end(),key);
+    nCacheSize+=size;
+    
+    while( (nCacheSize > nMaxCacheSize) && !lstLRU.empty() )                    // Evicting least recently used blocks
+    {
+        it=mapBlocks.find(lstLRU.front());
+        lstLRU.pop_front();
+        nCacheSize-=it->second.nSize;
+        delete it->second.block;
+        mapBlocks.erase(it);
+    }
+    
+    cond.notify_all();
+}
+
+void CBlockReader::Discard(const CDiskBlockPos& pos)
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    std::map<std::pair<int,unsigned int>,CBlockReaderEntry>::iterator it=mapBlocks.find(make_pair(pos.nFile,pos.nPos));
+    
+    if( (it != mapBlocks.end()) && (it->second.block == NULL) )
+    {
+        mapBlocks.erase(it);
+    }
+    cond.notify_all();
+}
+
+bool CBlockReader::Read(const CDiskBlockPos& pos,CBlock& block)
+{
+    if(pos.IsNull())
+    {
+        return false;
+    }
+    
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        std::pair<int,unsigned int> key=make_pair(pos.nFile,pos.nPos);
+        
+        if(!fActive)
+        {
+            return false;
+        }
+        while(true)
+        {
+            std::map<std::pair<int,unsigned int>,CBlockReaderEntry>::iterator it=mapBlocks.find(key);
+            if(it == mapBlocks.end())
+            {
+                break;
+            }
+            if(it->second.block)
+            {
+                block=*(it->second.block);
+                lstLRU.splice(lstLRU.end(),lstLRU,it->second.itLRU);
+                return true;
+            }
+            if(fStop)
+            {
+                return false;
+            }
+            cond.wait(lock);                                                    // Block is being read by worker
+        }
+    }
+    
+    return Load(pos,&block);
+}
+
+void CBlockReader::Readahead(const CBlockIndex* pindex)
+{
+    std::vector<CDiskBlockPos> vPos;
+    int direction=0;
+    int count=0;
+    
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        if(!fActive || (nThreads == 0))
+        {
+            return;
+        }
+        if(pindex->nHeight == nLastHeight+1)
+        {
+            direction=1;
+        }
+        if(pindex->nHeight == nLastHeight-1)
+        {
+            direction=-1;
+        }
+        nLastHeight=pindex->nHeight;
+        count=nReadahead;
+    }
+    
+    if(direction == 0)
+    {
+        return;
+    }
+    
+    {
+        TRY_LOCK(cs_main, lockMain);                                            // Readahead is skipped rather than waiting for cs_main
+        if(!lockMain)
+        {
+            return;
+        }
+        if(direction > 0)
+        {
+            if(chainActive[pindex->nHeight] != pindex)
+            {
+                return;
+            }
+            for(int height=pindex->nHeight+1;(height<=chainActive.Height()) && (height<=pindex->nHeight+count);height++)
+            {
+                if(chainActive[height]->nStatus & BLOCK_HAVE_DATA)
+                {
+                    vPos.push_back(chainActive[height]->GetBlockPos());
+                }
+            }
+        }
+        else
+        {
+            for(const CBlockIndex* pindexPrev=pindex->pprev;pindexPrev && ((int)vPos.size()<count);pindexPrev=pindexPrev->pprev)
+            {
+                if(pindexPrev->nStatus & BLOCK_HAVE_DATA)
+                {
+                    vPos.push_back(pindexPrev->GetBlockPos());
+                }
+            }
+        }
+    }
+    
+    boost::unique_lock<boost::mutex> lock(mutex);
+    for(int i=0;i<(int)vPos.size();i++)
+    {
+        if((int)vQueue.size() >= 2*nReadahead)
+        {
+            break;
+        }
+        if(mapBlocks.find(make_pair(vPos[i].nFile,vPos[i].nPos)) != mapBlocks.end())
+        {
+            continue;
+        }
+        if(find(vQueue.begin(),vQueue.end(),vPos[i]) != vQueue.end())
+        {
+            continue;
+        }
+        vQueue.push_back(vPos[i]);
+    }
+    cond.notify_all();
+}
+
+void CBlockReader::Worker()
+{
+    RenameThread("bitcoin-blockreader");
+    
+    try
+    {
+        while(true)
+        {
+            CDiskBlockPos pos;
+            {
+                boost::unique_lock<boost::mutex> lock(mutex);
+                while(!fStop && vQueue.empty())
+                {
+                    cond.wait(lock);
+                }
+                if(fStop)
+                {
+                    return;
+                }
+                pos=vQueue.front();
+                vQueue.pop_front();
+                std::pair<int,unsigned int> key=make_pair(pos.nFile,pos.nPos);
+                if(mapBlocks.find(key) != mapBlocks.end())
+                {
+                    continue;
+                }
+                CBlockReaderEntry& entry=mapBlocks[key];                        // Placeholder, readers of this block wait for worker
+                entry.block=NULL;
+                entry.nSize=0;
+            }
+            Load(pos,NULL);
+        }
+    }
+    catch (boost::thread_interrupted)
+    {
+    }
+}
+
+void StartBlockReader()
+{
+    BlockReader.Start();
+}
+
+void StopBlockReader()
+{
+    BlockReader.Stop();
+}
+
+/* MCHN END */
+
 bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos)
 {
     block.SetNull();
 
+/* MCHN START */    
+    if(BlockReader.Read(pos,block))
+    {
+        return true;
+    }
+/* MCHN END */    
+    
     // Open history file to read
     CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
     if (filein.IsNull())
@@ -2061,6 +2545,9 @@ bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos)
 
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex)
 {
+/* MCHN START */    
+    BlockReader.Readahead(pindex);
+/* MCHN END */    
     if (!ReadBlockFromDisk(block, pindex->GetBlockPos()))
         return false;
     if (block.GetHash() != pindex->GetBlockHash())
@@ -2792,6 +3279,13 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     
     if(fDebug)LogPrint("mchn","mchn: Checking Block with %d transactions\n",block.vtx.size());
     
+/* MCHN START */    
+    if(!fJustCheck)
+    {
+        PrefetchBlockPermissions(block,view);
+    }
+/* MCHN END */    
+    
     for (unsigned int i = 0; i < block.vtx.size(); i++)
     {
         const CTransaction &tx = block.vtx[i];
@@ -3022,9 +3516,23 @@ void FlushStateToDisk() {
     FlushStateToDisk(state, FLUSH_STATE_ALWAYS);
 }
 
+/* MCHN START */
+/** Publish current chainActive tip for readers not holding cs_main, should be called after every chainActive.SetTip */
+void static PublishTipView() {
+    LOCK(cs_tipView);
+    pindexTipView = chainActive.Tip();
+}
+
+CChainTipView GetChainTipView() {
+    LOCK(cs_tipView);
+    return CChainTipView(pindexTipView);
+}
+/* MCHN END */
+
 /** Update chainActive and related internal data structures. */
 void static UpdateTip(CBlockIndex *pindexNew) {
     chainActive.SetTip(pindexNew);
+    PublishTipView();                                                           // MCHN
 
     // New best block
     nTimeBestReceived = GetTime();
@@ -5617,6 +6125,7 @@ bool static LoadBlockIndexDB(std::string& strError)
     if (it == mapBlockIndex.end())
         return true;
     chainActive.SetTip(it->second);
+    PublishTipView();                                                           // MCHN
 
     PruneBlockIndexCandidates();
 /* MCHN START */
@@ -5870,6 +6379,7 @@ void UnloadBlockIndex()
     mapBlockIndex.clear();
     setBlockIndexCandidates.clear();
     chainActive.SetTip(NULL);
+    PublishTipView();                                                           // MCHN
     pindexBestInvalid = NULL;
 }
 
@@ -7751,11 +8261,21 @@ bool ProcessMessages(CNode* pfrom)
         {
             fProcessInDataThread=false;
         }
+        bool fProcessInRelayThread=(nMessageHandlerThreads & MC_MHT_PROCESSRELAY) && (strCommand == "offchain");
         try
         {
             if(pfrom->fDisconnect || !MultichainNode_DisconnectRemote(pfrom))
             {
-                if(fProcessInDataThread)
+                if(fProcessInRelayThread)                                       // Offchain messages don't need cs_main
+                {
+                    {
+                        LOCK(pfrom->cs_vRecvRelayMsg);
+                        pfrom->vRecvRelayMsg.push_back(msg);
+                    }
+                    NotifyRelayMessageHandlers();
+                    fRet=true;
+                }
+                else if(fProcessInDataThread)
                 {
                     if(fProcessTxInSeparateDataThread)
                     {
@@ -8337,14 +8857,23 @@ bool SendMessages(CNode* pto, bool fSendTrickle)
         if(pwalletTxsMain->m_ChunkCollector)
         {
             int64_t time_millis_now=GetTimeMillis();
+            int64_t next_try_delay;
+            bool collect_now;
 
-            if(pwalletTxsMain->m_ChunkCollector->m_NextTryTimestamp < time_millis_now)
+            pwalletTxsMain->m_ChunkCollector->Lock();                           // m_NextTryTimestamp is also updated by ResponseReceived
+            collect_now=(pwalletTxsMain->m_ChunkCollector->m_NextTryTimestamp < time_millis_now);
+            pwalletTxsMain->m_ChunkCollector->UnLock();
+            
+            if(collect_now)
             {
                 if(MultichainNode_CollectChunks())
                 {
                     MultichainCollectChunks(pwalletTxsMain->m_ChunkCollector);
                 }                
-                pwalletTxsMain->m_ChunkCollector->m_NextTryTimestamp=time_millis_now+MultichainCollectChunksQueueStats(pwalletTxsMain->m_ChunkCollector);
+                next_try_delay=MultichainCollectChunksQueueStats(pwalletTxsMain->m_ChunkCollector);
+                pwalletTxsMain->m_ChunkCollector->Lock();
+                pwalletTxsMain->m_ChunkCollector->m_NextTryTimestamp=time_millis_now+next_try_delay;
+                pwalletTxsMain->m_ChunkCollector->UnLock();
                 
 //                    if(fDebug)LogPrint("chunks", "Chunks to collect: %d\n", still_to_collect);
 //                pwalletTxsMain->m_ChunkCollector->m_NextTryTimestamp=time_millis_now+GetArg("-offchainrequestfreq",MC_CCW_TIMEOUT_BETWEEN_COLLECTS_MILLIS);
@@ -150,6 +150,8 @@ extern bool fTxIndex;
 extern bool fAcceptOnlyRequestedTxs;
 extern bool fIsBareMultisigStd;
 extern uint32_t nMessageHandlerThreads;
+extern int nRelayMessageHandlerThreads;
+extern uint32_t nUpgradedParamsVersion;
 extern unsigned int nCoinCacheSize;
 extern CFeeRate minRelayTxFee;
 
@@ -173,8 +175,17 @@ static const uint64_t nMinDiskSpace = 52428800;
 #define MC_MHT_GETDATA                                     0x00000001
 #define MC_MHT_PROCESSDATA                                 0x00000002
 #define MC_MHT_PROCESSTXDATA                               0x00000004
+#define MC_MHT_PROCESSRELAY                                0x00000008
 #define MC_MHT_DEFAULT                                     0x00000007 
 
+// Block reader
+
+#define MC_BRD_DEFAULT_THREADS                                      2
+#define MC_BRD_MAX_THREADS                                         16
+#define MC_BRD_DEFAULT_READAHEAD                                   16
+#define MC_BRD_DEFAULT_CACHE_SIZE                                  32 
+#define MC_BRD_DEFAULT_OPEN_FILES                                   8
+
 
 
 
@@ -420,6 +431,9 @@ public:
 bool WriteBlockToDisk(CBlock& block, CDiskBlockPos& pos);
 bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos);
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex);
+/** Block reader - open block files, recently read blocks and readahead for sequential readers */
+void StartBlockReader();
+void StopBlockReader();
 
 
 /** Functions for validating blocks and updating the block tree */
@@ -587,6 +601,10 @@ bool ReconsiderBlock(CValidationState& state, CBlockIndex *pindex);
 
 /** The currently-connected chain of blocks. */
 extern CChain chainActive;
+/* MCHN START */
+/** Returns view of chainActive as of the last tip update, safe to call without cs_main. */
+CChainTipView GetChainTipView();
+/* MCHN END */
 extern int GenesisBlockSize;
 extern uint256 GenesisCoinBaseTxID;
 extern CTransaction GenesisCoinBaseTx;
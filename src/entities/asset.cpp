@@ -109,6 +109,278 @@ int mc_EntityDB::Close()
     return 0;
 }
     
+/** Set initial index values */
+
+void mc_EntityIndex::Zero()
+{
+    m_Hashes=NULL;
+    m_Rows=NULL;
+    m_Size=0;
+    m_Count=0;
+    m_Used=0;
+    m_MaxMemory=0;
+    m_Enabled=0;
+    m_Overflow=0;
+    m_Hits=0;
+    m_Misses=0;
+    m_Writes=0;
+    m_Deletes=0;
+}
+
+/** Allocate empty index, 0 - index is disabled */
+
+int mc_EntityIndex::Initialize(int64_t max_memory)
+{
+    Destroy();
+    
+    m_MaxMemory=max_memory;
+    if(m_MaxMemory <= 0)
+    {
+        return MC_ERR_NOERROR;
+    }
+    if(m_MaxMemory > 0x7FFFFFFF)                                                // mc_New size limit
+    {
+        m_MaxMemory=0x7FFFFFFF;
+    }
+    
+    if(Resize(MC_ENT_INDEX_MIN_SIZE))
+    {
+        Disable(1);
+        return MC_ERR_NOERROR;
+    }
+    
+    m_Enabled=1;
+    
+    return MC_ERR_NOERROR;
+}
+
+void mc_EntityIndex::Destroy()
+{
+    if(m_Hashes)
+    {
+        mc_Delete(m_Hashes);
+    }
+    if(m_Rows)
+    {
+        mc_Delete(m_Rows);
+    }
+    Zero();
+}
+
+/** Free index memory, lookups fall back to database until index is rebuilt */
+
+void mc_EntityIndex::Disable(int overflow)
+{
+    int64_t max_memory=m_MaxMemory;
+    Destroy();
+    m_MaxMemory=max_memory;
+    m_Overflow=overflow;
+}
+
+int64_t mc_EntityIndex::GetMemory()
+{
+    return m_Size*(sizeof(uint32_t)+sizeof(mc_EntityDBRow));
+}
+
+uint32_t mc_EntityIndex::Hash(mc_EntityDBRow *row)
+{
+    uint32_t hash=2166136261U;
+    unsigned char *ptr=(unsigned char *)row;
+    int i;
+    
+    for(i=0;i<MC_ENT_KEY_SIZE+(int)sizeof(uint32_t);i++)                       // Key and key type
+    {
+        hash=(hash ^ ptr[i]) * 16777619U;
+    }
+    
+    if(hash < 2)
+    {
+        hash+=2;
+    }
+    
+    return hash;
+}
+
+/** Returns slot of the row key, or first free slot if not found (-slot-1) */
+
+int64_t mc_EntityIndex::Find(mc_EntityDBRow *row,uint32_t hash)
+{
+    int64_t slot,mask,free_slot;
+    
+    mask=m_Size-1;
+    slot=hash & mask;
+    free_slot=-1;
+    
+    while(m_Hashes[slot])
+    {
+        if(m_Hashes[slot] == hash)
+        {
+            if(memcmp(m_Rows+slot,row,MC_ENT_KEY_SIZE+sizeof(uint32_t)) == 0)
+            {
+                return slot;
+            }
+        }
+        else
+        {
+            if( (m_Hashes[slot] == 1) && (free_slot < 0) )
+            {
+                free_slot=slot;
+            }
+        }
+        slot=(slot+1) & mask;
+    }
+    
+    if(free_slot < 0)
+    {
+        free_slot=slot;
+    }
+    
+    return -free_slot-1;
+}
+
+int mc_EntityIndex::Resize(int64_t size)
+{
+    uint32_t *old_hashes;
+    mc_EntityDBRow *old_rows;
+    int64_t old_size,i,slot;
+    
+    if(size*(int64_t)(sizeof(uint32_t)+sizeof(mc_EntityDBRow)) > m_MaxMemory)
+    {
+        return MC_ERR_ALLOCATION;
+    }
+    
+    old_hashes=m_Hashes;
+    old_rows=m_Rows;
+    old_size=m_Size;
+    
+    m_Hashes=(uint32_t*)mc_New(size*sizeof(uint32_t));
+    m_Rows=(mc_EntityDBRow*)mc_New(size*sizeof(mc_EntityDBRow));
+    if( (m_Hashes == NULL) || (m_Rows == NULL) )
+    {
+        if(m_Hashes)
+        {
+            mc_Delete(m_Hashes);
+        }
+        if(m_Rows)
+        {
+            mc_Delete(m_Rows);
+        }
+        m_Hashes=old_hashes;
+        m_Rows=old_rows;
+        return MC_ERR_ALLOCATION;
+    }
+    
+    m_Size=size;
+    m_Used=m_Count;
+    
+    for(i=0;i<old_size;i++)
+    {
+        if(old_hashes[i] > 1)
+        {
+            slot=-Find(old_rows+i,old_hashes[i])-1;
+            m_Hashes[slot]=old_hashes[i];
+            memcpy(m_Rows+slot,old_rows+i,sizeof(mc_EntityDBRow));
+        }
+    }
+    
+    if(old_hashes)
+    {
+        mc_Delete(old_hashes);
+    }
+    if(old_rows)
+    {
+        mc_Delete(old_rows);
+    }
+    
+    return MC_ERR_NOERROR;
+}
+
+/** Fills row value if key is found. Returns 1 if found, 0 if not found, -1 if index is disabled */
+
+int mc_EntityIndex::Get(mc_EntityDBRow *row)
+{
+    int64_t slot;
+    
+    if(m_Enabled == 0)
+    {
+        return -1;
+    }
+    
+    slot=Find(row,Hash(row));
+    if(slot < 0)
+    {
+        m_Misses++;
+        return 0;
+    }
+    
+    memcpy(row,m_Rows+slot,sizeof(mc_EntityDBRow));
+    m_Hits++;
+    
+    return 1;
+}
+
+int mc_EntityIndex::Put(mc_EntityDBRow *row)
+{
+    int64_t slot,size;
+    uint32_t hash;
+    
+    if(m_Enabled == 0)
+    {
+        return MC_ERR_NOERROR;
+    }
+    
+    if( (m_Used+1)*4 > m_Size*3 )                                               // Load factor 0.75, including deleted slots
+    {
+        size=m_Size;
+        if( (m_Count+1)*2 > m_Size )
+        {
+            size*=2;
+        }
+        if(Resize(size))
+        {
+            Disable(1);
+            return MC_ERR_ALLOCATION;
+        }
+    }
+    
+    hash=Hash(row);
+    slot=Find(row,hash);
+    if(slot < 0)
+    {
+        slot=-slot-1;
+        if(m_Hashes[slot] == 0)
+        {
+            m_Used++;
+        }
+        m_Count++;
+        m_Hashes[slot]=hash;
+    }
+    memcpy(m_Rows+slot,row,sizeof(mc_EntityDBRow));
+    m_Writes++;
+    
+    return MC_ERR_NOERROR;
+}
+
+int mc_EntityIndex::Delete(mc_EntityDBRow *row)
+{
+    int64_t slot;
+    
+    if(m_Enabled == 0)
+    {
+        return MC_ERR_NOERROR;
+    }
+    
+    slot=Find(row,Hash(row));
+    if(slot >= 0)
+    {
+        m_Hashes[slot]=1;
+        m_Count--;
+        m_Deletes++;
+    }
+    
+    return MC_ERR_NOERROR;
+}
+
 /** Set initial ledger values */
 
 void mc_EntityLedger::Zero()
@@ -123,6 +395,11 @@ void mc_EntityLedger::Zero()
     memset(m_ZeroBuffer,0,m_TotalSize);                                         // Allocated for 96, check if m_TotalSize changed
     m_MaxScriptMemPoolSize=MC_AST_ASSET_MAX_MEMPOOL_SCRIPT_SIZE;
     m_MemPoolSize=m_TotalSize+2*sizeof(int32_t)+sizeof(unsigned char*)+m_MaxScriptMemPoolSize;         // 256
+    m_UseMap=0;
+    m_MapPtr=NULL;
+    m_MapSize=0;
+    m_MapFileSize=0;
+    m_RetiredMapCount=0;
 }
 
 /** Set ledger file name */
@@ -165,16 +442,149 @@ int mc_EntityLedger::Close()
     return 0;    
 }
 
+/** Release all ledger file mappings */
+
+void mc_EntityLedger::UnMap()
+{
+    int i;
+    
+    for(i=0;i<m_RetiredMapCount;i++)
+    {
+        __US_UnMapFile(m_RetiredMapPtrs[i],m_RetiredMapSizes[i]);
+    }
+    m_RetiredMapCount=0;
+    
+    if(m_MapPtr)
+    {
+        __US_UnMapFile(m_MapPtr,m_MapSize);
+    }
+    m_MapPtr=NULL;
+    m_MapSize=0;
+    m_MapFileSize=0;
+}
+
+/** Returns pointer to the mapped ledger range, NULL if it cannot be mapped, ledger file should be open */
+
+const unsigned char *mc_EntityLedger::MapRange(int64_t pos,int64_t size)
+{
+    int64_t file_size,map_size;
+    unsigned char *ptr;
+    
+    if(m_UseMap == 0)
+    {
+        return NULL;
+    }
+    
+    if(pos+size <= m_MapFileSize)
+    {
+        return m_MapPtr+pos;
+    }
+    
+    file_size=__US_FileSize(m_FileHan);
+    if( (file_size <= 0) || (pos+size > file_size) )
+    {
+        return NULL;
+    }
+    
+    if(file_size > m_MapSize)
+    {
+        if(m_RetiredMapCount >= MC_ENT_LEDGER_MAX_RETIRED_MAPS)
+        {
+            return NULL;
+        }
+        
+        map_size=MC_ENT_LEDGER_MAP_MIN_SIZE;
+        while(map_size < file_size)
+        {
+            map_size*=2;
+        }
+        
+        ptr=(unsigned char*)__US_MapFile(m_FileHan,map_size);
+        if(ptr == NULL)
+        {
+            m_UseMap=0;                                                         // Mapping not supported, reading from file
+            return NULL;
+        }
+        
+        if(m_MapPtr)                                                            // Rows returned by GetRowView may still point to the old mapping
+        {
+            m_RetiredMapPtrs[m_RetiredMapCount]=m_MapPtr;
+            m_RetiredMapSizes[m_RetiredMapCount]=m_MapSize;
+            m_RetiredMapCount++;
+        }
+        
+        m_MapPtr=ptr;
+        m_MapSize=map_size;
+    }
+    
+    m_MapFileSize=file_size;
+    
+    return m_MapPtr+pos;
+}
+
+/** Reads ledger row, script is copied into the row */
+
 int mc_EntityLedger::GetRow(int64_t pos, mc_EntityLedgerRow* row)
+{
+    return GetRowInternal(pos,row,0);
+}
+
+/** Reads ledger row, script points to the mapped file if possible, valid until the row is modified or ledger is destroyed */
+
+int mc_EntityLedger::GetRowView(int64_t pos, mc_EntityLedgerRow* row)
+{
+    return GetRowInternal(pos,row,1);
+}
+
+int mc_EntityLedger::GetRowInternal(int64_t pos, mc_EntityLedgerRow* row,int view)
 {
     unsigned char m_RowScript[MC_ENT_SCRIPT_ALLOC_SIZE];
     int size;
     int tail;
+    const unsigned char *ptr;
+    
     if(m_FileHan<=0)
     {
         return MC_ERR_INTERNAL_ERROR;
     }
     
+    ptr=MapRange(pos,m_TotalSize);
+    if(ptr)
+    {
+        row->ReleaseScriptPointer();
+        row->Zero();
+        
+        memcpy((unsigned char*)row+m_KeyOffset,ptr,m_TotalSize);
+        
+        size=row->m_ScriptSize+row->m_ExtendedScript;
+        if(size>0)
+        {
+            ptr=MapRange(pos+m_TotalSize,size);
+            if(ptr == NULL)
+            {
+                return MC_ERR_FILE_READ_ERROR;
+            }
+            if(row->m_ScriptSize)
+            {
+                if(view)
+                {
+                    row->m_Script=(unsigned char *)ptr;                         // Not registered in m_LedgerRowScripts, release is no-op
+                }
+                else
+                {
+                    row->m_Script=(unsigned char *)mc_gState->m_Assets->m_LedgerRowScripts->GetPointer(row,row->m_StaticScript,ptr,row->m_ScriptSize);            
+                }
+            }
+            if(row->m_ExtendedScript)
+            {
+                mc_Script *script=mc_gState->m_Assets->m_RowExtendedScripts->SetScriptPointer(MC_AST_ASSET_SCRIPT_POS_EXTENDED_SCRIPT,row->m_ExtendedScript);
+                memcpy(script->m_lpData,ptr+row->m_ScriptSize,row->m_ExtendedScript);
+            }
+        }
+        
+        return MC_ERR_NOERROR;
+    }
+    
     if(lseek64(m_FileHan,pos,SEEK_SET) != pos)
     {
         return MC_ERR_NOT_FOUND;
@@ -330,6 +740,7 @@ int mc_AssetDB::Zero()
 {
     m_Database = NULL;
     m_Ledger = NULL;
+    m_Index = NULL;
     m_MemPool = NULL;
     m_TmpRelevantEntities = NULL;
     m_ShortTxIDCache = NULL;
@@ -344,6 +755,7 @@ int mc_AssetDB::Zero()
     m_Pos=0;
     m_DBRowCount=0;     
     m_Flags=0;
+    m_StateVersion=0;
     
     m_Semaphore=NULL;
     m_LockedBy=0;
@@ -375,6 +787,7 @@ int mc_AssetDB::Initialize(const char *name,uint32_t mode,int32_t version)
     m_Database=new mc_EntityDB;
      
     m_Ledger->SetName(name);
+    m_Ledger->m_UseMap=(mc_gState->m_Params->GetOption("-entityledgermmap",1) != 0) ? 1 : 0;
     m_Database->SetName(name);
     
     strcpy(m_Name,name);
@@ -411,7 +824,7 @@ int mc_AssetDB::Initialize(const char *name,uint32_t mode,int32_t version)
 #ifndef MAC_OSX
         adbRow.m_Flags|=MC_ENT_FLAG_ENTITYLIST;
 #endif        
-        err=m_Database->m_DB->Write((char*)&adbRow+m_Database->m_KeyOffset,m_Database->m_KeySize,(char*)&adbRow+m_Database->m_ValueOffset,m_Database->m_ValueSize,0);
+        err=WriteDBRow(&adbRow,0);
         if(err)
         {
             return err;
@@ -537,6 +950,13 @@ int mc_AssetDB::Initialize(const char *name,uint32_t mode,int32_t version)
         return MC_ERR_CORRUPTED;
     }
     
+    m_Index=new mc_EntityIndex;
+    err=RebuildIndex();
+    if(err)
+    {
+        return err;
+    }
+    
     m_Semaphore=__US_SemCreate();
     if(m_Semaphore == NULL)
     {
@@ -575,7 +995,7 @@ void mc_AssetDB::RemoveFiles()
     if(m_Database)
     {
         adbRow.Zero();
-        m_Database->m_DB->Delete((char*)&adbRow+m_Database->m_KeyOffset,m_Database->m_KeySize,0);
+        DeleteDBRow(&adbRow,0);
         m_Database->m_DB->Commit(0);
     }
     if(m_Ledger)
@@ -603,6 +1023,11 @@ int mc_AssetDB::Destroy()
         delete m_Ledger;
     }
     
+    if(m_Index)
+    {
+        delete m_Index;
+    }
+    
     if(m_MemPool)
     {
         delete m_MemPool;
@@ -752,10 +1177,100 @@ void mc_AssetDB::ResetRollBackPos()
 
 
 
+/** Writes entity database row and updates the index */
+
+int mc_AssetDB::WriteDBRow(mc_EntityDBRow *row,uint32_t options)
+{
+    int err;
+    
+    err=m_Database->m_DB->Write((char*)row+m_Database->m_KeyOffset,m_Database->m_KeySize,
+                                (char*)row+m_Database->m_ValueOffset,m_Database->m_ValueSize,options);
+    if( (err == MC_ERR_NOERROR) && m_Index )
+    {
+        m_Index->Put(row);
+    }
+    
+    return err;
+}
+
+/** Deletes entity database row and updates the index */
+
+int mc_AssetDB::DeleteDBRow(mc_EntityDBRow *row,uint32_t options)
+{
+    int err;
+    
+    err=m_Database->m_DB->Delete((char*)row+m_Database->m_KeyOffset,m_Database->m_KeySize,options);
+    if( (err == MC_ERR_NOERROR) && m_Index )
+    {
+        m_Index->Delete(row);
+    }
+    
+    return err;
+}
+
+/** Loads all entity database rows into the index */
+
+int mc_AssetDB::RebuildIndex()
+{
+    mc_EntityDBRow adbRow;
+    unsigned char *ptr;
+    int value_len,err;
+    
+    err=m_Index->Initialize(mc_gState->m_Params->GetOption("-entityindexmemory",MC_ENT_DEFAULT_INDEX_MEMORY)*1024*1024);
+    if(err)
+    {
+        return err;
+    }
+    
+    if(m_Index->m_Enabled == 0)
+    {
+        return MC_ERR_NOERROR;
+    }
+    
+    adbRow.Zero();
+    ptr=(unsigned char*)m_Database->m_DB->Read((char*)&adbRow+m_Database->m_KeyOffset,m_Database->m_KeySize,&value_len,MC_OPT_DB_DATABASE_SEEK_ON_READ,&err);
+    if(err)
+    {
+        m_Index->Disable(0);
+        return MC_ERR_NOERROR;
+    }
+    
+    if(ptr)
+    {
+        memcpy((char*)&adbRow+m_Database->m_ValueOffset,ptr,m_Database->m_ValueSize);
+    }
+    
+    while(ptr && m_Index->m_Enabled)
+    {
+        m_Index->Put(&adbRow);
+        ptr=(unsigned char*)m_Database->m_DB->MoveNext(&err);
+        if(ptr)
+        {
+            memcpy((char*)&adbRow+m_Database->m_KeyOffset,ptr,m_Database->m_TotalSize);
+        }
+    }
+    
+    if(err)
+    {
+        m_Index->Disable(0);
+    }
+    
+    m_Index->m_Writes=0;
+    
+    return MC_ERR_NOERROR;
+}
+
 int mc_AssetDB::GetEntity(mc_EntityLedgerRow* row)
+{    
+    return GetEntity(row,0);
+}
+
+/** Finds entity row by key, if view is set, script of the confirmed row may point to the mapped ledger file */
+
+int mc_AssetDB::GetEntity(mc_EntityLedgerRow* row,int view)
 {    
     int err,value_len,mprow;
-    int result;
+    int result,found;
     mc_EntityDBRow adbRow;
     mc_RollBackPos *rollback_pos=GetRollBackPos();
     
@@ -764,23 +1279,32 @@ int mc_AssetDB::GetEntity(mc_EntityLedgerRow* row)
     adbRow.Zero();
     memcpy(adbRow.m_Key,row->m_Key,MC_ENT_KEY_SIZE);
     adbRow.m_KeyType=row->m_KeyType;
-    ptr=(unsigned char*)m_Database->m_DB->Read((char*)row+m_Database->m_KeyOffset,m_Database->m_KeySize,&value_len,0,&err);
-    if(err)
+    
+    found=m_Index->Get(&adbRow);
+    if(found < 0)
     {
-        return 0;
+        ptr=(unsigned char*)m_Database->m_DB->Read((char*)row+m_Database->m_KeyOffset,m_Database->m_KeySize,&value_len,0,&err);
+        if(err)
+        {
+            return 0;
+        }
+        found=0;
+        if(ptr)
+        {
+            memcpy((char*)&adbRow+m_Database->m_ValueOffset,ptr,m_Database->m_ValueSize);
+            found=1;
+        }
     }
     
-    if(ptr)
+    if(found)
     {         
-        memcpy((char*)&adbRow+m_Database->m_ValueOffset,ptr,m_Database->m_ValueSize);
-        
         if(m_Ledger->Open() <= 0)
         {
             return 0;
         }
 
         result=1;        
-        if(m_Ledger->GetRow(adbRow.m_LedgerPos,row))
+        if(m_Ledger->GetRowInternal(adbRow.m_LedgerPos,row,view))
         {
             result=0;
         }
@@ -1834,6 +2358,7 @@ int mc_AssetDB::Commit()
 
     if(m_MemPool->GetCount())
     {
+        m_StateVersion++;
         if(err == MC_ERR_NOERROR)
         {
             size=0;
@@ -1903,8 +2428,7 @@ int mc_AssetDB::Commit()
                     adbRow.m_LedgerPos=m_Pos;
                     adbRow.m_ChainPos=m_Pos;
 
-                    err=m_Database->m_DB->Write((char*)&adbRow+m_Database->m_KeyOffset,m_Database->m_KeySize,
-                                                (char*)&adbRow+m_Database->m_ValueOffset,m_Database->m_ValueSize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
+                    err=WriteDBRow(&adbRow,MC_OPT_DB_DATABASE_TRANSACTIONAL);
                     
                     if(err == MC_ERR_NOERROR)
                     {
@@ -1919,30 +2443,26 @@ int mc_AssetDB::Commit()
                             adbRow.m_LedgerPos=aldGenesisRow.m_FirstPos;
                             adbRow.m_ChainPos=m_Pos;
 
-                            err=m_Database->m_DB->Write((char*)&adbRow+m_Database->m_KeyOffset,m_Database->m_KeySize,
-                                                        (char*)&adbRow+m_Database->m_ValueOffset,m_Database->m_ValueSize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
+                            err=WriteDBRow(&adbRow,MC_OPT_DB_DATABASE_TRANSACTIONAL);
                             
                             memset(adbRow.m_Key,0,MC_ENT_KEY_SIZE);
                             memcpy(adbRow.m_Key,details.m_LedgerRow.m_Key+MC_AST_SHORT_TXID_OFFSET,MC_AST_SHORT_TXID_SIZE);
                             adbRow.m_KeyType=MC_ENT_KEYTYPE_SHORT_TXID;
-                            err=m_Database->m_DB->Write((char*)&adbRow+m_Database->m_KeyOffset,m_Database->m_KeySize,
-                                            (char*)&adbRow+m_Database->m_ValueOffset,m_Database->m_ValueSize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
+                            err=WriteDBRow(&adbRow,MC_OPT_DB_DATABASE_TRANSACTIONAL);
                             
                             if(details.m_Flags & MC_ENT_FLAG_OFFSET_IS_SET)
                             {
                                 memset(adbRow.m_Key,0,MC_ENT_KEY_SIZE);
                                 memcpy(adbRow.m_Key,details.m_Ref,MC_ENT_REF_SIZE);
                                 adbRow.m_KeyType=MC_ENT_KEYTYPE_REF;                                    
-                                err=m_Database->m_DB->Write((char*)&adbRow+m_Database->m_KeyOffset,m_Database->m_KeySize,
-                                                (char*)&adbRow+m_Database->m_ValueOffset,m_Database->m_ValueSize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
+                                err=WriteDBRow(&adbRow,MC_OPT_DB_DATABASE_TRANSACTIONAL);
                             }
                             if(details.m_Flags & MC_ENT_FLAG_NAME_IS_SET)
                             {
                                 memset(adbRow.m_Key,0,MC_ENT_KEY_SIZE);
                                 memcpy(adbRow.m_Key,details.m_Name,MC_ENT_MAX_NAME_SIZE);
                                 adbRow.m_KeyType=MC_ENT_KEYTYPE_NAME;                                    
-                                err=m_Database->m_DB->Write((char*)&adbRow+m_Database->m_KeyOffset,m_Database->m_KeySize,
-                                                (char*)&adbRow+m_Database->m_ValueOffset,m_Database->m_ValueSize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
+                                err=WriteDBRow(&adbRow,MC_OPT_DB_DATABASE_TRANSACTIONAL);
                             }
                         }
                     }
@@ -1976,8 +2496,7 @@ int mc_AssetDB::Commit()
         
         adbRow.m_Block=m_Block+1;
         adbRow.m_LedgerPos=m_PrevPos;
-        err=m_Database->m_DB->Write((char*)&adbRow+m_Database->m_KeyOffset,m_Database->m_KeySize,
-                        (char*)&adbRow+m_Database->m_ValueOffset,m_Database->m_ValueSize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
+        err=WriteDBRow(&adbRow,MC_OPT_DB_DATABASE_TRANSACTIONAL);
     }        
     
     if(err == MC_ERR_NOERROR)
@@ -1996,6 +2515,11 @@ int mc_AssetDB::Commit()
     
 exitlbl:
     
+    if(err)
+    {
+        m_Index->Disable(0);                                                    // Index may contain uncommitted rows
+    }
+    
     UnLock();
     return err;
 }
@@ -2029,6 +2553,7 @@ int mc_AssetDB::RollBackInternal(int block)
     
 
     ClearMemPoolInternal();
+    m_StateVersion++;
     
     if(m_Ledger->Open() <= 0)
     {
@@ -2049,13 +2574,13 @@ int mc_AssetDB::RollBackInternal(int block)
             adbRow.Zero();
             memcpy(adbRow.m_Key,aldRow.m_Key,MC_ENT_KEY_SIZE);
             adbRow.m_KeyType=aldRow.m_KeyType;
-            err=m_Database->m_DB->Delete((char*)&adbRow+m_Database->m_KeyOffset,m_Database->m_KeySize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
+            err=DeleteDBRow(&adbRow,MC_OPT_DB_DATABASE_TRANSACTIONAL);
 
             adbRow.Zero();
             memset(adbRow.m_Key,0,MC_ENT_KEY_SIZE);
             memcpy(adbRow.m_Key,aldRow.m_Key+MC_AST_SHORT_TXID_OFFSET,MC_AST_SHORT_TXID_SIZE);
             adbRow.m_KeyType=MC_ENT_KEYTYPE_SHORT_TXID;
-            err=m_Database->m_DB->Delete((char*)&adbRow+m_Database->m_KeyOffset,m_Database->m_KeySize,MC_OPT_DB_DATABASE_TRANSACTIONAL);                
+            err=DeleteDBRow(&adbRow,MC_OPT_DB_DATABASE_TRANSACTIONAL);                
             
             if((adbRow.m_KeyType & MC_ENT_KEYTYPE_FOLLOW_ON) == 0)
             {
@@ -2064,7 +2589,7 @@ int mc_AssetDB::RollBackInternal(int block)
                     memset(adbRow.m_Key,0,MC_ENT_KEY_SIZE);
                     memcpy(adbRow.m_Key,details.m_Ref,MC_ENT_REF_SIZE);
                     adbRow.m_KeyType=MC_ENT_KEYTYPE_REF;                                    
-                    err=m_Database->m_DB->Delete((char*)&adbRow+m_Database->m_KeyOffset,m_Database->m_KeySize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
+                    err=DeleteDBRow(&adbRow,MC_OPT_DB_DATABASE_TRANSACTIONAL);
                 }
 
                 if(details.m_Flags & MC_ENT_FLAG_NAME_IS_SET)
@@ -2072,7 +2597,7 @@ int mc_AssetDB::RollBackInternal(int block)
                     memset(adbRow.m_Key,0,MC_ENT_KEY_SIZE);
                     memcpy(adbRow.m_Key,details.m_Name,MC_ENT_MAX_NAME_SIZE);
                     adbRow.m_KeyType=MC_ENT_KEYTYPE_NAME;                                    
-                    err=m_Database->m_DB->Delete((char*)&adbRow+m_Database->m_KeyOffset,m_Database->m_KeySize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
+                    err=DeleteDBRow(&adbRow,MC_OPT_DB_DATABASE_TRANSACTIONAL);
                 }            
             }
             
@@ -2096,29 +2621,25 @@ int mc_AssetDB::RollBackInternal(int block)
                     {         
                         memcpy((char*)&adbRow+m_Database->m_ValueOffset,ptr,m_Database->m_ValueSize);
                         adbRow.m_ChainPos=new_chain_pos;
-                        err=m_Database->m_DB->Write((char*)&adbRow+m_Database->m_KeyOffset,m_Database->m_KeySize,
-                                        (char*)&adbRow+m_Database->m_ValueOffset,m_Database->m_ValueSize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
+                        err=WriteDBRow(&adbRow,MC_OPT_DB_DATABASE_TRANSACTIONAL);
                         
                         memset(adbRow.m_Key,0,MC_ENT_KEY_SIZE);
                         memcpy(adbRow.m_Key,details.m_LedgerRow.m_Key+MC_AST_SHORT_TXID_OFFSET,MC_AST_SHORT_TXID_SIZE);
                         adbRow.m_KeyType=MC_ENT_KEYTYPE_SHORT_TXID;
-                        err=m_Database->m_DB->Write((char*)&adbRow+m_Database->m_KeyOffset,m_Database->m_KeySize,
-                                        (char*)&adbRow+m_Database->m_ValueOffset,m_Database->m_ValueSize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
+                        err=WriteDBRow(&adbRow,MC_OPT_DB_DATABASE_TRANSACTIONAL);
                         if(details.m_Flags & MC_ENT_FLAG_OFFSET_IS_SET)
                         {
                             memset(adbRow.m_Key,0,MC_ENT_KEY_SIZE);
                             memcpy(adbRow.m_Key,details.m_Ref,MC_ENT_REF_SIZE);
                             adbRow.m_KeyType=MC_ENT_KEYTYPE_REF;                                    
-                            err=m_Database->m_DB->Write((char*)&adbRow+m_Database->m_KeyOffset,m_Database->m_KeySize,
-                                            (char*)&adbRow+m_Database->m_ValueOffset,m_Database->m_ValueSize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
+                            err=WriteDBRow(&adbRow,MC_OPT_DB_DATABASE_TRANSACTIONAL);
                         }
                         if(details.m_Flags & MC_ENT_FLAG_NAME_IS_SET)
                         {
                             memset(adbRow.m_Key,0,MC_ENT_KEY_SIZE);
                             memcpy(adbRow.m_Key,details.m_Name,MC_ENT_MAX_NAME_SIZE);
                             adbRow.m_KeyType=MC_ENT_KEYTYPE_NAME;                                    
-                            err=m_Database->m_DB->Write((char*)&adbRow+m_Database->m_KeyOffset,m_Database->m_KeySize,
-                                            (char*)&adbRow+m_Database->m_ValueOffset,m_Database->m_ValueSize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
+                            err=WriteDBRow(&adbRow,MC_OPT_DB_DATABASE_TRANSACTIONAL);
                         }
                     }
                     else
@@ -2164,8 +2685,7 @@ int mc_AssetDB::RollBackInternal(int block)
             m_Flags=adbRow.m_Flags;
         }
         
-        err=m_Database->m_DB->Write((char*)&adbRow+m_Database->m_KeyOffset,m_Database->m_KeySize,
-                        (char*)&adbRow+m_Database->m_ValueOffset,m_Database->m_ValueSize,MC_OPT_DB_DATABASE_TRANSACTIONAL);        
+        err=WriteDBRow(&adbRow,MC_OPT_DB_DATABASE_TRANSACTIONAL);        
     }        
     
     if(err == MC_ERR_NOERROR)
@@ -2173,6 +2693,11 @@ int mc_AssetDB::RollBackInternal(int block)
         err=m_Database->m_DB->Commit(MC_OPT_DB_DATABASE_TRANSACTIONAL);
     }    
     
+    if(err)
+    {
+        m_Index->Disable(0);
+    }
+    
     if(err == MC_ERR_NOERROR)
     {
         m_Ledger->GetRow(0,&aldRow);
@@ -2256,7 +2781,7 @@ int mc_AssetDB::FindEntityByTxID(mc_EntityDetails *entity,const unsigned char* t
     memcpy(aldRow.m_Key,txid,MC_ENT_KEY_SIZE);
     aldRow.m_KeyType=MC_ENT_KEYTYPE_TXID;
 
-    if(GetEntity(&aldRow))            
+    if(GetEntity(&aldRow,1))            
     {
         entity->Set(&aldRow);
         if(m_TmpRelevantEntities->GetCount())
@@ -2269,7 +2794,7 @@ int mc_AssetDB::FindEntityByTxID(mc_EntityDetails *entity,const unsigned char* t
 
     aldRow.m_KeyType=MC_ENT_KEYTYPE_TXID | MC_ENT_KEYTYPE_FOLLOW_ON;
 
-    if(GetEntity(&aldRow))            
+    if(GetEntity(&aldRow,1))            
     {
         entity->Set(&aldRow);
         res=1;
@@ -2305,7 +2830,7 @@ int mc_AssetDB::FindEntityByShortTxIDInternal (mc_EntityDetails *entity, const u
     memcpy(aldRow.m_Key,short_txid,MC_AST_SHORT_TXID_SIZE);
     aldRow.m_KeyType=MC_ENT_KEYTYPE_SHORT_TXID;
 
-    if(GetEntity(&aldRow))            
+    if(GetEntity(&aldRow,1))            
     {
         entity->Set(&aldRow);
         if(m_TmpRelevantEntities->GetCount())
@@ -2364,7 +2889,7 @@ int mc_AssetDB::FindEntityByRef (mc_EntityDetails *entity,const unsigned char* a
     memcpy(aldRow.m_Key,asset_ref,MC_ENT_REF_SIZE);
     aldRow.m_KeyType=MC_ENT_KEYTYPE_REF;
 
-    if(GetEntity(&aldRow))            
+    if(GetEntity(&aldRow,1))            
     {
         entity->Set(&aldRow);
         if(m_TmpRelevantEntities->GetCount())
@@ -2411,7 +2936,7 @@ int mc_AssetDB::FindEntityByName(mc_EntityDetails *entity,const char* name)
     mc_StringLowerCase((char*)(aldRow.m_Key),MC_ENT_MAX_NAME_SIZE);
     aldRow.m_KeyType=MC_ENT_KEYTYPE_NAME;
 
-    if(GetEntity(&aldRow))            
+    if(GetEntity(&aldRow,1))            
     {
         entity->Set(&aldRow);
         if(m_TmpRelevantEntities->GetCount())
@@ -2475,7 +3000,7 @@ int mc_AssetDB::FindLastEntityByGenesisInternal(mc_EntityDetails *last_entity, m
         m_Ledger->Open();
         while(pos>0)
         {
-            m_Ledger->GetRow(pos,&aldRow);
+            m_Ledger->GetRowView(pos,&aldRow);
             if( (rollback_pos == NULL) || (rollback_pos->InBlock() == 0) || ((rollback_pos->IsOut(aldRow.m_Block,aldRow.m_Offset)) == 0) )
             {
                 last_entity->Set(&aldRow);                
@@ -2542,7 +3067,7 @@ int mc_AssetDB::FindEntityByFollowOnInternal(mc_EntityDetails *entity,const unsi
     memcpy(aldRow.m_Key,txid,MC_ENT_KEY_SIZE);
     aldRow.m_KeyType=MC_ENT_KEYTYPE_FOLLOW_ON | MC_ENT_KEYTYPE_TXID;
 
-    if(GetEntity(&aldRow))            
+    if(GetEntity(&aldRow,1))            
     {
         m_Ledger->Open();
         
@@ -2552,7 +3077,7 @@ int mc_AssetDB::FindEntityByFollowOnInternal(mc_EntityDetails *entity,const unsi
         }
         else
         {
-            m_Ledger->GetRow(aldRow.m_FirstPos,&aldRow);
+            m_Ledger->GetRowView(aldRow.m_FirstPos,&aldRow);
         }
         m_Ledger->Close();
         entity->Set(&aldRow);
@@ -3364,7 +3889,7 @@ int64_t mc_AssetDB::GetChainPosition(mc_EntityLedgerRow *row,int32_t index)
         
         while(take_it)
         {
-            m_Ledger->GetRow(pos,&aldRow);
+            m_Ledger->GetRowView(pos,&aldRow);
             
             row_index=-1;
             value_offset=mc_FindSpecialParamInDetailsScript(aldRow.m_Script,aldRow.m_ScriptSize,MC_ENT_SPRM_CHAIN_INDEX,&value_size);
@@ -3490,7 +4015,7 @@ int64_t mc_AssetDB::GetTotalQuantity(mc_EntityLedgerRow *row,int32_t *chain_size
                 
         while(take_it)
         {
-            m_Ledger->GetRow(pos,&aldRow);
+            m_Ledger->GetRowView(pos,&aldRow);
             
             value_offset=mc_FindSpecialParamInDetailsScript(aldRow.m_Script,aldRow.m_ScriptSize,MC_ENT_SPRM_ASSET_TOTAL,&value_size);
             if(value_offset < aldRow.m_ScriptSize)
@@ -3561,7 +4086,7 @@ int mc_AssetDB::FindActiveUpdate(mc_EntityDetails *entity, const void* txid)
     memcpy(aldRow.m_Key,txid,MC_ENT_KEY_SIZE);
     aldRow.m_KeyType=MC_ENT_KEYTYPE_TXID;
     
-    if(GetEntity(&aldRow))            
+    if(GetEntity(&aldRow,1))            
     {
         entity->Set(&aldRow);
         if(entity->AllowedFollowOns() == 0)
@@ -3626,7 +4151,7 @@ int mc_AssetDB::FindActiveUpdate(mc_EntityDetails *entity, const void* txid)
             m_Ledger->Open();
             while(take_it)
             {
-                m_Ledger->GetRow(pos,&aldRow);
+                m_Ledger->GetRowView(pos,&aldRow);
                 if(aldRow.m_KeyType & MC_ENT_KEYTYPE_FOLLOW_ON)
                 {
                     if( (rollback_pos == NULL) || (rollback_pos->InBlock() == 0) || ((rollback_pos->IsOut(aldRow.m_Block,aldRow.m_Offset)) == 0) )
@@ -3690,7 +4215,7 @@ int mc_AssetDB::FindUpdateByName(mc_EntityDetails *entity, const void* txid,cons
     memcpy(aldRow.m_Key,txid,MC_ENT_KEY_SIZE);
     aldRow.m_KeyType=MC_ENT_KEYTYPE_TXID;
     
-    if(GetEntity(&aldRow))            
+    if(GetEntity(&aldRow,1))            
     {
         if(strlen(name) == 0)
         {
@@ -3725,7 +4250,7 @@ int mc_AssetDB::FindUpdateByName(mc_EntityDetails *entity, const void* txid,cons
             m_Ledger->Open();
             while(take_it)
             {
-                m_Ledger->GetRow(pos,&aldRow);
+                m_Ledger->GetRowView(pos,&aldRow);
                 value_offset=mc_FindSpecialParamInDetailsScript(aldRow.m_Script,aldRow.m_ScriptSize,MC_ENT_SPRM_UPDATE_NAME,&value_size);
                 if(value_offset < aldRow.m_ScriptSize)
                 {   
@@ -3789,7 +4314,7 @@ mc_Buffer *mc_AssetDB::GetFollowOns(const void* txid)
     memcpy(aldRow.m_Key,txid,MC_ENT_KEY_SIZE);
     aldRow.m_KeyType=MC_ENT_KEYTYPE_TXID;
 
-    if(GetEntity(&aldRow))            
+    if(GetEntity(&aldRow,1))            
     {
         pos=aldRow.m_ChainPos;
         first_pos=aldRow.m_FirstPos;
@@ -3813,7 +4338,7 @@ mc_Buffer *mc_AssetDB::GetFollowOns(const void* txid)
             m_Ledger->Open();
             while(take_it)
             {
-                m_Ledger->GetRow(pos,&aldRow);
+                m_Ledger->GetRowView(pos,&aldRow);
                 result->Add(aldRow.m_Key,NULL);
                 if(pos != first_pos)
                 {
@@ -3854,7 +4379,7 @@ int mc_AssetDB::FindEntityByPosition(mc_EntityDetails *entity, int64_t pos)
     if(pos>0)
     {
         m_Ledger->Open();
-        m_Ledger->GetRow(pos,&aldRow);
+        m_Ledger->GetRowView(pos,&aldRow);
         m_Ledger->Close();        
     }
     else
@@ -3889,7 +4414,7 @@ void mc_AssetDB::ReloadDetailsIfNeeded(mc_EntityDetails *entity)
         {
             int64_t pos=entity->m_ThisPos;
             m_Ledger->Open();
-            m_Ledger->GetRow(pos,&aldRow);
+            m_Ledger->GetRowView(pos,&aldRow);
             entity->Set(&aldRow);
             entity->m_ThisPos=pos;
             m_Ledger->Close();
@@ -4053,7 +4578,7 @@ mc_Buffer *mc_AssetDB::GetFollowOnPositionsByLastEntity(mc_EntityDetails *last_e
             m_Ledger->Open();
             while(take_it)
             {
-                m_Ledger->GetRow(pos,&aldRow);
+                m_Ledger->GetRowView(pos,&aldRow);
                 entity.Set(&aldRow);
                 entity.m_ThisPos=pos;
                 result->Add(&(entity.m_ThisPos),NULL);                
@@ -4098,7 +4623,7 @@ int mc_AssetDB::HasFollowOns(const void* txid)
     memcpy(aldRow.m_Key,txid,MC_ENT_KEY_SIZE);
     aldRow.m_KeyType=MC_ENT_KEYTYPE_TXID;
 
-    if(GetEntity(&aldRow))            
+    if(GetEntity(&aldRow,1))            
     {
         if(aldRow.m_FirstPos >= 0)
         {
@@ -44,6 +44,10 @@
 #define MC_ENT_MAX_STORED_ISSUERS                     128 
 #define MC_ENT_SCRIPT_STATIC_SIZE                    4096
 #define MC_ENT_SCRIPT_ALLOC_SIZE                    66000 // > MC_ENT_MAX_SCRIPT_SIZE + MC_ENT_MAX_FIXED_FIELDS_SIZE + 27*MC_ENT_MAX_STORED_ISSUERS
+#define MC_ENT_LEDGER_MAP_MIN_SIZE            0x4000000                           // 64MB, minimal ledger mapping, grows geometrically
+#define MC_ENT_LEDGER_MAX_RETIRED_MAPS               64
+#define MC_ENT_DEFAULT_INDEX_MEMORY                 256                         // MB, in-memory entity key index
+#define MC_ENT_INDEX_MIN_SIZE                     65536
 #define MC_ENT_DEFAULT_MAX_ASSET_TOTAL 0x7FFFFFFFFFFFFFFF
 
 #define MC_ENT_KEY_SIZE              32
@@ -162,6 +166,46 @@ typedef struct mc_EntityDBRow
     void Zero();
 } mc_EntityDBRow;
 
+/** In-memory open-addressing index mirroring entity database rows, authoritative when enabled */
+
+typedef struct mc_EntityIndex
+{
+    uint32_t *m_Hashes;                                                         // Slot hashes, 0 - empty, 1 - deleted
+    mc_EntityDBRow *m_Rows;                                                     // Slot rows
+    int64_t m_Size;                                                             // Number of slots, power of 2
+    int64_t m_Count;                                                            // Number of live rows
+    int64_t m_Used;                                                             // Number of live and deleted rows
+    int64_t m_MaxMemory;                                                        // Memory budget, index is disabled if exceeded
+    int m_Enabled;
+    int m_Overflow;                                                             // Set if index was disabled because of memory budget
+    uint64_t m_Hits;
+    uint64_t m_Misses;
+    uint64_t m_Writes;
+    uint64_t m_Deletes;
+    
+    mc_EntityIndex()
+    {
+        Zero();
+    }
+    
+    ~mc_EntityIndex()
+    {
+        Destroy();
+    }
+    
+    void Zero();
+    int Initialize(int64_t max_memory);
+    void Destroy();
+    void Disable(int overflow);
+    int Get(mc_EntityDBRow *row);
+    int Put(mc_EntityDBRow *row);
+    int Delete(mc_EntityDBRow *row);
+    int Resize(int64_t size);
+    int64_t GetMemory();
+    int64_t Find(mc_EntityDBRow *row,uint32_t hash);
+    uint32_t Hash(mc_EntityDBRow *row);
+} mc_EntityIndex;
+
 /** Database */
 
 typedef struct mc_EntityDB
@@ -295,6 +339,13 @@ typedef struct mc_EntityLedger
     uint32_t m_MemPoolSize;                                                     // Totals size of the ledger row in mempool
     uint32_t m_MaxScriptMemPoolSize;                                            // Maximal script size stored in mempool
     unsigned char m_ZeroBuffer[96];
+    int m_UseMap;                                                               // Read rows from memory-mapped file
+    unsigned char *m_MapPtr;                                                    // Current read-only mapping of the ledger file
+    int64_t m_MapSize;                                                          // Size of the mapping, may exceed file size
+    int64_t m_MapFileSize;                                                      // File size known to be covered by the mapping
+    int m_RetiredMapCount;                                                      // Number of mappings replaced when file grew
+    unsigned char *m_RetiredMapPtrs[MC_ENT_LEDGER_MAX_RETIRED_MAPS];            // Replaced mappings, kept until destruction as row views may point to them
+    int64_t m_RetiredMapSizes[MC_ENT_LEDGER_MAX_RETIRED_MAPS];
    
     mc_EntityLedger()
     {
@@ -304,6 +355,7 @@ typedef struct mc_EntityLedger
     ~mc_EntityLedger()
     {
         Close();
+        UnMap();
     }
     
     void Zero();
@@ -312,6 +364,10 @@ typedef struct mc_EntityLedger
     void Flush();
     void SetName(const char *name);
     int GetRow(int64_t pos,mc_EntityLedgerRow *row);
+    int GetRowView(int64_t pos,mc_EntityLedgerRow *row);
+    int GetRowInternal(int64_t pos,mc_EntityLedgerRow *row,int view);
+    const unsigned char *MapRange(int64_t pos,int64_t size);
+    void UnMap();
     int64_t GetSize();
     int SetRow(int64_t pos,mc_EntityLedgerRow *row);
     int SetZeroRow(mc_EntityLedgerRow *row);
@@ -323,6 +379,7 @@ typedef struct mc_AssetDB
 {    
     mc_EntityDB *m_Database;
     mc_EntityLedger *m_Ledger;
+    mc_EntityIndex *m_Index;
     
     mc_Buffer   *m_MemPool;
     mc_Buffer   *m_TmpRelevantEntities;
@@ -341,6 +398,7 @@ typedef struct mc_AssetDB
     uint64_t m_CheckPointMemPoolSize;
     int m_DBRowCount;
     uint32_t m_Flags;
+    uint64_t m_StateVersion;                                                    // Incremented when block changes entities or is rolled back
     uint32_t m_Mode;
     int32_t m_Version;
     
@@ -377,6 +435,8 @@ typedef struct mc_AssetDB
     int RollBackToCheckPoint();
     
     int GetEntity(mc_EntityLedgerRow *row);
+    int GetEntity(mc_EntityLedgerRow *row,int view);
+    int RebuildIndex();
 
     int FindEntityByTxID(mc_EntityDetails *entity, const unsigned char* txid);
     int FindEntityByShortTxID (mc_EntityDetails *entity, const unsigned char* short_txid);
@@ -428,6 +488,8 @@ typedef struct mc_AssetDB
     int FindEntityByShortTxIDInternal (mc_EntityDetails *entity, const unsigned char* short_txid);
     int FindLastEntityByGenesisInternal(mc_EntityDetails *last_entity, mc_EntityDetails *genesis_entity);    
     int FindEntityByFollowOnInternal(mc_EntityDetails *entity, const unsigned char* txid);    
+    int WriteDBRow(mc_EntityDBRow *row,uint32_t options);
+    int DeleteDBRow(mc_EntityDBRow *row,uint32_t options);
      
     void Lock(int write_mode);
     void UnLock();
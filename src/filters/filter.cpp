@@ -46,6 +46,7 @@ void mc_FilterEngine::Zero()
     m_Impl = nullptr;
     m_runningFilter = nullptr;
     m_watchdog = nullptr;
+    m_timedOut = false;
     m_filterCallback.ResetCallbackLog();
 }
 
@@ -119,6 +120,7 @@ int mc_FilterEngine::RunFilter(const mc_Filter *filter, std::string &strResult,
 
     m_filterCallback.ResetCallbackLog();
     m_filterCallback.SetCreateCallbackLog(createCallbackLog);
+    m_timedOut = false;
     auto v8engine = static_cast<mc_v8::V8Engine *>(m_Impl);
     auto v8filter = static_cast<mc_v8::V8Filter *>(filter->m_Impl);
     SetRunningFilter(filter);
@@ -146,12 +148,32 @@ void mc_FilterEngine::TerminateFilter(std::string reason)
         LogPrint("v8filter", "v8filter: mc_FilterEngine::TerminateFilter\n");
     if (m_runningFilter != nullptr)
     {
+        m_timedOut = true;
         auto v8engine = static_cast<mc_v8::V8Engine *>(m_Impl);
         auto v8filter = static_cast<mc_v8::V8Filter *>(m_runningFilter->m_Impl);
         v8engine->TerminateFilter(v8filter, reason);
     }
 }
 
+void mc_FilterEngine::ResetCallbackCache()
+{
+    m_filterCallback.ResetResultCache();
+}
+
+size_t mc_FilterEngine::HeapUsed()
+{
+    if (m_Impl == nullptr)
+    {
+        return 0;
+    }
+    auto v8engine = static_cast<mc_v8::V8Engine *>(m_Impl);
+    v8::Isolate *isolate = v8engine->GetIsolate();
+    v8::Locker locker(isolate);
+    v8::HeapStatistics heapStatistics;
+    isolate->GetHeapStatistics(&heapStatistics);
+    return heapStatistics.used_heap_size();
+}
+
 void mc_FilterEngine::SetRunningFilter(const mc_Filter *filter)
 {
     m_runningFilter = filter;
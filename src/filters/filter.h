@@ -6,6 +6,7 @@
 
 #include "filters/filtercallback.h"
 #include "json/json_spirit.h"
+#include <atomic>
 
 class mc_FilterEngine;
 class Watchdog;
@@ -142,9 +143,29 @@ class mc_FilterEngine
      */
     void TerminateFilter(std::string reason);
 
+    /**
+     * Discard callback results cached for the previously filtered transaction.
+     */
+    void ResetCallbackCache();
+
+    /**
+     * Check if the last filter run was aborted by the watchdog.
+     */
+    bool TimedOut() const
+    {
+        return m_timedOut;
+    }
+
+    /**
+     * Get the size of the used V8 heap, in bytes, 0 if not available.
+     */
+    size_t HeapUsed();
+
   private:
     void *m_Impl;
     const mc_Filter *m_runningFilter;
+    // Set by the watchdog thread
+    std::atomic<bool> m_timedOut;
     Watchdog *m_watchdog;
     FilterCallback m_filterCallback;
 
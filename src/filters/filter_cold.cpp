@@ -25,6 +25,7 @@ int mc_Filter::Initialize(std::string &strResult)
 void mc_FilterEngine::Zero()
 {
     m_Impl = nullptr;
+    m_timedOut = false;
 }
 
 int mc_FilterEngine::Destroy()
@@ -69,3 +70,12 @@ int mc_FilterEngine::RunFilterWithCallbackLog(const mc_Filter *, std::string &st
 void mc_FilterEngine::TerminateFilter(std::string)
 {
 }
+
+void mc_FilterEngine::ResetCallbackCache()
+{
+}
+
+size_t mc_FilterEngine::HeapUsed()
+{
+    return 0;
+}
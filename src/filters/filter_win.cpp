@@ -56,6 +56,7 @@ void mc_FilterEngine::Zero()
     m_Impl = nullptr;
     m_runningFilter = nullptr;
     m_watchdog = nullptr;
+    m_timedOut = false;
     m_filterCallback.ResetCallbackLog();
 }
 
@@ -162,6 +163,7 @@ int mc_FilterEngine::RunFilter(const mc_Filter *filter, std::string &strResult,
 
     m_filterCallback.ResetCallbackLog();
     m_filterCallback.SetCreateCallbackLog(createCallbackLog);
+    m_timedOut = false;
     auto v8engine = static_cast<V8Engine_t *>(m_Impl);
     auto v8filter = static_cast<V8Filter_t *>(filter->m_Impl);
     SetRunningFilter(filter);
@@ -191,12 +193,23 @@ void mc_FilterEngine::TerminateFilter(std::string reason)
         LogPrint("v8filter", "v8filter: mc_FilterEngine::TerminateFilter\n");
     if (m_runningFilter != nullptr)
     {
+        m_timedOut = true;
         auto v8engine = static_cast<V8Engine_t *>(m_Impl);
         auto v8filter = static_cast<V8Filter_t *>(m_runningFilter->m_Impl);
         V8Engine_TerminateFilter(v8engine, v8filter, reason.c_str());
     }
 }
 
+void mc_FilterEngine::ResetCallbackCache()
+{
+    m_filterCallback.ResetResultCache();
+}
+
+size_t mc_FilterEngine::HeapUsed()
+{
+    return 0;
+}
+
 void mc_FilterEngine::SetRunningFilter(const mc_Filter *filter)
 {
     m_runningFilter = filter;
@@ -2,6 +2,7 @@
 // MultiChain code distributed under the GPLv3 license, see COPYING file.
 
 #include "filters/filtercallback.h"
+#include "filters/multichainfilter.h"
 #include "rpc/rpcserver.h"
 #include "utils/util.h"
 #include "json/json_spirit_ubjson.h"
@@ -30,6 +31,68 @@ static std::map<std::string, rpcfn_type> FilterCallbackFunctions{
     CALLBACK_LOOKUP(verifymessage)
 };
 
+/**
+ * Callbacks whose result depends only on the filtered transaction (and filter params), and can be reused
+ * while the same transaction is being filtered.
+ */
+static std::set<std::string> FilterCachedCallbacks{
+    "getfiltertxid",
+    "getfiltertransaction",
+    "getfilterstreamitem",
+    "getfilterstream",
+    "getfilterassetbalances",
+    "getfiltertokenbalances",
+    "getfiltertxinput"
+};
+
+Value FilterCallback::CallFunction(string name, const Array &args)
+{
+    Value result;
+    string key;
+    bool cached = FilterCachedCallbacks.find(name) != FilterCachedCallbacks.end();
+
+    if (cached)
+    {
+        key = name;
+        if (args.size())
+        {
+            key += json_spirit::write(args);
+        }
+        std::map<std::string, Value>::const_iterator it = m_resultCache.find(key);
+        if (it != m_resultCache.end())
+        {
+            return it->second;
+        }
+    }
+
+    int64_t start = GetTimeMicros();
+    try
+    {
+        result = FilterCallbackFunctions[name](args, false);
+    }
+    catch (...)
+    {
+        if (pMultiChainFilterEngine)
+            pMultiChainFilterEngine->RecordCallback(name, GetTimeMicros() - start, false);
+        throw;
+    }
+    if (pMultiChainFilterEngine)
+        pMultiChainFilterEngine->RecordCallback(name, GetTimeMicros() - start, true);
+
+    if (cached)
+    {
+        m_resultCache.insert(make_pair(key, result));
+    }
+    else
+    {
+        if (name == "setfilterparam")
+        {
+            m_resultCache.clear();
+        }
+    }
+    return result;
+}
+
 #ifdef WIN32
 void FilterCallback::UbjCallback(const char *name, Blob_t* argsBlob, Blob_t* resultBlob)
 {
@@ -45,7 +108,7 @@ void FilterCallback::UbjCallback(const char *name, Blob_t* argsBlob, Blob_t* res
         LogPrint("v8filter", "v8filter: About to call native function\n");
     try
     {
-        jspResult = FilterCallbackFunctions[name](jspArgs, false);
+        jspResult = this->CallFunction(name, jspArgs);
         this->CreateCallbackLog(name, jspArgs, jspResult);
     }
     catch (Object &e)
@@ -76,7 +139,7 @@ void FilterCallback::JspCallback(string name, Array args, Value &result)
     result = Value::null;
     try
     {
-        result = FilterCallbackFunctions[name](args, false);
+        result = this->CallFunction(name, args);
         this->CreateCallbackLog(name, args, result);
     }
     catch (Object &e)
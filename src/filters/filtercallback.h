@@ -6,6 +6,7 @@
 
 #include "filters/ifiltercallback.h"
 #include "json/json_spirit.h"
+#include <map>
 
 /**
  * A filter callback object that can create a callback log for debugging.
@@ -43,6 +44,17 @@ class FilterCallback : public IFilterCallback
         m_callbackLog.clear();
     }
 
+    /**
+     * Clear the cached callback results.
+     *
+     * Results of callbacks which depend only on the filtered transaction are kept until the next transaction
+     * is passed to the filters, so that several filters (or several calls in one filter) share them.
+     */
+    void ResetResultCache()
+    {
+        m_resultCache.clear();
+    }
+
 #ifdef WIN32
     /**
      * Callback using UBJSON to pass arguments and a return value.
@@ -66,6 +78,9 @@ class FilterCallback : public IFilterCallback
   private:
     json_spirit::Array m_callbackLog;
     bool m_createCallbackLog = false;
+    std::map<std::string, json_spirit::Value> m_resultCache;
+
+    json_spirit::Value CallFunction(std::string name, const json_spirit::Array &args);
 
     void CreateCallbackLog(std::string name, json_spirit::Array args, json_spirit::Value result);
     void CreateCallbackLogError(std::string name, json_spirit::Array args, json_spirit::Object &e);
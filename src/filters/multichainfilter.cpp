@@ -247,6 +247,68 @@ bool mc_MultiChainFilter::HasRelevantEntity(set <uint160>& sRelevantEntities)
     return false;
 }
 
+void mc_MultiChainFilterStats::Zero()
+{
+    m_Caption="";
+    m_FilterType=MC_FLT_TYPE_TX;
+    m_Count=0;
+    m_Rejected=0;
+    m_Errors=0;
+    m_Timeouts=0;
+    m_TotalMicros=0;
+    m_MaxMicros=0;
+    m_LastHeapUsed=0;
+    m_MaxHeapUsed=0;
+    memset(m_Buckets,0,sizeof(m_Buckets));
+}
+
+void mc_MultiChainFilterStats::AddTime(int64_t micros)
+{
+    int bucket=0;
+    
+    if(micros < 0)
+    {
+        micros=0;
+    }
+    
+    m_Count++;
+    m_TotalMicros+=micros;
+    if(micros > m_MaxMicros)
+    {
+        m_MaxMicros=micros;
+    }
+    
+    while( (bucket < MC_FLT_STATS_BUCKETS-1) && ((micros >> (bucket+1)) != 0) )
+    {
+        bucket++;
+    }
+    m_Buckets[bucket]++;
+}
+
+int64_t mc_MultiChainFilterStats::Percentile(int percent)
+{
+    int64_t total,threshold;
+    
+    if(m_Count == 0)
+    {
+        return 0;
+    }
+    
+    threshold=(m_Count*percent+99)/100;
+    total=0;
+    for(int bucket=0;bucket<MC_FLT_STATS_BUCKETS;bucket++)
+    {
+        total+=m_Buckets[bucket];
+        if(total >= threshold)
+        {
+            int64_t upper=((int64_t)1 << (bucket+1))-1;                         // Upper bound of the bucket, not more than maximum
+            return (upper < m_MaxMicros) ? upper : m_MaxMicros;
+        }
+    }
+    
+    return m_MaxMicros;
+}
+
 int mc_MultiChainFilterEngine::Zero()
 {
     m_Filters.clear();
@@ -260,6 +322,7 @@ int mc_MultiChainFilterEngine::Zero()
     m_LockedBy=0;
     
     m_CoinsCache=NULL;
+    m_ReadSet=0;
         
     return MC_ERR_NOERROR;
 }
@@ -972,6 +1035,7 @@ int mc_MultiChainFilterEngine::RunStreamFilters(const CTransaction& tx,int vout,
     m_TxID=m_Tx.GetHash();    
     m_Vout=vout;
     m_Params.Init();
+    pFilterEngine->ResetCallbackCache();
     
     unsigned char *stream_entity_txid=mc_gState->m_Assets->CachedTxIDFromShortTxID(stream_short_txid); 
     
@@ -1007,7 +1071,9 @@ int mc_MultiChainFilterEngine::RunStreamFilters(const CTransaction& tx,int vout,
                 bool already_tried=false;
                 while(run_it)
                 {
+                    int64_t run_start=GetTimeMicros();
                     err=pFilterEngine->RunFilter(worker,strResult);
+                    RecordFilterRun(&(m_Filters[i]),pFilterEngine,GetTimeMicros()-run_start,err,strResult);
                     if(err)
                     {
                         LogPrintf("Error while running filter %s, error: %d\n",m_Filters[i].m_FilterCaption.c_str(),err);
@@ -1057,6 +1123,111 @@ exitlbl:
     return err;    
 }
 
+void mc_MultiChainFilterEngine::RecordFilterRun(mc_MultiChainFilter *filter,mc_FilterEngine *engine,int64_t micros,int err,const string &strResult)
+{
+    bool timed_out=engine->TimedOut();
+    int64_t heap_used=engine->HeapUsed();
+    uint256 txid=*(uint256*)(filter->m_Details.GetTxID());
+    
+    if(fDebug)LogPrint("filter","filter: %s: run time %.3fms, heap %ldKB%s\n",filter->m_FilterCaption.c_str(),0.001*micros,heap_used/1024,
+            timed_out ? ", timeout" : (strResult.size() ? ", rejected" : ""));
+    
+    boost::mutex::scoped_lock lock(m_StatsMutex);
+    
+    map<uint256,mc_MultiChainFilterStats>::iterator it=m_FilterStats.find(txid);
+    if(it == m_FilterStats.end())
+    {
+        it=m_FilterStats.insert(make_pair(txid,mc_MultiChainFilterStats())).first;
+    }
+    mc_MultiChainFilterStats *stats=&(it->second);
+    
+    stats->m_Caption=filter->m_FilterCaption;
+    stats->m_FilterType=filter->m_FilterType;
+    stats->AddTime(micros);
+    if(err)
+    {
+        stats->m_Errors++;
+    }
+    else
+    {
+        if(timed_out)
+        {
+            stats->m_Timeouts++;
+        }
+        else
+        {
+            if(strResult.size())
+            {
+                stats->m_Rejected++;
+            }
+        }
+    }
+    stats->m_LastHeapUsed=heap_used;
+    if(heap_used > stats->m_MaxHeapUsed)
+    {
+        stats->m_MaxHeapUsed=heap_used;
+    }
+}
+
+/**
+ * State read by the callback, used to decide whether tx filters should be rerun when mempool is replayed.
+ * Callbacks not listed here depend only on the filtered transaction.
+ */
+static uint32_t mc_FilterCallbackReadSet(const string &name)
+{
+    if(name == "getlastblockinfo")
+    {
+        return MC_FLT_READ_CHAIN;
+    }
+    if(name == "verifypermission")
+    {
+        return MC_FLT_READ_PERMISSIONS;
+    }
+    if( (name == "getassetinfo") || (name == "getstreaminfo") || (name == "listassetissues") ||
+        (name == "getvariableinfo") || (name == "getvariablevalue") || (name == "getvariablehistory") )
+    {
+        return MC_FLT_READ_ENTITIES;
+    }
+    return 0;
+}
+
+void mc_MultiChainFilterEngine::RecordCallback(const string &name,int64_t micros,bool success)
+{
+    m_ReadSet |= mc_FilterCallbackReadSet(name);
+    
+    boost::mutex::scoped_lock lock(m_StatsMutex);
+    
+    map<string,mc_MultiChainFilterStats>::iterator it=m_CallbackStats.find(name);
+    if(it == m_CallbackStats.end())
+    {
+        it=m_CallbackStats.insert(make_pair(name,mc_MultiChainFilterStats())).first;
+        it->second.m_Caption=name;
+    }
+    it->second.AddTime(micros);
+    if(!success)
+    {
+        it->second.m_Errors++;
+    }
+}
+
+uint32_t mc_MultiChainFilterEngine::TxFilterReadSet()
+{
+    return m_ReadSet;
+}
+
+void mc_MultiChainFilterEngine::GetStats(map<uint256,mc_MultiChainFilterStats> &filter_stats,map<string,mc_MultiChainFilterStats> &callback_stats,bool reset)
+{
+    boost::mutex::scoped_lock lock(m_StatsMutex);
+    
+    filter_stats=m_FilterStats;
+    callback_stats=m_CallbackStats;
+    if(reset)
+    {
+        m_FilterStats.clear();
+        m_CallbackStats.clear();
+    }
+}
+
 int mc_MultiChainFilterEngine::RunTxFilters(const CTransaction& tx,std::set <uint160>& sRelevantEntities,std::string &strResult,mc_MultiChainFilter **lppFilter,int *applied,bool only_once)
 {    
     Lock(0);
@@ -1067,6 +1238,8 @@ int mc_MultiChainFilterEngine::RunTxFilters(const CTransaction& tx,std::set <uin
     m_TxID=m_Tx.GetHash();
     m_Vout=-1;
     m_Params.Init();
+    m_ReadSet=0;
+    pFilterEngine->ResetCallbackCache();
     
     if(applied)
     {
@@ -1086,7 +1259,9 @@ int mc_MultiChainFilterEngine::RunTxFilters(const CTransaction& tx,std::set <uin
                     bool run_it=true;
                     while(run_it)
                     {
+                        int64_t run_start=GetTimeMicros();
                         err=pFilterEngine->RunFilter(worker,strResult);
+                        RecordFilterRun(&(m_Filters[i]),pFilterEngine,GetTimeMicros()-run_start,err,strResult);
                         if(err)
                         {
                             LogPrintf("Error while running filter %s, error: %d\n",m_Filters[i].m_FilterCaption.c_str(),err);
@@ -1146,6 +1321,7 @@ int mc_MultiChainFilterEngine::RunFilter(const CTransaction& tx,mc_Filter *filte
     m_Tx=tx;
     m_TxID=m_Tx.GetHash();
     m_Params.Init();
+    pFilterEngine->ResetCallbackCache();
     
     err=pFilterEngine->RunFilter(filter,strResult);
     
@@ -1163,6 +1339,7 @@ int mc_MultiChainFilterEngine::RunFilterWithCallbackLog(const CTransaction& tx,i
     m_TxID=m_Tx.GetHash();
     m_EntityTxID=stream_txid;
     m_Params.Init();
+    pFilterEngine->ResetCallbackCache();
     m_Vout=vout;
 
     err=pFilterEngine->RunFilterWithCallbackLog(filter,strResult, &callbacks);
@@ -12,6 +12,8 @@
 #include "json/json_spirit_value.h"
 //#include "filters/filter.h"
 
+#include <boost/thread/mutex.hpp>
+
 #define MC_FLT_TYPE_BAD                    0xFFFFFFFF
 #define MC_FLT_TYPE_TX                     0
 #define MC_FLT_TYPE_STREAM                 1
@@ -22,9 +24,16 @@
 
 #define MC_FLT_LIBRARY_GLUE                "\n\n"
 
+#define MC_FLT_STATS_BUCKETS               40
+
+#define MC_FLT_READ_CHAIN                  0x00000001                           // Callback result depends on the chain tip
+#define MC_FLT_READ_PERMISSIONS            0x00000002                           // Callback reads permissions
+#define MC_FLT_READ_ENTITIES               0x00000004                           // Callback reads asset, stream or variable state
+
 std::vector <uint160>  mc_FillRelevantFilterEntitities(const unsigned char *ptr, size_t value_size);
 
 class mc_Filter;
+class mc_FilterEngine;
 
 typedef struct mc_MultiChainFilter
 {
@@ -110,6 +119,31 @@ typedef struct mc_MultiChainFilterParams
     int Close();
 }mc_MultiChainFilterParams;
 
+typedef struct mc_MultiChainFilterStats
+{
+    std::string m_Caption;
+    uint32_t m_FilterType;
+    int64_t m_Count;
+    int64_t m_Rejected;                                                         // Filters - rejected txs
+    int64_t m_Errors;                                                           // Filters - failed runs, callbacks - errors
+    int64_t m_Timeouts;
+    int64_t m_TotalMicros;
+    int64_t m_MaxMicros;
+    int64_t m_LastHeapUsed;
+    int64_t m_MaxHeapUsed;
+    int64_t m_Buckets[MC_FLT_STATS_BUCKETS];                                    // Bucket i - runs taking [2^i,2^(i+1)) microseconds
+    
+    mc_MultiChainFilterStats()
+    {
+        Zero();
+    }
+    
+    void Zero();
+    void AddTime(int64_t micros);
+    int64_t Percentile(int percent);
+    
+} mc_MultiChainFilterStats;
+
 typedef struct mc_MultiChainFilterEngine
 {
     std::vector <mc_MultiChainFilter> m_Filters;
@@ -124,10 +158,15 @@ typedef struct mc_MultiChainFilterEngine
     int m_Vout;
     mc_MultiChainFilterParams m_Params;
     void *m_CoinsCache;
+    uint32_t m_ReadSet;                                                         // MC_FLT_READ_ flags of callbacks called by filters since last RunTxFilters
     
     void *m_Semaphore;
     uint64_t m_LockedBy;
     
+    std::map<uint256,mc_MultiChainFilterStats> m_FilterStats;                   // By filter txid
+    std::map<std::string,mc_MultiChainFilterStats> m_CallbackStats;             // By callback name
+    boost::mutex m_StatsMutex;
+    
     mc_MultiChainFilterEngine()
     {
         Zero();
@@ -155,6 +194,10 @@ typedef struct mc_MultiChainFilterEngine
     int CheckLibraries(std::set <uint160>* lpAffectedLibraries,int for_block);
     int RebuildFilter(int row,int for_block);
     mc_Filter *StreamFilterWorker(int row,bool *modified);
+    void RecordFilterRun(mc_MultiChainFilter *filter,mc_FilterEngine *engine,int64_t micros,int err,const std::string &strResult);
+    void RecordCallback(const std::string &name,int64_t micros,bool success);
+    uint32_t TxFilterReadSet();
+    void GetStats(std::map<uint256,mc_MultiChainFilterStats> &filter_stats,std::map<std::string,mc_MultiChainFilterStats> &callback_stats,bool reset);
     
     int InFilter();
     int Zero();
@@ -503,6 +503,11 @@ void CNode::CloseSocketDisconnect()
         if (lockTxDataRecv)
             vRecvDataMsg.clear();
     }
+    {
+        TRY_LOCK(cs_vRecvRelayMsg, lockRelayRecv);
+        if (lockRelayRecv)
+            vRecvRelayMsg.clear();
+    }
 }
 
 void CNode::PushVersion()
@@ -675,6 +680,16 @@ size_t CNode::TotalBuffersSize()
             it++;
         }                
     }
+    {
+        LOCK(cs_vRecvRelayMsg);
+        total+=vRecvRelayMsg.size()*sizeof(CNetMessage);
+        std::deque<CNetMessage>::iterator it = vRecvRelayMsg.begin();
+        while (it != vRecvRelayMsg.end()) 
+        {
+            total+=it->vRecv.size();
+            it++;
+        }                
+    }
     {
         LOCK(cs_sTxsInFlight);
         total+=sTxsInFlight.size()*sizeof(uint256);
@@ -2247,6 +2262,104 @@ void ThreadTxDataMessageHandler()
     }
 }
 
+/**
+ * Relay (offchain) messages are processed by a pool of workers. Each peer has
+ * its own queue, filled by ThreadMessageHandler. A worker claims a peer by 
+ * taking its cs_RelayMsgWorker lock, so messages of one peer are processed in
+ * order, while different peers are processed in parallel. Workers start their
+ * scan at different peers and skip peers already claimed by other workers, 
+ * so busy peers are picked up by idle workers. 
+ */
+
+static boost::mutex csRelayMessageHandlers;
+static boost::condition_variable cvRelayMessageHandlers;
+
+#define MC_RMH_MAX_BATCH_SIZE       16
+
+void NotifyRelayMessageHandlers()
+{
+    cvRelayMessageHandlers.notify_one();
+}
+
+void ThreadRelayMessageHandler()
+{
+    SetThreadPriority(THREAD_PRIORITY_BELOW_NORMAL);
+    while (true)
+    {
+        boost::this_thread::interruption_point();
+        vector<CNode*> vNodesCopy;
+        {
+            LOCK(cs_vNodes);
+            vNodesCopy = vNodes;
+            BOOST_FOREACH(CNode* pnode, vNodesCopy) {
+                pnode->AddRef();
+            }
+        }
+
+        bool fSleep = true;
+        int nodes=(int)vNodesCopy.size();
+        int start=(nodes > 0) ? (int)(GetRand(nodes)) : 0;
+
+        for(int n=0;n<nodes;n++)
+        {
+            CNode* pnode=vNodesCopy[(start+n) % nodes];
+            if (pnode->fDisconnect)
+                continue;
+
+            TRY_LOCK(pnode->cs_RelayMsgWorker, lockWorker);
+            if(!lockWorker)                                                     // Other worker is processing this peer
+            {
+                continue;
+            }
+            
+            std::deque<CNetMessage> vBatch;
+            {
+                LOCK(pnode->cs_vRecvRelayMsg);
+                while(!pnode->vRecvRelayMsg.empty() && (vBatch.size() < MC_RMH_MAX_BATCH_SIZE))
+                {
+                    vBatch.push_back(std::move(pnode->vRecvRelayMsg.front()));
+                    pnode->vRecvRelayMsg.pop_front();
+                }
+                if (!pnode->vRecvRelayMsg.empty())
+                {
+                    fSleep = false;
+                }
+            }
+            
+            while(!vBatch.empty() && !pnode->fDisconnect)
+            {
+                if(!g_signals.ProcessDataMessage(pnode,vBatch.front()))         // Send buffer is full, retry later
+                {
+                    LOCK(pnode->cs_vRecvRelayMsg);
+                    while(!vBatch.empty())
+                    {
+                        pnode->vRecvRelayMsg.push_front(std::move(vBatch.back()));
+                        vBatch.pop_back();
+                    }
+                    break;
+                }
+                vBatch.pop_front();
+                boost::this_thread::interruption_point();
+            }
+        }
+
+        boost::this_thread::interruption_point();
+        
+        {
+            LOCK(cs_vNodes);
+            BOOST_FOREACH(CNode* pnode, vNodesCopy)
+                pnode->Release();
+        }
+
+        boost::this_thread::interruption_point();
+        
+        if (fSleep)
+        {
+            boost::unique_lock<boost::mutex> lock(csRelayMessageHandlers);
+            cvRelayMessageHandlers.timed_wait(lock,boost::posix_time::milliseconds(100));
+        }
+    }
+}
 
 void ThreadGetDataMessageHandler()
 {
@@ -2522,6 +2635,14 @@ void StartNode(boost::thread_group& threadGroup)
             threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "tmsghand", &ThreadTxDataMessageHandler));
         }
     }
+    if(nMessageHandlerThreads & MC_MHT_PROCESSRELAY)
+    {
+        // Process offchain relay messages
+        for(int i=0;i<nRelayMessageHandlerThreads;i++)
+        {
+            threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "rmsghand", &ThreadRelayMessageHandler));
+        }
+    }
     // Dump network addresses
     threadGroup.create_thread(boost::bind(&LoopForever<void (*)()>, "dumpaddr", &DumpAddresses, DUMP_ADDRESSES_INTERVAL * 1000));
 }
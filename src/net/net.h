@@ -77,6 +77,7 @@ void MapPort(bool fUseUPnP);
 unsigned short GetListenPort();
 bool BindListenPort(const CService &bindAddr, std::string& strError, bool fWhitelisted = false);
 void StartNode(boost::thread_group& threadGroup);
+void NotifyRelayMessageHandlers();
 bool StopNode();
 void SocketSendData(CNode *pnode);
 int mc_QuerySeed(boost::thread_group& threadGroup,const char *seedAddr);
@@ -255,6 +256,9 @@ public:
     CCriticalSection cs_vRecvDataMsg;
     std::deque<CNetMessage> vRecvTxDataMsg;
     CCriticalSection cs_vRecvTxDataMsg;
+    std::deque<CNetMessage> vRecvRelayMsg;
+    CCriticalSection cs_vRecvRelayMsg;
+    CCriticalSection cs_RelayMsgWorker;
     std::set<uint256> sTxsInFlight;
     CCriticalSection cs_sTxsInFlight;
     
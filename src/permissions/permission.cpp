@@ -7,6 +7,22 @@ unsigned char null_entity[MC_PLS_SIZE_ENTITY];
 unsigned char upgrade_entity[MC_PLS_SIZE_ENTITY];
 unsigned char adminminerlist_entity[MC_PLS_SIZE_ENTITY];
 
+/** 
+ * Per-thread state of mc_Permissions object: rollback position and lock ownership. It is never accessed by other 
+ * threads, so lock-free readers can check it without the lock. Keyed by instance ID rather than by address, so 
+ * object created later at the same address doesn't see stale state.
+ */
+
+typedef struct mc_PermissionThreadState
+{
+    mc_RollBackPos m_RollBackPos;
+    int m_RollBackPosSet;
+    int m_Locked;
+} mc_PermissionThreadState;
+
+static thread_local std::map<uint64_t,mc_PermissionThreadState> mc_PRMThreadStates;
+static volatile uint64_t mc_PRMLastInstanceID=0;
+
 int mc_IsNullEntity(const void* lpEntity)
 {
     if(lpEntity == NULL)
@@ -77,6 +93,304 @@ void mc_PermissionDetails::Zero()
     memset(this,0,sizeof(mc_PermissionDetails));    
 }
 
+void mc_PermissionQuery::Zero()
+{
+    memset(this,0,sizeof(mc_PermissionQuery));
+}
+
+int mc_ComparePermissionDBKeys(const void *row1,const void *row2)
+{
+    return memcmp(row1,row2,MC_PLS_SIZE_ENTITY+MC_PLS_SIZE_ADDRESS+4);
+}
+
+void mc_PermissionSnapshot::Zero()
+{
+    m_DBSnapshot=NULL;
+    m_SegmentCount=0;
+    m_CheckForMempoolFlag=0;
+    m_Block=-1;
+    m_CopiedRow=0;
+    m_CacheVersion=0;
+    m_NextRetired=NULL;
+    m_RetiredEpoch=0;
+}
+
+/** Setting initial values of the permission row cache */
+
+int mc_PermissionCache::Zero()
+{
+    m_Rows=NULL;
+    m_Size=0;
+    m_Version=0;
+    m_Hits=0;
+    m_Misses=0;
+    m_Inserts=0;
+    m_Evictions=0;
+    m_Invalidations=0;
+    m_Resets=0;
+    
+    return MC_ERR_NOERROR;
+}
+
+/** Allocates cache slots, size is rounded up to power of 2 */
+
+int mc_PermissionCache::Initialize(int size)
+{
+    uint32_t slots;
+    
+    Destroy();
+    
+    if(size <= 0)
+    {
+        return MC_ERR_NOERROR;
+    }
+    
+    slots=1;
+    while( (slots < (uint32_t)size) && (slots < 0x01000000) )
+    {
+        slots <<= 1;
+    }
+    
+    m_Rows=(mc_PermissionCacheRow*)mc_New(slots*sizeof(mc_PermissionCacheRow));
+    if(m_Rows == NULL)
+    {
+        return MC_ERR_ALLOCATION;
+    }
+    memset(m_Rows,0,slots*sizeof(mc_PermissionCacheRow));
+    m_Size=slots;
+    
+    return MC_ERR_NOERROR;
+}
+
+int mc_PermissionCache::Destroy()
+{
+    if(m_Rows)
+    {
+        mc_Delete(m_Rows);
+    }
+    
+    return Zero();
+}
+
+/** Rows modified outside of block commit (block info, admin/miner lists, upgrades, ledger header) are never cached */
+
+int mc_PermissionCache::IsCacheable(const mc_PermissionDBRow *key)
+{
+    if(key->m_Type == MC_PTP_NONE)
+    {
+        return 0;
+    }
+    if(key->m_Type & (MC_PTP_UPGRADE | MC_PTP_BLOCK_MINER | MC_PTP_BLOCK_INDEX))
+    {
+        return 0;
+    }
+    if( (memcmp(key->m_Entity,upgrade_entity,MC_PLS_SIZE_ENTITY) == 0) ||
+        (memcmp(key->m_Entity,adminminerlist_entity,MC_PLS_SIZE_ENTITY) == 0) )
+    {
+        return 0;
+    }
+    return 1;
+}
+
+uint32_t mc_PermissionCache::Slot(const mc_PermissionDBRow *key)
+{
+    uint32_t hash;
+    int i;
+    const unsigned char *ptr;
+    
+    hash=2166136261U;                                                           // FNV-1a over entity, address and type
+    ptr=(const unsigned char*)key;
+    for(i=0;i<MC_PLS_SIZE_ENTITY+MC_PLS_SIZE_ADDRESS+4;i++)
+    {
+        hash ^= ptr[i];
+        hash *= 16777619U;
+    }
+    
+    return hash & (m_Size-1);
+}
+
+/** Takes exclusive access to the slot, returns 0 if slot is busy */
+
+int mc_PermissionCache::LockSlot(mc_PermissionCacheRow *slot)
+{
+    uint32_t sequence;
+    
+    sequence=slot->m_Sequence;
+    if(sequence & 1)
+    {
+        return 0;
+    }
+    if(__sync_bool_compare_and_swap(&(slot->m_Sequence),sequence,sequence+1) == 0)
+    {
+        return 0;
+    }
+    __sync_synchronize();
+    return 1;
+}
+
+void mc_PermissionCache::UnLockSlot(mc_PermissionCacheRow *slot,uint32_t sequence)
+{
+    __sync_synchronize();
+    slot->m_Sequence=sequence+1;
+}
+
+/** Looks up row by key. Row is returned only if it was cached at version not newer than the version of the reader.
+ *  Returns 0 on cache miss, MC_PCF_VALID if row is known to be absent, MC_PCF_VALID | MC_PCF_FOUND if row is returned */
+
+int mc_PermissionCache::Get(const mc_PermissionDBRow *key,uint64_t version,mc_PermissionDBRow *row)
+{
+    mc_PermissionCacheRow *slot;
+    mc_PermissionDBRow cached_row;
+    uint32_t sequence,flags;
+    uint64_t row_version;
+    
+    if(m_Size == 0)
+    {
+        return 0;
+    }
+    
+    if(IsCacheable(key) == 0)
+    {
+        return 0;
+    }
+    
+    slot=m_Rows+Slot(key);
+    
+    sequence=slot->m_Sequence;
+    __sync_synchronize();
+    if(sequence & 1)
+    {
+        __sync_fetch_and_add(&m_Misses,1);
+        return 0;
+    }
+    
+    flags=slot->m_Flags;
+    row_version=slot->m_Version;
+    memcpy(&cached_row,&(slot->m_Row),sizeof(mc_PermissionDBRow));
+    
+    __sync_synchronize();
+    if(slot->m_Sequence != sequence)                                            // Slot was modified while copying
+    {
+        flags=MC_PCF_NONE;
+    }
+    
+    if( (flags & MC_PCF_VALID) == 0 || 
+        (row_version > version) ||
+        (memcmp(&cached_row,key,MC_PLS_SIZE_ENTITY+MC_PLS_SIZE_ADDRESS+4) != 0) )
+    {
+        __sync_fetch_and_add(&m_Misses,1);
+        return 0;
+    }
+    
+    memcpy(row,&cached_row,sizeof(mc_PermissionDBRow));
+    __sync_fetch_and_add(&m_Hits,1);
+    return flags;
+}
+
+/** Stores row read from database at specified version. Ignored if database was modified since */
+
+void mc_PermissionCache::Put(const mc_PermissionDBRow *row,int found,uint64_t version)
+{
+    mc_PermissionCacheRow *slot;
+    uint32_t sequence;
+    
+    if(m_Size == 0)
+    {
+        return;
+    }
+    
+    if(IsCacheable(row) == 0)
+    {
+        return;
+    }
+    
+    slot=m_Rows+Slot(row);
+    
+    if(LockSlot(slot) == 0)
+    {
+        return;
+    }
+    sequence=slot->m_Sequence;
+    
+    if(m_Version == version)                                                    // Version may be bumped by commit while slot is locked, but then  
+    {                                                                           // invalidation of this key waits for the slot
+        if(slot->m_Flags & MC_PCF_VALID)
+        {
+            if(memcmp(&(slot->m_Row),row,MC_PLS_SIZE_ENTITY+MC_PLS_SIZE_ADDRESS+4))
+            {
+                __sync_fetch_and_add(&m_Evictions,1);
+            }
+        }
+        memcpy(&(slot->m_Row),row,sizeof(mc_PermissionDBRow));
+        if(found == 0)
+        {
+            memset((unsigned char*)&(slot->m_Row)+MC_PLS_SIZE_ENTITY+MC_PLS_SIZE_ADDRESS+4,0,
+                   sizeof(mc_PermissionDBRow)-(MC_PLS_SIZE_ENTITY+MC_PLS_SIZE_ADDRESS+4));
+        }
+        slot->m_Version=version;
+        slot->m_Flags=MC_PCF_VALID | (found ? MC_PCF_FOUND : MC_PCF_NONE);
+        __sync_fetch_and_add(&m_Inserts,1);
+    }
+    
+    UnLockSlot(slot,sequence);
+}
+
+/** Removes key from the cache, should be called after m_Version is incremented */
+
+void mc_PermissionCache::Invalidate(const mc_PermissionDBRow *key)
+{
+    mc_PermissionCacheRow *slot;
+    uint32_t sequence;
+    
+    if(m_Size == 0)
+    {
+        return;
+    }
+    
+    slot=m_Rows+Slot(key);
+    
+    while(LockSlot(slot) == 0)
+    {
+        __US_Sleep(0);
+    }
+    sequence=slot->m_Sequence;
+    
+    if(slot->m_Flags & MC_PCF_VALID)
+    {
+        if(memcmp(&(slot->m_Row),key,MC_PLS_SIZE_ENTITY+MC_PLS_SIZE_ADDRESS+4) == 0)
+        {
+            slot->m_Flags=MC_PCF_NONE;
+            __sync_fetch_and_add(&m_Invalidations,1);
+        }
+    }
+    
+    UnLockSlot(slot,sequence);
+}
+
+/** Increments version and removes all rows from the cache */
+
+void mc_PermissionCache::Reset()
+{
+    uint32_t i,sequence;
+    mc_PermissionCacheRow *slot;
+    
+    __sync_fetch_and_add(&m_Version,1);
+    
+    for(i=0;i<m_Size;i++)
+    {
+        slot=m_Rows+i;
+        while(LockSlot(slot) == 0)
+        {
+            __US_Sleep(0);
+        }
+        sequence=slot->m_Sequence;
+        slot->m_Flags=MC_PCF_NONE;
+        UnLockSlot(slot,sequence);
+    }
+    
+    __sync_fetch_and_add(&m_Resets,1);
+}
+
 
 /** Set initial database object values */
 
@@ -270,6 +584,7 @@ int mc_Permissions::Zero()
     m_Row=0;
     m_AdminCount=0;
     m_MinerCount=0;
+    m_StateVersion=0;
 //    m_DBRowCount=0;            
     m_CheckPointRow=0;
     m_CheckPointAdminCount=0;
@@ -288,13 +603,25 @@ int mc_Permissions::Zero()
 
     m_Semaphore=NULL;
     m_LockedBy=0;
+    m_LockedForWrite=0;
+    
+    m_Snapshot=NULL;
+    m_RetiredSnapshots=NULL;
+    m_SnapshotReaders[0]=0;
+    m_SnapshotReaders[1]=0;
+    m_SnapshotEpoch=0;
+    m_SnapshotDirty=0;
+    m_SnapshotValidRows=0;
+    memset(m_LockedState,0,sizeof(m_LockedState));
+    
+    m_Cache=NULL;
     
     m_MempoolPermissions=NULL;
     m_MempoolPermissionsToReplay=NULL;
     m_MempoolTxIDs=NULL;
     m_CheckForMempoolFlag=0;
     
-    m_ThreadRollBackPos=NULL;
+    m_InstanceID=0;
     
     return MC_ERR_NOERROR;
 }
@@ -494,15 +821,7 @@ int mc_Permissions::Initialize(const char *name,int mode)
     m_Block=pdbBlock;
     m_Row=pdbLastRow;            
 
-    m_ThreadRollBackPos=new mc_Buffer;
-    m_ThreadRollBackPos->Initialize(sizeof(uint64_t),sizeof(mc_RollBackPos)+sizeof(uint64_t),MC_BUF_MODE_MAP);    
-    m_ThreadRollBackPos->Realloc(MC_PRM_MAX_THREADS);
-
-    for(int mprow=0;mprow<MC_PRM_MAX_THREADS;mprow++)
-    {
-        mc_RollBackPos *rollback_pos=(mc_RollBackPos*)(m_ThreadRollBackPos->GetRow(mprow)+sizeof(uint64_t));    
-        rollback_pos->Zero();
-    }
+    m_InstanceID=__sync_add_and_fetch(&mc_PRMLastInstanceID,1);
     
     err=UpdateCounts();
     if(err)
@@ -549,6 +868,20 @@ int mc_Permissions::Initialize(const char *name,int mode)
         return MC_ERR_INTERNAL_ERROR;
     }
 
+    m_Cache=new mc_PermissionCache;
+    err=m_Cache->Initialize((int)mc_gState->m_Params->GetOption("-permissioncachesize",MC_PLS_DEFAULT_CACHE_SIZE));
+    if(err)
+    {
+        LogString("Initialize: Cannot allocate permission cache");
+        return err;
+    }
+    
+    err=PublishSnapshot();
+    if(err)
+    {
+        LogString("Initialize: Cannot create permission snapshot");
+        return err;
+    }
     
     sprintf(msg,"Initialized: Admin count: %d, Miner count: %d, ledger rows: %ld",m_AdminCount,m_MinerCount,m_Row);
     LogString(msg);
@@ -557,14 +890,13 @@ int mc_Permissions::Initialize(const char *name,int mode)
 
 mc_RollBackPos *mc_Permissions::GetRollBackPos()
 {
-    uint64_t thread_id=__US_ThreadID();
-    int mprow=m_ThreadRollBackPos->Seek(&thread_id);
-    if(mprow < 0)
+    std::map<uint64_t,mc_PermissionThreadState>::iterator it=mc_PRMThreadStates.find(m_InstanceID);
+    if( (it == mc_PRMThreadStates.end()) || (it->second.m_RollBackPosSet == 0) )
     {
         return NULL;
     }
     
-    return (mc_RollBackPos*)(m_ThreadRollBackPos->GetRow(mprow)+sizeof(uint64_t));        
+    return &(it->second.m_RollBackPos);
 }
 
 
@@ -657,6 +989,19 @@ int mc_Permissions::Destroy()
         __US_SemDestroy(m_Semaphore);
     }
     
+    if(m_Snapshot)
+    {
+        FreeSnapshot(m_Snapshot);
+        m_Snapshot=NULL;
+    }
+    
+    ReclaimSnapshots(1);
+    
+    if(m_Cache)
+    {
+        delete m_Cache;
+    }
+    
     if(m_Database)
     {
         if(removefiles)
@@ -685,62 +1030,449 @@ int mc_Permissions::Destroy()
     }  
     if(m_TmpPool)
     {
-        delete m_TmpPool;
-    }  
-    if(m_CopiedMemPool)
+        delete m_TmpPool;
+    }  
+    if(m_CopiedMemPool)
+    {
+        delete m_CopiedMemPool;        
+    }
+
+    if(m_MempoolPermissions)
+    {
+        delete m_MempoolPermissions;
+    }
+    
+    if(m_MempoolPermissionsToReplay)
+    {
+        delete m_MempoolPermissionsToReplay;
+    }
+    
+    if(m_MempoolTxIDs)
+    {
+        delete m_MempoolTxIDs;        
+    }
+    
+    mc_PRMThreadStates.erase(m_InstanceID);
+    
+    Zero();
+    
+    return MC_ERR_NOERROR;
+}
+  
+/** Locking permissions object */
+
+void mc_Permissions::Lock(int write_mode)
+{        
+    uint64_t this_thread;
+    this_thread=__US_ThreadID();
+    
+    if(this_thread == m_LockedBy)
+    {
+        LogString("Secondary lock!!!");
+        return;
+    }
+    
+    __US_SemWait(m_Semaphore); 
+    m_LockedBy=this_thread;
+    m_LockedForWrite=write_mode;
+    mc_PRMThreadStates[m_InstanceID].m_Locked=1;
+    if(m_LockedForWrite)
+    {
+        GetSnapshotState(m_LockedState);
+    }
+}
+
+/** Unlocking permissions object, published snapshot becomes stale if state was changed */
+
+void mc_Permissions::UnLock()
+{    
+    uint64_t state[MC_PLS_SNAPSHOT_STATE_SIZE];
+    
+    if(m_LockedForWrite)
+    {
+        GetSnapshotState(state);
+        if(memcmp(state,m_LockedState,sizeof(state)))                           // Checkpoints and lookups under write lock don't invalidate snapshot
+        {
+            m_SnapshotDirty=1;
+            __sync_synchronize();
+        }
+        m_LockedForWrite=0;
+    }
+    mc_PRMThreadStates[m_InstanceID].m_Locked=0;
+    m_LockedBy=0;
+    __US_SemPost(m_Semaphore);
+}
+
+/** 
+ * Values describing state visible to snapshot readers. Mempool rows are only appended or truncated/cleared, and
+ * bulk replacements change block or copied row, so count and ledger row are enough to detect mempool changes.
+ */
+
+void mc_Permissions::GetSnapshotState(uint64_t *state)
+{
+    state[0]=m_MemPool ? m_MemPool->GetCount() : 0;
+    state[1]=m_Row;
+    state[2]=(uint64_t)(int64_t)m_Block;
+    state[3]=m_CopiedRow;
+    state[4]=m_StateVersion;
+    state[5]=m_Cache ? m_Cache->m_Version : 0;
+    state[6]=m_CheckForMempoolFlag;
+}
+
+/** 
+ * Publishes snapshot of current state to lock-free readers, caller should hold the lock. 
+ * Mempool rows are shared with previous snapshot in immutable segments, only rows added since previous 
+ * snapshot are copied. New segment absorbs preceding segments which are not larger, so the number of segments
+ * stays small and every row is copied few times.
+ */
+
+int mc_Permissions::PublishSnapshot()
+{
+    int err,i,count,from,segment_count;
+    unsigned char *ptr;
+    mc_PermissionSnapshot *snapshot;
+    mc_PermissionSnapshot *old_snapshot;
+    mc_PermissionSnapshotSegment *segments[MC_PLS_SNAPSHOT_MAX_SEGMENTS];
+    mc_PermissionSnapshotSegment *segment;
+    
+    snapshot=new mc_PermissionSnapshot;
+    snapshot->Zero();
+    
+    snapshot->m_DBSnapshot=m_Database->m_DB->CreateSnapshot();
+    if(snapshot->m_DBSnapshot == NULL)
+    {
+        FreeSnapshot(snapshot);
+        LogString("PublishSnapshot: Cannot create database snapshot");
+        return MC_ERR_DBOPEN_ERROR;
+    }
+    
+    count=m_MemPool->GetCount();
+    if(m_SnapshotValidRows > count)
+    {
+        m_SnapshotValidRows=count;
+    }
+    
+    from=0;
+    segment_count=0;
+    if(m_Snapshot)
+    {
+        for(i=0;i<m_Snapshot->m_SegmentCount;i++)
+        {
+            segment=m_Snapshot->m_Segments[i];
+            if(segment->m_To > m_SnapshotValidRows)
+            {
+                break;
+            }
+            segments[segment_count]=segment;
+            segment_count++;
+            from=segment->m_To;
+        }
+    }
+    
+    if(from < count)
+    {
+        while( (segment_count > 0) && 
+               ( (segment_count >= MC_PLS_SNAPSHOT_MAX_SEGMENTS) || 
+                 (segments[segment_count-1]->m_To-segments[segment_count-1]->m_From <= count-from) ) )
+        {
+            segment_count--;
+            from=segments[segment_count]->m_From;
+        }
+        
+        segment=new mc_PermissionSnapshotSegment;
+        segment->m_From=from;
+        segment->m_To=count;
+        segment->m_RefCount=0;
+        segment->m_MemPool=new mc_Buffer;
+        err=segment->m_MemPool->Initialize(m_Ledger->m_KeySize,m_Ledger->m_TotalSize,MC_BUF_MODE_MAP);
+        if(err == MC_ERR_NOERROR)
+        {
+            err=segment->m_MemPool->Realloc(count-from);
+        }
+        for(i=from;(i<count) && (err == MC_ERR_NOERROR);i++)
+        {
+            ptr=m_MemPool->GetRow(i);
+            err=segment->m_MemPool->Add(ptr,ptr+m_MemPool->m_KeySize);                    
+        }
+        if(err)
+        {
+            delete segment->m_MemPool;
+            delete segment;
+            FreeSnapshot(snapshot);
+            LogString("PublishSnapshot: Cannot copy mempool rows");
+            return err;
+        }
+        segments[segment_count]=segment;
+        segment_count++;
+    }
+    
+    for(i=0;i<segment_count;i++)
+    {
+        segments[i]->m_RefCount++;
+        snapshot->m_Segments[i]=segments[i];
+    }
+    snapshot->m_SegmentCount=segment_count;
+    m_SnapshotValidRows=count;
+    
+    snapshot->m_CheckForMempoolFlag=m_CheckForMempoolFlag;
+    snapshot->m_Block=m_Block;
+    snapshot->m_CopiedRow=m_CopiedRow;
+    snapshot->m_CacheVersion=m_Cache ? m_Cache->m_Version : 0;
+    
+    __sync_synchronize();
+    old_snapshot=__sync_lock_test_and_set(&m_Snapshot,snapshot);
+    __sync_synchronize();
+    
+    m_SnapshotDirty=0;
+    if(m_LockedForWrite)
+    {
+        GetSnapshotState(m_LockedState);                                        // State is captured, UnLock should not mark snapshot as stale
+    }
+    
+    if(old_snapshot)
+    {
+        old_snapshot->m_RetiredEpoch=m_SnapshotEpoch;
+        old_snapshot->m_NextRetired=m_RetiredSnapshots;
+        m_RetiredSnapshots=old_snapshot;
+    }
+    
+    ReclaimSnapshots(0);
+    
+    return MC_ERR_NOERROR;
+}
+
+/** 
+ * Frees retired snapshots which cannot be used by readers anymore, never waits. Readers register in the 
+ * counter of current epoch. Epoch is advanced only when readers of the previous epoch are gone, so
+ * snapshots retired two or more epochs ago are not visible to anyone. If all is set, frees all retired snapshots.
+ */
+
+void mc_Permissions::ReclaimSnapshots(int all)
+{
+    mc_PermissionSnapshot *snapshot;
+    mc_PermissionSnapshot **lpNext;
+    
+    if(m_RetiredSnapshots == NULL)
+    {
+        return;
+    }
+    
+    __sync_synchronize();
+    
+    if(m_SnapshotReaders[(m_SnapshotEpoch+1) & 1] == 0)
+    {
+        __sync_fetch_and_add(&m_SnapshotEpoch,1);
+    }
+    
+    lpNext=&m_RetiredSnapshots;
+    while(*lpNext)
+    {
+        snapshot=*lpNext;
+        if(all || (snapshot->m_RetiredEpoch+2 <= m_SnapshotEpoch))
+        {
+            *lpNext=snapshot->m_NextRetired;
+            FreeSnapshot(snapshot);
+        }
+        else
+        {
+            lpNext=&(snapshot->m_NextRetired);
+        }
+    }
+}
+
+void mc_Permissions::FreeSnapshot(mc_PermissionSnapshot *snapshot)
+{
+    if(snapshot->m_DBSnapshot)
+    {
+        if(m_Database && m_Database->m_DB)
+        {
+            m_Database->m_DB->ReleaseSnapshot(snapshot->m_DBSnapshot);
+        }
+    }
+    for(int i=0;i<snapshot->m_SegmentCount;i++)
+    {
+        snapshot->m_Segments[i]->m_RefCount--;
+        if(snapshot->m_Segments[i]->m_RefCount == 0)
+        {
+            delete snapshot->m_Segments[i]->m_MemPool;
+            delete snapshot->m_Segments[i];
+        }
+    }
+    delete snapshot;
+}
+
+/** Mempool rows were removed, rows above new count cannot be shared with published snapshot anymore */
+
+void mc_Permissions::MemPoolTruncated()
+{
+    if(m_SnapshotValidRows > m_MemPool->GetCount())
+    {
+        m_SnapshotValidRows=m_MemPool->GetCount();
+    }
+}
+
+/** Returns first permission from the list found in published snapshot, without taking the lock. 
+ *  Returns MC_ERR_NOT_SUPPORTED if the caller should use locked path */
+
+int mc_Permissions::GetSnapshotPermission(const void* lpEntity,const void* lpAddress,const uint32_t *types,int type_count,uint32_t *result)
+{
+    int i,err,checkmempool;
+    uint64_t epoch;
+    mc_PermissionSnapshot *snapshot;
+    mc_RollBackPos *rollback_pos;
+    
+    *result=0;
+    
+    std::map<uint64_t,mc_PermissionThreadState>::iterator it=mc_PRMThreadStates.find(m_InstanceID);
+    if( (it != mc_PRMThreadStates.end()) && it->second.m_Locked )               // Called from inside locked section
+    {
+        return MC_ERR_NOT_SUPPORTED;
+    }
+    
+    if(mc_IsUpgradeEntity(lpEntity))
+    {
+        return MC_ERR_NOT_SUPPORTED;                
+    }
+    
+    rollback_pos=GetRollBackPos();
+    if( (rollback_pos != NULL) && (rollback_pos->InBlock() != 0) )              // Ledger rewind is required
     {
-        delete m_CopiedMemPool;        
+        return MC_ERR_NOT_SUPPORTED;                        
     }
-
-    if(m_MempoolPermissions)
+    
+    if(m_SnapshotDirty)
     {
-        delete m_MempoolPermissions;
+        Lock(0);
+        if(m_SnapshotDirty)
+        {
+            PublishSnapshot();
+        }
+        UnLock();
     }
     
-    if(m_MempoolPermissionsToReplay)
+    err=MC_ERR_NOERROR;
+    
+    while(true)                                                                 // Registering in current epoch
     {
-        delete m_MempoolPermissionsToReplay;
+        epoch=m_SnapshotEpoch;
+        __sync_fetch_and_add(&m_SnapshotReaders[epoch & 1],1);
+        if(epoch == m_SnapshotEpoch)
+        {
+            break;
+        }
+        __sync_fetch_and_sub(&m_SnapshotReaders[epoch & 1],1);
     }
     
-    if(m_MempoolTxIDs)
+    snapshot=m_Snapshot;
+    if( (snapshot == NULL) || snapshot->m_CheckForMempoolFlag )
     {
-        delete m_MempoolTxIDs;        
+        err=MC_ERR_NOT_SUPPORTED;
     }
     
-    if(m_ThreadRollBackPos)
+    for(i=0;(i<type_count) && (err == MC_ERR_NOERROR) && (*result == 0);i++)
     {
-        delete m_ThreadRollBackPos;
-        m_ThreadRollBackPos=NULL;
+        if( (snapshot->m_CopiedRow > 0) && ( (types[i] == MC_PTP_ADMIN) || (types[i] == MC_PTP_MINE) || (types[i] == MC_PTP_BLOCK_MINER) ) )
+        {
+            err=MC_ERR_NOT_SUPPORTED;
+        }
+        else
+        {
+            checkmempool=1;
+            if( (rollback_pos != NULL) && (rollback_pos->InMempool() != 0) && (types[i] == MC_PTP_FILTER) )
+            {
+                checkmempool=0;
+            }
+            *result=GetSnapshotPermissionInternal(snapshot,lpEntity,lpAddress,types[i],checkmempool);
+        }
     }
     
-    Zero();
+    __sync_fetch_and_sub(&m_SnapshotReaders[epoch & 1],1);
     
-    return MC_ERR_NOERROR;
+    return err;
 }
-  
-/** Locking permissions object */
 
-void mc_Permissions::Lock(int write_mode)
-{        
-    uint64_t this_thread;
-    this_thread=__US_ThreadID();
+/** Returns permission value for key (entity,address,type) in snapshot, mirrors GetPermission for the case without ledger rewind */
+
+uint32_t mc_Permissions::GetSnapshotPermissionInternal(mc_PermissionSnapshot *snapshot,const void* lpEntity,const void* lpAddress,uint32_t type,int checkmempool)
+{
+    int err,i,value_len,mprow,cached;
+    mc_PermissionLedgerRow pldRow;
+    mc_PermissionLedgerRow row;
+    mc_PermissionDBRow pdbRow;
     
-    if(this_thread == m_LockedBy)
+    if(lpEntity == NULL)
     {
-        LogString("Secondary lock!!!");
-        return;
+        lpEntity=null_entity;
     }
     
-    __US_SemWait(m_Semaphore); 
-    m_LockedBy=this_thread;
-}
+    pdbRow.Zero();
+    memcpy(&pdbRow.m_Entity,lpEntity,MC_PLS_SIZE_ENTITY);
+    memcpy(&pdbRow.m_Address,lpAddress,MC_PLS_SIZE_ADDRESS);
+    pdbRow.m_Type=type;
+    
+    pldRow.Zero();
+    memcpy(&pldRow.m_Entity,lpEntity,MC_PLS_SIZE_ENTITY);
+    memcpy(&pldRow.m_Address,lpAddress,MC_PLS_SIZE_ADDRESS);
+    pldRow.m_Type=type;
 
-/** Unlocking permissions object */
+    memcpy(&row,&pldRow,sizeof(mc_PermissionLedgerRow));
+    
+    cached=m_Cache ? m_Cache->Get(&pdbRow,snapshot->m_CacheVersion,&pdbRow) : MC_PCF_NONE;
+    if(cached & MC_PCF_VALID)
+    {
+        value_len=(cached & MC_PCF_FOUND) ? m_Database->m_ValueSize : -1;
+    }
+    else
+    {
+        err=m_Database->m_DB->ReadToBuffer(snapshot->m_DBSnapshot,(char*)&pdbRow+m_Database->m_KeyOffset,m_Database->m_KeySize,
+                                           (char*)&pdbRow+m_Database->m_ValueOffset,m_Database->m_ValueSize,&value_len);
+        if(err)
+        {
+            LogString("GetSnapshotPermission: Cannot read from database");
+            return 0;
+        }
+        if(m_Cache)
+        {
+            m_Cache->Put(&pdbRow,(value_len >= 0) ? 1 : 0,snapshot->m_CacheVersion);
+        }
+    }
+    
+    if(value_len >= 0)
+    {
+        row.m_BlockFrom=pdbRow.m_BlockFrom;
+        row.m_BlockTo=pdbRow.m_BlockTo;
+        row.m_ThisRow=pdbRow.m_LedgerRow;
+        row.m_Flags=pdbRow.m_Flags;     
+        pldRow.m_PrevRow=pdbRow.m_LedgerRow;        
+    }
+    
+    if(checkmempool)
+    {
+        mprow=0;
+        while(mprow>=0)
+        {
+            mprow=-1;
+            for(i=0;(i<snapshot->m_SegmentCount) && (mprow<0);i++)              // Earliest row wins, as in single buffer
+            {
+                mprow=snapshot->m_Segments[i]->m_MemPool->Seek((unsigned char*)&pldRow+m_Ledger->m_KeyOffset);
+                if(mprow>=0)
+                {
+                    memcpy((unsigned char*)&row+m_Ledger->m_KeyOffset,snapshot->m_Segments[i]->m_MemPool->GetRow(mprow),m_Ledger->m_TotalSize);
+                    pldRow.m_PrevRow=row.m_ThisRow;
+                }
+            }
+        }
+    }
+    
+    if((uint32_t)(snapshot->m_Block+1) >= row.m_BlockFrom)
+    {
+        if((uint32_t)(snapshot->m_Block+1) < row.m_BlockTo)
+        {
+            return type;
+        }                                
+    }
 
-void mc_Permissions::UnLock()
-{    
-    m_LockedBy=0;
-    __US_SemPost(m_Semaphore);
+    return 0;
 }
 
 int mc_MemcmpCheckSize(const void *s1,const char *s2,size_t s1_size)
@@ -946,20 +1678,12 @@ int mc_RollBackPos::NotApplied()
 
 int mc_Permissions::SetRollBackPos(int block,int offset,int inmempool)
 {
-    mc_RollBackPos *rollback_pos=GetRollBackPos();
-    if(rollback_pos == NULL)
+    mc_PermissionThreadState *state=&(mc_PRMThreadStates[m_InstanceID]);
+    mc_RollBackPos *rollback_pos=&(state->m_RollBackPos);
+    if(state->m_RollBackPosSet == 0)
     {
-        Lock(1);
-        uint64_t thread_id=__US_ThreadID();
-        m_ThreadRollBackPos->Add(&thread_id,NULL);        
-        UnLock();        
-        rollback_pos=GetRollBackPos();
-        if(rollback_pos == NULL)
-        {
-            LogString("Couldn't create rollback object");
-            return MC_ERR_INTERNAL_ERROR;
-        }
         rollback_pos->Zero();
+        state->m_RollBackPosSet=1;
     }
     
     rollback_pos->m_Block=block;
@@ -1029,10 +1753,11 @@ uint32_t mc_Permissions::GetPermission(const void* lpEntity,const void* lpAddres
         return GetPermission(null_entity,lpAddress,type,row,checkmempool);
     }
     
-    int err,value_len,mprow;
+    int err,value_len,mprow,cached;
     uint32_t result;
     mc_PermissionLedgerRow pldRow;
     mc_PermissionDBRow pdbRow;
+    mc_PermissionDBRow pdbCachedRow;
     unsigned char *ptr;
 
     pdbRow.Zero();
@@ -1053,11 +1778,32 @@ uint32_t mc_Permissions::GetPermission(const void* lpEntity,const void* lpAddres
         return 0;
     }
                                                                                 
-    ptr=(unsigned char*)m_Database->m_DB->Read((char*)&pdbRow+m_Database->m_KeyOffset,m_Database->m_KeySize,&value_len,0,&err);
-    if(err)
+    cached=m_Cache ? m_Cache->Get(&pdbRow,m_Cache->m_Version,&pdbCachedRow) : MC_PCF_NONE;
+    if(cached & MC_PCF_VALID)
     {
-        LogString("GetPermission: Cannot read from database");
-        return 0;
+        ptr=(cached & MC_PCF_FOUND) ? (unsigned char*)&pdbCachedRow+m_Database->m_ValueOffset : NULL;
+    }
+    else
+    {
+        ptr=(unsigned char*)m_Database->m_DB->Read((char*)&pdbRow+m_Database->m_KeyOffset,m_Database->m_KeySize,&value_len,0,&err);
+        if(err)
+        {
+            LogString("GetPermission: Cannot read from database");
+            return 0;
+        }
+        if(m_Cache)
+        {
+            if(ptr)
+            {
+                memcpy((char*)&pdbCachedRow,(char*)&pdbRow,m_Database->m_ValueOffset);
+                memcpy((char*)&pdbCachedRow+m_Database->m_ValueOffset,ptr,m_Database->m_ValueSize);
+                m_Cache->Put(&pdbCachedRow,1,m_Cache->m_Version);
+            }
+            else
+            {
+                m_Cache->Put(&pdbRow,0,m_Cache->m_Version);                
+            }
+        }
     }
     
     result=0;
@@ -1167,6 +1913,113 @@ uint32_t mc_Permissions::GetPermission(const void* lpEntity,const void* lpAddres
     return result;    
 }
 
+/** Loads database rows for all queries into row cache, subsequent permission checks for these keys don't hit the database */
+
+int mc_Permissions::PrefetchPermissions(mc_PermissionQuery *queries,int count)
+{
+    int err;
+    
+    Lock(0);
+    err=PrefetchPermissionsInternal(queries,count);
+    UnLock();
+    
+    return err;
+}
+
+int mc_Permissions::PrefetchPermissionsInternal(mc_PermissionQuery *queries,int count)
+{
+    int i,err,row_count,unique_count;
+    int *results;
+    uint32_t type;
+    uint64_t version;
+    mc_PermissionDBRow *rows;
+    
+    if( (m_Cache == NULL) || (m_Cache->m_Size == 0) || (count <= 0) )
+    {
+        return MC_ERR_NOERROR;
+    }
+    
+    row_count=0;
+    for(i=0;i<count;i++)
+    {
+        for(type=1;type;type<<=1)
+        {
+            if(queries[i].m_Type & type)
+            {
+                row_count++;
+            }
+        }
+    }
+    
+    if(row_count == 0)
+    {
+        return MC_ERR_NOERROR;
+    }
+    
+    rows=(mc_PermissionDBRow*)mc_New(row_count*sizeof(mc_PermissionDBRow));
+    results=(int*)mc_New(row_count*sizeof(int));
+    if( (rows == NULL) || (results == NULL) )
+    {
+        mc_Delete(rows);
+        mc_Delete(results);
+        return MC_ERR_ALLOCATION;
+    }
+    
+    row_count=0;
+    for(i=0;i<count;i++)
+    {
+        for(type=1;type;type<<=1)
+        {
+            if(queries[i].m_Type & type)
+            {
+                rows[row_count].Zero();
+                memcpy(rows[row_count].m_Entity,queries[i].m_Entity,MC_PLS_SIZE_ENTITY);
+                memcpy(rows[row_count].m_Address,queries[i].m_Address,MC_PLS_SIZE_ADDRESS);
+                rows[row_count].m_Type=type;
+                if(m_Cache->IsCacheable(rows+row_count))
+                {
+                    row_count++;
+                }
+            }
+        }
+    }
+    
+    qsort(rows,row_count,sizeof(mc_PermissionDBRow),mc_ComparePermissionDBKeys);// LevelDB keys are compared bytewise
+    
+    unique_count=0;
+    for(i=0;i<row_count;i++)
+    {
+        if( (unique_count == 0) || (mc_ComparePermissionDBKeys(rows+unique_count-1,rows+i) != 0) )
+        {
+            if(unique_count != i)
+            {
+                memcpy(rows+unique_count,rows+i,sizeof(mc_PermissionDBRow));
+            }
+            unique_count++;
+        }
+    }
+    
+    version=m_Cache->m_Version;                                                 // Database cannot be modified while we hold the lock
+    err=m_Database->m_DB->BatchRead(NULL,(char*)rows+m_Database->m_KeyOffset,sizeof(mc_PermissionDBRow),m_Database->m_KeySize,
+                                    results,unique_count,0);
+    if(err)
+    {
+        LogString("PrefetchPermissions: Cannot read from database");
+    }
+    else
+    {
+        for(i=0;i<unique_count;i++)
+        {
+            m_Cache->Put(rows+i,(results[i] >= 0) ? 1 : 0,version);
+        }
+    }
+    
+    mc_Delete(rows);
+    mc_Delete(results);
+    
+    return err;
+}
+
 /** Returns permission value and details for NULL entity */
 
 uint32_t mc_Permissions::GetPermission(const void* lpAddress,uint32_t type,mc_PermissionLedgerRow *row)
@@ -1270,6 +2123,14 @@ int mc_Permissions::CanConnectInternal(const void* lpEntity,const void* lpAddres
     }
     
     int result;
+    uint32_t snapshot_result;
+    const uint32_t types[]={MC_PTP_CONNECT,MC_PTP_ADMIN,MC_PTP_ACTIVATE,MC_PTP_MINE};
+    
+    if(GetSnapshotPermission(lpEntity,lpAddress,types,with_implicit ? 4 : 1,&snapshot_result) == MC_ERR_NOERROR)
+    {
+        return snapshot_result ? MC_PTP_CONNECT : 0;
+    }
+    
     Lock(0);
             
     result=GetPermission(lpEntity,lpAddress,MC_PTP_CONNECT);
@@ -1333,6 +2194,14 @@ int mc_Permissions::CanSend(const void* lpEntity,const void* lpAddress)
         }
     }
     
+    uint32_t snapshot_result;
+    const uint32_t types[]={MC_PTP_SEND,MC_PTP_ISSUE,MC_PTP_CREATE,MC_PTP_ADMIN,MC_PTP_ACTIVATE};
+    
+    if(GetSnapshotPermission(lpEntity,lpAddress,types,5,&snapshot_result) == MC_ERR_NOERROR)
+    {
+        return snapshot_result ? MC_PTP_SEND : 0;
+    }
+    
     Lock(0);
             
     result = GetPermission(lpEntity,lpAddress,MC_PTP_SEND);    
@@ -1398,6 +2267,14 @@ int mc_Permissions::CanReceive(const void* lpEntity,const void* lpAddress)
         }
     }
 
+    uint32_t snapshot_result;
+    const uint32_t types[]={MC_PTP_RECEIVE,MC_PTP_ADMIN,MC_PTP_ACTIVATE};
+    
+    if(GetSnapshotPermission(lpEntity,lpAddress,types,3,&snapshot_result) == MC_ERR_NOERROR)
+    {
+        return snapshot_result ? MC_PTP_RECEIVE : 0;
+    }
+    
     Lock(0);
     
     result = GetPermission(lpEntity,lpAddress,MC_PTP_RECEIVE);    
@@ -1445,6 +2322,14 @@ int mc_Permissions::CanWrite(const void* lpEntity,const void* lpAddress)
         return 0;
     }
     
+    uint32_t snapshot_result;
+    const uint32_t types[]={MC_PTP_WRITE};
+    
+    if(GetSnapshotPermission(lpEntity,lpAddress,types,1,&snapshot_result) == MC_ERR_NOERROR)
+    {
+        return snapshot_result ? MC_PTP_WRITE : 0;
+    }
+    
     Lock(0);
     
     result = GetPermission(lpEntity,lpAddress,MC_PTP_WRITE);    
@@ -1481,6 +2366,14 @@ int mc_Permissions::CanRead(const void* lpEntity,const void* lpAddress)
         return 0;
     }
     
+    uint32_t snapshot_result;
+    const uint32_t types[]={MC_PTP_READ};
+    
+    if(GetSnapshotPermission(lpEntity,lpAddress,types,1,&snapshot_result) == MC_ERR_NOERROR)
+    {
+        return snapshot_result ? MC_PTP_READ : 0;
+    }
+    
     Lock(0);
     
     result = GetPermission(lpEntity,lpAddress,MC_PTP_READ);    
@@ -1506,6 +2399,14 @@ int mc_Permissions::FilterApproved(const void* lpEntity,const void* lpAddress)
         return 0;
     }
     
+    uint32_t snapshot_result;
+    const uint32_t types[]={MC_PTP_FILTER};
+    
+    if(GetSnapshotPermission(lpEntity,lpAddress,types,1,&snapshot_result) == MC_ERR_NOERROR)
+    {
+        return snapshot_result ? MC_PTP_FILTER : 0;
+    }
+    
     Lock(0);
     
     result = GetPermission(lpEntity,lpAddress,MC_PTP_FILTER);    
@@ -1589,6 +2490,14 @@ int mc_Permissions::CanCreate(const void* lpEntity,const void* lpAddress)
         }
     }
     
+    uint32_t snapshot_result;
+    const uint32_t types[]={MC_PTP_CREATE};
+    
+    if(GetSnapshotPermission(lpEntity,lpAddress,types,1,&snapshot_result) == MC_ERR_NOERROR)
+    {
+        return snapshot_result ? MC_PTP_CREATE : 0;
+    }
+    
     Lock(0);
     
     result = GetPermission(lpEntity,lpAddress,MC_PTP_CREATE);    
@@ -1617,11 +2526,21 @@ int mc_Permissions::CanIssue(const void* lpEntity,const void* lpAddress)
     }
 
     int result;
-    Lock(0);
-            
-    result=GetPermission(lpEntity,lpAddress,MC_PTP_ISSUE);
+    uint32_t snapshot_result;
+    const uint32_t types[]={MC_PTP_ISSUE};
     
-    UnLock();
+    if(GetSnapshotPermission(lpEntity,lpAddress,types,1,&snapshot_result) == MC_ERR_NOERROR)
+    {
+        result=snapshot_result;
+    }
+    else
+    {
+        Lock(0);
+
+        result=GetPermission(lpEntity,lpAddress,MC_PTP_ISSUE);
+
+        UnLock();
+    }
     
     return result;    
 }
@@ -1629,6 +2548,12 @@ int mc_Permissions::CanIssue(const void* lpEntity,const void* lpAddress)
 int mc_Permissions::CanCustom(const void* lpEntity,const void* lpAddress,uint32_t permission)
 {
     int result;
+    uint32_t snapshot_result;
+    
+    if(GetSnapshotPermission(lpEntity,lpAddress,&permission,1,&snapshot_result) == MC_ERR_NOERROR)
+    {
+        return snapshot_result;
+    }
     
     Lock(0);
             
@@ -2026,11 +2951,21 @@ int mc_Permissions::CanAdmin(const void* lpEntity,const void* lpAddress)
     }
     
     int result;
-    Lock(0);
-            
-    result=GetPermission(lpEntity,lpAddress,MC_PTP_ADMIN);
+    uint32_t snapshot_result;
+    const uint32_t types[]={MC_PTP_ADMIN};
     
-    UnLock();
+    if(GetSnapshotPermission(lpEntity,lpAddress,types,1,&snapshot_result) == MC_ERR_NOERROR)
+    {
+        result=snapshot_result;
+    }
+    else
+    {
+        Lock(0);
+
+        result=GetPermission(lpEntity,lpAddress,MC_PTP_ADMIN);
+
+        UnLock();
+    }
     
     return result;    
 }
@@ -2048,11 +2983,21 @@ int mc_Permissions::CanActivate(const void* lpEntity,const void* lpAddress)
     }
     
     int result;
-    Lock(0);
-            
-    result=GetPermission(lpEntity,lpAddress,MC_PTP_ACTIVATE);
+    uint32_t snapshot_result;
+    const uint32_t types[]={MC_PTP_ACTIVATE};
     
-    UnLock();
+    if(GetSnapshotPermission(lpEntity,lpAddress,types,1,&snapshot_result) == MC_ERR_NOERROR)
+    {
+        result=snapshot_result;
+    }
+    else
+    {
+        Lock(0);
+
+        result=GetPermission(lpEntity,lpAddress,MC_PTP_ACTIVATE);
+
+        UnLock();
+    }
     
     if(result == 0)
     {
@@ -2288,6 +3233,7 @@ int mc_Permissions::ClearMemPool()
     int result;
     Lock(1);
     result=ClearMemPoolInternal();
+    PublishSnapshot();
     UnLock();
     return result;        
 }
@@ -2301,6 +3247,7 @@ int mc_Permissions::ClearMemPoolInternal()
     {
         m_Row-=m_MemPool->GetCount();
         m_MemPool->Clear();
+        MemPoolTruncated();
         m_AdminCount=m_ClearedAdminCount;
         m_MinerCount=m_ClearedMinerCount;
         UpdateCounts();
@@ -2423,6 +3370,7 @@ int mc_Permissions::RollBackBeforeMinerVerification(uint32_t block)
         m_MinerCount=m_ClearedMinerCount;
         m_Row-=m_MemPool->GetCount();    
         m_MemPool->Clear();
+        MemPoolTruncated();
     }
     
     m_CopiedBlock=m_Block;
@@ -2504,6 +3452,7 @@ int mc_Permissions::RestoreAfterMinerVerification()
     Lock(1);
     
     m_MemPool->Clear();
+    MemPoolTruncated();
     
     m_Block=m_CopiedBlock;
     m_ForkBlock=0;
@@ -3718,6 +4667,7 @@ int mc_Permissions::RollBackToCheckPoint()
     m_AdminCount=m_CheckPointAdminCount;
     m_MinerCount=m_CheckPointMinerCount;
     m_MemPool->SetCount(m_CheckPointMemPoolSize);
+    MemPoolTruncated();
 
     UnLock();
     
@@ -3837,6 +4787,7 @@ int mc_Permissions::Commit(const void* lpMiner,const void* lpHash)
     int result;
     Lock(1);
     result=CommitInternal(lpMiner,lpHash);
+    PublishSnapshot();
     UnLock();
     return result;
 }
@@ -4005,6 +4956,10 @@ int mc_Permissions::CommitInternal(const void* lpMiner,const void* lpHash)
     
     block_flags=CalculateBlockFlags();
     pld_items=m_MemPool->GetCount();
+    if(pld_items)
+    {
+        m_StateVersion++;
+    }
     
     if(lpMiner)
     {
@@ -4170,6 +5125,20 @@ int mc_Permissions::CommitInternal(const void* lpMiner,const void* lpHash)
             LogString("Error: Commit: DB commit error");                                    
         }
     }    
+    
+    if( (err == MC_ERR_NOERROR) && (m_Cache != NULL) )
+    {
+        __sync_fetch_and_add(&(m_Cache->m_Version),1);                          // Readers of older snapshots still can use older rows
+        for(i=0;i<pld_items;i++)
+        {
+            memcpy((unsigned char*)&pldRow+m_Ledger->m_KeyOffset,m_MemPool->GetRow(i),m_Ledger->m_TotalSize);
+            pdbRow.Zero();
+            memcpy(pdbRow.m_Entity,pldRow.m_Entity,MC_PLS_SIZE_ENTITY);
+            memcpy(pdbRow.m_Address,pldRow.m_Address,MC_PLS_SIZE_ADDRESS);
+            pdbRow.m_Type=pldRow.m_Type;
+            m_Cache->Invalidate(&pdbRow);
+        }
+    }
 
     if(m_Ledger->Open() <= 0)
     {
@@ -4203,6 +5172,7 @@ int mc_Permissions::CommitInternal(const void* lpMiner,const void* lpHash)
     else
     {
         m_MemPool->Clear();
+        MemPoolTruncated();
         StoreBlockInfoInternal(lpMiner,lpHash,0);
         m_Block++;
     }
@@ -4480,6 +5450,7 @@ int mc_Permissions::RollBack(int block)
     int result;
     Lock(1);
     result=RollBackInternal(block);
+    PublishSnapshot();
     UnLock();
     return result;    
 }
@@ -4505,6 +5476,7 @@ int mc_Permissions::RollBackInternal(int block)
     }
 
     ClearMemPoolInternal();
+    m_StateVersion++;
     
     this_row=m_Row-1;
     take_it=1;
@@ -4594,6 +5566,11 @@ int mc_Permissions::RollBackInternal(int block)
         err=m_Database->m_DB->Commit(MC_OPT_DB_DATABASE_TRANSACTIONAL);
     }    
     
+    if(m_Cache)
+    {
+        m_Cache->Reset();
+    }
+    
     if(err == MC_ERR_NOERROR)
     {
         m_Ledger->GetRow(0,&pldRow);
@@ -59,8 +59,20 @@
 #define MC_PLS_SIZE_UPGRADE           16
 #define MC_PLS_SIZE_OFFSETS_PER_ROW    6
 
+#define MC_PLS_SNAPSHOT_STATE_SIZE     7                                        // Number of values compared to detect state change under write lock
+#define MC_PLS_SNAPSHOT_MAX_SEGMENTS  32                                        // Maximal number of mempool row segments in published snapshot
+#define MC_PLS_DEFAULT_CACHE_SIZE     65536                                     // Default number of permission rows kept in hot cache
+
+#define MC_PCF_NONE                   0x00000000
+#define MC_PCF_VALID                  0x00000001                                // Cache slot contains row
+#define MC_PCF_FOUND                  0x00000002                                // Row exists in database
+
 #define MC_PPL_REPLAY             0x00000001    
-#define MC_PPL_ADMINMINERGRANT    0x00000002    
+#define MC_PPL_ADMINMINERGRANT    0x00000002
+#define MC_PPL_READ_PERMISSIONS   0x00000100                                    // Tx filters read permissions not covered by mempool permission checks
+#define MC_PPL_READ_ENTITIES      0x00000200                                    // Tx or its filters read asset, stream or variable state
+#define MC_PPL_READ_CHAIN         0x00000400                                    // Tx filters read chain tip, always rechecked
+#define MC_PPL_READ_MASK          0x0000FF00    
 
 #define MC_PSE_UPGRADE                0x01                                      
 #define MC_PSE_ADMINMINERLIST         0x02                                      
@@ -246,6 +258,16 @@ typedef struct mc_PermissionDetails
 } mc_PermissionDetails;
 
 
+/** Permission prefetch query */
+
+typedef struct mc_PermissionQuery
+{    
+    unsigned char m_Entity[MC_PLS_SIZE_ENTITY];                                 // Entity genesis transaction TxID, all 0s for master permissions 
+    unsigned char m_Address[MC_PLS_SIZE_ADDRESS];                               // Address 
+    uint32_t m_Type;                                                            // Permission types to check, MC_PTP_ constants
+    void Zero();
+} mc_PermissionQuery;
+
 typedef struct mc_RollBackPos
 {
     int m_Block;
@@ -260,6 +282,83 @@ typedef struct mc_RollBackPos
 } mc_RollBackPos;
 
 
+/** Immutable copy of mempool ledger rows [m_From,m_To), shared by published snapshots */
+
+typedef struct mc_PermissionSnapshotSegment
+{
+    mc_Buffer *m_MemPool;                                                       // Same layout as mc_Permissions::m_MemPool
+    int m_From;
+    int m_To;
+    int m_RefCount;                                                             // Number of snapshots using this segment, modified under lock
+} mc_PermissionSnapshotSegment;
+
+/** Immutable view of permission state published to lock-free readers */
+
+typedef struct mc_PermissionSnapshot
+{
+    void *m_DBSnapshot;                                                         // Database snapshot taken when this view was published
+    mc_PermissionSnapshotSegment *m_Segments[MC_PLS_SNAPSHOT_MAX_SEGMENTS];    // Mempool ledger rows, consecutive ranges
+    int m_SegmentCount;
+    int m_CheckForMempoolFlag;
+    int m_Block;                                                                // Last committed block
+    uint64_t m_CopiedRow;                                                       // Non-zero if published during miner verification
+    uint64_t m_CacheVersion;                                                    // Version of row cache when this view was published
+    struct mc_PermissionSnapshot *m_NextRetired;                                // Next snapshot in the list waiting for readers to drain
+    uint64_t m_RetiredEpoch;                                                    // Reader epoch in which this snapshot was replaced
+    
+    void Zero();
+} mc_PermissionSnapshot;
+
+/** Hot cache slot, m_Sequence is odd while slot is being modified */
+
+typedef struct mc_PermissionCacheRow
+{
+    volatile uint32_t m_Sequence;                                               // Sequence counter for lock-free reads
+    uint32_t m_Flags;                                                           // Flags MC_PCF_ constants
+    uint64_t m_Version;                                                         // Cache version this row was read at
+    mc_PermissionDBRow m_Row;                                                   // Database row (key and value)
+} mc_PermissionCacheRow;
+
+/** Direct-mapped cache of decoded permission database rows */
+
+typedef struct mc_PermissionCache
+{
+    mc_PermissionCacheRow *m_Rows;
+    uint32_t m_Size;                                                            // Number of slots, power of 2
+    volatile uint64_t m_Version;                                                // Incremented every time database is modified
+    
+    volatile uint64_t m_Hits;
+    volatile uint64_t m_Misses;
+    volatile uint64_t m_Inserts;
+    volatile uint64_t m_Evictions;
+    volatile uint64_t m_Invalidations;
+    volatile uint64_t m_Resets;
+    
+    mc_PermissionCache()
+    {
+        Zero();
+    }
+    
+    ~mc_PermissionCache()
+    {
+        Destroy();
+    }
+    
+    int Initialize(int size);
+    int Zero();
+    int Destroy();
+    
+    int IsCacheable(const mc_PermissionDBRow *key);
+    int Get(const mc_PermissionDBRow *key,uint64_t version,mc_PermissionDBRow *row);
+    void Put(const mc_PermissionDBRow *row,int found,uint64_t version);
+    void Invalidate(const mc_PermissionDBRow *key);
+    void Reset();
+    
+    uint32_t Slot(const mc_PermissionDBRow *key);
+    int LockSlot(mc_PermissionCacheRow *slot);
+    void UnLockSlot(mc_PermissionCacheRow *slot,uint32_t sequence);
+} mc_PermissionCache;
+
 typedef struct mc_Permissions
 {    
     mc_PermissionDB *m_Database;
@@ -272,6 +371,7 @@ typedef struct mc_Permissions
     uint64_t m_Row;
     int m_AdminCount;
     int m_MinerCount;
+    uint64_t m_StateVersion;                                                    // Incremented when block changes permissions or is rolled back
 //    int m_DBRowCount;
 
     uint64_t m_CheckPointRow;
@@ -297,10 +397,21 @@ typedef struct mc_Permissions
     mc_Buffer               *m_MempoolPermissionsToReplay;  
     mc_Buffer               *m_MempoolTxIDs;
     
-    mc_Buffer   *m_ThreadRollBackPos;
+    uint64_t m_InstanceID;                                                      // Key of per-thread state of this object
     
     void *m_Semaphore;
     uint64_t m_LockedBy;
+    int m_LockedForWrite;
+    
+    mc_PermissionSnapshot * volatile m_Snapshot;
+    mc_PermissionSnapshot *m_RetiredSnapshots;
+    volatile int m_SnapshotReaders[2];                                          // Active lock-free readers by epoch parity
+    volatile uint64_t m_SnapshotEpoch;
+    volatile int m_SnapshotDirty;
+    int m_SnapshotValidRows;                                                    // Leading mempool rows not modified since snapshot was published
+    uint64_t m_LockedState[MC_PLS_SNAPSHOT_STATE_SIZE];                         // State when write lock was taken
+    
+    mc_PermissionCache *m_Cache;
 
     mc_Permissions()
     {
@@ -338,6 +449,7 @@ typedef struct mc_Permissions
     int RewindToRollBackPos(mc_PermissionLedgerRow *row);
     
     uint32_t GetAllPermissions(const void* lpEntity,const void* lpAddress,uint32_t type);
+    int PrefetchPermissions(mc_PermissionQuery *queries,int count);
     uint32_t GetPermissionType(const char *str,uint32_t full_type);
     uint32_t GetPermissionType(const char *str,const void *entity_details);
     uint32_t GetPossiblePermissionTypes(uint32_t entity_type);
@@ -403,6 +515,15 @@ typedef struct mc_Permissions
     void Lock(int write_mode);
     void UnLock();
     
+    int PublishSnapshot();
+    void ReclaimSnapshots(int all);
+    void GetSnapshotState(uint64_t *state);
+    void FreeSnapshot(mc_PermissionSnapshot *snapshot);
+    void MemPoolTruncated();
+    int GetSnapshotPermission(const void* lpEntity,const void* lpAddress,const uint32_t *types,int type_count,uint32_t *result);
+    uint32_t GetSnapshotPermissionInternal(mc_PermissionSnapshot *snapshot,const void* lpEntity,const void* lpAddress,uint32_t type,int checkmempool);
+    int PrefetchPermissionsInternal(mc_PermissionQuery *queries,int count);
+    
     int SetPermissionInternal(const void* lpEntity,const void* lpAddress,uint32_t type,const void* lpAdmin,uint32_t from,uint32_t to,uint32_t timestamp,
                                                                                                            uint32_t flags,int update_mempool,int offset);
     int CanConnectInternal(const void* lpEntity,const void* lpAddress,int with_implicit);
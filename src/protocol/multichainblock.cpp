@@ -9,15 +9,28 @@
 #include "multichain/multichain.h"
 #include "wallet/wallettxs.h"
 #include "community/community.h"
+#include "filters/multichainfilter.h"
 
 #include <boost/assign/list_of.hpp>
 
 extern mc_WalletTxs* pwalletTxsMain;
+extern mc_MultiChainFilterEngine* pMultiChainFilterEngine;
 
 size_t nTotalMempoolTxSize=0;
 size_t nTotalMempoolItems=0;
 size_t nMapRelaySize=0;
 
+/**
+ * State seen by the last mempool replay after block. Mempool txs store their read set, and only txs which read
+ * the state changed since then are rechecked in full, others only recheck their mempool permission rows.
+ */
+
+static bool fReplayStateRecorded=false;
+static uint64_t nReplayPermissionVersion=0;
+static uint64_t nReplayEntityVersion=0;
+static uint32_t nReplayUpgradedParamsVersion=0;
+static vector <uint160> vReplayTxFilters;
+
 using namespace std;
 /*
 bool AcceptMultiChainTransaction(const CTransaction& tx, 
@@ -37,6 +50,7 @@ bool AcceptAssetTransfers(const CTransaction& tx, const CCoinsViewCache &inputs,
 bool AcceptAssetGenesis(const CTransaction &tx,int offset,bool accept,string& reason);
 bool AcceptPermissionsAndCheckForDust(const CTransaction &tx,bool accept,string& reason);
 bool IsTxBanned(uint256 txid);
+void MultiChainTransaction_SetTmpOutputScript(const CScript& script1);
 
 
 int CreateUpgradeLists(int current_height,vector<mc_UpgradedParameter> *vParams,vector<mc_UpgradeStatus> *vUpgrades)
@@ -372,6 +386,28 @@ int64_t TotalMempoolsSize()
     return total_size;
 }
 
+vector <uint160> ReplayApprovedTxFilters()
+{
+    vector <uint160> filters;
+    
+    if(pMultiChainFilterEngine)
+    {
+        for(int i=0;i<(int)pMultiChainFilterEngine->m_Filters.size();i++)
+        {
+            mc_MultiChainFilter *filter=&(pMultiChainFilterEngine->m_Filters[i]);
+            if( (filter->m_FilterType == MC_FLT_TYPE_TX) && (filter->m_CreateError.size() == 0) )
+            {
+                if(mc_gState->m_Permissions->FilterApproved(NULL,&(filter->m_FilterAddress)))
+                {
+                    filters.push_back(filter->m_FilterAddress);
+                }
+            }
+        }
+    }
+    
+    return filters;
+}
+
 bool ReplayMemPool(CTxMemPool& pool, int from,bool accept)
 {
     int pos;
@@ -405,7 +441,10 @@ bool ReplayMemPool(CTxMemPool& pool, int from,bool accept)
     int added_txs=0;
     size_t added_size=0;
     int rejected_txs=0;
+    int rechecked_txs=0;
     size_t send_stop_size=MAX_BLOCK_SIZE;
+    bool fTracked,fPermissionsChanged,fEntitiesChanged;
+    vector <uint160> vTxFilters;
     
     pool.hashSendStop=0;
     
@@ -416,6 +455,15 @@ bool ReplayMemPool(CTxMemPool& pool, int from,bool accept)
         mc_gState->m_Permissions->ClearMempoolTxIDs();
     }
     
+                                                                                // Read sets are used only for full replay after block,
+                                                                                // upgrades or changes in tx filter set require full recheck
+    vTxFilters=ReplayApprovedTxFilters();
+    fTracked=accept && (from == 0) && fReplayStateRecorded && 
+             (nReplayUpgradedParamsVersion == nUpgradedParamsVersion) &&
+             (vReplayTxFilters == vTxFilters);
+    fPermissionsChanged=(nReplayPermissionVersion != mc_gState->m_Permissions->m_StateVersion);
+    fEntitiesChanged=(nReplayEntityVersion != mc_gState->m_Assets->m_StateVersion);
+    
     for(pos=from;pos<pool.hashList->m_Count;pos++)
     {
         hash=*(uint256*)pool.hashList->GetRow(pos);
@@ -423,6 +471,10 @@ bool ReplayMemPool(CTxMemPool& pool, int from,bool accept)
         {
             const CTxMemPoolEntry entry=pool.mapTx[hash];
             const CTransaction& tx = entry.GetTx();            
+            bool fFullReplay=pool.mapTx[hash].FullReplayRequired();             // Copy constructor resets replay parameters
+            uint32_t read_set=pool.mapTx[hash].ReplayReadSet();
+            int replay_from=pool.mapTx[hash].ReplayPermissionFrom();
+            int replay_to=pool.mapTx[hash].ReplayPermissionTo();
             string removed_type="";
             string reason;
             list<CTransaction> removed;
@@ -435,21 +487,33 @@ bool ReplayMemPool(CTxMemPool& pool, int from,bool accept)
             {
                 int permissions_from,permissions_to;
                 permissions_from=mc_gState->m_Permissions->m_MempoolPermissions->GetCount();
-                if(entry.FullReplayRequired())
+                if(!fTracked || (replay_from < 0) ||
+                   (read_set & MC_PPL_READ_CHAIN) ||
+                   ((read_set & MC_PPL_READ_PERMISSIONS) && fPermissionsChanged) ||
+                   ((read_set & MC_PPL_READ_ENTITIES) && fEntitiesChanged) )
+                {
+                    fFullReplay=true;
+                }
+                if(fFullReplay)
                 {
                     LOCK(pool.cs);
                     CCoinsView dummy;
                     CCoinsViewCache view(&dummy);
                     CCoinsViewMemPool viewMemPool(pcoinsTip, pool);
                     view.SetBackend(viewMemPool);
-                    if(!AcceptMultiChainTransaction(tx,view,-1,accept ? MC_AMT_DEFAULT : MC_AMT_NO_ACCEPT,reason,NULL,NULL))
+                    uint32_t replay=0;
+                    if(!AcceptMultiChainTransaction(tx,view,-1,accept ? MC_AMT_DEFAULT : MC_AMT_NO_ACCEPT,reason,NULL,&replay))
                     {
                         removed_type="rejected";                    
+                        fTracked=false;                                         // State written by this tx may be used by txs below
                     }
+                    fFullReplay=( (replay & MC_PPL_REPLAY) != 0) ? true : false;
+                    read_set=replay & MC_PPL_READ_MASK;
+                    rechecked_txs++;
                 }
                 else
                 {
-                   if(mc_gState->m_Permissions->MempoolPermissionsCheck(entry.ReplayPermissionFrom(),entry.ReplayPermissionTo()) == 0) 
+                   if(mc_gState->m_Permissions->MempoolPermissionsCheck(replay_from,replay_to) == 0) 
                    {
                         removed_type="rejected";                                               
                    }                        
@@ -457,7 +521,7 @@ bool ReplayMemPool(CTxMemPool& pool, int from,bool accept)
                 if(removed_type.size() == 0)
                 {
                     permissions_to=mc_gState->m_Permissions->m_MempoolPermissions->GetCount();
-                    pool.mapTx[hash].SetReplayNodeParams(entry.FullReplayRequired(),permissions_from,permissions_to);                    
+                    pool.mapTx[hash].SetReplayNodeParams(fFullReplay,permissions_from,permissions_to,read_set);                    
                 }
             }
 
@@ -496,8 +560,17 @@ bool ReplayMemPool(CTxMemPool& pool, int from,bool accept)
     nTotalMempoolTxSize=added_size;
     nTotalMempoolItems=added_txs;
     
-    LogPrint("mcblockperf","mchn-block-perf: Replaying mempool after block %6d. New %8d, total %8d, added %8d, rejected %8d, time %8.3fs\n",
-            chainActive.Height(),total_txs-from,total_txs,added_txs-rejected_txs,rejected_txs,mc_TimeNowAsDouble()-start_time);
+    if(accept && (from == 0))
+    {
+        fReplayStateRecorded=true;
+        nReplayPermissionVersion=mc_gState->m_Permissions->m_StateVersion;
+        nReplayEntityVersion=mc_gState->m_Assets->m_StateVersion;
+        nReplayUpgradedParamsVersion=nUpgradedParamsVersion;
+        vReplayTxFilters=vTxFilters;
+    }
+    
+    LogPrint("mcblockperf","mchn-block-perf: Replaying mempool after block %6d. New %8d, total %8d, added %8d, rejected %8d, rechecked %8d, time %8.3fs\n",
+            chainActive.Height(),total_txs-from,total_txs,added_txs-rejected_txs,rejected_txs,rechecked_txs,mc_TimeNowAsDouble()-start_time);
     
     return true;
 }
@@ -997,3 +1070,104 @@ bool CheckBlockPermissions(const CBlock& block,CBlockIndex* prev_block,unsigned
     return checked;
 }
 
+void PrefetchBlockPermissionAddress(vector<mc_PermissionQuery>& queries,const void *entity,const CTxDestination& address,uint32_t type)
+{
+    const CKeyID *lpKeyID=boost::get<CKeyID> (&address);
+    const CScriptID *lpScriptID=boost::get<CScriptID> (&address);
+    mc_PermissionQuery query;
+    
+    query.Zero();
+    if(entity)
+    {
+        memcpy(query.m_Entity,entity,MC_PLS_SIZE_ENTITY);
+    }
+    if(lpKeyID)
+    {
+        memcpy(query.m_Address,lpKeyID,MC_PLS_SIZE_ADDRESS);
+    }
+    else
+    {
+        if(lpScriptID == NULL)
+        {
+            return;
+        }
+        memcpy(query.m_Address,lpScriptID,MC_PLS_SIZE_ADDRESS);        
+    }
+    query.m_Type=type;
+    queries.push_back(query);
+}
+
+/* Loads permission rows required for verification of all block transactions into permission cache, using single sorted database pass */
+
+void PrefetchBlockPermissions(const CBlock& block,const CCoinsViewCache& view)
+{
+    vector<mc_PermissionQuery> queries;
+    vector<CTxDestination> input_addresses;
+    unsigned char short_txid[MC_AST_SHORT_TXID_SIZE];
+    mc_EntityDetails entity;
+    CTxDestination address;
+    
+    if(mc_gState->m_NetworkParams->IsProtocolMultichain() == 0)
+    {
+        return;
+    }
+    
+    for (unsigned int i = 0; i < block.vtx.size(); i++)
+    {
+        const CTransaction &tx = block.vtx[i];
+        
+        input_addresses.clear();
+        if (!tx.IsCoinBase())
+        {
+            for (unsigned int j = 0; j < tx.vin.size(); j++)
+            {
+                const CCoins *coins = view.AccessCoins(tx.vin[j].prevout.hash);
+                if(coins && coins->IsAvailable(tx.vin[j].prevout.n))
+                {
+                    if(ExtractDestination(coins->vout[tx.vin[j].prevout.n].scriptPubKey,address))
+                    {
+                        input_addresses.push_back(address);
+                        PrefetchBlockPermissionAddress(queries,NULL,address,
+                                MC_PTP_SEND | MC_PTP_ISSUE | MC_PTP_CREATE | MC_PTP_ADMIN | MC_PTP_ACTIVATE);
+                    }
+                }
+            }
+        }
+        
+        for (unsigned int j = 0; j < tx.vout.size(); j++)
+        {
+            MultiChainTransaction_SetTmpOutputScript(tx.vout[j].scriptPubKey);
+            if(mc_gState->m_TmpScript->IsOpReturnScript())
+            {
+                if(mc_gState->m_TmpScript->GetNumElements() > 1)                // Entity item, publishers need per-entity permissions
+                {
+                    mc_gState->m_TmpScript->SetElement(0);
+                    if(mc_gState->m_TmpScript->GetEntity(short_txid) == 0)
+                    {
+                        if(mc_gState->m_Assets->FindEntityByShortTxID(&entity,short_txid))
+                        {
+                            for (unsigned int k = 0; k < input_addresses.size(); k++)
+                            {
+                                PrefetchBlockPermissionAddress(queries,entity.GetTxID(),input_addresses[k],
+                                        MC_PTP_WRITE | MC_PTP_ISSUE | MC_PTP_ADMIN | MC_PTP_ACTIVATE);
+                            }
+                        }
+                    }
+                }
+            }
+            else
+            {
+                if(ExtractDestination(tx.vout[j].scriptPubKey,address))
+                {
+                    PrefetchBlockPermissionAddress(queries,NULL,address,MC_PTP_RECEIVE);
+                }
+            }
+        }
+    }
+    
+    if(queries.size())
+    {
+        mc_gState->m_Permissions->PrefetchPermissions(&(queries[0]),(int)queries.size());
+    }
+}
+
@@ -45,6 +45,8 @@ typedef struct CMultiChainTxDetails
     bool fLicenseTokenIssuance;                                                 // New license token
     bool fLicenseTokenTransfer;                                                 // License token transfer
     bool fLibraryUpdate;                                                        // Library update
+    bool fFiltersApplied;                                                       // Tx filters were applied to this tx
+    uint32_t nFilterReadSet;                                                    // MC_FLT_READ_ flags of callbacks called by tx filters
     
     vector <txnouttype> vInputScriptTypes;                                      // Input script types
     vector <uint160> vInputDestinations;                                        // Addresses used in input scripts
@@ -119,6 +121,8 @@ void CMultiChainTxDetails::Zero()
     fLicenseTokenIssuance=false;
     fLicenseTokenTransfer=false;
     fLibraryUpdate=false;
+    fFiltersApplied=false;
+    nFilterReadSet=0;
     
     details_script_size=0;
     details_script_type=-1;
@@ -3861,7 +3865,8 @@ bool AcceptMultiChainTransaction   (const CTransaction& tx,
                     }
                     if(applied)
                     {
-                        details.fFullReplayCheckRequired=true;                        
+                        details.fFiltersApplied=true;
+                        details.nFilterReadSet=pMultiChainFilterEngine->TxFilterReadSet();
                     }
                 }
             }
@@ -3915,6 +3920,19 @@ exitlbl:
         if(details.fAdminMinerGrant)
         {
             *replay |= MC_PPL_ADMINMINERGRANT;
+        }
+                                                                                // Read set, permission checks are recorded separately in mempool permissions
+        if(details.vRelevantEntities.size() || details.fFiltersApplied)
+        {
+            *replay |= MC_PPL_READ_ENTITIES;
+        }
+        if(details.nFilterReadSet & MC_FLT_READ_PERMISSIONS)
+        {
+            *replay |= MC_PPL_READ_PERMISSIONS;
+        }
+        if(details.nFilterReadSet & MC_FLT_READ_CHAIN)
+        {
+            *replay |= MC_PPL_READ_CHAIN;
         }
     }
 
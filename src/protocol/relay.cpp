@@ -437,7 +437,12 @@ void mc_RelayManager::MsgTypeSettings(uint32_t msg_type,int latency,int seconds,
 void mc_RelayManager::Zero()
 {
     m_Semaphore=NULL;
-    m_LockedBy=0;         
+    for(int i=0;i<MC_RLM_SHARDS;i++)
+    {
+        m_RecordShards[i].m_Semaphore=NULL;
+        m_RequestShards[i].m_Semaphore=NULL;
+        m_RequestShards[i].m_LockedBy=0;
+    }
     m_LastTime=0;
 }
 
@@ -447,6 +452,17 @@ void mc_RelayManager::Destroy()
     {
         __US_SemDestroy(m_Semaphore);
     }
+    for(int i=0;i<MC_RLM_SHARDS;i++)
+    {
+        if(m_RecordShards[i].m_Semaphore)
+        {
+            __US_SemDestroy(m_RecordShards[i].m_Semaphore);
+        }
+        if(m_RequestShards[i].m_Semaphore)
+        {
+            __US_SemDestroy(m_RequestShards[i].m_Semaphore);
+        }
+    }
     
     Zero();    
 }
@@ -454,35 +470,70 @@ void mc_RelayManager::Destroy()
 int mc_RelayManager::Initialize()
 {
     m_Semaphore=__US_SemCreate();
+    for(int i=0;i<MC_RLM_SHARDS;i++)
+    {
+        m_RecordShards[i].m_Semaphore=__US_SemCreate();
+        m_RequestShards[i].m_Semaphore=__US_SemCreate();
+    }
     InitNodeAddress(&m_MyAddress,NULL,MC_PRA_NONE);
     SetDefaults();
     return MC_ERR_NOERROR;    
 }
 
-int mc_RelayManager::Lock(int write_mode,int allow_secondary)
+int mc_RelayManager::ShardIndex(const mc_OffchainMessageID& msg_id)
+{
+    return (int)((msg_id.m_Nonce.GetLow64() >> 56) % MC_RLM_SHARDS);
+}
+
+/** 
+ * Locks request shard, returns 1 if the lock was taken, 0 if this thread 
+ * already holds it. Only SendNextRequest takes second shard while holding one,
+ * all other lock holders wait for nothing, so this cannot deadlock.
+ */
+
+int mc_RelayManager::LockShard(int shard)
 {        
     uint64_t this_thread;
     this_thread=__US_ThreadID();
     
-    if(this_thread == m_LockedBy)
+    if(this_thread == m_RequestShards[shard].m_LockedBy)
     {
-        return allow_secondary;
+        return 0;
     }
-    __US_SemWait(m_Semaphore); 
-    m_LockedBy=this_thread;
+    __US_SemWait(m_RequestShards[shard].m_Semaphore); 
+    m_RequestShards[shard].m_LockedBy=this_thread;
     
-    return 0;
+    return 1;
+}
+
+void mc_RelayManager::UnLockShard(int shard)
+{    
+    m_RequestShards[shard].m_LockedBy=0;
+    __US_SemPost(m_RequestShards[shard].m_Semaphore);
 }
 
 void mc_RelayManager::UnLock()
 {    
-    m_LockedBy=0;
-    __US_SemPost(m_Semaphore);
+    uint64_t this_thread;
+    this_thread=__US_ThreadID();
+    
+    for(int i=0;i<MC_RLM_SHARDS;i++)
+    {
+        if(m_RequestShards[i].m_LockedBy == this_thread)
+        {
+            UnLockShard(i);
+        }
+    }
 }
 
-int mc_RelayManager::Lock()
-{        
-    return Lock(1,0);
+int mc_RelayManager::RequestCount()
+{
+    int count=0;
+    for(int i=0;i<MC_RLM_SHARDS;i++)
+    {
+        count+=(int)m_RequestShards[i].m_Requests.size();                       // Approximate, for logging only
+    }
+    return count;
 }
 
 void mc_RelayManager::SetDefaults()
@@ -511,25 +562,33 @@ void mc_RelayManager::CheckTime()
         return;
     }
 
-    Lock();
-    for(map<const mc_RelayRecordKey,mc_RelayRecordValue>::iterator it = m_RelayRecords.begin(); it != m_RelayRecords.end();)
+    __US_SemWait(m_Semaphore);
+    if(time_now == m_LastTime)                                                  // Other thread already expired records
     {
-        if(it->second.m_Timestamp < m_LastTime)
+        __US_SemPost(m_Semaphore);
+        return;
+    }
+    
+    for(int i=0;i<MC_RLM_SHARDS;i++)
+    {
+        mc_RelayRecordShard *shard=&(m_RecordShards[i]);
+        __US_SemWait(shard->m_Semaphore);
+        while(!shard->m_Expirations.empty() && (shard->m_Expirations.begin()->first < m_LastTime))
         {
+            BOOST_FOREACH(const mc_RelayRecordKey& key, shard->m_Expirations.begin()->second)
+            {
 /*            
-            mc_OffchainMessageID msg_id=it->first.m_ID;
-            if(fDebug)LogPrint("offchain","Offchain rrdl:  %s, from: %d, to: %d, msg: %s, now: %d, exp: %d\n",
-            msg_id.ToString().c_str(),it->second.m_NodeFrom,it->first.m_NodeTo,mc_MsgTypeStr(it->second.m_MsgType).c_str(),m_LastTime,it->second.m_Timestamp);
+                if(fDebug)LogPrint("offchain","Offchain rrdl:  %s, to: %d, now: %d\n",
+                key.m_ID.ToString().c_str(),key.m_NodeTo,m_LastTime);
 */
-            m_RelayRecords.erase(it++);
-        }
-        else
-        {
-            it++;
+                shard->m_RelayRecords.erase(key);
+            }
+            shard->m_Expirations.erase(shard->m_Expirations.begin());
         }
-    }        
+        __US_SemPost(shard->m_Semaphore);
+    }
     m_LastTime=time_now;
-    UnLock();
+    __US_SemPost(m_Semaphore);
 }
 
 void mc_RelayManager::SetRelayRecord(CNode *pto,CNode *pfrom,uint32_t msg_type,mc_OffchainMessageID msg_id)
@@ -560,10 +619,13 @@ void mc_RelayManager::SetRelayRecord(CNode *pto,CNode *pfrom,uint32_t msg_type,m
     value.m_Timestamp=m_LastTime+itlat->second;
     value.m_Count=1;
     
-    map<const mc_RelayRecordKey, mc_RelayRecordValue>::iterator it = m_RelayRecords.find(key);
-    if (it == m_RelayRecords.end())
+    mc_RelayRecordShard *shard=&(m_RecordShards[ShardIndex(msg_id)]);
+    __US_SemWait(shard->m_Semaphore);
+    boost::unordered_map<mc_RelayRecordKey, mc_RelayRecordValue, mc_RelayRecordKeyHasher>::iterator it = shard->m_RelayRecords.find(key);
+    if (it == shard->m_RelayRecords.end())
     {
-        m_RelayRecords.insert(make_pair(key,value));
+        shard->m_RelayRecords.insert(make_pair(key,value));
+        shard->m_Expirations[value.m_Timestamp].push_back(key);                 // Timestamp is not changed on update
     }                    
     else
     {
@@ -571,6 +633,7 @@ void mc_RelayManager::SetRelayRecord(CNode *pto,CNode *pfrom,uint32_t msg_type,m
         value.m_Count=(it->second).m_Count;
         it->second=value;
     }
+    __US_SemPost(shard->m_Semaphore);
 /*   
     if(fDebug)LogPrint("offchain","Offchain rrst:  %s, from: %d, to: %d, msg: %s, now: %d, exp: %d\n",
     msg_id.ToString().c_str(),pfrom ? pfrom->GetId() : 0,pto ? pto->GetId() : 0,mc_MsgTypeStr(msg_type).c_str(),m_LastTime,value.m_Timestamp);
@@ -589,26 +652,40 @@ int mc_RelayManager::GetRelayRecord(CNode *pfrom,mc_OffchainMessageID msg_id,uin
     }
 //    printf("getrr: %d, ts: %u, nc: %u\n",pfrom_id,timestamp,nonce);
     const mc_RelayRecordKey key=mc_RelayRecordKey(msg_id,pfrom_id);
-    map<const mc_RelayRecordKey, mc_RelayRecordValue>::iterator it = m_RelayRecords.find(key);
-    if (it == m_RelayRecords.end())
+    mc_RelayRecordValue value;
+    int count=0;
+    
+    mc_RelayRecordShard *shard=&(m_RecordShards[ShardIndex(msg_id)]);
+    __US_SemWait(shard->m_Semaphore);
+    boost::unordered_map<mc_RelayRecordKey, mc_RelayRecordValue, mc_RelayRecordKeyHasher>::iterator it = shard->m_RelayRecords.find(key);
+    if (it == shard->m_RelayRecords.end())
     {
+        __US_SemPost(shard->m_Semaphore);
         return MC_ERR_NOT_FOUND;
     }
     
-    if(it->second.m_MsgType == MC_RMT_ERROR_IN_MESSAGE)
+    value=it->second;
+    if( (pto == NULL) && (value.m_MsgType != MC_RMT_ERROR_IN_MESSAGE) )
+    {
+        it->second.m_Count+=1;
+        count=it->second.m_Count;
+    }
+    __US_SemPost(shard->m_Semaphore);
+    
+    if(value.m_MsgType == MC_RMT_ERROR_IN_MESSAGE)
     {
         return MC_ERR_ERROR_IN_SCRIPT;
     }
     
     if(msg_type)
     {
-        *msg_type=it->second.m_MsgType;        
+        *msg_type=value.m_MsgType;        
     }
     
     
     if(pto)
     {
-        pto_id=it->second.m_NodeFrom;
+        pto_id=value.m_NodeFrom;
     
         if(pto_id)
         {
@@ -629,8 +706,7 @@ int mc_RelayManager::GetRelayRecord(CNode *pfrom,mc_OffchainMessageID msg_id,uin
     }
     else
     {
-        it->second.m_Count+=1;
-        if(it->second.m_Count > m_MaxResponses)
+        if(count > m_MaxResponses)
         {
             return MC_ERR_NOT_ALLOWED;            
         }
@@ -984,30 +1060,39 @@ bool mc_RelayManager::ProcessRelay( CNode* pfrom,
     
     map<uint32_t, mc_Limiter>::iterator itlim_all = m_Limiters.find(MC_RMT_NONE);
     map<uint32_t, mc_Limiter>::iterator itlim_msg = m_Limiters.find(msg_type_in);
+    int64_t msg_size=vRecv.size();
+    bool disallowed=false;
     
+    __US_SemWait(m_Semaphore);
     if(itlim_all != m_Limiters.end())
     {
-        itlim_all->second.SetEvent(1,vRecv.size());
+        itlim_all->second.SetEvent(1,msg_size);
         if( verify_flags & MC_VRA_LIMIT_ALL ) 
         {
             if(itlim_all->second.Disallowed(m_LastTime))
             {
-                return false;
+                disallowed=true;
             }
         }        
     }
     
-    if(itlim_msg != m_Limiters.end())
+    if(!disallowed && (itlim_msg != m_Limiters.end()) )
     {
-        itlim_msg->second.SetEvent(1,vRecv.size());
+        itlim_msg->second.SetEvent(1,msg_size);
         if( verify_flags & MC_VRA_LIMIT_MSG_TYPE ) 
         {
             if(itlim_msg->second.Disallowed(m_LastTime))
             {
-                return false;
+                disallowed=true;
             }
         }        
     }
+    __US_SemPost(m_Semaphore);
+    
+    if(disallowed)
+    {
+        return false;
+    }
     
     vRecv >> flags_in;
     vRecv >> vPayloadIn;
@@ -1081,15 +1166,19 @@ bool mc_RelayManager::ProcessRelay( CNode* pfrom,
         }
     }
     
+    __US_SemWait(m_Semaphore);
     if(itlim_all != m_Limiters.end())
     {
+        itlim_all->second.SetEvent(1,msg_size);                                 // Other thread could overwrite event
         itlim_all->second.Increment();
     }
     
     if(itlim_msg != m_Limiters.end())
     {
+        itlim_msg->second.SetEvent(1,msg_size);
         itlim_msg->second.Increment();        
     }    
+    __US_SemPost(m_Semaphore);
 
     if(pto_stored)
     {
@@ -1125,12 +1214,12 @@ bool mc_RelayManager::ProcessRelay( CNode* pfrom,
                     }
                     else
                     {
-                        map<mc_OffchainMessageID, mc_RelayRequest>::iterator itreq = m_Requests.find(msg_id_to_respond);
-                        if(itreq != m_Requests.end())
+                        if(AddResponse(msg_id_to_respond,pfrom,vHops.size() ? vHops[0] : 0,hop_count,msg_id_received,msg_type_in,flags_in,vPayloadIn,MC_RST_SUCCESS) == MC_ERR_NOERROR)
                         {
-                            Lock();
-                            AddResponse(itreq->second.m_MsgID,pfrom,vHops.size() ? vHops[0] : 0,hop_count,msg_id_received,msg_type_in,flags_in,vPayloadIn,MC_RST_SUCCESS);
-                            UnLock();
+                            if(pwalletTxsMain->m_ChunkCollector)
+                            {
+                                pwalletTxsMain->m_ChunkCollector->ResponseReceived(msg_id_to_respond,msg_type_in);
+                            }
                         }                        
                         else
                         {
@@ -1209,9 +1298,11 @@ void mc_RelayRequest::Zero()
 int mc_RelayManager::AddRequest(CNode *pto,int64_t destination,mc_OffchainMessageID msg_id,uint32_t msg_type,uint32_t flags,vector <unsigned char>& payload,uint32_t status,int ef_cache_id)
 {    
     int err=MC_ERR_NOERROR;
+    int shard=ShardIndex(msg_id);
+    int locked=LockShard(shard);
  
-    map<mc_OffchainMessageID, mc_RelayRequest>::iterator itreq_this = m_Requests.find(msg_id);
-    if(itreq_this == m_Requests.end())
+    boost::unordered_map<mc_OffchainMessageID, mc_RelayRequest, mc_OffchainMessageIDHasher>::iterator itreq_this = m_RequestShards[shard].m_Requests.find(msg_id);
+    if(itreq_this == m_RequestShards[shard].m_Requests.end())
     {    
         mc_RelayRequest request;
 
@@ -1228,13 +1319,17 @@ int mc_RelayManager::AddRequest(CNode *pto,int64_t destination,mc_OffchainMessag
         request.m_Responses.clear();
 
         if(fDebug)LogPrint("offchain","Offchain rqst: %s, to: %d, msg: %s, size: %d\n",msg_id.ToString().c_str(),pto ? pto->GetId() : 0,mc_MsgTypeStr(msg_type).c_str(),(int)payload.size());
-        m_Requests.insert(make_pair(msg_id,request));
+        m_RequestShards[shard].m_Requests.insert(make_pair(msg_id,request));
     }
     else
     {
         err=MC_ERR_FOUND;
     }    
     
+    if(locked)
+    {
+        UnLockShard(shard);
+    }
     return err;            
 }
 
@@ -1268,58 +1363,75 @@ int mc_RelayManager::AddResponse(mc_OffchainMessageID request,CNode *pfrom,int32
     response.m_Payload=payload;
     response.m_Requests.clear();    
     
-    if(!request.IsZero())
-    {
-        map<mc_OffchainMessageID, mc_RelayRequest>::iterator itreq = m_Requests.find(request);
-        if(itreq != m_Requests.end())
-        {    
-            itreq->second.m_Responses.push_back(response);
-            if(status & MC_RST_SUCCESS)
-            {
-                itreq->second.m_Status |= MC_RST_SUCCESS;
-            }
-        }
-        else
+    int err=MC_ERR_NOERROR;
+    int shard=ShardIndex(request);
+    int locked=LockShard(shard);
+    
+    boost::unordered_map<mc_OffchainMessageID, mc_RelayRequest, mc_OffchainMessageIDHasher>::iterator itreq = m_RequestShards[shard].m_Requests.find(request);
+    if(itreq != m_RequestShards[shard].m_Requests.end())
+    {    
+        itreq->second.m_Responses.push_back(response);
+        if(status & MC_RST_SUCCESS)
         {
-            return MC_ERR_NOT_FOUND;
+            itreq->second.m_Status |= MC_RST_SUCCESS;
         }
     }
+    else
+    {
+        err=MC_ERR_NOT_FOUND;
+    }
     
-    return MC_ERR_NOERROR; 
+    if(locked)
+    {
+        UnLockShard(shard);
+    }
+    return err; 
 }
 
 int mc_RelayManager::DeleteRequest(mc_OffchainMessageID request)
 {
     int err=MC_ERR_NOERROR;
+    int shard=ShardIndex(request);
+    int locked=LockShard(shard);
 
-    Lock();
-    map<mc_OffchainMessageID, mc_RelayRequest>::iterator itreq = m_Requests.find(request);
-    if(itreq != m_Requests.end())
+    boost::unordered_map<mc_OffchainMessageID, mc_RelayRequest, mc_OffchainMessageIDHasher>::iterator itreq = m_RequestShards[shard].m_Requests.find(request);
+    if(itreq != m_RequestShards[shard].m_Requests.end())
     {
         pEF->OFF_FreeEFCache(itreq->second.m_EFCacheID);
         if(fDebug)LogPrint("offchain","Offchain delete: %s, msg: %s, size: %d. Open requests: %d\n",itreq->second.m_MsgID.ToString().c_str(),
-            mc_MsgTypeStr(itreq->second.m_MsgType).c_str(),(int)itreq->second.m_Payload.size(),(int)m_Requests.size());
-        m_Requests.erase(itreq);       
+            mc_MsgTypeStr(itreq->second.m_MsgType).c_str(),(int)itreq->second.m_Payload.size(),RequestCount());
+        m_RequestShards[shard].m_Requests.erase(itreq);       
     }    
     else
     {
         err= MC_ERR_NOT_FOUND;
     }
     
-    UnLock();
+    if(locked)
+    {
+        UnLockShard(shard);
+    }
     return err;     
 }
 
+/** 
+ * Returns request with its shard locked, caller should call UnLock() when done
+ */
+
 mc_RelayRequest *mc_RelayManager::FindRequest(mc_OffchainMessageID request)
 {
-    Lock();
-    map<mc_OffchainMessageID, mc_RelayRequest>::iterator itreq = m_Requests.find(request);
-    if(itreq != m_Requests.end())
+    int shard=ShardIndex(request);
+    int locked=LockShard(shard);
+    boost::unordered_map<mc_OffchainMessageID, mc_RelayRequest, mc_OffchainMessageIDHasher>::iterator itreq = m_RequestShards[shard].m_Requests.find(request);
+    if(itreq != m_RequestShards[shard].m_Requests.end())
     {
         return &(itreq->second);
     }    
     
-    UnLock();
+    if(locked)
+    {
+        UnLockShard(shard);
+    }
     return NULL;    
 }
 
@@ -1333,7 +1445,8 @@ mc_OffchainMessageID mc_RelayManager::SendRequest(CNode* pto,uint32_t msg_type,u
 
     msg_id=GenerateMsgID();
     
-    Lock();
+    int shard=ShardIndex(msg_id);
+    int locked=LockShard(shard);                                                // Responses wait until request is added
     {
         LOCK(cs_vNodes);
         BOOST_FOREACH(CNode* pnode, vNodes)
@@ -1364,13 +1477,17 @@ mc_OffchainMessageID mc_RelayManager::SendRequest(CNode* pto,uint32_t msg_type,u
         }
     }
 
-    if(AddRequest(pto,0,msg_id,msg_type,flags,payload,MC_RST_NONE,-1) != MC_ERR_NOERROR)
+    int err=AddRequest(pto,0,msg_id,msg_type,flags,payload,MC_RST_NONE,-1);
+    
+    if(locked)
+    {
+        UnLockShard(shard);
+    }
+    if(err != MC_ERR_NOERROR)
     {
-        UnLock();
         return mc_OffchainMessageID();
     }
     
-    UnLock();
     return msg_id;
 }
 
@@ -1384,8 +1501,7 @@ mc_OffchainMessageID mc_RelayManager::SendNextRequest(mc_RelayResponse* response
     
     msg_id=GenerateMsgID();
 
-    
-    Lock();                                                                     // Secondary lock, to make sure it is locked by this thread
+    LockShard(ShardIndex(msg_id));                                              // Caller may hold the lock on shard of the response
     {
         LOCK(cs_vNodes);
         BOOST_FOREACH(CNode* pnode, vNodes)
@@ -1419,29 +1535,32 @@ mc_OffchainMessageID mc_RelayManager::SendNextRequest(mc_RelayResponse* response
 
 void mc_RelayManager::InvalidateResponsesFromDisconnected()
 {
-    LOCK(cs_vNodes);
-    int m=(int)vNodes.size();
-    Lock();
-    BOOST_FOREACH(PAIRTYPE(const mc_OffchainMessageID,mc_RelayRequest)& item, m_Requests)    
+    set<NodeId> setConnected;
     {
-        for(int i=0;i<(int)item.second.m_Responses.size();i++)
+        LOCK(cs_vNodes);
+        BOOST_FOREACH(CNode* pnode, vNodes)
         {
-            int n=0;
-            while(n<m)
+            setConnected.insert(pnode->GetId());
+        }
+    }
+    
+    for(int shard=0;shard<MC_RLM_SHARDS;shard++)
+    {
+        int locked=LockShard(shard);
+        BOOST_FOREACH(PAIRTYPE(const mc_OffchainMessageID,mc_RelayRequest)& item, m_RequestShards[shard].m_Requests)    
+        {
+            for(int i=0;i<(int)item.second.m_Responses.size();i++)
             {
-                if(vNodes[n]->GetId() == item.second.m_Responses[i].m_NodeFrom)
+                if(setConnected.find(item.second.m_Responses[i].m_NodeFrom) == setConnected.end())
                 {
-                    n=m+1;
+                    item.second.m_Responses[i].m_Status &= ~MC_RST_SUCCESS;
+                    item.second.m_Responses[i].m_Status |= MC_RST_DISCONNECTED;
                 }
-                n++;
-            }
-            if(n == m)
-            {
-                item.second.m_Responses[i].m_Status &= ~MC_RST_SUCCESS;
-                item.second.m_Responses[i].m_Status |= MC_RST_DISCONNECTED;
             }
+        }    
+        if(locked)
+        {
+            UnLockShard(shard);
         }
-    }    
-    UnLock();
+    }
 }
-
@@ -14,6 +14,8 @@
 #include "keys/key.h"
 #include "net/net.h"
 
+#include <boost/unordered_map.hpp>
+
 #define MC_PRA_NONE                          0x00000000
 #define MC_PRA_MY_ORIGIN_MC_ADDRESS          0x00000001
 #define MC_PRA_MY_ORIGIN_NT_ADDRESS          0x00000002
@@ -65,6 +67,8 @@
 #define MC_LIM_MAX_SECONDS                60
 #define MC_LIM_MAX_MEASURES                4
 
+#define MC_RLM_SHARDS                     16
+
 
 
 #define MC_RST_NONE                          0x00000000
@@ -169,6 +173,14 @@ typedef struct mc_OffchainMessageID
     }
 } mc_OffchainMessageID;
 
+typedef struct mc_OffchainMessageIDHasher
+{
+    size_t operator()(const mc_OffchainMessageID& msg_id) const
+    {
+        return (size_t)(msg_id.m_Nonce.GetLow64() ^ ((uint64_t)msg_id.m_TimeStamp << 32));
+    }
+} mc_OffchainMessageIDHasher;
+
 typedef struct CRelayResponsePair
 {
     mc_OffchainMessageID request_id;
@@ -219,8 +231,21 @@ typedef struct mc_RelayRecordKey
                 (a.m_ID == b.m_ID && a.m_NodeTo < b.m_NodeTo));
     }
     
+    friend bool operator==(const mc_RelayRecordKey& a, const mc_RelayRecordKey& b)
+    {
+        return (a.m_ID == b.m_ID && a.m_NodeTo == b.m_NodeTo);
+    }
+    
 } mc_RelayRecordKey;
 
+typedef struct mc_RelayRecordKeyHasher
+{
+    size_t operator()(const mc_RelayRecordKey& key) const
+    {
+        return mc_OffchainMessageIDHasher()(key.m_ID) ^ (size_t)((uint64_t)key.m_NodeTo * 0x9E3779B97F4A7C15ULL);
+    }
+} mc_RelayRecordKeyHasher;
+
 typedef struct mc_RelayRecordValue
 {
     uint32_t m_MsgType;
@@ -278,6 +303,26 @@ typedef struct mc_RelayRequest
     void Zero();
 } mc_RelayRequest;
 
+/** 
+ * Relay records and requests are split into shards by message ID, every shard
+ * has its own lock. Relay records expire by timestamp buckets, so CheckTime
+ * doesn't scan all records.
+ */
+
+typedef struct mc_RelayRecordShard
+{
+    void *m_Semaphore;
+    boost::unordered_map<mc_RelayRecordKey,mc_RelayRecordValue,mc_RelayRecordKeyHasher> m_RelayRecords;
+    map<uint32_t,vector<mc_RelayRecordKey> > m_Expirations;                     // Record keys by expiration timestamp
+} mc_RelayRecordShard;
+
+typedef struct mc_RelayRequestShard
+{
+    void *m_Semaphore;
+    uint64_t m_LockedBy;
+    boost::unordered_map<mc_OffchainMessageID,mc_RelayRequest,mc_OffchainMessageIDHasher> m_Requests;
+} mc_RelayRequestShard;
+
 typedef struct mc_RelayManager
 {
     uint32_t m_MyIPs[64];
@@ -286,8 +331,7 @@ typedef struct mc_RelayManager
     uint32_t m_LastTime;    
     uint32_t m_MinTimeShift;
     uint32_t m_MaxTimeShift;
-    void *m_Semaphore;                                                          
-    uint64_t m_LockedBy;                                                        
+    void *m_Semaphore;                                                          // Limiters and expiration
     mc_NodeFullAddress m_MyAddress;
             
     mc_RelayManager()
@@ -302,15 +346,17 @@ typedef struct mc_RelayManager
     
     map<uint32_t,int> m_Latency;
     map<uint32_t,mc_Limiter> m_Limiters;
-    map<const mc_RelayRecordKey,mc_RelayRecordValue> m_RelayRecords;
-    map<mc_OffchainMessageID,mc_RelayRequest> m_Requests;
+    mc_RelayRecordShard m_RecordShards[MC_RLM_SHARDS];
+    mc_RelayRequestShard m_RequestShards[MC_RLM_SHARDS];
     
     void Zero();
     void Destroy();
-    int Lock();
-    int Lock(int write_mode, int allow_secondary);
+    int ShardIndex(const mc_OffchainMessageID& msg_id);
+    int LockShard(int shard);
+    void UnLockShard(int shard);
     void UnLock();        
     int Initialize();
+    int RequestCount();
     
     uint32_t GenerateNonce();
     mc_OffchainMessageID GenerateMsgID(uint32_t timestamp);
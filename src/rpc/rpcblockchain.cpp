@@ -74,13 +74,14 @@ double GetDifficulty(const CBlockIndex* blockindex)
 Object blockToJSONForListBlocks(CBlock& block, const CBlockIndex* blockindex, bool verbose)
 {
     Object result;
+    CChainTipView tipView=GetRPCTipView();                                      // MCHN
     result.push_back(Pair("hash", blockindex->GetBlockHash().GetHex()));
 /* MCHN START */    
     CKeyID keyID;
     Value miner;
     if(mc_gState->m_NetworkParams->IsProtocolMultichain())
     {
-        if (chainActive.Contains(blockindex))
+        if (tipView.Contains(blockindex))
         {
             if(mc_gState->m_Permissions->GetBlockMiner(blockindex->nHeight,(unsigned char*)&keyID) == MC_ERR_NOERROR)
             {
@@ -92,7 +93,10 @@ Object blockToJSONForListBlocks(CBlock& block, const CBlockIndex* blockindex, bo
             unsigned char sig[255];
             int sig_size;
             uint32_t hash_type;
-            FindSigner(&block, sig, &sig_size, &hash_type);
+            {
+                LOCK(cs_main);                                                  // FindSigner uses mc_gState->m_TmpScript1
+                FindSigner(&block, sig, &sig_size, &hash_type);
+            }
             std::vector<unsigned char> vchPubKey=std::vector<unsigned char> (block.vSigner+1, block.vSigner+1+block.vSigner[0]);
             CPubKey pubKeyOut(vchPubKey);
             keyID=pubKeyOut.GetID();
@@ -103,8 +107,8 @@ Object blockToJSONForListBlocks(CBlock& block, const CBlockIndex* blockindex, bo
 /* MCHN END */        
     int confirmations = -1;
     // Only report confirmations if the block is on the main chain
-    if (chainActive.Contains(blockindex))
-        confirmations = chainActive.Height() - blockindex->nHeight + 1;
+    if (tipView.Contains(blockindex))
+        confirmations = tipView.Height() - blockindex->nHeight + 1;
     result.push_back(Pair("confirmations", confirmations));
     result.push_back(Pair("height", blockindex->nHeight));
     result.push_back(Pair("time", (int64_t)blockindex->nTime));
@@ -122,7 +126,7 @@ Object blockToJSONForListBlocks(CBlock& block, const CBlockIndex* blockindex, bo
 
         if (blockindex->pprev)
             result.push_back(Pair("previousblockhash", blockindex->pprev->GetBlockHash().GetHex()));
-        CBlockIndex *pnext = chainActive.Next(blockindex);
+        CBlockIndex *pnext = tipView.Next(blockindex);
         if (pnext)
             result.push_back(Pair("nextblockhash", pnext->GetBlockHash().GetHex()));
     }
@@ -135,13 +139,14 @@ Object blockToJSONForListBlocks(CBlock& block, const CBlockIndex* blockindex, bo
 Object blockToJSON(CBlock& block, const CBlockIndex* blockindex, bool txDetails = false, int verbose_level = 1)
 {
     Object result;
+    CChainTipView tipView=GetRPCTipView();                                      // MCHN
     result.push_back(Pair("hash", block.GetHash().GetHex()));
 /* MCHN START */    
     CKeyID keyID;
     Value miner;
     if(mc_gState->m_NetworkParams->IsProtocolMultichain())
     {
-        if (chainActive.Contains(blockindex))
+        if (tipView.Contains(blockindex))
         {
             if(mc_gState->m_Permissions->GetBlockMiner(blockindex->nHeight,(unsigned char*)&keyID) == MC_ERR_NOERROR)
             {
@@ -153,7 +158,10 @@ Object blockToJSON(CBlock& block, const CBlockIndex* blockindex, bool txDetails
             unsigned char sig[255];
             int sig_size;
             uint32_t hash_type;
-            FindSigner(&block, sig, &sig_size, &hash_type);
+            {
+                LOCK(cs_main);                                                  // FindSigner uses mc_gState->m_TmpScript1
+                FindSigner(&block, sig, &sig_size, &hash_type);
+            }
             std::vector<unsigned char> vchPubKey=std::vector<unsigned char> (block.vSigner+1, block.vSigner+1+block.vSigner[0]);
             CPubKey pubKeyOut(vchPubKey);
             keyID=pubKeyOut.GetID();
@@ -164,8 +172,8 @@ Object blockToJSON(CBlock& block, const CBlockIndex* blockindex, bool txDetails
 /* MCHN END */        
     int confirmations = -1;
     // Only report confirmations if the block is on the main chain
-    if (chainActive.Contains(blockindex))
-        confirmations = chainActive.Height() - blockindex->nHeight + 1;
+    if (tipView.Contains(blockindex))
+        confirmations = tipView.Height() - blockindex->nHeight + 1;
     result.push_back(Pair("confirmations", confirmations));
     result.push_back(Pair("size", (int)::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION)));
     result.push_back(Pair("height", blockindex->nHeight));
@@ -212,14 +220,19 @@ Object blockToJSON(CBlock& block, const CBlockIndex* blockindex, bool txDetails
     result.push_back(Pair("difficulty", GetDifficulty(blockindex)));
     result.push_back(Pair("chainwork", blockindex->nChainWork.GetHex()));
 
-    if(blockindex->nStatus & BLOCK_FAILED_MASK)
+    bool fFailed;
+    {
+        LOCK(cs_main);                                                          // nStatus is updated under cs_main
+        fFailed=(blockindex->nStatus & BLOCK_FAILED_MASK) != 0;
+    }
+    if(fFailed)
     {
         result.push_back(Pair("valid", false));        
     }
     
     if (blockindex->pprev)
         result.push_back(Pair("previousblockhash", blockindex->pprev->GetBlockHash().GetHex()));
-    CBlockIndex *pnext = chainActive.Next(blockindex);
+    CBlockIndex *pnext = tipView.Next(blockindex);
     if (pnext)
         result.push_back(Pair("nextblockhash", pnext->GetBlockHash().GetHex()));
     return result;
@@ -231,7 +244,7 @@ Value getblockcount(const Array& params, bool fHelp)
     if (fHelp || params.size() != 0)
         throw runtime_error("Help message not found\n");
 
-    return chainActive.Height();
+    return GetRPCTipView().Height();                                            // MCHN
 }
 
 Value getbestblockhash(const Array& params, bool fHelp)
@@ -239,7 +252,7 @@ Value getbestblockhash(const Array& params, bool fHelp)
     if (fHelp || params.size() != 0)
         throw runtime_error("Help message not found\n");
 
-    return chainActive.Tip()->GetBlockHash().GetHex();
+    return GetRPCTipView().Tip()->GetBlockHash().GetHex();                      // MCHN
 }
 
 Value getdifficulty(const Array& params, bool fHelp)
@@ -307,10 +320,11 @@ Value getblockhash(const Array& params, bool fHelp)
         throw runtime_error("Help message not found\n");
 
     int64_t nHeight = params[0].get_int64();                                    // MCHN - was int
-    if (nHeight < 0 || nHeight > chainActive.Height())
+    CChainTipView tipView=GetRPCTipView();                                      // MCHN
+    if (nHeight < 0 || nHeight > tipView.Height())
         throw JSONRPCError(RPC_BLOCK_NOT_FOUND, "Block height out of range");
 
-    CBlockIndex* pblockindex = chainActive[nHeight];
+    CBlockIndex* pblockindex = tipView[nHeight];
     return pblockindex->GetBlockHash().GetHex();
 }
 
@@ -422,7 +436,8 @@ Value getlastblockinfo(const Array& params, bool fHelp)
         mc_ThrowHelpMessage("getlastblockinfo");        
 //        throw runtime_error("Help message not found\n");
     
-    CBlockIndex* pblockindex = chainActive.Tip();
+    CChainTipView tipView=GetRPCTipView();
+    CBlockIndex* pblockindex = tipView.Tip();
     
     if(params.size() == 1)
     {
@@ -432,10 +447,10 @@ Value getlastblockinfo(const Array& params, bool fHelp)
         }
         
         int skip=params[0].get_int();
-        if (skip < 0 || skip > chainActive.Height())
+        if (skip < 0 || skip > tipView.Height())
             throw JSONRPCError(RPC_BLOCK_NOT_FOUND, "Skip out of range");
         
-        pblockindex=chainActive[chainActive.Height() - skip];
+        pblockindex=tipView[tipView.Height() - skip];
     }
    
     Object result;
@@ -489,12 +504,13 @@ Value getblock(const Array& params, bool fHelp)
         }        
     }
     
+    CChainTipView tipView=GetRPCTipView();                                      // MCHN
     if(!is_hash)
     {
-        if (nHeight < 0 || nHeight > chainActive.Height())
+        if (nHeight < 0 || nHeight > tipView.Height())
             throw JSONRPCError(RPC_BLOCK_NOT_FOUND, "Block height out of range");
 
-        strHash=chainActive[nHeight]->GetBlockHash().GetHex();                    
+        strHash=tipView[nHeight]->GetBlockHash().GetHex();                    
     }
         
 //        int nHeight = atoi(params[0].get_str().c_str());
@@ -524,16 +540,22 @@ Value getblock(const Array& params, bool fHelp)
         }
     }    
     
-    if (mapBlockIndex.count(hash) == 0)
-        throw JSONRPCError(RPC_BLOCK_NOT_FOUND, "Block not found");
-    
     CBlock block;
-    CBlockIndex* pblockindex = mapBlockIndex[hash];
+    CBlockIndex* pblockindex;
+/* MCHN START */    
+    {
+        LOCK(cs_main);                                                          // mapBlockIndex can be rehashed by new headers, lookup only
+        BlockMap::iterator mi = mapBlockIndex.find(hash);
+        if (mi == mapBlockIndex.end())
+            throw JSONRPCError(RPC_BLOCK_NOT_FOUND, "Block not found");
+        pblockindex = mi->second;
+    }
+/* MCHN END */    
 
 //    if(pMultiChainFilterEngine->m_TxID != 0)
     if(pMultiChainFilterEngine->InFilter())
     {
-        if (!chainActive.Contains(pblockindex))
+        if (!tipView.Contains(pblockindex))
         {
             throw JSONRPCError(RPC_BLOCK_NOT_FOUND, "Block not found in active chain");
         }    
@@ -551,6 +573,12 @@ Value getblock(const Array& params, bool fHelp)
         return HexStr(ssBlock.begin(), ssBlock.end());
     }
 
+    if(verbose_level == 4)
+    {
+        LOCK(cs_main);                                                          // MCHN - TxToJSON uses shared temporary buffers
+        return blockToJSON(block, pblockindex, true, verbose_level);
+    }
+    
     return blockToJSON(block, pblockindex, true, verbose_level);
 }
 
@@ -54,3 +54,61 @@ Value getchunkqueuetotals(const Array& params, bool fHelp)
     
     return result;
 }
+
+Value getchunkpeerinfo(const Array& params, bool fHelp)
+{
+    Array result;
+    int64_t time_now;
+    mc_ChunkCollector *collector=pwalletTxsMain->m_ChunkCollector;
+    
+    time_now=GetTimeMillis();
+    
+    collector->Lock();
+    
+    BOOST_FOREACH(PAIRTYPE(const int64_t, mc_ChunkCollectorPeerStat)& item, collector->m_PeerStats)    
+    {
+        Object entry;
+        Object requested;
+        Object delivered;
+        int pending=0;
+        
+        for(map<mc_OffchainMessageID,mc_ChunkCollectorPendingRequest>::iterator itreq = collector->m_PendingRequests.begin();itreq != collector->m_PendingRequests.end();itreq++)
+        {
+            if(itreq->second.m_DestinationID == item.first)
+            {
+                pending++;
+            }
+        }
+        
+        requested.push_back(Pair("chunks",item.second.m_RequestedChunks));
+        requested.push_back(Pair("bytes",item.second.m_RequestedBytes));
+        delivered.push_back(Pair("chunks",item.second.m_DeliveredChunks));
+        delivered.push_back(Pair("bytes",item.second.m_DeliveredBytes));
+        
+        entry.push_back(Pair("id",(int64_t)(item.first >> 32)));
+        entry.push_back(Pair("source",(int64_t)(item.first & 0xFFFFFFFF)));
+        entry.push_back(Pair("requests",item.second.m_Requests));
+        entry.push_back(Pair("responses",item.second.m_Responses));
+        entry.push_back(Pair("badresponses",item.second.m_BadResponses));
+        entry.push_back(Pair("timeouts",item.second.m_Timeouts));
+        entry.push_back(Pair("pending",pending));
+        entry.push_back(Pair("requested",requested));
+        entry.push_back(Pair("delivered",delivered));
+        entry.push_back(Pair("rtt",item.second.m_RTT));
+        entry.push_back(Pair("bytespersecond",item.second.m_BytesPerSecond));
+        entry.push_back(Pair("window",collector->DestinationWindow(item.first,(int64_t)collector->m_MaxKBPerDestination*1024)));
+        if(item.second.m_LastResponseTime)
+        {
+            entry.push_back(Pair("lastresponse",(time_now-item.second.m_LastResponseTime)/1000));
+        }
+        else
+        {
+            entry.push_back(Pair("lastresponse",Value::null));            
+        }
+        result.push_back(entry);
+    }
+    
+    collector->UnLock();
+    
+    return result;
+}
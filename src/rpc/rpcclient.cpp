@@ -37,6 +37,7 @@ static const std::string vAPINames[] =
 "appendrawtransaction",
 "approvefrom",
 "backupwallet",
+"cancelrescan",
 "clearmempool",
 "combineunspent",
 "completerawexchange",
@@ -61,6 +62,7 @@ static const std::string vAPINames[] =
 "encryptwallet",
 "estimatefee",
 "estimatepriority",
+"exportstreamitems",
 "filters",
 "getaccount",
 "getaccountaddress",
@@ -81,6 +83,7 @@ static const std::string vAPINames[] =
 "getblockhash",
 "getblocktemplate",
 "getchaintips",
+"getchunkpeerinfo",
 "getchunkqueueinfo",
 "getchunkqueuetotals",
 "getconnectioncount",
@@ -88,6 +91,7 @@ static const std::string vAPINames[] =
 "getfilterassetbalances",
 "getfiltertokenbalances",
 "getfiltercode",
+"getfilterstats",
 "getfilterstreamitem",
 "getfilterstream",
 "getfiltertransaction",
@@ -112,6 +116,7 @@ static const std::string vAPINames[] =
 "liststorednodes",
 "getrawchangeaddress",
 "getrawmempool",
+"getrescaninfo",
 "getrawtransaction",
 "getreceivedbyaccount",
 "getreceivedbyaddress",
@@ -283,6 +288,7 @@ static const std::string vAPINames[] =
 "update",
 "updatefrom",
 "getdiagnostics",
+"getcacheinfo",
 "applycommands",
 "decodehexubjson",
 "encodehexubjson",
@@ -367,7 +373,8 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "testtxfilter", 0 },                                                            
     { "teststreamfilter", 0 },                                                            
     { "teststreamfilter", 3 },                                                            
-    { "runstreamfilter", 2 },                                                            
+    { "runstreamfilter", 2 },
+    { "getfilterstats", 0 },                                                            
     { "publishfrom", 2 },                                                            
     { "publishfrom", 3 },                                                            
     { "publish", 1 },
@@ -497,6 +504,10 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "liststreamitems", 2 },
     { "liststreamitems", 3 },
     { "liststreamitems", 4 },
+    { "exportstreamitems", 3 },
+    { "exportstreamitems", 4 },
+    { "exportstreamitems", 5 },
+    { "exportstreamitems", 6 },
     { "gettxoutdata", 1 },
     { "gettxoutdata", 2 },
     { "gettxoutdata", 3 },
@@ -515,6 +526,8 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "liststreampublishers", 5 },
     { "liststreamqueryitems", 1 },
     { "liststreamqueryitems", 2 },
+    { "liststreamqueryitems", 3 },
+    { "liststreamqueryitems", 4 },
     { "liststreamkeyitems", 2 },
     { "liststreamkeyitems", 3 },
     { "liststreamkeyitems", 4 },
@@ -171,7 +171,18 @@ Value importprivkey(const Array& params, bool fHelp)
     }    
     
     if (fRescan) {
-        pwalletMain->ScanForWalletTransactions(chainActive[start_block], true, true);
+        if(GetBoolArg("-rescanbackground",false) || IsBackgroundRescanActive())
+        {
+            string strError;
+            if(!StartBackgroundRescan(pwalletMain,start_block,true,false,false,strError))
+            {
+                throw JSONRPCError(RPC_NOT_ALLOWED, strError);                        
+            }
+        }
+        else
+        {
+            pwalletMain->ScanForWalletTransactions(chainActive[start_block], true, true);
+        }
     }
     
     return Value::null;
@@ -295,8 +306,19 @@ Value importaddress(const Array& params, bool fHelp)
     {
         if (fRescan)
         {
-            pwalletMain->ScanForWalletTransactions(chainActive[start_block], true, true);
-            pwalletMain->ReacceptWalletTransactions();
+            if(GetBoolArg("-rescanbackground",false) || IsBackgroundRescanActive())
+            {
+                string strError;
+                if(!StartBackgroundRescan(pwalletMain,start_block,true,false,true,strError))
+                {
+                    throw JSONRPCError(RPC_NOT_ALLOWED, strError);                        
+                }
+            }
+            else
+            {
+                pwalletMain->ScanForWalletTransactions(chainActive[start_block], true, true);
+                pwalletMain->ReacceptWalletTransactions();
+            }
         }
     }
 
@@ -1319,6 +1319,73 @@ Value testtxfilter(const json_spirit::Array& params, bool fHelp)
     return testfilter(entities, js, (params.size() > 2) ? params[2] : Value::null, -1, MC_FLT_TYPE_TX, library_code);
 }
 
+Object FilterLatencyEntry(mc_MultiChainFilterStats *stats)
+{
+    Object latency;
+    
+    latency.push_back(Pair("average",(stats->m_Count > 0) ? 0.001*(double)stats->m_TotalMicros/stats->m_Count : 0.));
+    latency.push_back(Pair("p50",0.001*stats->Percentile(50)));
+    latency.push_back(Pair("p99",0.001*stats->Percentile(99)));
+    latency.push_back(Pair("max",0.001*stats->m_MaxMicros));
+    
+    return latency;
+}
+
+Value getfilterstats(const json_spirit::Array& params, bool fHelp)
+{
+    if (fHelp || params.size() > 1)
+        throw runtime_error("Help message not found\n");
+    
+    bool reset=false;
+    if (params.size() > 0)    
+    {
+        reset=paramtobool(params[0]);
+    }
+    
+    map<uint256,mc_MultiChainFilterStats> filter_stats;
+    map<string,mc_MultiChainFilterStats> callback_stats;
+    
+    pMultiChainFilterEngine->GetStats(filter_stats,callback_stats,reset);
+    
+    Array filters;
+    for(map<uint256,mc_MultiChainFilterStats>::iterator it=filter_stats.begin();it != filter_stats.end();it++)
+    {
+        Object entry;
+        Object heap;
+        
+        entry.push_back(Pair("txid",it->first.ToString()));
+        entry.push_back(Pair("name",it->second.m_Caption));
+        entry.push_back(Pair("type",(it->second.m_FilterType == MC_FLT_TYPE_STREAM) ? "streamfilter" : "txfilter"));
+        entry.push_back(Pair("runs",it->second.m_Count));
+        entry.push_back(Pair("rejected",it->second.m_Rejected));
+        entry.push_back(Pair("timeouts",it->second.m_Timeouts));
+        entry.push_back(Pair("errors",it->second.m_Errors));
+        entry.push_back(Pair("latency",FilterLatencyEntry(&(it->second))));
+        heap.push_back(Pair("last",it->second.m_LastHeapUsed));
+        heap.push_back(Pair("max",it->second.m_MaxHeapUsed));
+        entry.push_back(Pair("heap",heap));
+        filters.push_back(entry);
+    }
+    
+    Array callbacks;
+    for(map<string,mc_MultiChainFilterStats>::iterator it=callback_stats.begin();it != callback_stats.end();it++)
+    {
+        Object entry;
+        
+        entry.push_back(Pair("name",it->first));
+        entry.push_back(Pair("calls",it->second.m_Count));
+        entry.push_back(Pair("errors",it->second.m_Errors));
+        entry.push_back(Pair("latency",FilterLatencyEntry(&(it->second))));
+        callbacks.push_back(entry);
+    }
+    
+    Object result;
+    result.push_back(Pair("filters",filters));
+    result.push_back(Pair("callbacks",callbacks));
+    
+    return result;
+}
+
 Value runstreamfilter(const json_spirit::Array& params, bool fHelp)
 {
     if (fHelp || params.size() < 1 || params.size() > 3)
@@ -2359,7 +2359,8 @@ void mc_InitRPCHelpMap10()
             "2. \"label\"                          (string, optional, default=\"\") An optional label\n"
             "3. rescan                           (boolean or integer, optional, default=true) Rescan the wallet for transactions. \n"
             "                                                       If integer rescan from block, if negative - from the end.\n"
-            "\nNote: This call can take minutes to complete if rescan is true.\n"
+            "\nNote: This call can take minutes to complete if rescan is true,\n"
+            "unless -rescanbackground is set. Use getrescaninfo to follow the background rescan.\n"
             "\nResult:\n"
             "\nExamples:\n"
             "\nImport an address with rescan\n"
@@ -2793,6 +2794,40 @@ void mc_InitRPCHelpMap12()
             + HelpExampleRpc("liststreamitems", "\"test-stream\", false, 20")
         ));
     
+    mapHelpStrings.insert(std::make_pair("exportstreamitems",
+            "exportstreamitems \"stream-identifier\" \"filename\" ( \"format\" verbose count start local-ordering )\n"
+            "\nWrites stream items to file in a single call. Items are read page by page, memory use does not depend on the number of items.\n"
+            "\nArguments:\n"
+            "1. \"stream-identifier\"              (string, required) Stream identifier - one of: create txid, stream reference, stream name.\n"
+            "2. \"filename\"                       (string, required) The output file name, relative to the node working directory if not absolute\n"
+            "3. \"format\"                         (string, optional, default=ndjson) One of: ndjson, binary\n"
+            "                                                         ndjson - one stream item per line, as in liststreamitems.\n"
+            "                                                         If item data is shown as reference (larger than maxshowndata or off-chain),\n"
+            "                                                         full data is added to the reference as \"hex\" field.\n"
+            "                                                         binary - \"MCSI\" followed by version byte 1, then for every item:\n"
+            "                                                         txid (32 bytes), vout (uint32), block (int32, -1 if unconfirmed),\n"
+            "                                                         blocktime (uint32), flags (uint8, 1 - off-chain, 2 - available), format (uint8),\n"
+            "                                                         keys and publishers (compact size count, compact size prefixed strings),\n"
+            "                                                         data size (uint64) and raw item data, including off-chain data.\n"
+            "                                                         Integers are little-endian.\n"
+            "4. verbose                          (boolean, optional, default=false) If true, includes information about item transaction, ndjson only\n"
+            "5. count                            (number, optional, default=INT_MAX - all) The number of items to export\n"
+            "6. start                            (number, optional, default=0) Start from specific item, 0 based, if negative - from the end\n"
+            "7. local-ordering                   (boolean, optional, default=false) If true, items appear in the order they were processed by the wallet,\n"
+            "                                                                       if false - in the order they appear in blockchain\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"file\": \"filename\",            (string) Output file name\n"
+            "  \"format\": \"format\",            (string) Output format\n"
+            "  \"items\": n,                    (numeric) Number of exported items\n"
+            "  \"bytes\": n                     (numeric) Number of bytes written\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("exportstreamitems", "\"test-stream\" \"/tmp/test-stream.ndjson\"") 
+            + HelpExampleCli("exportstreamitems", "\"test-stream\" \"/tmp/test-stream.bin\" binary") 
+            + HelpExampleRpc("exportstreamitems", "\"test-stream\", \"/tmp/test-stream.ndjson\", \"ndjson\", true")
+        ));
+    
     mapHelpStrings.insert(std::make_pair("liststreamkeyitems",
             "liststreamkeyitems \"stream-identifier\" \"key\" ( verbose count start local-ordering )\n"
             "\nReturns stream items for specific key.\n"
@@ -3598,7 +3633,8 @@ void mc_InitRPCHelpMap15()
             "                                                         items-local - same as items, for local-ordering=true,\n"
             "                                                         keys-local - same as keys, for local-ordering=true,\n"
             "                                                         publishers-local - same as publishers, for local-ordering=true\n"
-            "\nNote: This call can take minutes to complete if rescan is true.\n"
+            "\nNote: This call can take minutes to complete if rescan is true,\n"
+            "unless -rescanbackground is set. Use getrescaninfo to follow the background rescan.\n"
             "\nResult:\n"
             "\nExamples:\n"
             "\nSubscribe to the stream with rescan\n"
@@ -4376,9 +4412,36 @@ void mc_InitRPCHelpMap18()
             + HelpExampleRpc("getchunkqueuetotals", "")
         ));
     
+    mapHelpStrings.insert(std::make_pair("getchunkpeerinfo",
+            "getchunkpeerinfo\n"
+            "\nReturns chunk retrieval statistics for each peer which received chunk requests.\n"
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"id\": n,                          (numeric) Peer index, as in getpeerinfo\n"
+            "    \"source\": n,                      (numeric) Source of the chunks behind this peer, 0 if peer itself\n"
+            "    \"requests\": n,                    (numeric) Number of chunk requests sent\n"
+            "    \"responses\": n,                   (numeric) Number of valid responses\n"
+            "    \"badresponses\": n,                (numeric) Number of invalid responses\n"
+            "    \"timeouts\": n,                    (numeric) Number of requests expired without response\n"
+            "    \"pending\": n,                     (numeric) Number of requests in flight\n"
+            "    \"requested\": {...},               (object) Number of requested chunks and bytes\n"
+            "    \"delivered\": {...},               (object) Number of delivered chunks and bytes\n"
+            "    \"rtt\": n,                         (numeric) Smoothed request round trip time, in milliseconds\n"
+            "    \"bytespersecond\": n,              (numeric) Smoothed throughput, in bytes per second\n"
+            "    \"window\": n,                      (numeric) Number of bytes which can be requested at once\n"
+            "    \"lastresponse\": n,                (numeric) Seconds since the last response\n"
+            "  }\n"
+            "  ,...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getchunkpeerinfo", "")
+            + HelpExampleRpc("getchunkpeerinfo", "")
+        ));
+    
     
      mapHelpStrings.insert(std::make_pair("liststreamqueryitems",
-            "liststreamqueryitems \"stream-identifier\" query ( verbose )\n"
+            "liststreamqueryitems \"stream-identifier\" query ( verbose count start )\n"
             "\nReturns stream items for specific query.\n"
             "\nArguments:\n"
             "1. \"stream-identifier\"              (string, required) Stream identifier - one of: create txid, stream reference, stream name.\n"
@@ -4391,13 +4454,24 @@ void mc_InitRPCHelpMap18()
             "      \"publisher\" : \"publisher\"       (string, optional, default: \"\") Publisher\n"
             "        or\n"
             "      \"publishers\" : publishers       (array, optional) Publishers, array of strings\n"
+            "        and/or\n"
+            "      \"anykeys\" : keys                (array, optional) Item should have at least one of these keys\n"
+            "        and/or\n"
+            "      \"anypublishers\" : publishers    (array, optional) Item should have at least one of these publishers\n"
+            "        and/or\n"
+            "      \"notkeys\" : keys                (array, optional) Item should have none of these keys\n"
+            "        and/or\n"
+            "      \"notpublishers\" : publishers    (array, optional) Item should have none of these publishers\n"
             "    }\n"                                
             "3. verbose                          (boolean, optional, default=false) If true, returns information about item transaction \n"
+            "4. count                            (number, optional, default=all) The number of items to display\n"
+            "5. start                            (number, optional, default=-count - last) Start from specific item, 0 based, if negative - from the end\n"
             "\nResult:\n"
             "\"stream-items\"                      (array) List of stream items for specific query.\n"
             "\nExamples:\n"
             + HelpExampleCli("liststreamqueryitems", "\"test-stream\" \"{\\\"keys\\\":[\\\"key01\\\",\"key02\"]}\"") 
             + HelpExampleCli("liststreamqueryitems", "\"test-stream\" \"{\\\"keys\\\":[\\\"key01\\\",\"key02\"],\\\"publisher\\\":\\\"1D1ZrZNe3JUo7ZycKEYQQiQAWd9y54F4XZ\\\"}\" true ") 
+            + HelpExampleCli("liststreamqueryitems", "\"test-stream\" \"{\\\"anykeys\\\":[\\\"key01\\\",\"key02\"],\\\"notkeys\\\":[\\\"key03\\\"]}\" false 10 0") 
             + HelpExampleRpc("liststreamqueryitems", "\"test-stream\", \"{\\\"keys\\\":[\\\"key01\\\",\"key02\"],\\\"publisher\\\":\\\"1D1ZrZNe3JUo7ZycKEYQQiQAWd9y54F4XZ\\\"}\", false")
         ));
     
@@ -4644,6 +4718,40 @@ void mc_InitRPCHelpMap19()
             + HelpExampleRpc("runstreamfilter", "filter1")
         ));
      
+     mapHelpStrings.insert(std::make_pair("getfilterstats",
+            "getfilterstats ( reset )\n"
+            "\nReturns execution statistics of filters and filter callbacks since node start or last reset\n"
+            "\nArguments:\n"
+            "1. reset                            (boolean, optional, default=false) Reset statistics after returning them\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"filters\": [                      (array of objects) Statistics for each filter which was run\n"
+            "    {\n"
+            "      \"txid\": \"txid\",               (string) Filter create txid\n"
+            "      \"name\": \"name\",               (string) Filter name\n"
+            "      \"type\": \"type\",               (string) txfilter or streamfilter\n"
+            "      \"runs\": n,                    (numeric) Number of filter runs\n"
+            "      \"rejected\": n,                (numeric) Number of rejected transactions or stream items\n"
+            "      \"timeouts\": n,                (numeric) Number of runs aborted by timeout\n"
+            "      \"errors\": n,                  (numeric) Number of engine errors\n"
+            "      \"latency\": {...},             (object) Average, median (p50), p99 and maximal run time, in milliseconds\n"
+            "      \"heap\": {...},                (object) Last and maximal V8 heap size used after the run, in bytes\n"
+            "    }\n"
+            "  ],\n"
+            "  \"callbacks\": [                    (array of objects) Statistics for each callback function which was called\n"
+            "    {\n"
+            "      \"name\": \"name\",               (string) Callback name\n"
+            "      \"calls\": n,                   (numeric) Number of calls, not including calls served from cache\n"
+            "      \"errors\": n,                  (numeric) Number of calls which returned error\n"
+            "      \"latency\": {...},             (object) Average, median (p50), p99 and maximal call time, in milliseconds\n"
+            "    }\n"
+            "  ]\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getfilterstats", "")
+            + HelpExampleRpc("getfilterstats", "")
+        ));
+     
      mapHelpStrings.insert(std::make_pair("teststreamfilter",
             "teststreamfilter restrictions \"javascript-code\" ( \"tx-hex\"|\"txid\" vout )\n"
             "\nCompile a test filter and optionally test it on a transaction\n"
@@ -4811,6 +4919,39 @@ void mc_InitRPCHelpMap20()
             + HelpExampleRpc("trimsubscribe", "\"test-stream\", \"retrieve,publishers\"")
          ));
     
+    mapHelpStrings.insert(std::make_pair("getrescaninfo",
+            "getrescaninfo\n"
+            "\nReturns the status of the background rescan started by subscribe, importaddress or importprivkey\n"
+            "when -rescanbackground is set.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"status\": \"status\",          (string) One of: idle, running, completed, cancelled, failed\n"
+            "  \"active\": true|false,        (boolean) Rescan is running\n"
+            "  \"startblock\": n,             (numeric) First block of the rescan\n"
+            "  \"currentblock\": n,           (numeric) Last block merged into the import\n"
+            "  \"chainblock\": n,             (numeric) Active chain height, the rescan completes when it catches up with it\n"
+            "  \"progress\": x.xx,            (numeric) Percentage of blocks scanned\n"
+            "  \"pending\": true|false,       (boolean) Another pass was requested while the rescan was running\n"
+            "  \"restarts\": n,               (numeric) Number of restarts caused by chain reorganizations\n"
+            "  \"starttime\": n,              (numeric) Start time, seconds since epoch\n"
+            "  \"elapsed\": n,                (numeric) Duration in seconds\n"
+            "  \"error\": n                   (numeric) Error code if the rescan failed\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getrescaninfo", "")
+            + HelpExampleRpc("getrescaninfo", "")
+        ));
+    
+    mapHelpStrings.insert(std::make_pair("cancelrescan",
+            "cancelrescan\n"
+            "\nCancels the background rescan. Entities remain not synchronized and can be rescanned later.\n"
+            "\nResult:\n"
+            "true|false                          (boolean) True if the running rescan was cancelled\n"
+            "\nExamples:\n"
+            + HelpExampleCli("cancelrescan", "")
+            + HelpExampleRpc("cancelrescan", "")
+        ));
+    
     mapHelpStrings.insert(std::make_pair("retrievestreamitems",
             "retrievestreamitems stream-identifier \"txids\"|txouts|blocks|query\n"
             "\nAvailable only in Enterprise Edition.\n"
@@ -5739,6 +5880,40 @@ void mc_InitRPCHelpMap25()
             + HelpExampleRpc("getdiagnostics", "")
         ));
     
+    mapHelpStrings.insert(std::make_pair("getcacheinfo",
+            "getcacheinfo\n"
+            "\nReturns statistics of in-memory caches.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"permissions\" : {                (object) Permission row cache, size is set by -permissioncachesize\n"
+            "    \"enabled\" : true|false,        (boolean) Cache is enabled\n"
+            "    \"size\" : n,                    (numeric) Number of cache slots\n"
+            "    \"version\" : n,                 (numeric) Number of permission database modifications\n"
+            "    \"hits\" : n,                    (numeric) Number of lookups served from cache\n"
+            "    \"misses\" : n,                  (numeric) Number of lookups served from database\n"
+            "    \"inserts\" : n,                 (numeric) Number of rows stored in cache\n"
+            "    \"evictions\" : n,               (numeric) Number of rows replaced by other rows\n"
+            "    \"invalidations\" : n,           (numeric) Number of rows removed after block commit\n"
+            "    \"resets\" : n,                  (numeric) Number of times cache was cleared on rollback\n"
+            "  },\n"
+            "  \"entities\" : {                   (object) Entity key index, memory budget is set by -entityindexmemory\n"
+            "    \"enabled\" : true|false,        (boolean) Index is enabled, lookups are served from database otherwise\n"
+            "    \"overflow\" : true|false,       (boolean) Index was disabled because memory budget was exceeded\n"
+            "    \"size\" : n,                    (numeric) Number of index slots\n"
+            "    \"rows\" : n,                    (numeric) Number of indexed keys (txid, ref, name and short txid)\n"
+            "    \"memory\" : n,                  (numeric) Memory used by the index, in bytes\n"
+            "    \"maxmemory\" : n,               (numeric) Memory budget, in bytes\n"
+            "    \"hits\" : n,                    (numeric) Number of lookups of existing keys\n"
+            "    \"misses\" : n,                  (numeric) Number of lookups of missing keys\n"
+            "    \"writes\" : n,                  (numeric) Number of keys written since startup\n"
+            "    \"deletes\" : n,                 (numeric) Number of keys deleted since startup\n"
+            "  }\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getcacheinfo", "")
+            + HelpExampleRpc("getcacheinfo", "")
+        ));
+    
     mapHelpStrings.insert(std::make_pair("applycommands",
             "applycommands \"commands\"\n"
             "\nRuns API commands described in hex-encoded UBJSON array.\n"
@@ -5912,6 +6087,15 @@ void mc_InitRPCAllowedWhenOffline()
     
 }
 
+void mc_InitRPCReadFromTipView()
+{
+    setReadFromTipView.insert("getblockcount");    
+    setReadFromTipView.insert("getbestblockhash");    
+    setReadFromTipView.insert("getblockhash");    
+    setReadFromTipView.insert("getblock");    
+    setReadFromTipView.insert("getlastblockinfo");    
+}
+
 void mc_InitRPCHelpMap()
 {
     mc_InitRPCHelpMap01();
@@ -5945,6 +6129,7 @@ void mc_InitRPCHelpMap()
     mc_InitRPCLogParamCountMap();
     mc_InitRPCAllowedWhenWaitingForUpgradeSet();    
     mc_InitRPCAllowedWhenOffline();    
+    mc_InitRPCReadFromTipView();    
 }
 
 Value purehelpitem(const Array& params, bool fHelp)
@@ -65,6 +65,7 @@ static const CRPCCommand vRPCCommands[] =
     { "control",            "getruntimeparams",       &getruntimeparams,       true,      false,      false }, 
     { "control",            "setruntimeparam",        &setruntimeparam,        true,      false,      false }, 
     { "control",            "getdiagnostics",         &getdiagnostics,         true,      false,      false }, 
+    { "control",            "getcacheinfo",           &getcacheinfo,           true,      true,       false }, 
     { "control",            "applycommands",          &applycommands,          true,      false,      false }, 
 /* MCHN END */    
 
@@ -80,6 +81,7 @@ static const CRPCCommand vRPCCommands[] =
     { "network",            "ping",                   &ping,                   true,      false,      false },
     { "network",            "getchunkqueueinfo",      &getchunkqueueinfo,      true,      true,       false },
     { "network",            "getchunkqueuetotals",    &getchunkqueuetotals,    true,      true,       false },
+    { "network",            "getchunkpeerinfo",       &getchunkpeerinfo,       true,      true,       false },
 
     /* Block chain and UTXO */
     { "blockchain",         "getblockchaininfo",      &getblockchaininfo,      true,      false,      false },
@@ -111,6 +113,7 @@ static const CRPCCommand vRPCCommands[] =
     { "blockchain",         "runtxfilter",            &runtxfilter,            true,      false,      false },
     { "blockchain",         "teststreamfilter",       &teststreamfilter,       true,      false,      false },
     { "blockchain",         "runstreamfilter",        &runstreamfilter,        true,      false,      false },
+    { "blockchain",         "getfilterstats",         &getfilterstats,         true,      true,       false },
     { "blockchain",         "listblocks",             &listblocks,             true,      false,      false },
     { "blockchain",         "getassetinfo",           &getassetinfo,           true,      false,      false },
     { "blockchain",         "getstreaminfo",          &getstreaminfo,          true,      false,      false },
@@ -316,6 +319,8 @@ static const CRPCCommand vRPCCommands[] =
     { "wallet",             "subscribe",              &subscribe,               false,     false,      true },
     { "wallet",             "unsubscribe",            &unsubscribe,             false,     false,      true },
     { "wallet",             "trimsubscribe",          &trimsubscribe,           false,     false,      true },
+    { "wallet",             "getrescaninfo",          &getrescaninfo,           true,      false,      true },
+    { "wallet",             "cancelrescan",           &cancelrescan,            true,      false,      true },
     { "wallet",             "retrievestreamitems",    &retrievestreamitems,     false,     false,      true },
     { "wallet",             "purgestreamitems",       &purgestreamitems,        false,     false,      true },
     { "wallet",             "purgepublisheditems",    &purgepublisheditems,     false,     false,      true },
@@ -324,6 +329,7 @@ static const CRPCCommand vRPCCommands[] =
     { "wallet",             "getstreamitem",          &getstreamitem,           false,      true,      true },
     { "wallet",             "liststreamtxitems",      &liststreamtxitems,       false,      true,      true },
     { "wallet",             "liststreamitems",        &liststreamitems,         false,      true,      false },
+    { "wallet",             "exportstreamitems",      &exportstreamitems,       false,      true,      false },
     { "wallet",             "liststreamqueryitems",   &liststreamqueryitems,    false,     true,      true },
     { "wallet",             "liststreamkeyitems",     &liststreamkeyitems,      false,      true,      true },
     { "wallet",             "liststreampublisheritems",&liststreampublisheritems,false,     true,      true },
@@ -1719,6 +1719,55 @@ Value getdiagnostics(const Array& params, bool fHelp)
     return HexStr(vValue);            
 }
 
+Value getcacheinfo(const Array& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error("Help message not found\n");
+    
+    Object result;
+    Object permissions;
+    mc_PermissionCache *cache;
+    
+    cache=mc_gState->m_Permissions->m_Cache;
+    
+    permissions.push_back(Pair("enabled", ( (cache != NULL) && (cache->m_Size > 0) ) ? true : false));
+    if(cache)
+    {
+        permissions.push_back(Pair("size", (int64_t)cache->m_Size));
+        permissions.push_back(Pair("version", (int64_t)cache->m_Version));
+        permissions.push_back(Pair("hits", (int64_t)cache->m_Hits));
+        permissions.push_back(Pair("misses", (int64_t)cache->m_Misses));
+        permissions.push_back(Pair("inserts", (int64_t)cache->m_Inserts));
+        permissions.push_back(Pair("evictions", (int64_t)cache->m_Evictions));
+        permissions.push_back(Pair("invalidations", (int64_t)cache->m_Invalidations));
+        permissions.push_back(Pair("resets", (int64_t)cache->m_Resets));
+    }
+    result.push_back(Pair("permissions",permissions));
+    
+    Object entities;
+    mc_EntityIndex *index;
+    
+    mc_gState->m_Assets->Lock(0);
+    index=mc_gState->m_Assets->m_Index;
+    entities.push_back(Pair("enabled", ( (index != NULL) && index->m_Enabled ) ? true : false));
+    if(index)
+    {
+        entities.push_back(Pair("overflow", index->m_Overflow ? true : false));
+        entities.push_back(Pair("size", index->m_Size));
+        entities.push_back(Pair("rows", index->m_Count));
+        entities.push_back(Pair("memory", index->GetMemory()));
+        entities.push_back(Pair("maxmemory", index->m_MaxMemory));
+        entities.push_back(Pair("hits", (int64_t)index->m_Hits));
+        entities.push_back(Pair("misses", (int64_t)index->m_Misses));
+        entities.push_back(Pair("writes", (int64_t)index->m_Writes));
+        entities.push_back(Pair("deletes", (int64_t)index->m_Deletes));
+    }
+    mc_gState->m_Assets->UnLock();
+    result.push_back(Pair("entities",entities));
+    
+    return result;
+}
+
 Value applycommands(const Array& params, bool fHelp)
 {
     if (fHelp || params.size() != 1)
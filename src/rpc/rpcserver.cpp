@@ -58,6 +58,7 @@ static CCriticalSection cs_rpcWarmup;
 static map<uint64_t, RPCThreadLoad> rpc_loads;
 static map<uint64_t, int> rpc_slots;
 static uint32_t rpc_thread_flags[MC_PRM_MAX_THREADS];
+static CChainTipView rpc_tip_views[MC_PRM_MAX_THREADS];
 
 void LockWallet(CWallet* pWallet);
 int TxThrottlingDelay(bool print);
@@ -68,6 +69,7 @@ int TxThrottlingDelay(bool print);
 #define MC_RPC_FLAG_NONE              0x00000000 
 #define MC_RPC_FLAG_WRP_READ_LOCK     0x00000001 
 #define MC_RPC_FLAG_NEW_TX            0x00000002 
+#define MC_RPC_FLAG_TIP_VIEW          0x00000004 
 
 namespace std {
     template<class T> struct _Unique_if {
@@ -771,6 +773,7 @@ void CheckFlagsOnException(const string& strMethod,const Value& req_id,const str
         LogPrintf("WARNING: Unlocking wallet after failure: method: %s, error: %s\n",JSONRPCMethodIDForLog(strMethod,req_id).c_str(),message);
         pwalletTxsMain->WRPReadUnLock();
     }   
+    SetRPCTipView(0);
     {
         LOCK(cs_rpcWarmup);
     
@@ -1072,6 +1075,39 @@ void SetRPCWRPReadLockFlag(int lock)
     }    
 }
 
+void SetRPCTipView(int pin)
+{
+    uint64_t thread_id=__US_ThreadID();
+    map<uint64_t,int>::iterator slot_it=rpc_slots.find(thread_id);
+    if(slot_it != rpc_slots.end())
+    {
+        if(pin)
+        {
+            rpc_tip_views[slot_it->second]=GetChainTipView();
+            rpc_thread_flags[slot_it->second] |= MC_RPC_FLAG_TIP_VIEW;
+        }
+        else
+        {
+            if(rpc_thread_flags[slot_it->second] & MC_RPC_FLAG_TIP_VIEW)rpc_thread_flags[slot_it->second]-=MC_RPC_FLAG_TIP_VIEW;
+            rpc_tip_views[slot_it->second]=CChainTipView();
+        }
+    }    
+}
+
+CChainTipView GetRPCTipView()
+{
+    uint64_t thread_id=__US_ThreadID();
+    map<uint64_t,int>::iterator slot_it=rpc_slots.find(thread_id);
+    if(slot_it != rpc_slots.end())
+    {
+        if(rpc_thread_flags[slot_it->second] & MC_RPC_FLAG_TIP_VIEW)
+        {
+            return rpc_tip_views[slot_it->second];
+        }
+    }    
+    return GetChainTipView();                                                   // Not pinned, last published tip, no cs_main
+}
+
 void SetRPCNewTxFlag()
 {
     uint64_t thread_id=__US_ThreadID();
@@ -1163,6 +1199,12 @@ json_spirit::Value CRPCTable::execute(const std::string &strMethod, const json_s
         {
             if (pcmd->threadSafe)
                 result = pcmd->actor(params, false);
+            else if( (setReadFromTipView.count(strMethod) != 0) && GetBoolArg("-rpcreadtipview",true) )
+            {
+                SetRPCTipView(1);                                               // Chain reads go to pinned tip view, no cs_main
+                result = pcmd->actor(params, false);
+                SetRPCTipView(0);
+            }
 #ifdef ENABLE_WALLET
             else if (!pwalletMain) {
                 LOCK(cs_main);
@@ -1254,6 +1296,7 @@ std::map<std::string, int> mapLogParamCounts;
 std::set<std::string> setAllowedWhenWaitingForUpgrade;
 std::set<std::string> setAllowedWhenOffline;
 std::set<std::string> setAllowedWhenLimited;
+std::set<std::string> setReadFromTipView;
 
 std::vector<CRPCCommand> vStaticRPCCommands;
 std::vector<CRPCCommand> vStaticRPCWalletReadCommands;
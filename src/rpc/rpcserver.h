@@ -21,6 +21,7 @@
 #include "json/json_spirit_writer_template.h"
 
 class CBlockIndex;
+class CChainTipView;
 class CNetAddr;
 
 class AcceptedConnection
@@ -116,6 +117,18 @@ void RPCRunLater(const std::string& name, boost::function<void(void)> func, int6
 
 int GetRPCSlot();
 
+/**
+ * Pins (pin=1) or releases (pin=0) chain tip view for this RPC thread
+ */
+
+void SetRPCTipView(int pin);
+
+/**
+ * Returns chain tip view pinned for this RPC thread, or last published chain tip view if not pinned
+ */
+
+CChainTipView GetRPCTipView();
+
 typedef json_spirit::Value(*rpcfn_type)(const json_spirit::Array& params, bool fHelp);
 
 class CRPCCommand
@@ -161,6 +174,7 @@ extern std::map<std::string, int> mapLogParamCounts;
 extern std::set<std::string> setAllowedWhenWaitingForUpgrade;
 extern std::set<std::string> setAllowedWhenOffline;
 extern std::set<std::string> setAllowedWhenLimited;
+extern std::set<std::string> setReadFromTipView;
 extern std::vector<CRPCCommand> vStaticRPCCommands;
 extern std::vector<CRPCCommand> vStaticRPCWalletReadCommands;
 void mc_InitRPCHelpMap();
@@ -234,6 +248,7 @@ extern json_spirit::Value sendtoaddress(const json_spirit::Array& params, bool f
 extern json_spirit::Value debug(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value getchunkqueueinfo(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value getchunkqueuetotals(const json_spirit::Array& params, bool fHelp);
+extern json_spirit::Value getchunkpeerinfo(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value createkeypairs(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value getaddresses(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value createbinarycache(const json_spirit::Array& params, bool fHelp);
@@ -300,6 +315,7 @@ extern json_spirit::Value testtxfilter(const json_spirit::Array& params, bool fH
 extern json_spirit::Value runtxfilter(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value teststreamfilter(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value runstreamfilter(const json_spirit::Array& params, bool fHelp);
+extern json_spirit::Value getfilterstats(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value getassetinfo(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value getstreaminfo(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value verifypermission(const json_spirit::Array& params, bool fHelp);
@@ -315,6 +331,8 @@ extern json_spirit::Value publishmultifrom(const json_spirit::Array& params, boo
 extern json_spirit::Value subscribe(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value unsubscribe(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value trimsubscribe(const json_spirit::Array& params, bool fHelp);
+extern json_spirit::Value getrescaninfo(const json_spirit::Array& params, bool fHelp);
+extern json_spirit::Value cancelrescan(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value retrievestreamitems(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value purgestreamitems(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value purgepublisheditems(const json_spirit::Array& params, bool fHelp);
@@ -323,6 +341,7 @@ extern json_spirit::Value getassettransaction(const json_spirit::Array& params,
 extern json_spirit::Value getstreamitem(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value liststreamtxitems(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value liststreamitems(const json_spirit::Array& params, bool fHelp);
+extern json_spirit::Value exportstreamitems(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value liststreamkeyitems(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value liststreamqueryitems(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value liststreampublisheritems(const json_spirit::Array& params, bool fHelp);
@@ -362,6 +381,7 @@ extern json_spirit::Value addlibraryupdatefrom(const json_spirit::Array& params,
 extern json_spirit::Value getlibrarycode(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value testlibrary(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value getdiagnostics(const json_spirit::Array& params, bool fHelp);
+extern json_spirit::Value getcacheinfo(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value applycommands(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value decodehexubjson(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value encodehexubjson(const json_spirit::Array& params, bool fHelp);
@@ -19,6 +19,13 @@
 #define MC_QPR_TX_CHECK_COST                     100
 #define MC_QPR_MAX_TX_PER_BLOCK                    4
 
+#define MC_EXP_ITEMS_PER_PAGE                   1000
+#define MC_EXP_MAX_ITEMS                  2147483647
+#define MC_EXP_BINARY_MAGIC                "MCSI\x01"
+#define MC_EXP_BINARY_MAGIC_SIZE                   5
+#define MC_EXP_FLAG_OFFCHAIN                    0x01
+#define MC_EXP_FLAG_AVAILABLE                   0x02
+
 
 
 Value createupgradefromcmd(const Array& params, bool fHelp);
@@ -1309,12 +1316,66 @@ Value subscribe(const Array& params, bool fHelp)
     
     if (fRescan && fNewFound)
     {
-        pwalletMain->ScanForWalletTransactions(chainActive.Genesis(), true, true, true);
+        if(GetBoolArg("-rescanbackground",false) || IsBackgroundRescanActive())
+        {
+            string strError;
+            if(!StartBackgroundRescan(pwalletMain,0,true,true,false,strError))
+            {
+                throw JSONRPCError(RPC_NOT_ALLOWED, strError);                        
+            }
+        }
+        else
+        {
+            pwalletMain->ScanForWalletTransactions(chainActive.Genesis(), true, true, true);
+        }
     }
 
     return Value::null;
 }
 
+Value getrescaninfo(const Array& params, bool fHelp)
+{
+    if (fHelp || params.size() > 0)
+        throw runtime_error("Help message not found\n");
+
+    Object result;
+    CWalletRescanInfo info=GetBackgroundRescanInfo();
+    double progress=0.;
+    
+    if(info.nChainBlock >= info.nStartBlock)
+    {
+        progress=100.*(double)(info.nCurrentBlock-info.nStartBlock+1)/(double)(info.nChainBlock-info.nStartBlock+1);
+    }
+    
+    result.push_back(Pair("status",info.strStatus));
+    result.push_back(Pair("active",info.fActive));
+    if(info.nStartTime)
+    {
+        result.push_back(Pair("startblock",info.nStartBlock));
+        result.push_back(Pair("currentblock",info.nCurrentBlock));
+        result.push_back(Pair("chainblock",info.nChainBlock));
+        result.push_back(Pair("progress",progress));
+        result.push_back(Pair("pending",info.fPending));
+        result.push_back(Pair("restarts",info.nAttempts));
+        result.push_back(Pair("starttime",info.nStartTime));
+        result.push_back(Pair("elapsed",(info.fActive ? GetTime() : info.nEndTime)-info.nStartTime));
+        if(info.nError)
+        {
+            result.push_back(Pair("error",info.nError));
+        }
+    }
+    
+    return result;
+}
+
+Value cancelrescan(const Array& params, bool fHelp)
+{
+    if (fHelp || params.size() > 0)
+        throw runtime_error("Help message not found\n");
+
+    return CancelBackgroundRescan();
+}
+
 
 Value unsubscribe(const Array& params, bool fHelp)
 {
@@ -1407,7 +1468,12 @@ Value unsubscribe(const Array& params, bool fHelp)
 
     if(fNewFound)
     {
-        if(pwalletTxsMain->Unsubscribe(streams,purge))
+        int err=pwalletTxsMain->Unsubscribe(streams,purge);
+        if(err == MC_ERR_NOT_ALLOWED)
+        {
+            throw JSONRPCError(RPC_NOT_ALLOWED, "Stream or asset is being imported by background rescan. Wait for rescan to complete or stop it using cancelrescan");                                    
+        }
+        if(err)
         {
             throw JSONRPCError(RPC_INTERNAL_ERROR, "Couldn't unsubscribe from stream");                                    
         }
@@ -1754,221 +1820,709 @@ exitlbl:
     return retArray;
 }
 
-void WRPTxsForBlockRange(vector <uint256>& txids,mc_TxEntity *entity,int generation,int height_from,int height_to,mc_Buffer *entity_rows,int *errCode,string *strError)
+/**
+ * Writes export data, raw or hex-encoded. Returns number of bytes written, -1 on error.
+ */
+
+static int64_t ExportWrite(FILE *file,const unsigned char *data,size_t size,bool hex,int *errCode,string *strError)
 {
-    int first_item,last_item,count,i;
+    string hex_str;
     
-    last_item=pwalletTxsMain->WRPGetBlockItemIndex(entity,height_to);
-    if(last_item)
+    if(hex)
     {
-        first_item=pwalletTxsMain->WRPGetBlockItemIndex(entity,height_from-1)+1;
-        count=last_item-first_item+1;
-        if(count > 0)
-        {
-            WRPCheckWalletError(pwalletTxsMain->WRPGetList(entity,generation,first_item,count,entity_rows),entity->m_EntityType,"",errCode,strError);
-            if(strError->size())
-            {
-                return;
-            }
-            
-            mc_TxEntityRow *lpEntTx;
-            uint256 hash;
-            for(i=0;i<count;i++)
-            {
-                lpEntTx=(mc_TxEntityRow*)entity_rows->GetRow(i);
-                if( (lpEntTx->m_Flags & MC_TFL_IS_EXTENSION) == 0 )
-                {
-                    memcpy(&hash,lpEntTx->m_TxId,MC_TDB_TXID_SIZE);
-                    txids.push_back(hash);
-                }
-            }
-        }        
+        hex_str=HexStr(data,data+size);
+        data=(const unsigned char*)hex_str.c_str();
+        size=hex_str.size();
     }
-}
-
-Value liststreamblockitems(const Array& params, bool fHelp)
-{
-    if (fHelp || params.size() < 2 || params.size() > 5)
-        throw runtime_error("Help message not found\n");
-
-    if((mc_gState->m_WalletMode & MC_WMD_TXS) == 0)
+    
+    if(fwrite(data,1,size,file) != size)
     {
-        throw JSONRPCError(RPC_NOT_SUPPORTED, "API is not supported with this wallet version. For full streams functionality, run \"multichaind -walletdbversion=2 -rescan\" ");        
-    }   
-           
-    mc_TxEntityStat entStat;
-    int errCode;
-    string strError;
+        *errCode=RPC_GENERAL_FILE_ERROR;
+        *strError="Cannot write to export file";
+        return -1;
+    }
+    
+    return size;
+}
 
-    mc_Buffer *entity_rows=NULL;
-    Array retArray;
+/**
+ * Finds stream item data - inline script element or list of off-chain chunks.
+ * Returns data size, 0 if data is not available on this node.
+ */
 
-    int chain_height; 
-    vector <int> heights;
-    vector <uint256> txids;
-    int height_from,height_to;
-    bool fWRPLocked=false;
-    int count,start;
-    bool verbose=false;
+static int64_t GetExportItemData(int rpc_slot,const CWalletTx& wtx,int vout,const Object& entry,uint32_t *format,const unsigned char **elem,unsigned char **chunk_hashes,int *chunk_count)
+{
+    mc_Script *tmpscript;
+    int64_t total_chunk_size;
+    size_t elem_size;
     
-    mc_EntityDetails stream_entity;
+    tmpscript=mc_gState->m_TmpRPCBuffers[rpc_slot]->m_RpcScript1;
+    const CScript& script1 = wtx.vout[vout].scriptPubKey;        
+    CScript::const_iterator pc1 = script1.begin();
+    tmpscript->Clear();
+    tmpscript->SetScript((unsigned char*)(&pc1[0]),(size_t)(script1.end()-pc1),MC_SCR_TYPE_SCRIPTPUBKEY);
+    tmpscript->ExtractAndDeleteDataFormat(format,chunk_hashes,chunk_count,&total_chunk_size);
     
-    int rpc_slot=GetRPCSlot();
-    if(rpc_slot < 0)
+    *elem=NULL;
+    if(find_value(entry,"available").type() == bool_type)
     {
-        errCode=RPC_INTERNAL_ERROR;
-        strError="Couldn't find RPC Slot";
-        goto exitlbl;
+        if(find_value(entry,"available").get_bool())
+        {
+            if(*chunk_hashes == NULL)
+            {
+                *elem = tmpscript->GetData(tmpscript->GetNumElements()-1,&elem_size);
+                return elem_size;
+            }
+            return total_chunk_size;
+        }
     }
     
-    fWRPLocked=true;
-    pwalletTxsMain->WRPReadLock();
+    return 0;
+}
+
+/**
+ * Writes stream item data found by GetExportItemData.
+ * Off-chain data is copied from chunk database chunk by chunk, never assembled in memory.
+ */
+
+static int64_t ExportStreamItemData(FILE *file,const CWalletTx& wtx,int vout,const unsigned char *elem,int64_t data_size,unsigned char *chunk_hashes,int chunk_count,bool hex,int *errCode,string *strError)
+{
+    int64_t written,total_written;
+    size_t elem_size;
     
-    parseStreamIdentifier(params[0],&stream_entity,&errCode,&strError);           
-    if(strError.size())
+    if(data_size == 0)
     {
-        goto exitlbl;
+        return 0;
     }
-    if(!mc_CheckCanRetrieveStatus(&stream_entity,&errCode,&strError))
+    
+    if(elem)
     {
-        goto exitlbl;
+        return ExportWrite(file,elem,data_size,hex,errCode,strError);
     }
     
-    if (params.size() > 2)    
+    total_written=0;
+    unsigned char *ptr=chunk_hashes;
+    for(int chunk=0;chunk<chunk_count;chunk++)
     {
-        verbose=paramtobool(params[2]);
+        mc_ChunkDBRow chunk_def;
+        int shift;
+        int size=(int)mc_GetVarInt(ptr,MC_CDB_CHUNK_HASH_SIZE+16,-1,&shift);
+        ptr+=shift;
+        elem=NULL;
+        if( (size >= 0) && (pwalletTxsMain->m_ChunkDB->GetChunkDef(&chunk_def,ptr,NULL,NULL,-1) == MC_ERR_NOERROR) )
+        {
+            elem=pwalletTxsMain->m_ChunkDB->GetChunk(&chunk_def,0,-1,&elem_size,NULL,NULL);
+        }
+        if( (elem == NULL) || ((int)elem_size != size) )                        // Item header is already written, export cannot continue
+        {
+            *errCode=RPC_INTERNAL_ERROR;
+            *strError=strprintf("Cannot read chunk %d of item %s:%d",chunk,wtx.GetHash().ToString().c_str(),vout);
+            return -1;
+        }
+        written=ExportWrite(file,elem,elem_size,hex,errCode,strError);
+        if(written < 0)
+        {
+            return -1;
+        }
+        total_written+=written;
+        ptr+=MC_CDB_CHUNK_HASH_SIZE;
     }
     
-    count=2147483647;
-    if (params.size() > 3)    
+    return total_written;
+}
+
+/**
+ * Writes stream item in binary export format - fixed header, keys and publishers, followed by item data.
+ */
+
+static int64_t ExportBinaryStreamItem(FILE *file,int rpc_slot,const CWalletTx& wtx,int vout,const Object& entry,int block,int *errCode,string *strError)
+{
+    uint32_t format;
+    unsigned char *chunk_hashes;
+    int chunk_count;   
+    int64_t data_size;
+    const unsigned char *elem;
+    uint8_t flags;
+    int64_t written,data_written;
+    vector<string> keys;
+    vector<string> publishers;
+    
+    data_size=GetExportItemData(rpc_slot,wtx,vout,entry,&format,&elem,&chunk_hashes,&chunk_count);
+    
+    flags=0;
+    if(find_value(entry,"offchain").type() == bool_type)
     {
-        count=paramtoint(params[3],true,0,"Invalid count");
+        if(find_value(entry,"offchain").get_bool())
+        {
+            flags |= MC_EXP_FLAG_OFFCHAIN;
+        }
     }
-    start=-count;
-    if (params.size() > 4)    
+    if(find_value(entry,"available").type() == bool_type)
     {
-        start=paramtoint(params[4],false,0,"Invalid start");
+        if(find_value(entry,"available").get_bool())
+        {
+            flags |= MC_EXP_FLAG_AVAILABLE;
+        }
     }
-    chain_height=chainActive.Height();
-    heights=ParseBlockSetIdentifier(params[1],chain_height);              
-    if(heights.size() == 0)
+    
+    Array arr=find_value(entry,"keys").get_array();
+    for(int i=0;i<(int)arr.size();i++)
     {
-        goto exitlbl;
+        keys.push_back(arr[i].get_str());
+    }
+    arr=find_value(entry,"publishers").get_array();
+    for(int i=0;i<(int)arr.size();i++)
+    {
+        publishers.push_back(arr[i].get_str());
     }
     
-    entStat.Zero();
-    memcpy(&entStat,stream_entity.GetTxID()+MC_AST_SHORT_TXID_OFFSET,MC_AST_SHORT_TXID_SIZE);
-    entStat.m_Entity.m_EntityType=MC_TET_STREAM;
-    entStat.m_Entity.m_EntityType |= MC_TET_CHAINPOS;
-  
-        
-    if(!pwalletTxsMain->WRPFindEntity(&entStat))
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << wtx.GetHash();
+    ss << (uint32_t)vout;
+    ss << (int32_t)block;
+    ss << (uint32_t)((find_value(entry,"blocktime").type() == int_type) ? find_value(entry,"blocktime").get_int64() : 0);
+    ss << flags;
+    ss << (uint8_t)format;
+    ss << keys;
+    ss << publishers;
+    ss << (uint64_t)data_size;
+    
+    written=ExportWrite(file,(const unsigned char*)&ss[0],ss.size(),false,errCode,strError);
+    if(written < 0)
     {
-        errCode=RPC_NOT_SUBSCRIBED;
-        strError="Not subscribed to this stream";
-        goto exitlbl;
+        return -1;
     }
     
+    data_written=ExportStreamItemData(file,wtx,vout,elem,data_size,chunk_hashes,chunk_count,false,errCode,strError);
+    if(data_written < 0)
+    {
+        return -1;
+    }
     
-    height_from=heights[0];
-    height_to=heights[0];
+    return written+data_written;
+}
 
-    entity_rows=mc_gState->m_TmpRPCBuffers[rpc_slot]->m_RpcEntityRows;
-    entity_rows->Clear();
+/**
+ * Writes stream item as one ndjson line.
+ * If item data is shown as reference (larger than maxshowndata or off-chain), full data is added to the reference as "hex".
+ */
+
+static int64_t ExportNDJSONStreamItem(FILE *file,int rpc_slot,const CWalletTx& wtx,int vout,Object& entry,int *errCode,string *strError)
+{
+    uint32_t format;
+    unsigned char *chunk_hashes;
+    int chunk_count;   
+    int64_t data_size;
+    const unsigned char *elem;
+    int64_t written,total_written;
+    int data_pos;
+    string line;
     
-    for(unsigned int i=1;i<heights.size();i++)
+    data_pos=-1;
+    for(int i=0;i<(int)entry.size();i++)
     {
-        if(heights[i] > height_to + 1)
+        if(entry[i].name_ == "data")
         {
-            WRPTxsForBlockRange(txids,&entStat.m_Entity,entStat.m_Generation,height_from,height_to,entity_rows,&errCode,&strError);
-            if(strError.size())
+            if(entry[i].value_.type() == obj_type)
             {
-                goto exitlbl;                
+                if(find_value(entry[i].value_.get_obj(),"size").type() != null_type)
+                {
+                    data_pos=i;
+                }
             }
-            height_from=heights[i];
         }
-        height_to=heights[i];
     }
     
-    
-    WRPTxsForBlockRange(txids,&entStat.m_Entity,entStat.m_Generation,height_from,height_to,entity_rows,&errCode,&strError);
-    if(strError.size())
+    data_size=0;
+    if(data_pos >= 0)
     {
-        goto exitlbl;                
+        data_size=GetExportItemData(rpc_slot,wtx,vout,entry,&format,&elem,&chunk_hashes,&chunk_count);
     }
     
-    mc_AdjustStartAndCount(&count,&start,txids.size());
-    
-    for(int i=start;i<start+count;i++)
+    if(data_size == 0)
     {
-        mc_TxDefRow txdef;
-        const CWalletTx& wtx=pwalletTxsMain->WRPGetWalletTx(txids[i],&txdef,NULL);
-        int first_output=0;
-        int stream_output;
-        while(first_output < (int)wtx.vout.size())
-        {
-            Object entry=StreamItemEntry(rpc_slot,wtx,first_output,stream_entity.GetTxID()+MC_AST_SHORT_TXID_OFFSET,verbose,NULL,&stream_output,&txdef,chain_height);
-            if(entry.size())
-            {
-                retArray.push_back(entry);                                
-            }
-            first_output=stream_output+1;
-        }
+        line=write_string(Value(entry), false) + "\n";
+        return ExportWrite(file,(const unsigned char*)line.c_str(),line.size(),false,errCode,strError);
     }
+                                                                                // Data reference is moved to the end of the line, hex is streamed into it
+    Object data_ref=entry[data_pos].value_.get_obj();
+    entry.erase(entry.begin()+data_pos);
+    line=write_string(Value(entry), false);
+    line.resize(line.size()-1);                                                 // Closing brace
+    if(entry.size())
+    {
+        line+=",";
+    }
+    line+="\"data\":"+write_string(Value(data_ref), false);
+    line.resize(line.size()-1);
+    line+=",\"hex\":\"";
     
-exitlbl:                
+    written=ExportWrite(file,(const unsigned char*)line.c_str(),line.size(),false,errCode,strError);
+    if(written < 0)
+    {
+        return -1;
+    }
+    total_written=written;
     
-    if(fWRPLocked)
+    written=ExportStreamItemData(file,wtx,vout,elem,data_size,chunk_hashes,chunk_count,true,errCode,strError);
+    if(written < 0)
     {
-        pwalletTxsMain->WRPReadUnLock();
+        return -1;
     }
-
-    if(strError.size())
+    total_written+=written;
+    
+    line="\"}}\n";
+    written=ExportWrite(file,(const unsigned char*)line.c_str(),line.size(),false,errCode,strError);
+    if(written < 0)
     {
-        throw JSONRPCError(errCode, strError);            
+        return -1;
     }
     
-    return retArray;
+    return total_written+written;
 }
 
-
-bool getSubKeyEntityFromKey(string str,mc_TxEntityStat entStat,mc_TxEntity *entity,bool ignore_unsubscribed)
+Value exportstreamitems(const Array& params, bool fHelp)
 {
-    if(str == "*")
+    if (fHelp || params.size() < 2 || params.size() > 7)
+        throw runtime_error("Help message not found\n");
+
+    if((mc_gState->m_WalletMode & MC_WMD_TXS) == 0)
     {
-        return false;
-    }
-    uint160 key_string_hash;
-    uint160 stream_subkey_hash;
-    key_string_hash=Hash160(str.begin(),str.end());
-    mc_GetCompoundHash160(&stream_subkey_hash,entStat.m_Entity.m_EntityID,&key_string_hash);
-    memcpy(entity->m_EntityID,&stream_subkey_hash,MC_TDB_ENTITY_ID_SIZE);
-    entity->m_EntityType=entStat.m_Entity.m_EntityType | MC_TET_SUBKEY;   
-    if(pEF->STR_IsIndexSkipped(NULL,&(entStat.m_Entity),entity))
+        throw JSONRPCError(RPC_NOT_SUPPORTED, "API is not supported with this wallet version. For full streams functionality, run \"multichaind -walletdbversion=2 -rescan\" ");        
+    }   
+    
+    mc_TxEntityStat entStat;
+    mc_Buffer *entity_rows=NULL;
+    mc_EntityDetails stream_entity;
+    Object result;
+    int errCode=0;
+    string strError;
+    FILE *file=NULL;
+    string file_name=params[1].get_str();
+    
+    int count,start,pos,page,generation;
+    int64_t items,bytes,written;
+    bool verbose=false;
+    bool binary=false;
+    
+    if (params.size() > 2)    
     {
-        if(ignore_unsubscribed)
+        if(params[2].get_str() == "binary")
         {
-            return false;
+            binary=true;
+        }
+        else
+        {
+            if(params[2].get_str() != "ndjson")
+            {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid format, should be ndjson or binary");                        
+            }
         }
-        CheckWalletError(MC_ERR_NOT_ALLOWED,entStat.m_Entity.m_EntityType,"");
     }
     
-    return true;
-}
-
-bool WRPSubKeyEntityFromKey(string str,mc_TxEntityStat entStat,mc_TxEntity *entity,bool ignore_unsubscribed,int *errCode,string *strError)
-{
-    if(str == "*")
+    if (params.size() > 3)    
     {
-        return false;
+        verbose=paramtobool(params[3]);
     }
-    uint160 key_string_hash;
-    uint160 stream_subkey_hash;
-    key_string_hash=Hash160(str.begin(),str.end());
-    mc_GetCompoundHash160(&stream_subkey_hash,entStat.m_Entity.m_EntityID,&key_string_hash);
-    memcpy(entity->m_EntityID,&stream_subkey_hash,MC_TDB_ENTITY_ID_SIZE);
-    entity->m_EntityType=entStat.m_Entity.m_EntityType | MC_TET_SUBKEY;   
-    if(pEF->STR_IsIndexSkipped(NULL,&(entStat.m_Entity),entity))
+    
+    count=MC_EXP_MAX_ITEMS;
+    if (params.size() > 4)    
+    {
+        count=paramtoint(params[4],true,0,"Invalid count");
+    }
+    start=0;
+    if (params.size() > 5)    
+    {
+        start=paramtoint(params[5],false,0,"Invalid start");
+    }
+    
+    bool fLocalOrdering = false;
+    if (params.size() > 6)
+        fLocalOrdering = params[6].get_bool();
+    
+    bool fWRPLocked=false;
+    int chain_height; 
+  
+    items=0;
+    bytes=0;
+    
+    int rpc_slot=GetRPCSlot();
+    if(rpc_slot < 0)
+    {
+        errCode=RPC_INTERNAL_ERROR;
+        strError="Couldn't find RPC Slot";
+        goto exitlbl;
+    }
+    
+    fWRPLocked=true;    
+    pwalletTxsMain->WRPReadLock();
+    
+    parseStreamIdentifier(params[0],&stream_entity,&errCode,&strError);           
+    if(strError.size())
+    {
+        goto exitlbl;
+    }
+    if(!mc_CheckCanRetrieveStatus(&stream_entity,&errCode,&strError))
+    {
+        goto exitlbl;
+    }
+
+    entStat.Zero();
+    memcpy(&entStat,stream_entity.GetTxID()+MC_AST_SHORT_TXID_OFFSET,MC_AST_SHORT_TXID_SIZE);
+    entStat.m_Entity.m_EntityType=MC_TET_STREAM;
+    if(fLocalOrdering)
+    {
+        entStat.m_Entity.m_EntityType |= MC_TET_TIMERECEIVED;
+    }
+    else
+    {
+        entStat.m_Entity.m_EntityType |= MC_TET_CHAINPOS;
+    }
+    
+    if(!pwalletTxsMain->WRPFindEntity(&entStat))
+    {
+        errCode=RPC_NOT_SUBSCRIBED;
+        strError="Not subscribed to this stream";
+        goto exitlbl;
+    }
+    generation=entStat.m_Generation;
+    
+    mc_AdjustStartAndCount(&count,&start,pwalletTxsMain->WRPGetListSize(&entStat.m_Entity,entStat.m_Generation,NULL));
+    
+    file=fopen(file_name.c_str(),"wb");
+    if(file == NULL)
+    {
+        errCode=RPC_GENERAL_FILE_ERROR;
+        strError="Cannot open export file";
+        goto exitlbl;
+    }
+    if(binary)
+    {
+        if(fwrite(MC_EXP_BINARY_MAGIC,1,MC_EXP_BINARY_MAGIC_SIZE,file) != MC_EXP_BINARY_MAGIC_SIZE)
+        {
+            errCode=RPC_GENERAL_FILE_ERROR;
+            strError="Cannot write to export file";
+            goto exitlbl;
+        }
+        bytes+=MC_EXP_BINARY_MAGIC_SIZE;
+    }
+    
+    entity_rows=mc_gState->m_TmpRPCBuffers[rpc_slot]->m_RpcEntityRows;
+    
+                                                                                // Items are read page by page, wallet is unlocked between pages
+    for(pos=start;pos<start+count;pos+=page)
+    {
+        page=start+count-pos;
+        if(page > MC_EXP_ITEMS_PER_PAGE)
+        {
+            page=MC_EXP_ITEMS_PER_PAGE;
+        }
+        
+        if(!fWRPLocked)
+        {
+            fWRPLocked=true;    
+            pwalletTxsMain->WRPReadLock();
+            if(!pwalletTxsMain->WRPFindEntity(&entStat) || (entStat.m_Generation != generation))
+            {
+                errCode=RPC_NOT_SUBSCRIBED;
+                strError="Stream was unsubscribed during export";
+                goto exitlbl;
+            }
+        }
+        
+        entity_rows->Clear();
+        WRPCheckWalletError(pwalletTxsMain->WRPGetList(&entStat.m_Entity,entStat.m_Generation,pos+1,page,entity_rows),entStat.m_Entity.m_EntityType,"",&errCode,&strError);
+        if(strError.size())
+        {
+            goto exitlbl;
+        }
+
+        chain_height=chainActive.Height();
+        for(int i=0;i<entity_rows->GetCount();i++)
+        {
+            mc_TxEntityRow *lpEntTx;
+            mc_TxDefRow txdef;
+            lpEntTx=(mc_TxEntityRow*)entity_rows->GetRow(i);
+            uint256 hash;
+            int output;
+            int first_output=WRPGetHashAndFirstOutput(lpEntTx,&hash);
+            const CWalletTx& wtx=pwalletTxsMain->WRPGetWalletTx(hash,&txdef,NULL);
+            Object entry=StreamItemEntry(rpc_slot,wtx,first_output,stream_entity.GetTxID()+MC_AST_SHORT_TXID_OFFSET,binary ? false : verbose,NULL,&output,&txdef,chain_height);
+            if(entry.size())
+            {
+                if(binary)
+                {
+                    written=ExportBinaryStreamItem(file,rpc_slot,wtx,output,entry,
+                            ( (txdef.m_Block >= 0) && (txdef.m_Block <= chain_height) ) ? txdef.m_Block : -1,&errCode,&strError);
+                }
+                else
+                {
+                    written=ExportNDJSONStreamItem(file,rpc_slot,wtx,output,entry,&errCode,&strError);
+                }
+                if(written < 0)
+                {
+                    goto exitlbl;
+                }
+                bytes+=written;
+                items++;
+            }
+        }
+        
+        pwalletTxsMain->WRPReadUnLock();
+        fWRPLocked=false;
+        
+        if(ShutdownRequested())
+        {
+            errCode=RPC_INTERNAL_ERROR;
+            strError="Export interrupted by shutdown";
+            goto exitlbl;
+        }
+    }
+    
+    result.push_back(Pair("file", file_name));
+    result.push_back(Pair("format", binary ? "binary" : "ndjson"));
+    result.push_back(Pair("items", items));
+    result.push_back(Pair("bytes", bytes));
+    
+exitlbl:
+                
+    if(fWRPLocked)
+    {
+        pwalletTxsMain->WRPReadUnLock();
+    }
+    
+    if(file)
+    {
+        if(fclose(file) && (strError.size() == 0))
+        {
+            errCode=RPC_GENERAL_FILE_ERROR;
+            strError="Cannot write to export file";
+        }
+    }
+
+    if(strError.size())
+    {
+        throw JSONRPCError(errCode, strError);            
+    }
+    
+    return result;
+}
+
+void WRPTxsForBlockRange(vector <uint256>& txids,mc_TxEntity *entity,int generation,int height_from,int height_to,mc_Buffer *entity_rows,int *errCode,string *strError)
+{
+    int first_item,last_item,count,i;
+    
+    last_item=pwalletTxsMain->WRPGetBlockItemIndex(entity,height_to);
+    if(last_item)
+    {
+        first_item=pwalletTxsMain->WRPGetBlockItemIndex(entity,height_from-1)+1;
+        count=last_item-first_item+1;
+        if(count > 0)
+        {
+            WRPCheckWalletError(pwalletTxsMain->WRPGetList(entity,generation,first_item,count,entity_rows),entity->m_EntityType,"",errCode,strError);
+            if(strError->size())
+            {
+                return;
+            }
+            
+            mc_TxEntityRow *lpEntTx;
+            uint256 hash;
+            for(i=0;i<count;i++)
+            {
+                lpEntTx=(mc_TxEntityRow*)entity_rows->GetRow(i);
+                if( (lpEntTx->m_Flags & MC_TFL_IS_EXTENSION) == 0 )
+                {
+                    memcpy(&hash,lpEntTx->m_TxId,MC_TDB_TXID_SIZE);
+                    txids.push_back(hash);
+                }
+            }
+        }        
+    }
+}
+
+Value liststreamblockitems(const Array& params, bool fHelp)
+{
+    if (fHelp || params.size() < 2 || params.size() > 5)
+        throw runtime_error("Help message not found\n");
+
+    if((mc_gState->m_WalletMode & MC_WMD_TXS) == 0)
+    {
+        throw JSONRPCError(RPC_NOT_SUPPORTED, "API is not supported with this wallet version. For full streams functionality, run \"multichaind -walletdbversion=2 -rescan\" ");        
+    }   
+           
+    mc_TxEntityStat entStat;
+    int errCode;
+    string strError;
+
+    mc_Buffer *entity_rows=NULL;
+    Array retArray;
+
+    int chain_height; 
+    vector <int> heights;
+    vector <uint256> txids;
+    int height_from,height_to;
+    bool fWRPLocked=false;
+    int count,start;
+    bool verbose=false;
+    
+    mc_EntityDetails stream_entity;
+    
+    int rpc_slot=GetRPCSlot();
+    if(rpc_slot < 0)
+    {
+        errCode=RPC_INTERNAL_ERROR;
+        strError="Couldn't find RPC Slot";
+        goto exitlbl;
+    }
+    
+    fWRPLocked=true;
+    pwalletTxsMain->WRPReadLock();
+    
+    parseStreamIdentifier(params[0],&stream_entity,&errCode,&strError);           
+    if(strError.size())
+    {
+        goto exitlbl;
+    }
+    if(!mc_CheckCanRetrieveStatus(&stream_entity,&errCode,&strError))
+    {
+        goto exitlbl;
+    }
+    
+    if (params.size() > 2)    
+    {
+        verbose=paramtobool(params[2]);
+    }
+    
+    count=2147483647;
+    if (params.size() > 3)    
+    {
+        count=paramtoint(params[3],true,0,"Invalid count");
+    }
+    start=-count;
+    if (params.size() > 4)    
+    {
+        start=paramtoint(params[4],false,0,"Invalid start");
+    }
+    chain_height=chainActive.Height();
+    heights=ParseBlockSetIdentifier(params[1],chain_height);              
+    if(heights.size() == 0)
+    {
+        goto exitlbl;
+    }
+    
+    entStat.Zero();
+    memcpy(&entStat,stream_entity.GetTxID()+MC_AST_SHORT_TXID_OFFSET,MC_AST_SHORT_TXID_SIZE);
+    entStat.m_Entity.m_EntityType=MC_TET_STREAM;
+    entStat.m_Entity.m_EntityType |= MC_TET_CHAINPOS;
+  
+        
+    if(!pwalletTxsMain->WRPFindEntity(&entStat))
+    {
+        errCode=RPC_NOT_SUBSCRIBED;
+        strError="Not subscribed to this stream";
+        goto exitlbl;
+    }
+    
+    
+    height_from=heights[0];
+    height_to=heights[0];
+
+    entity_rows=mc_gState->m_TmpRPCBuffers[rpc_slot]->m_RpcEntityRows;
+    entity_rows->Clear();
+    
+    for(unsigned int i=1;i<heights.size();i++)
+    {
+        if(heights[i] > height_to + 1)
+        {
+            WRPTxsForBlockRange(txids,&entStat.m_Entity,entStat.m_Generation,height_from,height_to,entity_rows,&errCode,&strError);
+            if(strError.size())
+            {
+                goto exitlbl;                
+            }
+            height_from=heights[i];
+        }
+        height_to=heights[i];
+    }
+    
+    
+    WRPTxsForBlockRange(txids,&entStat.m_Entity,entStat.m_Generation,height_from,height_to,entity_rows,&errCode,&strError);
+    if(strError.size())
+    {
+        goto exitlbl;                
+    }
+    
+    mc_AdjustStartAndCount(&count,&start,txids.size());
+    
+    for(int i=start;i<start+count;i++)
+    {
+        mc_TxDefRow txdef;
+        const CWalletTx& wtx=pwalletTxsMain->WRPGetWalletTx(txids[i],&txdef,NULL);
+        int first_output=0;
+        int stream_output;
+        while(first_output < (int)wtx.vout.size())
+        {
+            Object entry=StreamItemEntry(rpc_slot,wtx,first_output,stream_entity.GetTxID()+MC_AST_SHORT_TXID_OFFSET,verbose,NULL,&stream_output,&txdef,chain_height);
+            if(entry.size())
+            {
+                retArray.push_back(entry);                                
+            }
+            first_output=stream_output+1;
+        }
+    }
+    
+exitlbl:                
+    
+    if(fWRPLocked)
+    {
+        pwalletTxsMain->WRPReadUnLock();
+    }
+
+    if(strError.size())
+    {
+        throw JSONRPCError(errCode, strError);            
+    }
+    
+    return retArray;
+}
+
+
+bool getSubKeyEntityFromKey(string str,mc_TxEntityStat entStat,mc_TxEntity *entity,bool ignore_unsubscribed)
+{
+    if(str == "*")
+    {
+        return false;
+    }
+    uint160 key_string_hash;
+    uint160 stream_subkey_hash;
+    key_string_hash=Hash160(str.begin(),str.end());
+    mc_GetCompoundHash160(&stream_subkey_hash,entStat.m_Entity.m_EntityID,&key_string_hash);
+    memcpy(entity->m_EntityID,&stream_subkey_hash,MC_TDB_ENTITY_ID_SIZE);
+    entity->m_EntityType=entStat.m_Entity.m_EntityType | MC_TET_SUBKEY;   
+    if(pEF->STR_IsIndexSkipped(NULL,&(entStat.m_Entity),entity))
+    {
+        if(ignore_unsubscribed)
+        {
+            return false;
+        }
+        CheckWalletError(MC_ERR_NOT_ALLOWED,entStat.m_Entity.m_EntityType,"");
+    }
+    
+    return true;
+}
+
+bool WRPSubKeyEntityFromKey(string str,mc_TxEntityStat entStat,mc_TxEntity *entity,bool ignore_unsubscribed,int *errCode,string *strError)
+{
+    if(str == "*")
+    {
+        return false;
+    }
+    uint160 key_string_hash;
+    uint160 stream_subkey_hash;
+    key_string_hash=Hash160(str.begin(),str.end());
+    mc_GetCompoundHash160(&stream_subkey_hash,entStat.m_Entity.m_EntityID,&key_string_hash);
+    memcpy(entity->m_EntityID,&stream_subkey_hash,MC_TDB_ENTITY_ID_SIZE);
+    entity->m_EntityType=entStat.m_Entity.m_EntityType | MC_TET_SUBKEY;   
+    if(pEF->STR_IsIndexSkipped(NULL,&(entStat.m_Entity),entity))
     {
         if(ignore_unsubscribed)
         {
@@ -3052,26 +3606,219 @@ Value liststreampublishers(const Array& params, bool fHelp)
         throw runtime_error("Help message not found\n");
     if((mc_gState->m_WalletMode & MC_WMD_TXS) == 0)
     {
-        throw JSONRPCError(RPC_NOT_SUPPORTED, "API is not supported with this wallet version. For full streams functionality, run \"multichaind -walletdbversion=2 -rescan\" ");        
-    }   
+        throw JSONRPCError(RPC_NOT_SUPPORTED, "API is not supported with this wallet version. For full streams functionality, run \"multichaind -walletdbversion=2 -rescan\" ");        
+    }   
+    
+    return liststreamkeys_or_publishers(params,true);
+}
+
+typedef struct mc_QueryListCursor
+{
+    mc_TxEntity m_Entity;                                                       // Subkey or stream entity 
+    int m_Generation;                                                           // Entity generation
+    int m_Size;                                                                 // List size
+    int m_Condition;                                                            // Condition index, conditions count for stream list
+    int m_Pos;                                                                  // First row not consumed yet, 1-based
+    int m_PosBlock;                                                             // Block of the row at m_Pos, -1 if not read
+    set<uint256> m_GroupTxIDs;                                                  // Transactions in the current block group
+    
+    void Zero()
+    {
+        m_Entity.Zero();
+        m_Generation=0;
+        m_Size=0;
+        m_Condition=-1;
+        m_Pos=1;
+        m_PosBlock=-1;
+        m_GroupTxIDs.clear();
+    }
+} mc_QueryListCursor;
+
+bool QueryListCursorLess(const mc_QueryListCursor *a,const mc_QueryListCursor *b)
+{
+    return a->m_Size < b->m_Size;
+}
+
+uint256 QueryRowTxID(mc_TxEntityRow *erow)
+{
+    uint256 txid=0;
+    
+    memcpy(&txid,erow->m_TxId,MC_TEE_OFFSET_IN_TXID);                           // Extension rows keep only the prefix of the txid
+    
+    return txid;
+}
+
+int WRPQueryListRow(mc_QueryListCursor *cursor,int pos,mc_TxEntityRow *erow,int unconfirmed_block,int *err)
+{
+    erow->Zero();
+    memcpy(&erow->m_Entity,&cursor->m_Entity,sizeof(mc_TxEntity));
+    erow->m_Generation=cursor->m_Generation;
+    erow->m_Pos=pos;
+    *err=pwalletTxsMain->WRPGetRow(erow);
+    if(*err)
+    {
+        return -1;
+    }
+    if(erow->m_Block < 0)
+    {
+        return unconfirmed_block;
+    }
+    return erow->m_Block;
+}
+
+/*
+ * Moves cursor to the first row confirmed in block >= block, galloping from the current position, 
+ * returns block of this row or INT_MAX if the end of the list is reached
+ */
+
+int WRPQueryListSeek(mc_QueryListCursor *cursor,int block,int unconfirmed_block,int *err)
+{
+    mc_TxEntityRow erow;
+    int lo,hi,mid,step,row_block;
+    
+    *err=MC_ERR_NOERROR;
+    if(cursor->m_Pos > cursor->m_Size)
+    {
+        return INT_MAX;
+    }
+    if(cursor->m_PosBlock < 0)
+    {
+        cursor->m_PosBlock=WRPQueryListRow(cursor,cursor->m_Pos,&erow,unconfirmed_block,err);
+        if(*err)
+        {
+            return INT_MAX;
+        }
+    }
+    if(cursor->m_PosBlock >= block)
+    {
+        return cursor->m_PosBlock;
+    }
+    
+    lo=cursor->m_Pos;
+    hi=cursor->m_Size+1;
+    step=1;
+    while(lo+step <= cursor->m_Size)
+    {
+        row_block=WRPQueryListRow(cursor,lo+step,&erow,unconfirmed_block,err);
+        if(*err)
+        {
+            return INT_MAX;
+        }
+        if(row_block >= block)
+        {
+            hi=lo+step;
+            cursor->m_PosBlock=row_block;
+            break;
+        }
+        lo+=step;
+        step*=2;
+    }
+    
+    while(hi-lo > 1)
+    {
+        mid=(lo+hi)/2;
+        row_block=WRPQueryListRow(cursor,mid,&erow,unconfirmed_block,err);
+        if(*err)
+        {
+            return INT_MAX;
+        }
+        if(row_block >= block)
+        {
+            hi=mid;
+            cursor->m_PosBlock=row_block;
+        }
+        else
+        {
+            lo=mid;
+        }
+    }
+    
+    cursor->m_Pos=hi;
+    if(hi > cursor->m_Size)
+    {
+        return INT_MAX;
+    }
+    
+    return cursor->m_PosBlock;
+}
+
+/*
+ * Reads all rows confirmed in block, cursor should be positioned by WRPQueryListSeek. 
+ * Transactions are stored in m_GroupTxIDs, rows are appended to entity_rows if it is not NULL
+ */
+
+int WRPQueryListLoadGroup(mc_QueryListCursor *cursor,int block,int unconfirmed_block,mc_Buffer *entity_rows)
+{
+    mc_TxEntityRow erow;
+    int err,row_block;
+    
+    cursor->m_GroupTxIDs.clear();
+    if(WRPQueryListSeek(cursor,block,unconfirmed_block,&err) != block)
+    {
+        return err;
+    }
     
-    return liststreamkeys_or_publishers(params,true);
+    while(cursor->m_Pos <= cursor->m_Size)
+    {
+        row_block=WRPQueryListRow(cursor,cursor->m_Pos,&erow,unconfirmed_block,&err);
+        if(err)
+        {
+            return err;
+        }
+        cursor->m_PosBlock=row_block;
+        if(row_block != block)
+        {
+            break;
+        }
+        cursor->m_GroupTxIDs.insert(QueryRowTxID(&erow));
+        if(entity_rows)
+        {
+            erow.m_Block=row_block;
+            erow.m_TempPos=0;
+            err=entity_rows->Add((char*)&erow,(char*)&erow+MC_TDB_ENTITY_KEY_SIZE);
+            if(err)
+            {
+                return err;
+            }
+        }
+        cursor->m_Pos++;
+        cursor->m_PosBlock=-1;
+    }
+    
+    return MC_ERR_NOERROR;
 }
 
+/*
+ * Query executor. Each condition is resolved to its subkey list, lists are ordered by chain position. 
+ * Lists of plain conditions are intersected, lists of MC_QCF_ANY conditions of the same type are united and 
+ * lists of MC_QCF_NOT conditions are subtracted. Intersection is performed by leapfrogging block-by-block,
+ * cursors are advanced by galloping search, so only rows in blocks where all lists meet are read. Within the block 
+ * rows are matched by txid. Rows are returned in the order of the smallest plain list (or stream list if there are no
+ * plain conditions). As lists are per-transaction, rows matching more than one condition (or any NOT condition) are
+ * marked as dirty (m_TempPos=2) and are checked per item by StreamItemEntry.
+ * Returns the number of dirty rows.
+ */
+
 int WRPGetAndQueryDirtyList(vector<mc_QueryCondition>& conditions, mc_EntityDetails *stream_entity,bool fLocalOrdering,mc_Buffer *entity_rows,int *errCodeOut,string *strErrorOut)
 {
     int i,row,out_row;
+    int err=MC_ERR_NOERROR;
     int conditions_count=(int)conditions.size();
-    int conditions_used=0;
-    int max_size=0;
-    int clean_count,dirty_count,last_state;
+    int dirty_count=0;
+    int unconfirmed_block,block,next_block,group_block;
+    int verify_count;
+    int64_t cost,any_cost;
     vector<mc_TxEntity> vConditionEntities;
     vector<int> vConditionListSizes;
-    vector<int> vConditionMerged;
+    vector<mc_QueryListCursor> vCursors;
+    vector<mc_QueryListCursor*> vAllCursors;
+    vector<mc_QueryListCursor*> vNotCursors;
+    vector< vector<mc_QueryListCursor*> > vAnyGroups;
+    mc_QueryListCursor *lpOutput=NULL;
     mc_TxEntityStat entStat;
-    bool merge_lists=true;
     bool one_index_found=false;
     bool both_types=false;
+    bool stable,in_not;
     uint32_t error_type=0;
     
     int errCode;
@@ -3079,9 +3826,9 @@ int WRPGetAndQueryDirtyList(vector<mc_QueryCondition>& conditions, mc_EntityDeta
     
     vConditionEntities.resize(conditions_count+1);
     vConditionListSizes.resize(conditions_count+1);
-    vConditionMerged.resize(conditions_count+1);
-    clean_count=0;
-    dirty_count=0;
+    vCursors.resize(conditions_count+1);
+    
+    entity_rows->Clear();
     
     entStat.Zero();
     memcpy(&entStat,stream_entity->GetTxID()+MC_AST_SHORT_TXID_OFFSET,MC_AST_SHORT_TXID_SIZE);
@@ -3105,7 +3852,6 @@ int WRPGetAndQueryDirtyList(vector<mc_QueryCondition>& conditions, mc_EntityDeta
     {
         vConditionEntities[i].Zero();
         vConditionListSizes[i]=-1;
-        vConditionMerged[i]=0;
         
         entStat.m_Entity.m_EntityType &= MC_TET_ORDERMASK;
         bool index_found=true;
@@ -3181,10 +3927,6 @@ int WRPGetAndQueryDirtyList(vector<mc_QueryCondition>& conditions, mc_EntityDeta
                 {
                     vConditionListSizes[i]=pwalletTxsMain->GetListSize(&vConditionEntities[i],entStat.m_Generation,NULL);                         
                 }
-                if(vConditionListSizes[i]>max_size)
-                {
-                    max_size=vConditionListSizes[i];
-                }
             }
         }
     }
@@ -3198,133 +3940,301 @@ int WRPGetAndQueryDirtyList(vector<mc_QueryCondition>& conditions, mc_EntityDeta
         }
     }
     
+/* Planning: plain conditions are intersected, smallest list first, conditions without active index are checked per item */    
     
-    while(merge_lists)
+    verify_count=0;
+    for(i=0;i<=conditions_count;i++)
     {
-        int min_size=max_size+1;
-        int min_condition=conditions_count;
-        for(i=0;i<conditions_count;i++)
+        vCursors[i].Zero();
+        memcpy(&vCursors[i].m_Entity,&vConditionEntities[i],sizeof(mc_TxEntity));
+        vCursors[i].m_Generation=entStat.m_Generation;
+        vCursors[i].m_Size=vConditionListSizes[i];
+        vCursors[i].m_Condition=i;
+        if(i<conditions_count)
         {
-            if(vConditionMerged[i] == 0)
+            if(vConditionListSizes[i] < 0)
             {
-                if(vConditionListSizes[i] > 0)
+                if( (conditions[i].m_Flags & (MC_QCF_ANY | MC_QCF_NOT)) != MC_QCF_ANY )
                 {
-                    if(vConditionListSizes[i]<=min_size)
-                    {
-                        min_size=vConditionListSizes[i];
-                        min_condition=i;
-                    }
+                    verify_count++;                                             // No index, checked per item
                 }
             }
-        }
-        
-        if(min_condition<conditions_count)
-        {
-            merge_lists=true;
-            if(conditions_used == 0)
+            else
             {
-                if(min_size > MC_QPR_MAX_UNCHECKED_TX_LIST_SIZE)
-                {
-                    errCode=RPC_NOT_SUPPORTED;
-                    strError= "This query may take too much time";
-                    goto exitlbl;
-                }          
-                if(strErrorOut)
+                if(conditions[i].m_Flags & MC_QCF_NOT)
                 {
-                    WRPCheckWalletError(pwalletTxsMain->WRPGetList(&vConditionEntities[min_condition],entStat.m_Generation,1,min_size,entity_rows),vConditionEntities[min_condition].m_EntityType,"",&errCode,&strError);                             
-                    if(strError.size())
+                    if(vConditionListSizes[i] > 0)
                     {
-                        goto exitlbl;
+                        vNotCursors.push_back(&vCursors[i]);
                     }
                 }
                 else
                 {
-                    CheckWalletError(pwalletTxsMain->GetList(&vConditionEntities[min_condition],entStat.m_Generation,1,min_size,entity_rows),vConditionEntities[min_condition].m_EntityType,"");         
-                }
-                conditions_used++;
-                clean_count=0;
-                dirty_count=0;
-                for(row=0;row<entity_rows->GetCount();row++)
-                {
-                    mc_TxEntityRow *lpEntTx;
-                    lpEntTx=(mc_TxEntityRow*)entity_rows->GetRow(row);
-                    lpEntTx->m_TempPos=0;
-                    if( (lpEntTx->m_Flags & MC_TFL_IS_EXTENSION) == 0 )
-                    {
-                        clean_count++;
-                    }
-                    if(!fLocalOrdering)
+                    if( (conditions[i].m_Flags & MC_QCF_ANY) == 0 )
                     {
-                        if(lpEntTx->m_Block == -1)
+                        if(vConditionListSizes[i] == 0)
                         {
-                            lpEntTx->m_Block=chainActive.Height()+1;
+                            goto exitlbl;                                       // Empty result
                         }
+                        vAllCursors.push_back(&vCursors[i]);
+                        verify_count++;
                     }
                 }
             }
-            else
+        }
+    }
+    
+    for(uint32_t type=MC_QCT_KEY;type<=MC_QCT_PUBLISHER;type++)
+    {
+        vector<mc_QueryListCursor*> vGroup;
+        bool group_indexed=true;
+        int group_count=0;
+        for(i=0;i<conditions_count;i++)
+        {
+            if( (conditions[i].m_Type == type) && ((conditions[i].m_Flags & (MC_QCF_ANY | MC_QCF_NOT)) == MC_QCF_ANY) )
             {
-                merge_lists=false;
+                group_count++;
+                verify_count++;
+                if(vConditionListSizes[i] < 0)
+                {
+                    group_indexed=false;
+                }
+                if(vConditionListSizes[i] > 0)
+                {
+                    vGroup.push_back(&vCursors[i]);
+                }
             }
         }
-        else
+        if(group_count && group_indexed)
         {
-            merge_lists=false;            
+            if(vGroup.size() == 0)
+            {
+                goto exitlbl;                                                   // All lists in the group are empty
+            }
+            vAnyGroups.push_back(vGroup);
         }
     }
-
-    last_state=2;
-    clean_count=0;
-    dirty_count=0;
-    out_row=0;
-    for(row=0;row<entity_rows->GetCount();row++)
+    
+    sort(vAllCursors.begin(),vAllCursors.end(),QueryListCursorLess);
+    if(vAllCursors.size())
     {
-        mc_TxEntityRow *lpEntTx;
-        lpEntTx=(mc_TxEntityRow*)entity_rows->GetRow(row);
-        if(lpEntTx->m_Flags & MC_TFL_IS_EXTENSION)
+        lpOutput=vAllCursors[0];
+        verify_count--;                                                         // Output list condition is satisfied by list itself
+    }
+    else
+    {
+        lpOutput=&vCursors[conditions_count];
+        vAllCursors.push_back(lpOutput);
+    }
+    
+    cost=lpOutput->m_Size;
+    for(i=0;i<(int)vAnyGroups.size();i++)
+    {
+        any_cost=0;
+        for(int g=0;g<(int)vAnyGroups[i].size();g++)
         {
-            lpEntTx->m_TempPos=last_state;
-            if(lpEntTx->m_TempPos == 2)
+            any_cost+=vAnyGroups[i][g]->m_Size;
+        }
+        if(any_cost < cost)
+        {
+            cost=any_cost;
+        }
+    }
+    
+    if(cost > MC_QPR_MAX_UNCHECKED_TX_LIST_SIZE)
+    {
+        errCode=RPC_NOT_SUPPORTED;
+        strError= "This query may take too much time";
+        goto exitlbl;
+    }          
+    
+    if(fLocalOrdering)                                                          // Lists are not ordered by block, output list is checked per item
+    {
+        if(strErrorOut)
+        {
+            WRPCheckWalletError(pwalletTxsMain->WRPGetList(&lpOutput->m_Entity,lpOutput->m_Generation,1,lpOutput->m_Size,entity_rows),lpOutput->m_Entity.m_EntityType,"",&errCode,&strError);                             
+            if(strError.size())
             {
-                dirty_count++;                
+                goto exitlbl;
             }
         }
         else
         {
-            switch(lpEntTx->m_TempPos)
+            CheckWalletError(pwalletTxsMain->GetList(&lpOutput->m_Entity,lpOutput->m_Generation,1,lpOutput->m_Size,entity_rows),lpOutput->m_Entity.m_EntityType,"");         
+        }
+        for(row=0;row<entity_rows->GetCount();row++)
+        {
+            mc_TxEntityRow *lpEntTx;
+            lpEntTx=(mc_TxEntityRow*)entity_rows->GetRow(row);
+            lpEntTx->m_TempPos=0;
+            if( (verify_count > 0) || (vAnyGroups.size() > 0) || (vNotCursors.size() > 0) )
             {
-                case 1:
-                    break;
-                case 2:
-                    dirty_count++;
-                    break;
-                default:
-                    if(conditions_used < conditions_count)
+                lpEntTx->m_TempPos=2;
+                dirty_count++;
+            }
+        }
+        goto exitlbl;
+    }
+    
+/* Execution: leapfrog over blocks */    
+    
+    unconfirmed_block=chainActive.Height()+1;
+    block=0;
+    err=MC_ERR_NOERROR;
+    while(block < INT_MAX)
+    {
+        stable=false;
+        while(!stable && (block < INT_MAX))
+        {
+            stable=true;
+            for(i=0;i<(int)vAllCursors.size();i++)
+            {
+                next_block=WRPQueryListSeek(vAllCursors[i],block,unconfirmed_block,&err);
+                if(err)
+                {
+                    goto exitlbl;
+                }
+                if(next_block > block)
+                {
+                    block=next_block;
+                    stable=false;
+                }
+            }
+            for(i=0;i<(int)vAnyGroups.size();i++)
+            {
+                group_block=INT_MAX;
+                for(int g=0;g<(int)vAnyGroups[i].size();g++)
+                {
+                    next_block=WRPQueryListSeek(vAnyGroups[i][g],block,unconfirmed_block,&err);
+                    if(err)
                     {
-                        lpEntTx->m_TempPos=2;
-                        dirty_count++;
+                        goto exitlbl;
                     }
-                    else
+                    if(next_block < group_block)
                     {
-                        clean_count++;
+                        group_block=next_block;
                     }
-                    break;                    
+                }
+                if(group_block > block)
+                {
+                    block=group_block;
+                    stable=false;
+                }
             }
-            last_state=lpEntTx->m_TempPos;
         }
-        if(lpEntTx->m_TempPos != 1)
+        
+        if(block == INT_MAX)
+        {
+            break;
+        }
+        
+        for(i=0;i<(int)vAllCursors.size();i++)
+        {
+            if(vAllCursors[i] != lpOutput)
+            {
+                err=WRPQueryListLoadGroup(vAllCursors[i],block,unconfirmed_block,NULL);
+                if(err)
+                {
+                    goto exitlbl;
+                }
+            }
+        }
+        for(i=0;i<(int)vAnyGroups.size();i++)
+        {
+            for(int g=0;g<(int)vAnyGroups[i].size();g++)
+            {
+                err=WRPQueryListLoadGroup(vAnyGroups[i][g],block,unconfirmed_block,NULL);
+                if(err)
+                {
+                    goto exitlbl;
+                }
+            }
+        }
+        for(i=0;i<(int)vNotCursors.size();i++)
+        {
+            err=WRPQueryListLoadGroup(vNotCursors[i],block,unconfirmed_block,NULL);
+            if(err)
+            {
+                goto exitlbl;
+            }
+        }
+        
+        row=entity_rows->GetCount();
+        err=WRPQueryListLoadGroup(lpOutput,block,unconfirmed_block,entity_rows);
+        if(err)
         {
-            if(out_row < row)
+            goto exitlbl;
+        }
+        
+        for(out_row=row;row<entity_rows->GetCount();row++)
+        {
+            mc_TxEntityRow *lpEntTx;
+            lpEntTx=(mc_TxEntityRow*)entity_rows->GetRow(row);
+            uint256 txid=QueryRowTxID(lpEntTx);
+            bool take_it=true;
+            
+            for(i=0;take_it && (i<(int)vAllCursors.size());i++)
+            {
+                if(vAllCursors[i] != lpOutput)
+                {
+                    if(vAllCursors[i]->m_GroupTxIDs.count(txid) == 0)
+                    {
+                        take_it=false;
+                    }
+                }
+            }
+            for(i=0;take_it && (i<(int)vAnyGroups.size());i++)
+            {
+                take_it=false;
+                for(int g=0;!take_it && (g<(int)vAnyGroups[i].size());g++)
+                {
+                    if(vAnyGroups[i][g]->m_GroupTxIDs.count(txid))
+                    {
+                        take_it=true;
+                    }
+                }
+            }
+            
+            if(take_it)
             {
-                memcpy(entity_rows->GetRow(out_row),lpEntTx,entity_rows->m_Size);
+                in_not=false;
+                for(i=0;!in_not && (i<(int)vNotCursors.size());i++)
+                {
+                    if(vNotCursors[i]->m_GroupTxIDs.count(txid))
+                    {
+                        in_not=true;
+                    }
+                }
+                if(in_not || (verify_count > 0))
+                {
+                    lpEntTx->m_TempPos=2;
+                    dirty_count++;
+                }
+                if(out_row < row)
+                {
+                    memcpy(entity_rows->GetRow(out_row),lpEntTx,entity_rows->m_Size);
+                }
+                out_row++;
             }
-            out_row++;
         }
+        entity_rows->SetCount(out_row);
+        
+        block++;
     }
     
-    entity_rows->SetCount(out_row);
-    
 exitlbl:
+    
+    if(err && lpOutput)
+    {
+        if(strErrorOut)
+        {
+            WRPCheckWalletError(err,lpOutput->m_Entity.m_EntityType,"",&errCode,&strError);
+        }
+        else
+        {
+            CheckWalletError(err,lpOutput->m_Entity.m_EntityType,"");
+        }
+    }
                 
     if(strError.size())
     {
@@ -3348,10 +4258,43 @@ int GetAndQueryDirtyList(vector<mc_QueryCondition>& conditions, mc_EntityDetails
 }
 
 
+void FillConditionsGroup(vector<mc_QueryCondition>& conditions, Value param, uint32_t type, uint32_t flags, string field_name)
+{
+    string item_name=(type == MC_QCT_KEY) ? "key" : "publisher";
+    
+    if(param.type() != array_type)
+    {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Invalid %s, should be array",field_name.c_str()));                                                            
+    }
+    if(param.get_array().size() == 0)
+    {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Invalid %s, should be non-empty array",field_name.c_str()));                                                            
+    }
+    if(param.get_array().size() == 1)
+    {
+        flags &= ~MC_QCF_ANY;                                                   // Group of one condition is plain condition
+    }
+    for(int i=0;i<(int)param.get_array().size();i++)
+    {
+        if(param.get_array()[i].type()==str_type)
+        {
+            conditions.push_back(mc_QueryCondition(type,param.get_array()[i].get_str(),flags));
+        }
+        else
+        {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Invalid %s, should be string",item_name.c_str()));                                                            
+        }
+    }                
+}
+
 void FillConditionsList(vector<mc_QueryCondition>& conditions, Value param)
 {
     bool key_found=false;
     bool publisher_found=false;
+    bool anykeys_found=false;
+    bool anypublishers_found=false;
+    bool notkeys_found=false;
+    bool notpublishers_found=false;
     bool field_parsed;
     
     if(param.type() != obj_type)
@@ -3458,6 +4401,36 @@ void FillConditionsList(vector<mc_QueryCondition>& conditions, Value param)
             publisher_found=true;
         }
         
+        if( (d.name_ == "anykeys") || (d.name_ == "anypublishers") || (d.name_ == "notkeys") || (d.name_ == "notpublishers") )
+        {
+            bool *found=&anykeys_found;
+            uint32_t type=MC_QCT_KEY;
+            uint32_t flags=MC_QCF_ANY;
+            if(d.name_ == "anypublishers")
+            {
+                found=&anypublishers_found;
+                type=MC_QCT_PUBLISHER;
+            }
+            if(d.name_ == "notkeys")
+            {
+                found=&notkeys_found;
+                flags=MC_QCF_NOT;
+            }
+            if(d.name_ == "notpublishers")
+            {
+                found=&notpublishers_found;
+                type=MC_QCT_PUBLISHER;
+                flags=MC_QCF_NOT;
+            }
+            if(*found)
+            {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Only one %s field can appear in the object",d.name_.c_str()));                                                            
+            }
+            FillConditionsGroup(conditions,d.value_,type,flags,d.name_);
+            field_parsed=true;
+            *found=true;
+        }
+        
         if(!field_parsed)
         {
             throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Invalid field: %s",d.name_.c_str()));                                                            
@@ -3468,7 +4441,7 @@ void FillConditionsList(vector<mc_QueryCondition>& conditions, Value param)
 
 Value liststreamqueryitems(const Array& params, bool fHelp)
 {
-    if (fHelp || params.size() < 2 || params.size() > 3)
+    if (fHelp || params.size() < 2 || params.size() > 5)
         throw runtime_error("Help message not found\n");
 
     if((mc_gState->m_WalletMode & MC_WMD_TXS) == 0)
@@ -3488,13 +4461,27 @@ Value liststreamqueryitems(const Array& params, bool fHelp)
     mc_EntityDetails stream_entity;
 
     bool verbose=false;
+    bool fPaginate=false;
     int dirty_count,max_count;
+    int count,start,skip_count,scanned_count;
     
     if (params.size() > 2)    
     {
         verbose=paramtobool(params[2]);
     }
     
+    count=0;
+    if (params.size() > 3)    
+    {
+        count=paramtoint(params[3],true,0,"Invalid count");
+        fPaginate=true;
+    }
+    start=-count;
+    if (params.size() > 4)    
+    {
+        start=paramtoint(params[4],false,0,"Invalid start");
+    }
+    
     
     FillConditionsList(conditions,params[1]);    
 
@@ -3537,21 +4524,42 @@ Value liststreamqueryitems(const Array& params, bool fHelp)
         goto exitlbl;
     }
     max_count=GetArg("-maxqueryscanitems",MAX_STREAM_QUERY_ITEMS);
-    if(dirty_count > max_count)
+    skip_count=0;
+    if(fPaginate)
     {
-        errCode=RPC_NOT_SUPPORTED;
-        strError=strprintf("This query requires decoding %d items, which is above the maxqueryscanitems limit of %d.",
-                dirty_count,max_count);
-        goto exitlbl;
-    }          
+        if( (dirty_count == 0) || (start >= 0) )                                // Page can be found without decoding all dirty items
+        {
+            if(dirty_count == 0)
+            {
+                mc_AdjustStartAndCount(&count,&start,entity_rows->GetCount());
+            }
+            skip_count=start;
+        }
+        else
+        {
+            fPaginate=false;                                                    // Counting from the end, all items should be decoded
+        }
+    }
     
-    if(entity_rows->GetCount() > max_count)
+    if(!fPaginate)
     {
-        errCode=RPC_NOT_SUPPORTED;
-        strError="Resulting list is too large";
-        goto exitlbl;
+        if(dirty_count > max_count)
+        {
+            errCode=RPC_NOT_SUPPORTED;
+            strError=strprintf("This query requires decoding %d items, which is above the maxqueryscanitems limit of %d.",
+                    dirty_count,max_count);
+            goto exitlbl;
+        }          
+
+        if(entity_rows->GetCount() > max_count)
+        {
+            errCode=RPC_NOT_SUPPORTED;
+            strError="Resulting list is too large";
+            goto exitlbl;
+        }
     }
     
+    scanned_count=0;
     chain_height=chainActive.Height();
     for(int i=0;i<entity_rows->GetCount();i++)
     {
@@ -3559,6 +4567,26 @@ Value liststreamqueryitems(const Array& params, bool fHelp)
         mc_TxDefRow txdef;
         lpEntTx=(mc_TxEntityRow*)entity_rows->GetRow(i);
         lpConditions=NULL;
+        if(fPaginate)
+        {
+            if((int)retArray.size() >= count)
+            {
+                break;
+            }
+            if( (skip_count > 0) && (lpEntTx->m_TempPos == 0) )                 // Clean rows are skipped without decoding
+            {
+                skip_count--;
+                last_hash=0;
+                continue;
+            }
+            scanned_count++;
+            if(scanned_count > max_count)
+            {
+                errCode=RPC_NOT_SUPPORTED;
+                strError=strprintf("This query requires decoding more than %d items, which is the maxqueryscanitems limit.",max_count);
+                goto exitlbl;
+            }
+        }
         if(lpEntTx->m_TempPos != 1)
         {
             if(lpEntTx->m_TempPos == 2)
@@ -3585,7 +4613,14 @@ Value liststreamqueryitems(const Array& params, bool fHelp)
                 Object entry=StreamItemEntry(rpc_slot,wtx,first_output,stream_entity.GetTxID()+MC_AST_SHORT_TXID_OFFSET,verbose,lpConditions,&last_output,&txdef,chain_height);
                 if(entry.size())
                 {
-                    retArray.push_back(entry);                                
+                    if(skip_count > 0)
+                    {
+                        skip_count--;
+                    }
+                    else
+                    {
+                        retArray.push_back(entry);                                
+                    }
                 }                    
                 else
                 {
@@ -3595,6 +4630,19 @@ Value liststreamqueryitems(const Array& params, bool fHelp)
         }
     }
     
+    if( (params.size() > 3) && !fPaginate )                                     // All matching items are decoded, page is taken from the end 
+    {
+        Array pageArray;
+        int size=(int)retArray.size();
+        count=paramtoint(params[3],true,0,"Invalid count");
+        mc_AdjustStartAndCount(&count,&start,size);
+        for(int i=start;i<start+count;i++)
+        {
+            pageArray.push_back(retArray[i]);
+        }
+        retArray=pageArray;
+    }
+    
 exitlbl:
                 
     if(fWRPLocked)
@@ -26,16 +26,28 @@
 #define MC_QCT_KEY                  1
 #define MC_QCT_PUBLISHER            2
 
+#define MC_QCF_ANY                  0x00000001                                  // At least one condition of this type in the group should match
+#define MC_QCF_NOT                  0x00000002                                  // Condition should not match
 
 typedef struct mc_QueryCondition
 {
     uint32_t m_Type;
+    uint32_t m_Flags;
     string m_Value;      
     bool m_TmpMatch;
     
     mc_QueryCondition(int type, string value)
     {
         m_Type=type;
+        m_Flags=0;
+        m_Value=value;
+        m_TmpMatch=false;
+    }
+    
+    mc_QueryCondition(int type, string value, uint32_t flags)
+    {
+        m_Type=type;
+        m_Flags=flags;
         m_Value=value;
         m_TmpMatch=false;
     }
@@ -49,6 +61,7 @@ vector<CTxDestination> ParseAddresses(string param, bool create_full_list, bool
 void FindAddressesWithPublishPermission(std::vector<CTxDestination>& fromaddresses,mc_EntityDetails *stream_entity);
 set<string> ParseAddresses(Value param, isminefilter filter);
 bool CBitcoinAddressFromTxEntity(CBitcoinAddress &address,mc_TxEntity *lpEntity);
+bool QueryConditionsMatch(vector<mc_QueryCondition> *given_conditions,uint32_t type);
 Object StreamItemEntry(const CWalletTx& wtx,int first_output,const unsigned char *stream_id, bool verbose, vector<mc_QueryCondition> *given_conditions,int *output);
 Object StreamItemEntry(int rpc_slot,const CWalletTx& wtx,int first_output,const unsigned char *stream_id, bool verbose, vector<mc_QueryCondition> *given_conditions,int *output,mc_TxDefRow *txdef_in,int chain_height);
 Object TxOutEntry(const CTxOut& TxOutIn,int vout,const CTxIn& TxIn,uint256 hash,mc_Buffer *amounts,mc_Script *lpScript);
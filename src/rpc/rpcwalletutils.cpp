@@ -710,6 +710,51 @@ Object StreamItemEntry(const CWalletTx& wtx,int first_output,const unsigned char
     return StreamItemEntry(-1,wtx,first_output,stream_id,verbose,given_conditions,output,NULL,-1);
 }
 
+bool QueryConditionsMatch(vector<mc_QueryCondition> *given_conditions,uint32_t type)
+{
+    int any_count=0;
+    bool any_match=false;
+    
+    for(int c=0;c<(int)(*given_conditions).size();c++)
+    {
+        if((*given_conditions)[c].m_Type == type)
+        {
+            if((*given_conditions)[c].m_Flags & MC_QCF_NOT)
+            {
+                if((*given_conditions)[c].m_TmpMatch)
+                {
+                    return false;
+                }
+            }
+            else
+            {
+                if((*given_conditions)[c].m_Flags & MC_QCF_ANY)
+                {
+                    any_count++;
+                    if((*given_conditions)[c].m_TmpMatch)
+                    {
+                        any_match=true;
+                    }
+                }
+                else
+                {
+                    if(!(*given_conditions)[c].m_TmpMatch)
+                    {
+                        return false;
+                    }
+                }
+            }
+        }
+    }
+    
+    if(any_count && !any_match)
+    {
+        return false;
+    }
+    
+    return true;
+}
+
 Object StreamItemEntry(int rpc_slot,const CWalletTx& wtx,int first_output,const unsigned char *stream_id, bool verbose, vector<mc_QueryCondition> *given_conditions,int *output,
                         mc_TxDefRow *txdef_in,int chain_height)
 {
@@ -810,15 +855,9 @@ Object StreamItemEntry(int rpc_slot,const CWalletTx& wtx,int first_output,const
                                 
                                 if(given_conditions)
                                 {
-                                    for(int c=0;c<(int)(*given_conditions).size();c++)
+                                    if(!QueryConditionsMatch(given_conditions,MC_QCT_KEY))
                                     {
-                                        if((*given_conditions)[c].m_Type == MC_QCT_KEY)
-                                        {
-                                            if(!(*given_conditions)[c].m_TmpMatch)
-                                            {
-                                                stream_output=-1;                                                
-                                            }
-                                        }
+                                        stream_output=-1;                                                
                                     }
                                 }
 
@@ -894,15 +933,9 @@ Object StreamItemEntry(int rpc_slot,const CWalletTx& wtx,int first_output,const
 
         if(given_conditions)
         {
-            for(int c=0;c<(int)(*given_conditions).size();c++)
+            if(!QueryConditionsMatch(given_conditions,MC_QCT_PUBLISHER))
             {
-                if((*given_conditions)[c].m_Type == MC_QCT_PUBLISHER)
-                {
-                    if(!(*given_conditions)[c].m_TmpMatch)
-                    {
-                        stream_output=-1;                                                
-                    }
-                }
+                stream_output=-1;                                                
             }
         }
                         
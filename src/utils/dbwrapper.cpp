@@ -7,6 +7,65 @@
 #include "leveldb/include/leveldb/c.h"
 #include "multichain/multichain.h"
 
+#include <map>
+#include <mutex>
+#include <vector>
+
+/** 
+ * LRU cache and bloom filter policy are shared by all databases of the node, 
+ * created when the first database is opened and destroyed when the last one 
+ * is closed.
+ */
+
+static std::mutex mc_DBSharedMutex;
+static leveldb_cache_t *mc_DBSharedCache=NULL;
+static leveldb_filterpolicy_t *mc_DBFilterPolicy=NULL;
+static int mc_DBSharedRefCount=0;
+
+static void mc_AcquireSharedDBResources()
+{
+    std::lock_guard<std::mutex> lock(mc_DBSharedMutex);
+    
+    if(mc_DBSharedRefCount == 0)
+    {
+        int64_t cache_size=MC_DCT_DB_DEFAULT_SHARED_CACHE_SIZE;
+        if(mc_gState && mc_gState->m_Params)
+        {
+            cache_size=mc_gState->m_Params->GetOption("-leveldbcache",MC_DCT_DB_DEFAULT_SHARED_CACHE_SIZE);
+        }
+        if(cache_size < MC_DCT_DB_MIN_SHARED_CACHE_SIZE)
+        {
+            cache_size=MC_DCT_DB_MIN_SHARED_CACHE_SIZE;
+        }
+        mc_DBSharedCache=leveldb_cache_create_lru((size_t)cache_size << 20);
+        mc_DBFilterPolicy=leveldb_filterpolicy_create_bloom(MC_DCT_DB_BLOOM_BITS_PER_KEY);
+    }
+    mc_DBSharedRefCount++;
+}
+
+static void mc_ReleaseSharedDBResources()
+{
+    std::lock_guard<std::mutex> lock(mc_DBSharedMutex);
+    
+    mc_DBSharedRefCount--;
+    if(mc_DBSharedRefCount == 0)
+    {
+        leveldb_cache_destroy(mc_DBSharedCache);
+        mc_DBSharedCache=NULL;
+        leveldb_filterpolicy_destroy(mc_DBFilterPolicy);
+        mc_DBFilterPolicy=NULL;
+    }
+}
+
+/** 
+ * Point reads from thread-safe databases are copied to buffers owned by reading thread, one per database.
+ * Buffer of the thread closing the database is released in Close(), buffers of other threads are released 
+ * when these threads exit. Stale buffer left for a closed database is only reused as scratch space by a 
+ * database later opened at the same address.
+ */
+
+static thread_local std::map<const cs_Database*,std::vector<char> > mc_DBThreadReadBuffers;
+
 int cs_Database::Zero()
 {
     
@@ -45,8 +104,6 @@ int cs_Database::Zero()
     
     m_Name[0]=0;
     
-    m_ThreadReadBuffers=NULL;
-    
     return MC_ERR_NOERROR;
 }
 
@@ -71,12 +128,6 @@ int cs_Database::Destroy()
         m_ReadBuffer=NULL;
     }
     
-    if(m_ThreadReadBuffers)
-    {
-        delete m_ThreadReadBuffers;
-        m_ThreadReadBuffers=NULL;
-    }
-
     if(m_Semaphore)
     {
         __US_SemDestroy(m_Semaphore);
@@ -119,13 +170,15 @@ int cs_Database::Open(char *name,int Options)
                 m_IterOptions = (void*)leveldb_readoptions_create();
                 m_WriteOptions = (void*)leveldb_writeoptions_create();
                 m_SyncOptions = (void*)leveldb_writeoptions_create();
-                m_Cache = (void*)leveldb_cache_create_lru(128 << 20);
+                mc_AcquireSharedDBResources();
+                m_Cache = (void*)mc_DBSharedCache;
                 
-                leveldb_readoptions_set_fill_cache((leveldb_readoptions_t*)m_ReadOptions,0);
+                leveldb_readoptions_set_fill_cache((leveldb_readoptions_t*)m_ReadOptions,1);      // Point reads are hot, scans should not evict them
                 leveldb_readoptions_set_fill_cache((leveldb_readoptions_t*)m_IterOptions,0);
                 leveldb_writeoptions_set_sync((leveldb_writeoptions_t*)m_SyncOptions,1);
                 
                 leveldb_options_set_cache((leveldb_options_t*)m_OpenOptions,(leveldb_cache_t*)m_Cache);
+                leveldb_options_set_filter_policy((leveldb_options_t*)m_OpenOptions,mc_DBFilterPolicy);
                 leveldb_options_set_max_open_files((leveldb_options_t*)m_OpenOptions,128);
                 if(Options & MC_OPT_DB_DATABASE_CREATE_IF_MISSING)
                 {
@@ -146,6 +199,7 @@ int cs_Database::Open(char *name,int Options)
 
                 if (err != NULL) 
                 {
+                    mc_ReleaseSharedDBResources();
                     Destroy();
                     printf("%s\n",err);
                     leveldb_free(err);
@@ -222,9 +276,6 @@ int cs_Database::Open(char *name,int Options)
             
     if(m_Options & MC_OPT_DB_DATABASE_THREAD_SAFE)
     {
-        m_ThreadReadBuffers=new mc_Buffer;
-        m_ThreadReadBuffers->Initialize(sizeof(uint64_t),sizeof(uint64_t)+m_KeySize+m_ValueSize+1,MC_BUF_MODE_MAP);    
-        m_ThreadReadBuffers->Realloc(m_MaxClients);
         m_Semaphore=__US_SemCreate();
     }
     
@@ -233,24 +284,15 @@ int cs_Database::Open(char *name,int Options)
     return MC_ERR_NOERROR;    
 }
 
-char *cs_Database::GetReadBuffer()
+char *cs_Database::GetReadBuffer(int size)
 {
-    if(m_ThreadReadBuffers == NULL)
-    {
-        return NULL;
-    }
-    
-    uint64_t thread_id=__US_ThreadID();
-    int mprow=m_ThreadReadBuffers->Seek(&thread_id);
-    if(mprow < 0)
+    std::vector<char>& buffer=mc_DBThreadReadBuffers[this];
+    if((int)buffer.size() < size)
     {
-        __US_SemWait(m_Semaphore);
-        mprow=m_ThreadReadBuffers->GetCount();
-        m_ThreadReadBuffers->Add(&thread_id,NULL);        
-        __US_SemPost(m_Semaphore);
+        buffer.resize(((size-1)/MC_DCT_DB_READ_BUFFER_SIZE + 1) * MC_DCT_DB_READ_BUFFER_SIZE);
     }
     
-    return (char*)m_ThreadReadBuffers->GetRow(mprow)+sizeof(uint64_t);    
+    return &(buffer[0]);    
 }
 
 int cs_Database::Close()
@@ -259,16 +301,12 @@ int cs_Database::Close()
 //    uint32_t pid; 
 //    double start_time;
     
+    mc_DBThreadReadBuffers.erase(this);
+    
     switch(m_Options & MC_OPT_DB_DATABASE_TYPE_MASK)
     {
         case MC_OPT_DB_DATABASE_LEVELDB:    
 
-            if(m_Cache)
-            {
-                leveldb_cache_destroy((leveldb_cache_t*)m_Cache);
-                m_Cache=NULL;
-            }
-
             if(m_OpenOptions)
             {
                 leveldb_options_destroy((leveldb_options_t*)m_OpenOptions);
@@ -321,6 +359,12 @@ int cs_Database::Close()
                 }
                 m_DB=NULL;
             }
+            
+            if(m_Cache)                                                         // Released after closing, database may use it on close
+            {
+                mc_ReleaseSharedDBResources();
+                m_Cache=NULL;
+            }
             break;
         case MC_OPT_DB_DATABASE_REMOTE_SHMEM:    
 /*            
@@ -545,7 +589,7 @@ char *cs_Database::Read(char *key,int key_len,int *value_len,int Options,int *er
     }
  
     read_buf=NULL;
-    if(m_ThreadReadBuffers==NULL)
+    if((m_Options & MC_OPT_DB_DATABASE_THREAD_SAFE) == 0)
     {
         if(*value_len+klen+1>m_ReadBufferSize)
         {
@@ -573,7 +617,7 @@ char *cs_Database::Read(char *key,int key_len,int *value_len,int Options,int *er
     {        
         if(lpRead)
         {
-            read_buf=GetReadBuffer();
+            read_buf=GetReadBuffer(*value_len+1);
 //            printf("%16X %16X %ld %d\n",(uint64_t)this,(uint64_t)read_buf,__US_ThreadID(),m_KeySize+m_ValueSize);
             memcpy(read_buf,lpRead,*value_len);
             read_buf[*value_len]=0;        
@@ -613,6 +657,237 @@ char *cs_Database::Read(char *key,int key_len,int *value_len,int Options,int *er
     return m_ReadBuffer;    
 }
 
+typedef struct mc_DatabaseSnapshot
+{
+    const leveldb_snapshot_t *m_Snapshot;
+    leveldb_readoptions_t *m_ReadOptions;
+} mc_DatabaseSnapshot;
+
+void *cs_Database::CreateSnapshot()
+{
+    mc_DatabaseSnapshot *snapshot;
+    
+    if(m_DB == NULL)
+    {
+        return NULL;
+    }
+    
+    if((m_Options & MC_OPT_DB_DATABASE_TYPE_MASK) != MC_OPT_DB_DATABASE_LEVELDB)
+    {
+        return NULL;
+    }
+    
+    snapshot=new mc_DatabaseSnapshot;
+    snapshot->m_Snapshot=leveldb_create_snapshot((leveldb_t*)m_DB);
+    snapshot->m_ReadOptions=leveldb_readoptions_create();
+    leveldb_readoptions_set_fill_cache(snapshot->m_ReadOptions,0);
+    leveldb_readoptions_set_snapshot(snapshot->m_ReadOptions,snapshot->m_Snapshot);
+    
+    return snapshot;
+}
+
+void cs_Database::ReleaseSnapshot(void *snapshot)
+{
+    mc_DatabaseSnapshot *db_snapshot=(mc_DatabaseSnapshot *)snapshot;
+    
+    if(db_snapshot == NULL)
+    {
+        return;
+    }
+    
+    leveldb_readoptions_destroy(db_snapshot->m_ReadOptions);
+    if(m_DB)
+    {
+        leveldb_release_snapshot((leveldb_t*)m_DB,db_snapshot->m_Snapshot);
+    }
+    
+    delete db_snapshot;
+}
+
+int cs_Database::ReadToBuffer(void *snapshot,char *key,int key_len,char *value,int max_value_len,int *value_len)
+{
+    char *err = NULL;
+    char *lpRead;
+    size_t vallen;
+    leveldb_readoptions_t *read_options;
+    
+    int klen=key_len;
+    
+    *value_len=-1;
+    
+    if(key == NULL)
+    {
+        return MC_ERR_INTERNAL_ERROR;
+    }
+    if(klen<0)klen=strlen(key);
+    
+    if(m_DB == NULL)
+    {
+        return MC_ERR_DBOPEN_ERROR;
+    }
+    
+    if((m_Options & MC_OPT_DB_DATABASE_TYPE_MASK) != MC_OPT_DB_DATABASE_LEVELDB)
+    {
+        return MC_ERR_NOT_SUPPORTED;
+    }
+    
+    read_options=(leveldb_readoptions_t*)m_ReadOptions;
+    if(snapshot)
+    {
+        read_options=((mc_DatabaseSnapshot *)snapshot)->m_ReadOptions;
+    }
+    
+    lpRead = leveldb_get((leveldb_t*)m_DB, read_options, key, klen, &vallen, &err);
+    
+    if (err != NULL) 
+    {
+        leveldb_free(err);
+        return MC_ERR_INTERNAL_ERROR;
+    }
+    
+    if(lpRead == NULL)
+    {
+        return MC_ERR_NOERROR;
+    }
+    
+    if((int)vallen > max_value_len)
+    {
+        leveldb_free(lpRead);
+        return MC_ERR_ALLOCATION;
+    }
+    
+    memcpy(value,lpRead,vallen);
+    *value_len=vallen;
+    
+    leveldb_free(lpRead);
+    
+    return MC_ERR_NOERROR;
+}
+
+int mc_CompareDatabaseKeys(const char *key1,size_t len1,const char *key2,size_t len2)
+{
+    int cmp;
+    
+    cmp=memcmp(key1,key2,(len1 < len2) ? len1 : len2);
+    if(cmp)
+    {
+        return cmp;
+    }
+    if(len1 < len2)
+    {
+        return -1;
+    }
+    if(len1 > len2)
+    {
+        return 1;
+    }
+    return 0;
+}
+
+/** Sorted keys are read by moving single iterator forward, seek is used only if the next key is far */
+
+int cs_Database::BatchRead(void *snapshot,char *Data,int record_size,int key_len,int *results,int count,int Options)
+{
+    char *err = NULL;
+    leveldb_readoptions_t *read_options;
+    leveldb_iterator_t *iterator;
+    const char *lpIterKey;
+    const char *lpIterValue;
+    size_t keylen,vallen;
+    char *key;
+    int i,steps,positioned,valid,cmp,error;
+    
+    if(Data == NULL)
+    {
+        return MC_ERR_INTERNAL_ERROR;
+    }
+    
+    if(m_DB == NULL)
+    {
+        return MC_ERR_DBOPEN_ERROR;
+    }
+    
+    if((m_Options & MC_OPT_DB_DATABASE_TYPE_MASK) != MC_OPT_DB_DATABASE_LEVELDB)
+    {
+        return MC_ERR_NOT_SUPPORTED;
+    }
+    
+    read_options=(leveldb_readoptions_t*)m_ReadOptions;
+    if(snapshot)
+    {
+        read_options=((mc_DatabaseSnapshot *)snapshot)->m_ReadOptions;
+    }
+    
+    iterator=leveldb_create_iterator((leveldb_t*)m_DB,read_options);
+    
+    error=MC_ERR_NOERROR;
+    positioned=0;
+    valid=0;
+    cmp=-1;
+    
+    for(i=0;i<count;i++)
+    {
+        key=Data+i*record_size;
+        results[i]=-1;
+        
+        steps=0;
+        cmp=-1;
+        while(positioned && valid)                                              // Iterator is before or at the key, trying to move forward
+        {
+            lpIterKey=leveldb_iter_key(iterator,&keylen);
+            cmp=mc_CompareDatabaseKeys(lpIterKey,keylen,key,key_len);
+            if( (cmp >= 0) || (steps >= MC_DCT_DB_BATCH_READ_MAX_STEPS) )
+            {
+                break;
+            }
+            leveldb_iter_next(iterator);
+            valid=leveldb_iter_valid(iterator);
+            steps++;
+        }
+        
+        if(positioned && !valid)                                                // End of database, remaining keys are not found
+        {
+            continue;
+        }
+        
+        if(cmp < 0)
+        {
+            leveldb_iter_seek(iterator,key,key_len);
+            positioned=1;
+            valid=leveldb_iter_valid(iterator);
+            if(!valid)
+            {
+                continue;
+            }
+            lpIterKey=leveldb_iter_key(iterator,&keylen);
+            cmp=mc_CompareDatabaseKeys(lpIterKey,keylen,key,key_len);
+        }
+        
+        if(cmp == 0)
+        {
+            lpIterValue=leveldb_iter_value(iterator,&vallen);
+            if((int)vallen > record_size-key_len)
+            {
+                error=MC_ERR_ALLOCATION;
+                break;
+            }
+            memcpy(key+key_len,lpIterValue,vallen);
+            results[i]=vallen;
+        }
+    }
+    
+    leveldb_iter_get_error(iterator,&err);
+    if (err != NULL) 
+    {
+        leveldb_free(err);
+        error=MC_ERR_INTERNAL_ERROR;
+    }
+    
+    leveldb_iter_destroy(iterator);
+    
+    return error;
+}
+
 int cs_Database::Delete(char *key,int key_len,int Options)
 {    
     char *err = NULL;
@@ -7,12 +7,16 @@
 #define MC_DCT_DB_MAX_PATH                     1024
 
 #define MC_DCT_DB_READ_BUFFER_SIZE                         4096
+#define MC_DCT_DB_BATCH_READ_MAX_STEPS                        8
 #define MC_DCT_DB_DEFAULT_MAX_CLIENTS                       256
 #define MC_DCT_DB_DEFAULT_MAX_ROWS                          256
 #define MC_DCT_DB_DEFAULT_MAX_KEY_SIZE                      256
 #define MC_DCT_DB_DEFAULT_MAX_VALUE_SIZE                    256
 #define MC_DCT_DB_DEFAULT_MAX_TIME_PER_SWEEP                1.f
 #define MC_DCT_DB_DEFAULT_MAX_SHMEM_TIMEOUT                 3.f
+#define MC_DCT_DB_DEFAULT_SHARED_CACHE_SIZE                 256
+#define MC_DCT_DB_MIN_SHARED_CACHE_SIZE                       8
+#define MC_DCT_DB_BLOOM_BITS_PER_KEY                         10
 
 #define MC_STT_DB_DATABASE_CLOSED                           0x00000000
 #define MC_STT_DB_DATABASE_OPENED                           0x00000001
@@ -105,7 +109,7 @@ typedef struct mc_Database
     void *                  m_IterOptions;
     void *                  m_WriteOptions;
     void *                  m_SyncOptions;
-    void *                  m_Cache;
+    void *                  m_Cache;                                            /* Node-wide LRU cache shared by all databases */
     void *                  m_WriteBatch;
     void *                  m_Iterator;
     
@@ -138,8 +142,6 @@ typedef struct mc_Database
     char                   *m_LogBuffer;    
     int                     m_LogSize;    
     
-    mc_Buffer              *m_ThreadReadBuffers;
-    
     int LogWrite(int op,
                       char  *key,                                               /* key */
                       int key_len,                                              /* key length, -1 if strlen is should be used */
@@ -165,18 +167,21 @@ typedef struct mc_Database
         int value_len,                                                          /* value length, -1 if strlen is used */
         int Options                                                             /* Options - not used */
     );
-    char *Read(                                                                 /* Reads value for specified key, no freeing required, pointer is valid until next read */
+    char *Read(                                                                 /* Reads value for specified key, no freeing required, pointer is valid until next read by this thread */
         char  *key,                                                             /* key */
         int key_len,                                                            /* key length, -1 if strlen is should be used */
         int *value_len,                                                         /* value length */
         int Options,                                                            /* Options - not used */
         int *error                                                              /* Error */
     );
-    int BatchRead(
-        char *Data,
-        int *results,
-        int count,
-        int Options
+    int BatchRead(                                                              /* Reads values for multiple keys with single iterator, reentrant */
+        void *snapshot,                                                         /* Snapshot returned by CreateSnapshot, NULL for current state */
+        char *Data,                                                             /* Array of records (key, value buffer), keys should be sorted */
+        int record_size,                                                        /* Record size */
+        int key_len,                                                            /* Key length, value buffer follows the key in each record */
+        int *results,                                                           /* Value lengths, -1 if key is not found */
+        int count,                                                              /* Number of records */
+        int Options                                                             /* Options - not used */
     );
     int Delete(                                                                 /* Delete key from database */
         char  *key,                                                             /* key */
@@ -190,7 +195,7 @@ typedef struct mc_Database
     void Lock(int write_mode);
     void UnLock();
     int Synchronize();
-    char *GetReadBuffer();
+    char *GetReadBuffer(int size);
     
     char *MoveNext(
         int *error
@@ -201,6 +206,19 @@ typedef struct mc_Database
         int *error
     );
     
+    void *CreateSnapshot();                                                     /* Creates read-only point-in-time view of the database */
+    void ReleaseSnapshot(
+        void *snapshot                                                          /* Snapshot returned by CreateSnapshot */
+    );
+    int ReadToBuffer(                                                           /* Reads value into caller-owned buffer, reentrant */
+        void *snapshot,                                                         /* Snapshot returned by CreateSnapshot, NULL for current state */
+        char  *key,                                                             /* key */
+        int key_len,                                                            /* key length, -1 if strlen is should be used */
+        char *value,                                                            /* Output buffer */
+        int max_value_len,                                                      /* Output buffer size */
+        int *value_len                                                          /* value length, -1 if key is not found */
+    );
+    
 } cs_Database;
 
 
@@ -59,6 +59,43 @@ typedef struct mc_MapStringString
     int GetCount();
 } mc_MapStringString;
 
+typedef struct mc_HashIndexSlot
+{
+    uint32_t                m_Hash;
+    int32_t                 m_Row;                                              // Row in the buffer, -1 - empty, -2 - deleted
+} mc_HashIndexSlot;
+
+typedef struct mc_HashIndex
+{
+    mc_HashIndex()
+    {
+        Zero();
+    }
+
+    ~mc_HashIndex()
+    {
+        Destroy();
+    }
+
+    mc_HashIndexSlot       *m_lpSlots;
+    int                     m_Size;                                             // Number of slots, power of 2
+    int                     m_Count;                                            // Number of live slots
+    int                     m_Used;                                             // Number of live and deleted slots
+    int                     m_KeySize;
+    int                     m_RowSize;
+    
+    void Zero();
+    int Destroy();
+    int Initialize(int KeySize,int RowSize);
+    int Clear();
+    int Resize(int Size);
+    int Find(const void *lpKey,uint32_t Hash,const unsigned char *lpData);
+    int Get(const void *lpKey,const unsigned char *lpData);
+    int Add(const void *lpKey,int RowID,const unsigned char *lpData);
+    int Set(const void *lpKey,int RowID,const unsigned char *lpData);
+    int Remove(const void *lpKey,int RowID,const unsigned char *lpData);
+} mc_HashIndex;
+
 typedef struct mc_Buffer
 {
     mc_Buffer()
@@ -71,7 +108,7 @@ typedef struct mc_Buffer
         Destroy();
     }
 
-    mc_MapStringIndex      *m_lpIndex;
+    mc_HashIndex           *m_lpIndex;
     unsigned char          *m_lpData;   
     int                     m_AllocSize;
     int                     m_Size;
@@ -230,6 +267,7 @@ struct mc_TerminalInput
 /* Functions */
     
 int mc_AllocSize(int items,int chunk_size,int item_size);
+uint32_t mc_HashBytes(const void *lpData,int size);
 void *mc_New(int Size);
 void mc_Delete(void *ptr);
 void mc_PutLE(void *dest,void *src,int dest_size);
@@ -323,6 +361,9 @@ void __US_FlushFileWithMode(int FileHan,uint32_t use_data_sync);
 int __US_LockFile(int FileHan,int exclusive,int non_blocking);
 int __US_UnLockFile(int FileHan);
 int __US_DeleteFile(const char *file_name);
+void* __US_MapFile(int FileHan,int64_t size);
+void __US_UnMapFile(void *ptr,int64_t size);
+int64_t __US_FileSize(int FileHan);
 int __US_GetPID();
 int __US_FindMacServerAddress(unsigned char **lppAddr,unsigned char *lpAddrToValidate);
 void sprintf_hex(char *hex,const unsigned char *bin,int size);
@@ -344,6 +344,37 @@ int __US_DeleteFile(const char *file_name)
     return unlink(file_name);
 }
 
+void* __US_MapFile(int FileHan,int64_t size)
+{
+    void *ptr;
+    
+    ptr=mmap(NULL,(size_t)size,PROT_READ,MAP_SHARED,FileHan,0);
+    if(ptr == MAP_FAILED)
+    {
+        return NULL;
+    }
+    return ptr;
+}
+
+void __US_UnMapFile(void *ptr,int64_t size)
+{
+    if(ptr)
+    {
+        munmap(ptr,(size_t)size);
+    }
+}
+
+int64_t __US_FileSize(int FileHan)
+{
+    struct stat st;
+    
+    if(fstat(FileHan,&st))                                                      // Unlike lseek, doesn't move file offset shared with other readers
+    {
+        return -1;
+    }
+    return (int64_t)st.st_size;
+}
+
 int __US_GetPID()
 {
     return getpid();
@@ -676,6 +707,20 @@ int __US_DeleteFile(const char *file_name)
     return (int)DeleteFile(file_name);
 }
 
+void* __US_MapFile(int FileHan,int64_t size)
+{
+    return NULL;                                                                // Mapping beyond end of file is not supported, callers fall back to read()
+}
+
+void __US_UnMapFile(void *ptr,int64_t size)
+{
+}
+
+int64_t __US_FileSize(int FileHan)
+{
+    return (int64_t)_filelengthi64(FileHan);
+}
+
 int __US_GetPID()
 {
     return (int)GetCurrentProcessId();
@@ -338,6 +338,269 @@ double mc_TimeNowAsDouble()
 }
 
 
+/** 32-bit hash of arbitrary bytes, 8 bytes per step */
+
+uint32_t mc_HashBytes(const void *lpData,int size)
+{
+    const unsigned char *ptr=(const unsigned char *)lpData;
+    uint64_t hash=0xCBF29CE484222325ULL ^ (uint64_t)size;
+    uint64_t word;
+    
+    while(size >= 8)
+    {
+        memcpy(&word,ptr,8);
+        hash=(hash ^ word) * 0x9E3779B97F4A7C15ULL;
+        hash^=hash >> 29;
+        ptr+=8;
+        size-=8;
+    }
+    
+    if(size > 0)
+    {
+        word=0;
+        memcpy(&word,ptr,size);
+        hash=(hash ^ word) * 0x9E3779B97F4A7C15ULL;
+        hash^=hash >> 29;
+    }
+    
+    hash*=0xBF58476D1CE4E5B9ULL;
+    
+    return (uint32_t)(hash >> 32);
+}
+
+void mc_HashIndex::Zero()
+{
+    m_lpSlots=NULL;
+    m_Size=0;
+    m_Count=0;
+    m_Used=0;
+    m_KeySize=0;
+    m_RowSize=0;
+}
+
+int mc_HashIndex::Destroy()
+{
+    if(m_lpSlots)
+    {
+        mc_Delete(m_lpSlots);
+    }
+    
+    Zero();
+    
+    return MC_ERR_NOERROR;
+}
+
+int mc_HashIndex::Initialize(int KeySize,int RowSize)
+{
+    Destroy();
+    
+    m_KeySize=KeySize;
+    m_RowSize=RowSize;
+    
+    return Resize(MC_DCT_BUF_ALLOC_ITEMS);
+}
+
+int mc_HashIndex::Clear()
+{
+    int i;
+    
+    if(m_Size > 4*MC_DCT_BUF_ALLOC_ITEMS)                                       // Shrink after large buffer is cleared
+    {
+        mc_Delete(m_lpSlots);
+        m_lpSlots=NULL;
+        m_Size=0;
+        m_Count=0;
+        m_Used=0;
+        return Resize(MC_DCT_BUF_ALLOC_ITEMS);
+    }
+    
+    for(i=0;i<m_Size;i++)
+    {
+        m_lpSlots[i].m_Row=-1;
+    }
+    m_Count=0;
+    m_Used=0;
+    
+    return MC_ERR_NOERROR;
+}
+
+/** Rebuilds slot table, live keys are unique, so only stored hashes are needed */
+
+int mc_HashIndex::Resize(int Size)
+{
+    mc_HashIndexSlot *lpOldSlots;
+    int OldSize,i,slot,mask;
+    
+    lpOldSlots=m_lpSlots;
+    OldSize=m_Size;
+    
+    m_lpSlots=(mc_HashIndexSlot*)mc_New(Size*sizeof(mc_HashIndexSlot));
+    if(m_lpSlots == NULL)
+    {
+        m_lpSlots=lpOldSlots;
+        return MC_ERR_ALLOCATION;
+    }
+    
+    for(i=0;i<Size;i++)
+    {
+        m_lpSlots[i].m_Row=-1;
+    }
+    
+    m_Size=Size;
+    mask=m_Size-1;
+    
+    for(i=0;i<OldSize;i++)
+    {
+        if(lpOldSlots[i].m_Row >= 0)
+        {
+            slot=lpOldSlots[i].m_Hash & mask;
+            while(m_lpSlots[slot].m_Row != -1)
+            {
+                slot=(slot+1) & mask;
+            }
+            m_lpSlots[slot]=lpOldSlots[i];
+        }
+    }
+    
+    m_Used=m_Count;
+    
+    if(lpOldSlots)
+    {
+        mc_Delete(lpOldSlots);
+    }
+    
+    return MC_ERR_NOERROR;
+}
+
+/** Returns slot containing the key, or -(first free slot)-1 if not found */
+
+int mc_HashIndex::Find(const void *lpKey,uint32_t Hash,const unsigned char *lpData)
+{
+    int slot,mask,free_slot;
+    mc_HashIndexSlot *lpSlot;
+    
+    mask=m_Size-1;
+    slot=Hash & mask;
+    free_slot=-1;
+    
+    for(;;)
+    {
+        lpSlot=m_lpSlots+slot;
+        if(lpSlot->m_Row == -1)
+        {
+            break;
+        }
+        if(lpSlot->m_Row >= 0)
+        {
+            if(lpSlot->m_Hash == Hash)
+            {
+                if(memcmp(lpData+(int64_t)m_RowSize*lpSlot->m_Row,lpKey,m_KeySize) == 0)
+                {
+                    return slot;
+                }
+            }
+        }
+        else
+        {
+            if(free_slot < 0)
+            {
+                free_slot=slot;
+            }
+        }
+        slot=(slot+1) & mask;
+    }
+    
+    if(free_slot < 0)
+    {
+        free_slot=slot;
+    }
+    
+    return -free_slot-1;
+}
+
+int mc_HashIndex::Get(const void *lpKey,const unsigned char *lpData)
+{
+    int slot;
+    
+    slot=Find(lpKey,mc_HashBytes(lpKey,m_KeySize),lpData);
+    if(slot < 0)
+    {
+        return -1;
+    }
+    
+    return m_lpSlots[slot].m_Row;
+}
+
+/** Adds key if it is not in the index yet, row should already contain the key */
+
+int mc_HashIndex::Add(const void *lpKey,int RowID,const unsigned char *lpData)
+{
+    int slot,err;
+    uint32_t hash;
+    
+    if( (m_Used+1)*2 > m_Size )
+    {
+        err=Resize( ((m_Count+1)*4 > m_Size) ? m_Size*2 : m_Size);
+        if(err)
+        {
+            return err;
+        }
+    }
+    
+    hash=mc_HashBytes(lpKey,m_KeySize);
+    slot=Find(lpKey,hash,lpData);
+    if(slot >= 0)
+    {
+        return MC_ERR_NOERROR;
+    }
+    
+    slot=-slot-1;
+    if(m_lpSlots[slot].m_Row == -1)
+    {
+        m_Used++;
+    }
+    m_lpSlots[slot].m_Hash=hash;
+    m_lpSlots[slot].m_Row=RowID;
+    m_Count++;
+    
+    return MC_ERR_NOERROR;
+}
+
+/** Adds key or points existing key to another row */
+
+int mc_HashIndex::Set(const void *lpKey,int RowID,const unsigned char *lpData)
+{
+    int slot;
+    
+    slot=Find(lpKey,mc_HashBytes(lpKey,m_KeySize),lpData);
+    if(slot >= 0)
+    {
+        m_lpSlots[slot].m_Row=RowID;
+        return MC_ERR_NOERROR;
+    }
+    
+    return Add(lpKey,RowID,lpData);
+}
+
+/** Removes key if it points to specified row */
+
+int mc_HashIndex::Remove(const void *lpKey,int RowID,const unsigned char *lpData)
+{
+    int slot;
+    
+    slot=Find(lpKey,mc_HashBytes(lpKey,m_KeySize),lpData);
+    if(slot >= 0)
+    {
+        if(m_lpSlots[slot].m_Row == RowID)
+        {
+            m_lpSlots[slot].m_Row=-2;
+            m_Count--;
+        }
+    }
+    
+    return MC_ERR_NOERROR;
+}
+
 void mc_Buffer::Zero()
 {
     m_lpData=NULL;   
@@ -380,7 +643,12 @@ int mc_Buffer::Initialize(int KeySize,int RowSize,uint32_t Mode)
     
     if(m_Mode & MC_BUF_MODE_MAP)
     {
-        m_lpIndex=new mc_MapStringIndex;
+        m_lpIndex=new mc_HashIndex;
+        err=m_lpIndex->Initialize(m_KeySize,m_RowSize);
+        if(err)
+        {
+            return err;
+        }
     }
         
     
@@ -503,7 +771,12 @@ int mc_Buffer::Add(const void *lpKey,const void *lpValue)
     
     if(m_lpIndex)
     {
-        m_lpIndex->Add((unsigned char*)lpKey,m_KeySize,m_Count);
+        err=m_lpIndex->Add(lpKey,m_Count,m_lpData);
+        if(err)
+        {
+            m_Size-=m_RowSize;
+            return err;
+        }
     }
     
     m_Count++;
@@ -525,7 +798,7 @@ int mc_Buffer::UpdateRow(int RowID,const void *lpKey,const void *lpValue)
     
     if(m_lpIndex)
     {
-        m_lpIndex->Remove((char*)GetRow(RowID),m_RowSize-m_KeySize);
+        m_lpIndex->Remove(GetRow(RowID),RowID,m_lpData);
     }
     
     return PutRow(RowID,lpKey,lpValue);
@@ -554,14 +827,7 @@ int mc_Buffer::PutRow(int RowID,const void *lpKey,const void *lpValue)
     
     if(m_lpIndex)
     {
-        if(m_lpIndex->Get((unsigned char*)lpKey,m_KeySize) >= 0)
-        {
-            m_lpIndex->Set((unsigned char*)lpKey,m_KeySize,RowID);            
-        }
-        else
-        {
-            m_lpIndex->Add((unsigned char*)lpKey,m_KeySize,RowID);
-        }
+        return m_lpIndex->Set(lpKey,RowID,m_lpData);
     }
     
     return MC_ERR_NOERROR;
@@ -575,16 +841,7 @@ int mc_Buffer::Seek(void *lpKey)
     
     if(m_lpIndex)
     {
-        row=m_lpIndex->Get((unsigned char*)lpKey,m_KeySize);
-        if(row >= 0)
-        {
-            ptr=GetRow(row);
-            if(memcmp(ptr,lpKey,m_KeySize)==0)
-            {
-                return row;
-            }
-        }
-        return -1;
+        return m_lpIndex->Get(lpKey,m_lpData);                                  // Keys are compared with buffer rows
     }
     
     ptr=m_lpData;
@@ -629,7 +886,7 @@ int mc_Buffer::SetCount(int count)
             for(i=0;i<count;i++)
             {
                 m_Size+=m_RowSize;
-                m_lpIndex->Add((unsigned char*)GetRow(i),m_KeySize,m_Count);
+                m_lpIndex->Add(GetRow(i),m_Count,m_lpData);
                 m_Count++;
 //                Add(GetRow(i),GetRow(i)+m_KeySize);
             }
@@ -6,7 +6,10 @@
 #include "utils/util.h"
 #include "v8/v8filter.h"
 #include "v8/v8utils.h"
+#include <algorithm>
+#include <ctime>
 #include <libplatform/libplatform.h>
+#include <vector>
 
 extern char _binary_icudtl_dat_start;
 extern char _binary_icudtl_dat_end;
@@ -39,9 +42,191 @@ int V8Engine::Initialize(IFilterCallback *filterCallback, std::string &strResult
     m_createParams.array_buffer_allocator = v8::ArrayBuffer::Allocator::NewDefaultAllocator();
     m_isolate = v8::Isolate::New(m_createParams);
     m_filterCallback = filterCallback;
+    InitializeCodeCache();
     return MC_ERR_NOERROR;
 }
 
+void V8Engine::InitializeCodeCache()
+{
+    boost::mutex::scoped_lock lock(m_codeCacheMutex);
+    if (m_isCodeCacheInitialized)
+    {
+        return;
+    }
+    m_isCodeCacheInitialized = true;
+    m_persistCodeCache = GetBoolArg("-filtercodecache", true);
+    if (m_persistCodeCache)
+    {
+        boost::system::error_code ec;
+        fs::create_directories(GetDataDir() / "filtercache", ec);
+        if (ec)
+        {
+            LogPrintf("Couldn't create filter code cache directory, code cache will not be persisted: %s\n", ec.message());
+            m_persistCodeCache = false;
+        }
+        else
+        {
+            // Files left by interrupted writes
+            for (fs::directory_iterator it(GetDataDir() / "filtercache", ec), end; !ec && it != end; it.increment(ec))
+            {
+                if (it->path().extension() == ".tmp")
+                {
+                    boost::system::error_code fileEc;
+                    fs::remove(it->path(), fileEc);
+                }
+            }
+            PruneCodeCache();
+        }
+    }
+}
+
+bool V8Engine::GetCodeCache(const uint256 &hash, std::string &data)
+{
+    boost::mutex::scoped_lock lock(m_codeCacheMutex);
+    auto it = m_codeCache.find(hash);
+    if (it != m_codeCache.end())
+    {
+        data = it->second.first;
+        m_codeCacheLRU.splice(m_codeCacheLRU.end(), m_codeCacheLRU, it->second.second);
+        return true;
+    }
+    if (!m_persistCodeCache)
+    {
+        return false;
+    }
+
+    std::ifstream ifs(CodeCacheFileName(hash).string(), std::fstream::in | std::fstream::binary);
+    if (!ifs.is_open())
+    {
+        return false;
+    }
+    data.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+    ifs.close();
+    if (data.empty())
+    {
+        return false;
+    }
+    // Pruning removes least recently used files first
+    boost::system::error_code ec;
+    fs::last_write_time(CodeCacheFileName(hash), std::time(nullptr), ec);
+    if (fDebug)
+        LogPrint("v8filter", "v8filter: Code cache loaded for %s\n", hash.ToString());
+    StoreCodeCache(hash, data);
+    return true;
+}
+
+void V8Engine::SetCodeCache(const uint256 &hash, const std::string &data)
+{
+    boost::mutex::scoped_lock lock(m_codeCacheMutex);
+    StoreCodeCache(hash, data);
+    if (m_persistCodeCache)
+    {
+        // Written to a temporary file and renamed, so other engines never read a partially written file
+        fs::path fileName = CodeCacheFileName(hash);
+        fs::path tmpFileName = fileName;
+        tmpFileName += ".tmp";
+        WriteBinaryFile(tmpFileName, const_cast<char *>(data.data()), data.size());
+        boost::system::error_code ec;
+        fs::rename(tmpFileName, fileName, ec);
+        if (ec)
+        {
+            fs::remove(tmpFileName, ec);
+            return;
+        }
+        PruneCodeCache();
+    }
+}
+
+void V8Engine::RemoveCodeCache(const uint256 &hash)
+{
+    if (fDebug)
+        LogPrint("v8filter", "v8filter: Code cache rejected for %s\n", hash.ToString());
+    boost::mutex::scoped_lock lock(m_codeCacheMutex);
+    auto it = m_codeCache.find(hash);
+    if (it != m_codeCache.end())
+    {
+        m_codeCacheSize -= it->second.first.size();
+        m_codeCacheLRU.erase(it->second.second);
+        m_codeCache.erase(it);
+    }
+    if (m_persistCodeCache)
+    {
+        boost::system::error_code ec;
+        fs::remove(CodeCacheFileName(hash), ec);
+    }
+}
+
+void V8Engine::StoreCodeCache(const uint256 &hash, const std::string &data)
+{
+    auto it = m_codeCache.find(hash);
+    if (it != m_codeCache.end())
+    {
+        m_codeCacheSize -= it->second.first.size();
+        it->second.first = data;
+        m_codeCacheLRU.splice(m_codeCacheLRU.end(), m_codeCacheLRU, it->second.second);
+    }
+    else
+    {
+        m_codeCache.insert(
+            std::make_pair(hash, std::make_pair(data, m_codeCacheLRU.insert(m_codeCacheLRU.end(), hash))));
+    }
+    m_codeCacheSize += data.size();
+
+    while (m_codeCacheSize > MC_V8_MAX_MEMORY_CODE_CACHE_SIZE && m_codeCacheLRU.size() > 1)
+    {
+        it = m_codeCache.find(m_codeCacheLRU.front());
+        m_codeCacheSize -= it->second.first.size();
+        m_codeCache.erase(it);
+        m_codeCacheLRU.pop_front();
+    }
+}
+
+fs::path V8Engine::CodeCacheFileName(const uint256 &hash)
+{
+    return GetDataDir() / "filtercache" / (hash.ToString() + ".bin");
+}
+
+void V8Engine::PruneCodeCache()
+{
+    int64_t maxSize = GetArg("-filtercodecachesize", MC_V8_DEFAULT_CODE_CACHE_SIZE) << 20;
+    if (maxSize <= 0)
+    {
+        return;
+    }
+
+    boost::system::error_code ec;
+    std::vector<std::pair<std::time_t, std::pair<fs::path, int64_t>>> files;
+    int64_t totalSize = 0;
+    for (fs::directory_iterator it(GetDataDir() / "filtercache", ec), end; !ec && it != end; it.increment(ec))
+    {
+        if (it->path().extension() != ".bin")
+        {
+            continue;
+        }
+        boost::system::error_code fileEc;
+        int64_t size = fs::file_size(it->path(), fileEc);
+        std::time_t time = fs::last_write_time(it->path(), fileEc);
+        if (!fileEc)
+        {
+            files.push_back(std::make_pair(time, std::make_pair(it->path(), size)));
+            totalSize += size;
+        }
+    }
+    if (totalSize <= maxSize)
+    {
+        return;
+    }
+
+    std::sort(files.begin(), files.end());
+    for (size_t i = 0; i < files.size() && totalSize > maxSize; i++)
+    {
+        if (fDebug)
+            LogPrint("v8filter", "v8filter: Code cache pruned: %s\n", files[i].second.first.filename().string());
+        fs::remove(files[i].second.first, ec);
+        totalSize -= files[i].second.second;
+    }
+}
+
 int V8Engine::CreateFilter(std::string script, std::string main_name, std::vector<std::string> &callback_names,
                            V8Filter *filter, std::string &strResult)
 {
@@ -101,4 +286,10 @@ void V8Engine::InitializeV8()
 std::unique_ptr<v8::Platform> V8Engine::m_platform;
 v8::Isolate::CreateParams V8Engine::m_createParams;
 bool V8Engine::m_isV8Initialized = false;
+boost::mutex V8Engine::m_codeCacheMutex;
+std::map<uint256, std::pair<std::string, std::list<uint256>::iterator>> V8Engine::m_codeCache;
+std::list<uint256> V8Engine::m_codeCacheLRU;
+size_t V8Engine::m_codeCacheSize = 0;
+bool V8Engine::m_isCodeCacheInitialized = false;
+bool V8Engine::m_persistCodeCache = false;
 } // namespace mc_v8
@@ -7,8 +7,17 @@
 #include "filters/ifiltercallback.h"
 #include "rpc/rpcserver.h"
 //#include "json/json_spirit.h"
+#include <boost/filesystem/path.hpp>
+#include <boost/thread/mutex.hpp>
+#include <list>
+#include <map>
 #include <v8.h>
 
+// Default maximal size of the filtercache directory, in MB
+#define MC_V8_DEFAULT_CODE_CACHE_SIZE 64
+// Maximal total size of code cache kept in memory, in bytes
+#define MC_V8_MAX_MEMORY_CODE_CACHE_SIZE (16 * 1024 * 1024)
+
 namespace mc_v8
 {
 class V8Filter;
@@ -75,6 +84,33 @@ class V8Engine
         return m_reason;
     }
 
+    /**
+     * Find the V8 code cache for a script.
+     *
+     * The code cache is shared by all V8Engine instances.
+     * Looks in memory first, then in the filtercache directory if persistent code cache is enabled.
+     *
+     * @param hash The hash of the script source.
+     * @param data The serialized code cache.
+     * @return     true if found, false otherwise.
+     */
+    bool GetCodeCache(const uint256 &hash, std::string &data);
+
+    /**
+     * Store the V8 code cache for a script, in memory and (if enabled) in the filtercache directory.
+     *
+     * @param hash The hash of the script source.
+     * @param data The serialized code cache.
+     */
+    void SetCodeCache(const uint256 &hash, const std::string &data);
+
+    /**
+     * Discard the V8 code cache for a script, e.g. if it was rejected by V8.
+     *
+     * @param hash The hash of the script source.
+     */
+    void RemoveCodeCache(const uint256 &hash);
+
   private:
     IFilterCallback *m_filterCallback = nullptr;
     v8::Isolate *m_isolate = nullptr;
@@ -83,7 +119,28 @@ class V8Engine
     static bool m_isV8Initialized;
     std::string m_reason;
 
+    static boost::mutex m_codeCacheMutex;
+    static std::map<uint256, std::pair<std::string, std::list<uint256>::iterator>> m_codeCache;
+    static std::list<uint256> m_codeCacheLRU;
+    static size_t m_codeCacheSize;
+    static bool m_isCodeCacheInitialized;
+    static bool m_persistCodeCache;
+
     static void InitializeV8();
+    static void InitializeCodeCache();
+    static boost::filesystem::path CodeCacheFileName(const uint256 &hash);
+
+    /**
+     * Add code cache to memory, evicting least recently used entries above MC_V8_MAX_MEMORY_CODE_CACHE_SIZE.
+     * Called with m_codeCacheMutex locked.
+     */
+    static void StoreCodeCache(const uint256 &hash, const std::string &data);
+
+    /**
+     * Remove least recently used files from the filtercache directory until it fits -filtercodecachesize.
+     * Called with m_codeCacheMutex locked.
+     */
+    static void PruneCodeCache();
 };
 
 } // namespace mc_v8
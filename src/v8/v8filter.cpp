@@ -3,6 +3,7 @@
 
 #include "v8/v8filter.h"
 #include "chainparams/state.h"
+#include "structs/hash.h"
 //#include "utils/define.h"
 #include "utils/tinyformat.h"
 #include "utils/util.h"
@@ -300,14 +301,38 @@ int V8Filter::CompileAndLoadScript(std::string script, std::string functionName,
     v8::ScriptOrigin scriptOrigin(String2V8(isolate, source));
     v8::Local<v8::String> v8script = String2V8(isolate, script);
 
+    // Filters and libraries are compiled again on every Reset, reuse V8 code cache keyed by the source hash
+    uint256 hash = Hash(script.data(), script.data() + script.size());
+    std::string cacheData;
+    v8::ScriptCompiler::CachedData *cachedData = nullptr;
+    if (m_engine->GetCodeCache(hash, cacheData))
+    {
+        cachedData = new v8::ScriptCompiler::CachedData(reinterpret_cast<const uint8_t *>(cacheData.data()),
+                                                         static_cast<int>(cacheData.size()));
+    }
+    v8::ScriptCompiler::Source scriptSource(v8script, scriptOrigin, cachedData);
+
     v8::Local<v8::Script> compiledScript;
-    if (!v8::Script::Compile(context, v8script, &scriptOrigin).ToLocal(&compiledScript))
+    if (!v8::ScriptCompiler::Compile(context, &scriptSource,
+                                     (cachedData != nullptr) ? v8::ScriptCompiler::kConsumeCodeCache
+                                                             : v8::ScriptCompiler::kNoCompileOptions)
+             .ToLocal(&compiledScript))
     {
         assert(tryCatch.HasCaught());
         this->ReportException(&tryCatch, strResult);
         return MC_ERR_NOERROR;
     }
 
+    bool createCodeCache = true;
+    if (cachedData != nullptr)
+    {
+        createCodeCache = scriptSource.GetCachedData()->rejected;
+        if (createCodeCache)
+        {
+            m_engine->RemoveCodeCache(hash);
+        }
+    }
+
     v8::Local<v8::Value> result;
     if (!compiledScript->Run(context).ToLocal(&result))
     {
@@ -316,6 +341,19 @@ int V8Filter::CompileAndLoadScript(std::string script, std::string functionName,
         return MC_ERR_NOERROR;
     }
 
+    if (createCodeCache)
+    {
+        // Created after the first run, so that the functions compiled lazily while running are included
+        v8::ScriptCompiler::CachedData *newCodeCache =
+            v8::ScriptCompiler::CreateCodeCache(compiledScript->GetUnboundScript());
+        if (newCodeCache != nullptr)
+        {
+            m_engine->SetCodeCache(
+                hash, std::string(reinterpret_cast<const char *>(newCodeCache->data), newCodeCache->length));
+            delete newCodeCache;
+        }
+    }
+
     if (!functionName.empty())
     {
         v8::Local<v8::String> processName = String2V8(isolate, functionName);
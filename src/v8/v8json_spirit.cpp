@@ -6,61 +6,75 @@
 
 namespace mc_v8
 {
-v8::Local<v8::Value> Jsp2V8(v8::Isolate *isolate, const json_spirit::Value &j)
+/**
+ * Build the V8 value for a json_spirit value.
+ *
+ * Works inside the caller's handle and context scopes, and walks the json_spirit tree by reference, so that
+ * large callback results (e.g. transactions) are not copied at every nesting level.
+ * Returns an empty handle if V8 refuses a property, e.g. when the isolate is being terminated by the watchdog.
+ */
+static v8::Local<v8::Value> Jsp2V8Value(v8::Isolate *isolate, v8::Local<v8::Context> context,
+                                        const json_spirit::Value &j)
 {
-    v8::Isolate::Scope isolateScope(isolate);
-    v8::EscapableHandleScope handleScope(isolate);
-    v8::Local<v8::Context> context = isolate->GetCurrentContext();
-    v8::Context::Scope contextScope(context);
-
-    v8::Local<v8::Value> result = v8::Null(isolate);
     switch (j.type())
     {
     case json_spirit::obj_type:
     {
+        const json_spirit::Object &jspObj = j.get_obj();
         auto v8obj = v8::Object::New(isolate);
-        for (json_spirit::Pair property : j.get_obj())
+        for (const json_spirit::Pair &property : jspObj)
         {
-            v8obj->Set(String2V8(isolate, property.name_), Jsp2V8(isolate, property.value_));
+            v8::Local<v8::Value> value = Jsp2V8Value(isolate, context, property.value_);
+            if (value.IsEmpty() || v8obj->Set(context, Name2V8(isolate, property.name_), value).IsNothing())
+            {
+                return v8::Local<v8::Value>();
+            }
         }
-        result = v8obj;
-        break;
+        return v8obj;
     }
 
     case json_spirit::array_type:
     {
-        auto jspArray = j.get_array();
+        const json_spirit::Array &jspArray = j.get_array();
         auto v8array = v8::Array::New(isolate, static_cast<int>(jspArray.size()));
         for (unsigned i = 0; i < jspArray.size(); ++i)
         {
-            v8array->Set(i, Jsp2V8(isolate, jspArray[i]));
+            v8::Local<v8::Value> value = Jsp2V8Value(isolate, context, jspArray[i]);
+            if (value.IsEmpty() || v8array->Set(context, i, value).IsNothing())
+            {
+                return v8::Local<v8::Value>();
+            }
         }
-        result = v8array;
-        break;
+        return v8array;
     }
 
     case json_spirit::str_type:
-        result = String2V8(isolate, j.get_str());
-        break;
+        return String2V8(isolate, j.get_str());
 
     case json_spirit::bool_type:
-        result = v8::Boolean::New(isolate, j.get_bool());
-        break;
+        return v8::Boolean::New(isolate, j.get_bool());
 
     case json_spirit::int_type:
-        result = v8::Integer::New(isolate, j.get_int());
-        break;
+        return v8::Integer::New(isolate, j.get_int());
 
     case json_spirit::real_type:
-        result = v8::Number::New(isolate, j.get_real());
-        break;
+        return v8::Number::New(isolate, j.get_real());
 
     case json_spirit::null_type:
-        result = v8::Null(isolate);
         break;
     };
 
-    return handleScope.Escape(result);
+    return v8::Null(isolate);
+}
+
+v8::Local<v8::Value> Jsp2V8(v8::Isolate *isolate, const json_spirit::Value &j)
+{
+    v8::Isolate::Scope isolateScope(isolate);
+    v8::EscapableHandleScope handleScope(isolate);
+    v8::Local<v8::Context> context = isolate->GetCurrentContext();
+    v8::Context::Scope contextScope(context);
+
+    return handleScope.Escape(Jsp2V8Value(isolate, context, j));
 }
 
 json_spirit::Value V82Jsp(v8::Isolate *isolate, v8::Local<v8::Value> v)
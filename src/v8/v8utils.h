@@ -34,11 +34,26 @@ inline std::string V82String(v8::Isolate *isolate, v8::Local<v8::Value> value)
  * @param str     The std::string to convert.
  * @return        The equivalent V8 Value.
  */
-inline v8::Local<v8::String> String2V8(v8::Isolate *isolate, std::string str)
+inline v8::Local<v8::String> String2V8(v8::Isolate *isolate, const std::string &str)
 {
     return v8::String::NewFromUtf8(isolate, str.c_str(), v8::NewStringType::kNormal).ToLocalChecked();
 }
 
+/**
+ * Convert an std::string used as a property name to an internalized V8 String.
+ *
+ * Internalized strings are shared by all objects using the same property name, which is much cheaper
+ * when the same names are set on many objects.
+ *
+ * @param isolate The v8::Isolate environment to use.
+ * @param str     The property name to convert.
+ * @return        The equivalent V8 String.
+ */
+inline v8::Local<v8::String> Name2V8(v8::Isolate *isolate, const std::string &str)
+{
+    return v8::String::NewFromUtf8(isolate, str.c_str(), v8::NewStringType::kInternalized).ToLocalChecked();
+}
+
 /**
  * Get a directory for multichain temporary files.
  */
@@ -33,6 +33,16 @@ void mc_ChunkCollectorStat::Zero()
 {
     memset(this,0, sizeof(mc_ChunkCollectorStat));    
 }    
+
+void mc_ChunkCollectorPeerStat::Zero()
+{
+    memset(this,0, sizeof(mc_ChunkCollectorPeerStat));    
+}
+
+void mc_ChunkCollectorPendingRequest::Zero()
+{
+    memset(this,0, sizeof(mc_ChunkCollectorPendingRequest));    
+}
     
 void mc_ChunkCollector::Zero()
 {
@@ -94,6 +104,10 @@ void mc_ChunkCollector::Zero()
     m_StatTotal[0].Zero();
     m_StatTotal[1].Zero();
     
+    m_PeerStats.clear();
+    m_PendingRequests.clear();
+    m_LastCollectTimestamp=0;
+    
     m_Semaphore=NULL;
     m_LockedBy=0;     
     
@@ -210,6 +224,167 @@ void mc_ChunkCollector::AdjustKBPerDestination(CNode *pfrom,bool success)
     }
 }
 
+void mc_ChunkCollector::RequestSent(mc_OffchainMessageID request_id,int64_t destination_id,int64_t bytes,int chunks)
+{
+    mc_ChunkCollectorPendingRequest pending;
+    
+    pending.Zero();
+    pending.m_DestinationID=destination_id;
+    pending.m_SentTime=GetTimeMillis();
+    pending.m_Bytes=bytes;
+    pending.m_Chunks=chunks;
+    m_PendingRequests[request_id]=pending;
+    
+    map<int64_t,mc_ChunkCollectorPeerStat>::iterator itpeer = m_PeerStats.find(destination_id);
+    if(itpeer == m_PeerStats.end())
+    {
+        mc_ChunkCollectorPeerStat peer_stat;
+        peer_stat.Zero();
+        itpeer=m_PeerStats.insert(make_pair(destination_id,peer_stat)).first;
+    }
+    itpeer->second.m_Requests+=1;
+    itpeer->second.m_RequestedChunks+=chunks;
+    itpeer->second.m_RequestedBytes+=bytes;
+}
+
+void mc_ChunkCollector::ResponseReceived(mc_OffchainMessageID request_id,uint32_t msg_type)
+{
+    int64_t time_now;
+    
+    if( (msg_type != MC_RMT_CHUNK_RESPONSE) && (msg_type != MC_RMT_CHUNK_QUERY_HIT) )
+    {
+        return;
+    }
+    
+    time_now=GetTimeMillis();
+    
+    Lock();
+    if(msg_type == MC_RMT_CHUNK_RESPONSE)
+    {
+        map<mc_OffchainMessageID,mc_ChunkCollectorPendingRequest>::iterator itreq = m_PendingRequests.find(request_id);
+        if(itreq != m_PendingRequests.end())
+        {
+            if(itreq->second.m_ResponseTime == 0)
+            {
+                itreq->second.m_ResponseTime=time_now;
+            }
+        }
+    }
+    if(m_NextTryTimestamp > m_LastCollectTimestamp+MC_CCW_MIN_DELAY_BETWEEN_COLLECTS)    // Response is processed without waiting for the full round delay
+    {
+        m_NextTryTimestamp=m_LastCollectTimestamp+MC_CCW_MIN_DELAY_BETWEEN_COLLECTS;
+    }
+    UnLock();
+}
+
+void mc_ChunkCollector::RequestCompleted(mc_OffchainMessageID request_id,int64_t delivered_bytes,int delivered_chunks,bool success)
+{
+    int64_t time_now,rtt,bytes_per_second;
+    
+    map<mc_OffchainMessageID,mc_ChunkCollectorPendingRequest>::iterator itreq = m_PendingRequests.find(request_id);
+    if(itreq == m_PendingRequests.end())
+    {
+        return;
+    }
+    
+    map<int64_t,mc_ChunkCollectorPeerStat>::iterator itpeer = m_PeerStats.find(itreq->second.m_DestinationID);
+    if(itpeer != m_PeerStats.end())
+    {
+        mc_ChunkCollectorPeerStat *peer_stat=&(itpeer->second);
+        if(itreq->second.m_ResponseTime == 0)
+        {
+            peer_stat->m_Timeouts+=1;
+            peer_stat->m_BytesPerSecond/=2;                                     // Window shrinks until next measurement
+        }
+        else
+        {
+            time_now=itreq->second.m_ResponseTime;
+            if(success)
+            {
+                peer_stat->m_Responses+=1;
+                peer_stat->m_DeliveredChunks+=delivered_chunks;
+                peer_stat->m_DeliveredBytes+=delivered_bytes;
+                
+                rtt=time_now-itreq->second.m_SentTime;
+                if(rtt < 1)
+                {
+                    rtt=1;
+                }
+                bytes_per_second=(itreq->second.m_Bytes*1000)/rtt;
+                if(peer_stat->m_RTT == 0)
+                {
+                    peer_stat->m_RTT=rtt;
+                    peer_stat->m_BytesPerSecond=bytes_per_second;
+                }
+                else
+                {
+                    peer_stat->m_RTT=(7*peer_stat->m_RTT+rtt)/8;
+                    peer_stat->m_BytesPerSecond=(3*peer_stat->m_BytesPerSecond+bytes_per_second)/4;                    
+                }
+            }
+            else
+            {
+                peer_stat->m_BadResponses+=1;
+            }
+            peer_stat->m_LastResponseTime=time_now;
+        }
+    }
+    
+    m_PendingRequests.erase(itreq);
+}
+
+int64_t mc_ChunkCollector::DestinationWindow(int64_t destination_id,int64_t default_window)
+{
+    int64_t window;
+    
+    map<int64_t,mc_ChunkCollectorPeerStat>::iterator itpeer = m_PeerStats.find(destination_id);
+    if(itpeer == m_PeerStats.end())
+    {
+        return default_window;
+    }
+    
+    if( (itpeer->second.m_RTT == 0) || (itpeer->second.m_BytesPerSecond == 0) )
+    {
+        return default_window;
+    }
+    
+    window=(itpeer->second.m_BytesPerSecond*itpeer->second.m_RTT*MC_CCW_RTT_WINDOW_FACTOR)/1000;
+    if(window > (int64_t)m_MaxMaxKBPerDestination*1024)
+    {
+        window=(int64_t)m_MaxMaxKBPerDestination*1024;
+    }
+    if(window < MAX_CHUNK_SIZE + (int64_t)sizeof(mc_ChunkEntityKey))
+    {
+        window=MAX_CHUNK_SIZE + (int64_t)sizeof(mc_ChunkEntityKey);
+    }
+    
+    return window;
+}
+
+void mc_ChunkCollector::ExpirePendingRequests()
+{
+    int64_t time_limit;
+    
+    time_limit=GetTimeMillis()-2000*(int64_t)m_TimeoutRequest;                  // Requests deleted without processing
+    
+    map<mc_OffchainMessageID,mc_ChunkCollectorPendingRequest>::iterator itreq = m_PendingRequests.begin();
+    while(itreq != m_PendingRequests.end())
+    {
+        if(itreq->second.m_SentTime < time_limit)
+        {
+            map<int64_t,mc_ChunkCollectorPeerStat>::iterator itpeer = m_PeerStats.find(itreq->second.m_DestinationID);
+            if(itpeer != m_PeerStats.end())
+            {
+                itpeer->second.m_Timeouts+=1;
+            }
+            m_PendingRequests.erase(itreq++);
+        }
+        else
+        {
+            itreq++;
+        }
+    }
+}
 
 void mc_ChunkCollector::UnLock()
 {    
@@ -1146,6 +1321,8 @@ bool MultichainProcessChunkResponse(const CRelayResponsePair *response_pair,map
     bool result=false;
     string strError="";
     mc_ChunkCollectorRow *collect_row;
+    int64_t delivered_bytes=0;
+    int delivered_chunks=0;
         
     uint32_t total_size=0;
     ptrStart=&(request->m_Payload[0]);
@@ -1282,6 +1459,8 @@ bool MultichainProcessChunkResponse(const CRelayResponsePair *response_pair,map
                 else
                 {
                     for(int k=0;k<2;k++)collector->m_StatTotal[k].m_Delivered+=k ? collect_row->m_ChunkDef.m_Size : 1;                
+                    delivered_bytes+=collect_row->m_ChunkDef.m_Size;
+                    delivered_chunks++;
                     unsigned char* ptrhash=chunk->m_Hash;
                     if(fDebug)LogPrint("chunks","Retrieved chunk %s\n",(*(uint256*)ptrhash).ToString().c_str());                
                 }
@@ -1298,6 +1477,8 @@ bool MultichainProcessChunkResponse(const CRelayResponsePair *response_pair,map
 exitlbl:
                 
     pRelayManager->UnLock();
+    
+    collector->RequestCompleted(response_pair->request_id,delivered_bytes,delivered_chunks,result);
                 
     if(strError.size())
     {
@@ -1306,7 +1487,7 @@ exitlbl:
     return result;
 }
 
-int MultichainResponseScore(mc_RelayResponse *response,mc_ChunkCollectorRow *collect_row,map<int64_t,int64_t>& destination_loads,uint32_t max_total_size)
+int MultichainResponseScore(mc_RelayResponse *response,mc_ChunkCollectorRow *collect_row,map<int64_t,int64_t>& destination_loads,mc_ChunkCollector* collector,uint32_t max_total_size)
 {
     unsigned char *ptr;
     unsigned char *ptrEnd;
@@ -1327,7 +1508,7 @@ int MultichainResponseScore(mc_RelayResponse *response,mc_ChunkCollectorRow *col
         total_size=itdld->second;
     }                                    
     
-    if(total_size + collect_row->m_ChunkDef.m_Size + sizeof(mc_ChunkEntityKey) > max_total_size)
+    if(total_size + collect_row->m_ChunkDef.m_Size + sizeof(mc_ChunkEntityKey) > collector->DestinationWindow(response->SourceID(),max_total_size))
     {
         return MC_CCW_WORST_RESPONSE_SCORE;                
     }
@@ -1378,6 +1559,20 @@ int MultichainResponseScore(mc_RelayResponse *response,mc_ChunkCollectorRow *col
     {
         return MC_CCW_WORST_RESPONSE_SCORE;        
     }
+    
+    map<int64_t,mc_ChunkCollectorPeerStat>::iterator itpeer = collector->m_PeerStats.find(response->SourceID());
+    if(itpeer != collector->m_PeerStats.end())
+    {
+        if(itpeer->second.m_BytesPerSecond > 0)                                 // Expected completion time in ms for measured peers
+        {
+            int64_t expected_time=itpeer->second.m_RTT+((total_size+collect_row->m_ChunkDef.m_Size)*1000)/itpeer->second.m_BytesPerSecond;
+            if(expected_time >= 1024*1024)
+            {
+                expected_time=1024*1024-1;
+            }
+            return (response->m_TryCount+response->m_HopCount)*1024*1024+(int)expected_time;
+        }
+    }
         
     return (response->m_TryCount+response->m_HopCount)*1024*1024+total_size/1024;
 }
@@ -1407,6 +1602,7 @@ int MultichainCollectChunks(mc_ChunkCollector* collector)
     vector<int> vRows;
     CRelayRequestPairs request_pairs;
     int best_score,best_response,this_score,not_processed;
+    int64_t total_window,request_bytes;
     map<uint160,int> mapReadPermissionCache;
     set<CPubKey> sAddressesToSign;
     
@@ -1414,6 +1610,9 @@ int MultichainCollectChunks(mc_ChunkCollector* collector)
     pRelayManager->InvalidateResponsesFromDisconnected();
     
     collector->Lock();
+    
+    collector->m_LastCollectTimestamp=GetTimeMillis();
+    collector->ExpirePendingRequests();
 
     for(row=0;row<collector->m_MemPool->GetCount();row++)
     {
@@ -1424,6 +1623,7 @@ int MultichainCollectChunks(mc_ChunkCollector* collector)
             {
                 if(!collect_row->m_State.m_Request.IsZero())
                 {
+                    collector->RequestCompleted(collect_row->m_State.m_Request,0,0,false);
                     pRelayManager->DeleteRequest(collect_row->m_State.m_Request);
                     collect_row->m_State.m_Request=0;                    
                     for(int k=0;k<2;k++)collector->m_StatTotal[k].m_Undelivered+=k ? collect_row->m_ChunkDef.m_Size : 1;                
@@ -1492,6 +1692,24 @@ int MultichainCollectChunks(mc_ChunkCollector* collector)
     
     max_total_in_queries=collector->m_MaxKBPerDestination*1024;
     max_total_in_queries*=collector->m_TimeoutRequest;
+    
+    total_window=0;                                                             // Queries are not limited by single destination if several peers deliver
+    BOOST_FOREACH(PAIRTYPE(const int64_t, mc_ChunkCollectorPeerStat)& item, collector->m_PeerStats)    
+    {
+        if(item.second.m_LastResponseTime+1000*(int64_t)collector->m_TimeoutQuery >= collector->m_LastCollectTimestamp)
+        {
+            total_window+=collector->DestinationWindow(item.first,max_total_destination_size);
+        }
+    }
+    total_window*=collector->m_TimeoutRequest;
+    if(total_window > 0x7FFFFFFF)
+    {
+        total_window=0x7FFFFFFF;
+    }
+    if(total_window > max_total_in_queries)
+    {
+        max_total_in_queries=total_window;
+    }
     total_in_queries=0;
     query_count=0;
     
@@ -1563,7 +1781,7 @@ int MultichainCollectChunks(mc_ChunkCollector* collector)
                     best_score=MC_CCW_WORST_RESPONSE_SCORE;
                     for(int i=0;i<(int)query->m_Responses.size();i++)
                     {
-                        this_score=MultichainResponseScore(&(query->m_Responses[i]),collect_row,destination_loads,max_total_destination_size);
+                        this_score=MultichainResponseScore(&(query->m_Responses[i]),collect_row,destination_loads,collector,max_total_destination_size);
                         if(this_score < best_score)
                         {
                             best_score=this_score;
@@ -1670,6 +1888,7 @@ int MultichainCollectChunks(mc_ChunkCollector* collector)
             memcpy(ptrOut,buf,shift);
             ptrOut+=shift;
             count=0;
+            request_bytes=0;
             BOOST_FOREACH(PAIRTYPE(const int, int)& chunk_row, item.second.m_Pairs)    
             {                            
                 collect_subrow=(mc_ChunkCollectorRow *)collector->m_MemPool->GetRow(chunk_row.first);
@@ -1677,6 +1896,7 @@ int MultichainCollectChunks(mc_ChunkCollector* collector)
                 collect_subrow->m_State.m_RequestPos=count;
                 memcpy(ptrOut,&(collect_subrow->m_ChunkDef),sizeof(mc_ChunkEntityKey));
                 ptrOut+=sizeof(mc_ChunkEntityKey);
+                request_bytes+=collect_subrow->m_ChunkDef.m_Size+sizeof(mc_ChunkEntityKey);
                 count++;
             }
     //        mc_DumpSize("req",&(payload[0]),1+shift+sizeof(mc_ChunkEntityKey)*item.second.m_Pairs.size(),64);
@@ -1684,6 +1904,7 @@ int MultichainCollectChunks(mc_ChunkCollector* collector)
             if(!request_id.IsZero())
             {
                 if(fDebug)LogPrint("chunks","New chunk request: %s, response: %s, chunks: %d\n",request_id.ToString().c_str(),response->m_MsgID.ToString().c_str(),item.second.m_Pairs.size());
+                collector->RequestSent(request_id,response->SourceID(),request_bytes,count);
                 BOOST_FOREACH(PAIRTYPE(const int, int)& chunk_row, item.second.m_Pairs)    
                 {                
                     collect_subrow=(mc_ChunkCollectorRow *)collector->m_MemPool->GetRow(chunk_row.first);
@@ -2166,11 +2387,11 @@ bool mc_RelayProcess_Chunk_Request(unsigned char *ptrStart,unsigned char *ptrEnd
     unsigned char *ptr;
     int shift,count,size;
     mc_ChunkEntityKey chunk;
-    mc_ChunkDBRow chunk_def;
+    vector<mc_ChunkDBRow> chunk_defs;
     const unsigned char *chunk_found;
     unsigned char buf[16];
     size_t chunk_bytes;
-    unsigned char *ptrOut;
+    size_t payload_size;
     
     uint32_t total_size=0;
     uint32_t max_total_size=MAX_SIZE-OFFCHAIN_MSG_PADDING;
@@ -2181,9 +2402,6 @@ bool mc_RelayProcess_Chunk_Request(unsigned char *ptrStart,unsigned char *ptrEnd
         *read_permissioned=false;
     }
     
-    mc_gState->m_TmpBuffers->m_RelayTmpBuffer->Clear();
-    mc_gState->m_TmpBuffers->m_RelayTmpBuffer->AddElement();
-            
     size=sizeof(mc_ChunkEntityKey);
     ptr=ptrStart;
     while(ptr<ptrEnd)
@@ -2215,11 +2433,11 @@ bool mc_RelayProcess_Chunk_Request(unsigned char *ptrStart,unsigned char *ptrEnd
                     strError="Bad chunk ids request";
                     return false;                    
                 }                
-                for(int c=0;c<count;c++)
+                if(read_permissioned)
                 {
-                    chunk=*(mc_ChunkEntityKey*)ptr;
-                    if(read_permissioned)
+                    for(int c=0;c<count;c++)
                     {
+                        chunk=*(mc_ChunkEntityKey*)ptr;
                         if(mc_IsReadPermissionedStream(&chunk,mapReadPermissionCache,NULL) != 0)
                         {
                             *read_permissioned=true;
@@ -2229,60 +2447,70 @@ bool mc_RelayProcess_Chunk_Request(unsigned char *ptrStart,unsigned char *ptrEnd
                                 return false;                    
                             }
                         }
+                        ptr+=size;
                     }
-                    else
+                }
+                else
+                {
+                    chunk_defs.resize(count);                                   // Chunk definitions are resolved before response buffer is allocated
+                    payload_size=1+mc_PutVarInt(buf,16,count);
+                    for(int c=0;c<count;c++)
                     {
+                        chunk=*(mc_ChunkEntityKey*)(ptr+c*size);
                         unsigned char* ptrhash=chunk.m_Hash;
                         if(fDebug)LogPrint("chunks","Request for chunk: %s\n",(*(uint256*)ptrhash).ToString().c_str());
-                        if(pwalletTxsMain->m_ChunkDB->GetChunkDef(&chunk_def,chunk.m_Hash,NULL,NULL,-1) == MC_ERR_NOERROR)
-                        {
-                            if(chunk_def.m_Size != chunk.m_Size)
-                            {
-                                strError="Bad chunk size";
-                                return false;                    
-                            }
-                            total_size+=chunk_def.m_Size+size;
-                            if(total_size > MAX_SIZE-OFFCHAIN_MSG_PADDING)
-                            {
-                                strError="Total size of requested chunks is too big for message";
-                                return false;                                                
-                            }
-                            if(total_size > max_total_size)
-                            {
-                                strError="Total size of requested chunks is too big for response expiration";
-                                return false;                                                
-                            }
-                            
-                            unsigned char salt[MC_CDB_CHUNK_SALT_SIZE];
-                            uint32_t salt_size;
-                            
-                            chunk_found=pwalletTxsMain->m_ChunkDB->GetChunk(&chunk_def,0,-1,&chunk_bytes,salt,&salt_size);
-                            mc_gState->m_TmpBuffers->m_RelayTmpBuffer->SetData((unsigned char*)&chunk,size);
-                            mc_gState->m_TmpBuffers->m_RelayTmpBuffer->SetData(salt,salt_size);
-                            mc_gState->m_TmpBuffers->m_RelayTmpBuffer->SetData(chunk_found,chunk_bytes);
-                        }                    
-                        else
+                        if(pwalletTxsMain->m_ChunkDB->GetChunkDef(&(chunk_defs[c]),chunk.m_Hash,NULL,NULL,-1) != MC_ERR_NOERROR)
                         {
                             strError="Chunk not found";
+                            payload_response->clear();
+                            return false;                    
+                        }
+                        if(chunk_defs[c].m_Size != chunk.m_Size)
+                        {
+                            strError="Bad chunk size";
+                            payload_response->clear();
                             return false;                    
                         }
+                        total_size+=chunk_defs[c].m_Size+size;
+                        if(total_size > MAX_SIZE-OFFCHAIN_MSG_PADDING)
+                        {
+                            strError="Total size of requested chunks is too big for message";
+                            payload_response->clear();
+                            return false;                                                
+                        }
+                        if(total_size > max_total_size)
+                        {
+                            strError="Total size of requested chunks is too big for response expiration";
+                            payload_response->clear();
+                            return false;                                                
+                        }
+                        payload_size+=size+MC_CDB_CHUNK_SALT_SIZE+chunk_defs[c].m_Size;
                     }
-                    ptr+=size;
-                }
-                
-                if(!read_permissioned)
-                {
-                    chunk_found=mc_gState->m_TmpBuffers->m_RelayTmpBuffer->GetData(0,&chunk_bytes);
+                    
+                    payload_response->clear();                                  // Response is written directly into payload, chunk data is copied once
+                    payload_response->reserve(payload_size);
+                    payload_response->push_back(MC_RDT_CHUNKS);
                     shift=mc_PutVarInt(buf,16,count);
-                    payload_response->resize(1+shift+chunk_bytes);
-                    ptrOut=&(*payload_response)[0];
+                    payload_response->insert(payload_response->end(),buf,buf+shift);
+                    
+                    for(int c=0;c<count;c++)
+                    {
+                        unsigned char salt[MC_CDB_CHUNK_SALT_SIZE];
+                        uint32_t salt_size;
 
-                    *ptrOut=MC_RDT_CHUNKS;
-                    ptrOut++;
-                    memcpy(ptrOut,buf,shift);
-                    ptrOut+=shift;
-                    memcpy(ptrOut,chunk_found,chunk_bytes);
-                    ptrOut+=chunk_bytes;
+                        chunk=*(mc_ChunkEntityKey*)ptr;
+                        chunk_found=pwalletTxsMain->m_ChunkDB->GetChunk(&(chunk_defs[c]),0,-1,&chunk_bytes,salt,&salt_size);
+                        if(chunk_found == NULL)
+                        {
+                            strError="Chunk not found";
+                            payload_response->clear();
+                            return false;                    
+                        }
+                        payload_response->insert(payload_response->end(),(unsigned char*)&chunk,(unsigned char*)&chunk+size);
+                        payload_response->insert(payload_response->end(),salt,salt+salt_size);
+                        payload_response->insert(payload_response->end(),chunk_found,chunk_found+chunk_bytes);
+                        ptr+=size;
+                    }
                 }
                 
                 break;
@@ -2302,6 +2530,10 @@ bool mc_RelayProcess_Chunk_Request(unsigned char *ptrStart,unsigned char *ptrEnd
     if(total_size > max_total_size)
     {
         strError="Total size of requested chunks is too big for response expiration";
+        if(read_permissioned == NULL)
+        {
+            payload_response->clear();
+        }
         return false;                                                
     }
     
@@ -32,6 +32,8 @@
 #define MC_CCW_MAX_KBS_PER_SECOND               8196
 #define MC_CCW_MIN_KBS_PER_SECOND                128
 #define MC_CCW_MAX_DELAY_BETWEEN_COLLECTS       1000
+#define MC_CCW_MIN_DELAY_BETWEEN_COLLECTS         50                            // Delay after chunk response or query hit, ms
+#define MC_CCW_RTT_WINDOW_FACTOR                   2                            // Peer window covers this number of measured round trips
 #define MC_CCW_QUERY_SPLIT                         4
 #define MC_CCW_MAX_ITEMS_PER_CHUNKFOR_CHECK       16
 #define MC_CCW_MAX_EF_SIZE                     65536
@@ -115,6 +117,34 @@ typedef struct mc_ChunkCollectorStat
     void Zero();
 } mc_ChunkCollectorStat;
 
+typedef struct mc_ChunkCollectorPeerStat
+{
+    int64_t m_Requests;                                                         // Chunk requests sent to destination
+    int64_t m_Responses;                                                        // Requests processed with valid response
+    int64_t m_BadResponses;                                                     // Requests processed with invalid response
+    int64_t m_Timeouts;                                                         // Requests expired before response
+    int64_t m_RequestedChunks;
+    int64_t m_RequestedBytes;
+    int64_t m_DeliveredChunks;
+    int64_t m_DeliveredBytes;
+    int64_t m_RTT;                                                              // Smoothed request round trip time, ms, 0 - not measured
+    int64_t m_BytesPerSecond;                                                   // Smoothed throughput, 0 - not measured
+    int64_t m_LastResponseTime;                                                 // ms
+    
+    void Zero();
+} mc_ChunkCollectorPeerStat;
+
+typedef struct mc_ChunkCollectorPendingRequest
+{
+    int64_t m_DestinationID;
+    int64_t m_SentTime;                                                         // ms
+    int64_t m_ResponseTime;                                                     // Arrival of the response, ms, 0 - not arrived yet
+    int64_t m_Bytes;                                                            // Requested size, including chunk keys
+    int m_Chunks;
+    
+    void Zero();
+} mc_ChunkCollectorPendingRequest;
+
 typedef struct mc_ChunkCollector
 {    
     mc_Database *m_DB;                                                          // Database object
@@ -146,6 +176,10 @@ typedef struct mc_ChunkCollector
     mc_ChunkCollectorStat m_StatLast[2];
     mc_ChunkCollectorStat m_StatTotal[2];
     
+    map<int64_t,mc_ChunkCollectorPeerStat> m_PeerStats;                         // Per-destination request statistics
+    map<mc_OffchainMessageID,mc_ChunkCollectorPendingRequest> m_PendingRequests;// Chunk requests in flight
+    int64_t m_LastCollectTimestamp;
+    
     char m_Name[MC_PRM_NETWORK_NAME_MAX_SIZE+1];                                // Chain name
     char m_DBName[MC_DCT_DB_MAX_PATH];                                          // Full database name
     
@@ -210,6 +244,12 @@ typedef struct mc_ChunkCollector
     int FillMarkPoolByHash(const unsigned char *hash);    
     int FillMarkPoolByFlag(uint32_t flag, uint32_t not_flag);    
     void AdjustKBPerDestination(CNode* pfrom,bool success);
+    
+    void RequestSent(mc_OffchainMessageID request_id,int64_t destination_id,int64_t bytes,int chunks);
+    void ResponseReceived(mc_OffchainMessageID request_id,uint32_t msg_type);   // Called by relay manager, not under its lock
+    void RequestCompleted(mc_OffchainMessageID request_id,int64_t delivered_bytes,int delivered_chunks,bool success);
+    int64_t DestinationWindow(int64_t destination_id,int64_t default_window);   // Bytes allowed in flight to destination
+    void ExpirePendingRequests();
         
     int Commit();                                                      
     int CommitInternal(int fill_mempool); 
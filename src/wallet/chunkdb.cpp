@@ -34,6 +34,11 @@ void mc_ChunkDBRow::Zero()
     memset(this,0,sizeof(mc_ChunkDBRow));        
 }
 
+void mc_ChunkFileMap::Zero()
+{
+    memset(this,0,sizeof(mc_ChunkFileMap));        
+}
+
 void mc_ChunkDBRow::SwapPosBytes()
 {
     unsigned char *ptr=(unsigned char *)&m_Pos;
@@ -80,6 +85,15 @@ void mc_ChunkDB::Zero()
     
     m_FeedPos=0;
     
+    m_FileMaps=NULL;
+    m_ThreadFileMapPins=NULL;
+    m_MaxFileMaps=0;
+    m_FileMapUseCounter=0;
+    
+    m_SharedStorage=0;
+    m_SharedFileCounts=NULL;
+    m_SharedFilesToDelete=NULL;
+    
     m_Semaphore=NULL;
     m_LockedBy=0;    
 }
@@ -123,6 +137,30 @@ int mc_ChunkDB::Destroy()
         delete m_ThreadTmpScripts;
     }
     
+    if(m_FileMaps)
+    {
+        while(m_FileMaps->GetCount())
+        {
+            DeleteFileMap(*(mc_ChunkFileMap**)m_FileMaps->GetRow(0));
+        }
+        delete m_FileMaps;
+    }
+    
+    if(m_ThreadFileMapPins)
+    {
+        delete m_ThreadFileMapPins;
+    }
+    
+    if(m_SharedFileCounts)
+    {
+        delete m_SharedFileCounts;
+    }
+    
+    if(m_SharedFilesToDelete)
+    {
+        delete m_SharedFilesToDelete;
+    }
+    
     if(m_Semaphore)
     {
         __US_SemDestroy(m_Semaphore);
@@ -194,7 +232,7 @@ int mc_ChunkDB::AddSubscription(mc_SubscriptionDBRow *subscription)
     }
     else
     {
-        subscription->m_DirName[0]=0x00;
+        mc_GetFullFileName(m_Name,"chunks/data/shared","",MC_FOM_RELATIVE_TO_DATADIR,subscription->m_DirName);
     }
 
     if(subscription->m_SubscriptionID >= m_Subscriptions->GetCount())
@@ -593,6 +631,7 @@ int mc_ChunkDB::RemoveEntityInternal(mc_TxEntity *entity,uint32_t *removed_chunk
     }
 
     CommitInternal(-4,0);
+    m_SharedFileCounts->Clear();
     
     memcpy(&subscription,old_subscription,sizeof(mc_SubscriptionDBRow));
     subscription.m_Entity.m_EntityType |= MC_TET_DELETED;
@@ -615,6 +654,8 @@ int mc_ChunkDB::RemoveEntityInternal(mc_TxEntity *entity,uint32_t *removed_chunk
     
     m_Subscriptions->PutRow(old_subscription->m_SubscriptionID,&subscription,(char*)&subscription+m_ValueOffset);
     
+    CloseFileMaps(old_subscription->m_SubscriptionID);
+    
     sprintf(msg,"Entity (%08X, %s) unlinked successfully",entity->m_EntityType,enthex);
     LogString(msg);
  
@@ -702,6 +743,10 @@ int mc_ChunkDB::RemoveEntityInternal(mc_TxEntity *entity,uint32_t *removed_chunk
                                 {
                                     case MC_ENT_SPRM_CHUNK_HASH:
                                         if(chunk_found)
+                                        {
+                                            err=ReleaseSharedChunk(&chunk_def);
+                                        }
+                                        if(chunk_found && (err == MC_ERR_NOERROR))
                                         {
                                             chunk_def.SwapPosBytes();
                                             err=m_DB->Delete((char*)&chunk_def+m_KeyOffset,m_KeySize,MC_OPT_DB_DATABASE_TRANSACTIONAL);                                            
@@ -789,6 +834,13 @@ int mc_ChunkDB::RemoveEntityInternal(mc_TxEntity *entity,uint32_t *removed_chunk
         }
     }
     
+    if(err == MC_ERR_NOERROR)
+    {
+        if(chunk_found)
+        {
+            err=ReleaseSharedChunk(&chunk_def);
+        }
+    }
     if(err == MC_ERR_NOERROR)
     {
         if(chunk_found)
@@ -800,6 +852,14 @@ int mc_ChunkDB::RemoveEntityInternal(mc_TxEntity *entity,uint32_t *removed_chunk
         }
     }
     if(err == MC_ERR_NOERROR)
+    {
+        if(m_SharedFileCounts->GetCount())
+        {
+            err=UpdateSharedFiles();
+            count++;
+        }
+    }
+    if(err == MC_ERR_NOERROR)
     {
         if(count)
         {
@@ -818,6 +878,7 @@ int mc_ChunkDB::RemoveEntityInternal(mc_TxEntity *entity,uint32_t *removed_chunk
 
 exitlbl:
             
+    DeleteSharedFiles((err == MC_ERR_NOERROR) ? 1 : 0);
 
     if(err)
     {
@@ -1011,6 +1072,23 @@ int mc_ChunkDB::Initialize(const char *name,uint32_t mode)
     m_ThreadTmpScripts=new mc_Buffer;
     m_ThreadTmpScripts->Initialize(sizeof(uint64_t),sizeof(uint64_t)+sizeof(mc_Script *),MC_BUF_MODE_MAP);    
     m_ThreadTmpScripts->Realloc(MC_PRM_MAX_THREADS);
+    
+    m_MaxFileMaps=mc_gState->m_Params->GetOption("-chunkfilemaps",MC_CDB_DEFAULT_FILE_MAPS);
+    if(m_MaxFileMaps < 0)
+    {
+        m_MaxFileMaps=0;
+    }
+    m_FileMaps=new mc_Buffer;
+    m_FileMaps->Initialize(sizeof(mc_ChunkFileMap *),sizeof(mc_ChunkFileMap *),MC_BUF_MODE_DEFAULT);    
+    m_ThreadFileMapPins=new mc_Buffer;
+    m_ThreadFileMapPins->Initialize(sizeof(uint64_t),sizeof(uint64_t)+sizeof(mc_ChunkFileMap *),MC_BUF_MODE_MAP);    
+    m_ThreadFileMapPins->Realloc(MC_PRM_MAX_THREADS);
+    
+    m_SharedStorage=(mc_gState->m_Params->GetOption("-chunkdedup",(int64_t)0) != 0) ? 1 : 0;
+    m_SharedFileCounts=new mc_Buffer;
+    m_SharedFileCounts->Initialize(sizeof(uint32_t),sizeof(uint32_t)+sizeof(int32_t),MC_BUF_MODE_MAP);    
+    m_SharedFilesToDelete=new mc_Buffer;
+    m_SharedFilesToDelete->Initialize(sizeof(uint32_t),sizeof(uint32_t),MC_BUF_MODE_DEFAULT);    
             
     m_Semaphore=__US_SemCreate();
     if(m_Semaphore == NULL)
@@ -1441,6 +1519,7 @@ int mc_ChunkDB::AddChunkInternal(
     int total_items,on_disk_items,pos;
     int mempool_entity_row;
     int mempool_last_null_row;
+    int shared_chunk,mempool_shared_row;
     uint32_t timestamp;
     size_t bytes;
     const unsigned char *ptr;
@@ -1452,6 +1531,7 @@ int mc_ChunkDB::AddChunkInternal(
     mc_ChunkDBRow chunk_def;
     mc_ChunkDBRow entity_chunk_def;
     mc_ChunkDBRow null_chunk_def;
+    mc_ChunkDBRow shared_chunk_def;
     mc_SubscriptionDBRow *subscription;
     
     chunk_def.Zero();
@@ -1496,6 +1576,9 @@ int mc_ChunkDB::AddChunkInternal(
     total_items=0;
     on_disk_items=0;
     mempool_entity_row=-1;
+    mempool_last_null_row=-1;
+    shared_chunk=0;
+    mempool_shared_row=-1;
     
     if(txid)
     {
@@ -1538,6 +1621,84 @@ int mc_ChunkDB::AddChunkInternal(
                 return err; 
             }
         }
+        
+        if(m_SharedStorage && (subscription->m_Entity.m_EntityType == MC_TET_STREAM))   // Source chunks keep their data for recovery
+        {
+            err=GetSharedChunkDef(&shared_chunk_def,hash,&mempool_shared_row);
+            if(err == MC_ERR_NOERROR)
+            {
+                shared_chunk=1;                                                 // Data is already in shared store, reference is added
+            }
+            else
+            {
+                if(err != MC_ERR_NOT_FOUND)
+                {
+                    return err; 
+                }
+                shared_chunk=2;                                                 // Data should be added to shared store
+            }
+        }
+    }
+    
+    if(shared_chunk == 2)
+    {
+        shared_chunk_def.Zero();
+        memcpy(shared_chunk_def.m_Hash,hash,MC_CDB_CHUNK_HASH_SIZE);
+        shared_chunk_def.m_InternalFileID=-1;
+        shared_chunk_def.m_InternalFileOffset=m_ChunkData->m_NumElements;
+        shared_chunk_def.m_StorageFlags=MC_CFL_STORAGE_SHARED;
+        shared_chunk_def.m_Size=chunk_size;
+        shared_chunk_def.m_Flags=flags;
+        shared_chunk_def.m_ItemCount=1;
+        shared_chunk_def.m_NextSubscriptionID=subscription->m_SubscriptionID;
+        
+        m_TmpScript->Clear();    
+        m_TmpScript->AddElement();
+        m_TmpScript->SetSpecialParamValue(MC_ENT_SPRM_CHUNK_HASH,hash,MC_CDB_CHUNK_HASH_SIZE);
+        if(salt_size)
+        {
+            m_TmpScript->SetSpecialParamValue(MC_ENT_SPRM_SALT,salt,salt_size);        
+        }
+        m_TmpScript->SetSpecialParamValue(MC_ENT_SPRM_CHUNK_SIZE,(unsigned char*)&chunk_size,sizeof(chunk_size));
+        shared_chunk_def.m_HeaderSize=m_TmpScript->m_Size;
+        if(chunk_size)
+        {
+            m_TmpScript->SetSpecialParamValue(MC_ENT_SPRM_CHUNK_DATA,chunk,chunk_size);                
+            shared_chunk_def.m_HeaderSize=m_TmpScript->m_Size-chunk_size;
+        }
+        
+        ptr=m_TmpScript->GetData(0,&bytes);
+
+        m_ChunkData->SetElement(m_ChunkData->m_NumElements-1);
+        m_ChunkData->AddElement();
+        err=m_ChunkData->SetData(ptr,bytes);
+        if(err)
+        {
+            return err;
+        }
+        
+        if(mempool_shared_row >= 0)                                             // Null row of this commit becomes shared store row 
+        {
+            memcpy((char*)m_MemPool->GetRow(mempool_shared_row)+m_ValueOffset,(char*)&shared_chunk_def+m_ValueOffset,m_ValueSize);
+        }
+        else
+        {
+            m_MemPool->Add(&shared_chunk_def,(char*)&shared_chunk_def+m_ValueOffset);        
+        }
+        add_null_row=0;
+    }
+    
+    if(shared_chunk == 1)
+    {
+        if(mempool_shared_row >= 0)
+        {
+            ((mc_ChunkDBRow *)m_MemPool->GetRow(mempool_shared_row))->m_ItemCount += 1;        
+        }
+        else
+        {
+            shared_chunk_def.m_ItemCount+=1;                                    // Row is rewritten on commit, data is not
+            m_MemPool->Add(&shared_chunk_def,(char*)&shared_chunk_def+m_ValueOffset);        
+        }
     }
         
     chunk_def.Zero();
@@ -1587,7 +1748,7 @@ int mc_ChunkDB::AddChunkInternal(
     
     chunk_def.m_HeaderSize=m_TmpScript->m_Size;
     
-    if(total_items == 0)
+    if( (total_items == 0) && (shared_chunk == 0) )
     {
         if(chunk_size)
         {
@@ -1627,6 +1788,10 @@ int mc_ChunkDB::AddChunkInternal(
     chunk_def.m_ItemCount=total_items+1;
     chunk_def.m_TmpOnDiskItems=on_disk_items;
     chunk_def.m_NextSubscriptionID=0;
+    if(shared_chunk)
+    {
+        chunk_def.m_StorageFlags |= MC_CFL_STORAGE_SHARED;                      // Only header is stored in subscription files
+    }
     if(txid)
     {
         chunk_def.m_TxIDStart=(uint32_t)mc_GetLE((void*)txid,4);
@@ -1751,9 +1916,10 @@ unsigned char *mc_ChunkDB::GetChunkInternal(mc_ChunkDBRow *chunk_def,
     mc_SubscriptionDBRow *subscription;
     char FileName[MC_DCT_DB_MAX_PATH];    
     int FileHan;
-    uint32_t read_from;
+    uint32_t read_from,header_from;
     mc_ChunkDBRow chunk_def_zero;
     mc_Script *tmpscript;
+    mc_ChunkFileMap *file_map;
     
     
     ptr=NULL;
@@ -1773,10 +1939,22 @@ unsigned char *mc_ChunkDB::GetChunkInternal(mc_ChunkDBRow *chunk_def,
         return NULL;
     }
 
+    if( (offset >= 0) && (chunk_def->m_SubscriptionID != 0) && (chunk_def->m_StorageFlags & MC_CFL_STORAGE_SHARED) )
+    {
+        if(GetSharedChunkDef(&chunk_def_zero,chunk_def->m_Hash,NULL) == MC_ERR_NOERROR)
+        {
+            return GetChunkInternal(&chunk_def_zero,offset,len,bytes,salt,salt_size);
+        }
+        return NULL;
+    }
+    
     tmpscript=GetTmpScript();
     tmpscript->Clear();
     
+    PinFileMap(NULL);                                                           // Pointer returned by previous read in this thread is released
+    
     FileHan=0;
+    file_map=NULL;
     if(chunk_def->m_InternalFileID < 0)
     {
         ptr=(unsigned char *)m_ChunkData->GetData(chunk_def->m_InternalFileOffset,&bytes_to_read);
@@ -1809,47 +1987,22 @@ unsigned char *mc_ChunkDB::GetChunkInternal(mc_ChunkDBRow *chunk_def,
     else
     {
         subscription_id=chunk_def->m_SubscriptionID;
-        if(subscription_id == 0)
+        if( (subscription_id == 0) && ((chunk_def->m_StorageFlags & MC_CFL_STORAGE_SHARED) == 0) )
         {
             subscription_id=chunk_def->m_NextSubscriptionID;
         }
         subscription=(mc_SubscriptionDBRow *)m_Subscriptions->GetRow(subscription_id);
-        SetFileName(FileName,subscription,chunk_def->m_InternalFileID);
-     
-        FileHan=open(FileName,_O_BINARY | O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
-        if(FileHan<=0)
-        {
-            return NULL;
-        }
         
         if(chunk_def->m_HeaderSize >=0x80000000)                                // Fixing the overflow bug if data is not written
         {
             chunk_def->m_HeaderSize+=chunk_def->m_Size;
         }
     
+        header_from=chunk_def->m_InternalFileOffset;
         read_from=chunk_def->m_InternalFileOffset;
         bytes_to_read=chunk_def->m_HeaderSize;
         if(offset >= 0)
         {            
-            if(salt)
-            {
-                if(lseek64(FileHan,read_from,SEEK_SET) != (int)read_from)
-                {
-                    goto exitlbl;
-                }
-                tmpscript->Clear();
-                if(tmpscript->Resize(bytes_to_read,1))
-                {
-                    goto exitlbl;                                
-                }
-    
-                if(read(FileHan,tmpscript->m_lpData,bytes_to_read) != (int)bytes_to_read)
-                {
-                    goto exitlbl;
-                }
-                mc_GetChunkSalt(tmpscript->m_lpData,chunk_def->m_HeaderSize,salt,salt_size);                
-            }
-
             read_from+=chunk_def->m_HeaderSize+offset;
             bytes_to_read=chunk_def->m_Size;
             if(len>0)
@@ -1858,6 +2011,59 @@ unsigned char *mc_ChunkDB::GetChunkInternal(mc_ChunkDBRow *chunk_def,
             }
         }
         
+        if(m_MaxFileMaps)
+        {
+            file_map=GetFileMap(subscription,chunk_def->m_InternalFileID,(int64_t)read_from+bytes_to_read);
+        }
+        
+        if(file_map && file_map->m_MapPtr)                                      // Pointer into the mapping is returned, no copy
+        {
+            if( (offset >= 0) && salt )
+            {
+                mc_GetChunkSalt(file_map->m_MapPtr+header_from,chunk_def->m_HeaderSize,salt,salt_size);                                
+            }
+            PinFileMap(file_map);
+            if(bytes)
+            {
+                *bytes=bytes_to_read;
+            }
+            return file_map->m_MapPtr+read_from;
+        }
+        
+        if(file_map)
+        {
+            FileHan=file_map->m_FileHan;                                        // Cached handle, not closed on exit
+        }
+        else
+        {
+            SetFileName(FileName,subscription,chunk_def->m_InternalFileID);
+
+            FileHan=open(FileName,_O_BINARY | O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+            if(FileHan<=0)
+            {
+                return NULL;
+            }
+        }
+        
+        if( (offset >= 0) && salt )
+        {
+            if(lseek64(FileHan,header_from,SEEK_SET) != (int)header_from)
+            {
+                goto exitlbl;
+            }
+            tmpscript->Clear();
+            if(tmpscript->Resize(chunk_def->m_HeaderSize,1))
+            {
+                goto exitlbl;                                
+            }
+
+            if(read(FileHan,tmpscript->m_lpData,chunk_def->m_HeaderSize) != (int)chunk_def->m_HeaderSize)
+            {
+                goto exitlbl;
+            }
+            mc_GetChunkSalt(tmpscript->m_lpData,chunk_def->m_HeaderSize,salt,salt_size);                
+        }
+        
         if(lseek64(FileHan,read_from,SEEK_SET) != (int)read_from)
         {
             goto exitlbl;
@@ -1879,11 +2085,11 @@ unsigned char *mc_ChunkDB::GetChunkInternal(mc_ChunkDBRow *chunk_def,
         {
             *bytes=bytes_to_read;
         }
-}
+    }
 
 exitlbl:
         
-    if(FileHan)
+    if(FileHan && (file_map == NULL))
     {        
         close(FileHan);
     }
@@ -1908,6 +2114,219 @@ unsigned char *mc_ChunkDB::GetChunk(mc_ChunkDBRow *chunk_def,
 }
 
 
+void mc_ChunkDB::DeleteFileMap(mc_ChunkFileMap *file_map)
+{
+    int row,last_row;
+    
+    last_row=m_FileMaps->GetCount()-1;
+    for(row=0;row<=last_row;row++)
+    {
+        if(*(mc_ChunkFileMap**)m_FileMaps->GetRow(row) == file_map)
+        {
+            if(row < last_row)
+            {
+                m_FileMaps->PutRow(row,m_FileMaps->GetRow(last_row),NULL);
+            }
+            m_FileMaps->SetCount(last_row);
+            break;
+        }
+    }
+    
+    if(file_map->m_MapPtr)
+    {
+        __US_UnMapFile(file_map->m_MapPtr,file_map->m_MapSize);
+    }
+    if(file_map->m_FileHan > 0)
+    {
+        close(file_map->m_FileHan);
+    }
+    delete file_map;
+}
+
+void mc_ChunkDB::RetireFileMap(mc_ChunkFileMap *file_map)
+{
+    if(file_map->m_PinCount)
+    {
+        file_map->m_Retired=1;                                                  // Some thread still holds pointer into the mapping
+        return;
+    }
+    DeleteFileMap(file_map);
+}
+
+void mc_ChunkDB::PinFileMap(mc_ChunkFileMap *file_map)
+{
+    int mprow;
+    mc_ChunkFileMap *old_map;
+    uint64_t thread_id;
+    
+    if(m_ThreadFileMapPins == NULL)
+    {
+        return;
+    }
+    
+    thread_id=__US_ThreadID();
+    mprow=m_ThreadFileMapPins->Seek(&thread_id);    
+    if(mprow < 0)
+    {
+        if(file_map == NULL)
+        {
+            return;
+        }
+        mprow=m_ThreadFileMapPins->GetCount();
+        old_map=NULL;
+        m_ThreadFileMapPins->Add(&thread_id,&old_map);        
+    }
+    
+    old_map=*(mc_ChunkFileMap**)(m_ThreadFileMapPins->GetRow(mprow)+sizeof(uint64_t));
+    if(old_map == file_map)
+    {
+        return;
+    }
+    
+    *(mc_ChunkFileMap**)(m_ThreadFileMapPins->GetRow(mprow)+sizeof(uint64_t))=file_map;
+    if(file_map)
+    {
+        file_map->m_PinCount++;
+    }
+    if(old_map)
+    {
+        old_map->m_PinCount--;
+        if(old_map->m_Retired && (old_map->m_PinCount == 0))
+        {
+            DeleteFileMap(old_map);
+        }
+    }
+}
+
+void mc_ChunkDB::CloseFileMaps(int32_t subscription_id)
+{
+    int row;
+    mc_ChunkFileMap *file_map;
+    
+    if(m_FileMaps == NULL)
+    {
+        return;
+    }
+    
+    row=0;
+    while(row<m_FileMaps->GetCount())
+    {
+        file_map=*(mc_ChunkFileMap**)m_FileMaps->GetRow(row);
+        if( (file_map->m_Retired == 0) && 
+            ( (subscription_id < 0) || (file_map->m_SubscriptionID == subscription_id) ) )
+        {
+            if(file_map->m_PinCount)
+            {
+                RetireFileMap(file_map);
+                row++;
+            }
+            else
+            {
+                DeleteFileMap(file_map);                                        // Last row is moved to this one
+            }
+        }
+        else
+        {
+            row++;
+        }
+    }
+}
+
+mc_ChunkFileMap *mc_ChunkDB::GetFileMap(mc_SubscriptionDBRow *subscription,uint32_t fileid,int64_t end_offset)
+{
+    int row,active_count;
+    int64_t file_size,map_size;
+    char FileName[MC_DCT_DB_MAX_PATH];         
+    mc_ChunkFileMap *file_map;
+    mc_ChunkFileMap *lru_map;
+    
+    m_FileMapUseCounter++;
+    active_count=0;
+    lru_map=NULL;
+    for(row=0;row<m_FileMaps->GetCount();row++)
+    {
+        file_map=*(mc_ChunkFileMap**)m_FileMaps->GetRow(row);
+        if(file_map->m_Retired == 0)
+        {
+            if( (file_map->m_SubscriptionID == subscription->m_SubscriptionID) && (file_map->m_FileID == fileid) )
+            {
+                file_map->m_LastUsed=m_FileMapUseCounter;
+                if(end_offset <= file_map->m_FileSize)
+                {
+                    return file_map;
+                }
+                
+                file_size=lseek64(file_map->m_FileHan,0,SEEK_END);              // File was extended after it was opened
+                if(end_offset > file_size)
+                {
+                    return NULL;
+                }
+                if( (file_map->m_MapPtr == NULL) || (file_size <= file_map->m_MapSize) )
+                {
+                    file_map->m_FileSize=file_size;
+                    return file_map;
+                }
+                
+                RetireFileMap(file_map);                                        // File outgrew the mapping, it is reopened below
+                break;
+            }
+            active_count++;
+            if( (lru_map == NULL) || (file_map->m_LastUsed < lru_map->m_LastUsed) )
+            {
+                lru_map=file_map;
+            }
+        }
+    }
+    
+    if( lru_map && (active_count >= m_MaxFileMaps) )
+    {
+        RetireFileMap(lru_map);
+    }
+    
+    SetFileName(FileName,subscription,fileid);
+    file_map=new mc_ChunkFileMap;
+    file_map->Zero();
+    file_map->m_SubscriptionID=subscription->m_SubscriptionID;
+    file_map->m_FileID=fileid;
+    file_map->m_LastUsed=m_FileMapUseCounter;
+    
+    file_map->m_FileHan=open(FileName,_O_BINARY | O_RDONLY, S_IRUSR | S_IWUSR);
+    if(file_map->m_FileHan <= 0)
+    {
+        delete file_map;
+        return NULL;
+    }
+    
+    file_size=lseek64(file_map->m_FileHan,0,SEEK_END);
+    if(end_offset > file_size)
+    {
+        close(file_map->m_FileHan);
+        delete file_map;
+        return NULL;
+    }
+    
+    map_size=MC_CDB_MAX_FILE_SIZE;                                              // Whole file is mapped, file can grow without remapping 
+    if(file_size > map_size)
+    {
+        map_size=file_size;
+    }
+    
+    file_map->m_MapPtr=(unsigned char*)__US_MapFile(file_map->m_FileHan,map_size);
+    if(file_map->m_MapPtr)
+    {
+        file_map->m_MapSize=map_size;
+    }
+    file_map->m_FileSize=file_size;
+    
+    if(m_FileMaps->Add(&file_map,NULL))
+    {
+        DeleteFileMap(file_map);
+        return NULL;
+    }
+    
+    return file_map;
+}
+
 int mc_ChunkDB::AddToFile(const void* chunk,                  
                           uint32_t size,
                           mc_SubscriptionDBRow *subscription,
@@ -2144,10 +2563,56 @@ int mc_ChunkDB::CommitInternal(int block,uint32_t flush_mode)
 //    last_file_id=-1;
 //    last_file_offset=0;
     
+    m_SharedFileCounts->Clear();
+    
     for(r=0;r<m_MemPool->GetCount();r++)
     {
         chunk_def=(mc_ChunkDBRow *)m_MemPool->GetRow(r);
         
+        if( (chunk_def->m_SubscriptionID == 0) && (chunk_def->m_StorageFlags & MC_CFL_STORAGE_SHARED) )
+        {
+            subscription=(mc_SubscriptionDBRow *)m_Subscriptions->GetRow(0);
+            subscription->m_TmpFlags |= MC_CDB_TMP_FLAG_SHOULD_COMMIT;
+            
+            if(chunk_def->m_InternalFileID < 0)                                 // New shared row, data is still in memory
+            {
+                size=chunk_def->m_HeaderSize+chunk_def->m_Size;
+                if(subscription->m_LastFileSize+size > MC_CDB_MAX_FILE_SIZE)
+                {
+                    AddSharedFileCount(subscription->m_LastFileID,0);           // Deleted on update if not referenced anymore
+                    FlushDataFile(subscription,subscription->m_LastFileID,flush_mode);
+                    subscription->m_LastFileID+=1;
+                    subscription->m_LastFileSize=0;
+                }            
+
+                err=AddToFile(GetChunkInternal(chunk_def,-1,-1,NULL,NULL,NULL),size,
+                              subscription,subscription->m_LastFileID,subscription->m_LastFileSize,0);
+                if(err)
+                {
+                    sprintf(msg,"Couldn't store shared chunk in file, error:  %d",err);
+                    LogString(msg);
+                    return err;
+                }
+
+                chunk_def->m_InternalFileID=subscription->m_LastFileID;
+                chunk_def->m_InternalFileOffset=subscription->m_LastFileSize;
+
+                subscription->m_LastFileSize+=size;    
+                subscription->m_Count+=1;
+                subscription->m_FullSize+=chunk_def->m_Size;
+                
+                AddSharedFileCount(chunk_def->m_InternalFileID,1);
+            }
+            
+            chunk_def->SwapPosBytes();
+            err=m_DB->Write((char*)chunk_def+m_KeyOffset,m_KeySize,(char*)chunk_def+m_ValueOffset,m_ValueSize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
+            chunk_def->SwapPosBytes();
+            if(err)
+            {
+                goto exitlbl;
+            }                                            
+        }
+        
         if(chunk_def->m_SubscriptionID)
         {
             s=chunk_def->m_SubscriptionID;
@@ -2159,7 +2624,8 @@ int mc_ChunkDB::CommitInternal(int block,uint32_t flush_mode)
             {
 //                size=chunk_def->m_Size+chunk_def->m_HeaderSize;               // Fixed bug, chunk itself is not always stored
                 size=chunk_def->m_HeaderSize;
-                if( (chunk_def->m_Pos + chunk_def->m_TmpOnDiskItems) == 0)
+                if( ((chunk_def->m_Pos + chunk_def->m_TmpOnDiskItems) == 0) && 
+                    ((chunk_def->m_StorageFlags & MC_CFL_STORAGE_SHARED) == 0) )
                 {
                     size+=chunk_def->m_Size;
                 }
@@ -2250,6 +2716,12 @@ int mc_ChunkDB::CommitInternal(int block,uint32_t flush_mode)
         }
     }
 
+    err=UpdateSharedFiles();
+    if(err)
+    {
+        goto exitlbl;
+    }                                            
+    
     err=m_DB->Write((char*)&m_DBStat+m_KeyOffset,m_KeySize,(char*)&m_DBStat+m_ValueOffset,m_ValueSize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
     if(err)
     {
@@ -2264,6 +2736,8 @@ int mc_ChunkDB::CommitInternal(int block,uint32_t flush_mode)
     
     
 exitlbl:
+    DeleteSharedFiles((err == MC_ERR_NOERROR) ? 1 : 0);
+    
     if(err)
     {
         sprintf(msg,"Could not commit new Block %d, Chunks: %d, Error: %d",block,m_MemPool->GetCount(),err);
@@ -2330,3 +2804,215 @@ int mc_ChunkDB::RestoreChunkIfNeeded(mc_ChunkDBRow *chunk_def)
     return err;
 }
 
+
+int mc_ChunkDB::GetSharedChunkDef(mc_ChunkDBRow *chunk_def,
+                                  const unsigned char *hash,
+                                  int *mempool_row)
+{
+    int err,value_len,mprow;
+    unsigned char *ptr;
+    
+    err=MC_ERR_NOERROR;
+    
+    chunk_def->Zero();
+    memcpy(chunk_def->m_Hash,hash,MC_CDB_CHUNK_HASH_SIZE);
+    
+    if(mempool_row)
+    {
+        *mempool_row=-1;
+    }
+    
+    mprow=m_MemPool->Seek((unsigned char*)chunk_def);
+    if(mprow >= 0)
+    {
+        if(mempool_row)
+        {
+            *mempool_row=mprow;
+        }
+        memcpy(chunk_def,(mc_ChunkDBRow *)m_MemPool->GetRow(mprow),sizeof(mc_ChunkDBRow));
+    }
+    else
+    {
+        chunk_def->SwapPosBytes();
+        ptr=(unsigned char*)m_DB->Read((char*)chunk_def+m_KeyOffset,m_KeySize,&value_len,0,&err);
+        chunk_def->SwapPosBytes();
+        if(err)
+        {
+            return err;
+        }
+        if(ptr == NULL)
+        {
+            return MC_ERR_NOT_FOUND;
+        }
+        memcpy((char*)chunk_def+m_ValueOffset,ptr,m_ValueSize);        
+    }
+    
+    if( (chunk_def->m_StorageFlags & MC_CFL_STORAGE_SHARED) == 0 )              // Null row in mempool, not in shared store yet
+    {
+        return MC_ERR_NOT_FOUND;        
+    }
+    
+    return MC_ERR_NOERROR;
+}
+
+int mc_ChunkDB::AddSharedFileCount(uint32_t fileid,int32_t delta)
+{
+    int row;
+    unsigned char *ptr;
+    
+    row=m_SharedFileCounts->Seek(&fileid);
+    if(row >= 0)
+    {
+        ptr=m_SharedFileCounts->GetRow(row);
+        *(int32_t*)(ptr+sizeof(uint32_t)) += delta;
+        return MC_ERR_NOERROR;
+    }
+    
+    return m_SharedFileCounts->Add(&fileid,&delta);
+}
+
+int mc_ChunkDB::ReleaseSharedChunk(mc_ChunkDBRow *chunk_def)
+{
+    int err,value_len;
+    unsigned char *ptr;
+    mc_ChunkDBRow entity_chunk_def;
+    mc_ChunkDBRow shared_chunk_def;
+    
+    if(chunk_def->m_Pos)
+    {
+        return MC_ERR_NOERROR;
+    }
+    
+    err=MC_ERR_NOERROR;
+    
+    memcpy(&entity_chunk_def,chunk_def,sizeof(mc_ChunkDBRow));
+    entity_chunk_def.SwapPosBytes();
+    ptr=(unsigned char*)m_DB->Read((char*)&entity_chunk_def+m_KeyOffset,m_KeySize,&value_len,0,&err);
+    entity_chunk_def.SwapPosBytes();
+    if(err)
+    {
+        return err;
+    }
+    if(ptr == NULL)
+    {
+        return MC_ERR_NOERROR;
+    }
+    memcpy((char*)&entity_chunk_def+m_ValueOffset,ptr,m_ValueSize);
+    
+    if( (entity_chunk_def.m_StorageFlags & MC_CFL_STORAGE_SHARED) == 0 )
+    {
+        return MC_ERR_NOERROR;        
+    }
+    
+    err=GetSharedChunkDef(&shared_chunk_def,chunk_def->m_Hash,NULL);
+    if(err)
+    {
+        if(err == MC_ERR_NOT_FOUND)
+        {
+            LogString("Shared chunk not found on subscription removal");
+            err=MC_ERR_NOERROR;
+        }
+        return err;
+    }
+    
+    shared_chunk_def.m_ItemCount-=1;
+    
+    shared_chunk_def.SwapPosBytes();
+    if(shared_chunk_def.m_ItemCount > 0)
+    {
+        err=m_DB->Write((char*)&shared_chunk_def+m_KeyOffset,m_KeySize,(char*)&shared_chunk_def+m_ValueOffset,m_ValueSize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
+    }
+    else
+    {
+        err=m_DB->Delete((char*)&shared_chunk_def+m_KeyOffset,m_KeySize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
+    }
+    shared_chunk_def.SwapPosBytes();
+    
+    if( (err == MC_ERR_NOERROR) && (shared_chunk_def.m_ItemCount <= 0) )
+    {
+        err=AddSharedFileCount(shared_chunk_def.m_InternalFileID,-1);
+    }
+    
+    return err;
+}
+
+int mc_ChunkDB::UpdateSharedFiles()
+{
+    int err,value_len,row;
+    unsigned char *ptr;
+    int32_t delta;
+    mc_SubscriptionDBRow *subscription;
+    mc_SubscriptionFileDBRow file_row;
+    
+    err=MC_ERR_NOERROR;
+    subscription=(mc_SubscriptionDBRow *)m_Subscriptions->GetRow(0);
+    
+    for(row=0;row<m_SharedFileCounts->GetCount();row++)
+    {
+        ptr=m_SharedFileCounts->GetRow(row);
+        
+        file_row.Zero();
+        file_row.m_FileID=*(uint32_t*)ptr;
+        delta=*(int32_t*)(ptr+sizeof(uint32_t));
+        
+        ptr=(unsigned char*)m_DB->Read((char*)&file_row+m_KeyOffset,m_KeySize,&value_len,0,&err);
+        if(err)
+        {
+            return err;
+        }
+        if(ptr)
+        {
+            memcpy((char*)&file_row+m_ValueOffset,ptr,m_ValueSize);
+        }
+        
+        if( (delta < 0) && ((int32_t)file_row.m_Count <= -delta) )
+        {
+            file_row.m_Count=0;
+        }
+        else
+        {
+            file_row.m_Count+=delta;
+        }
+        
+        if( (file_row.m_Count == 0) && ((int32_t)file_row.m_FileID != subscription->m_LastFileID) )  // File is not referenced and not appended
+        {
+            err=m_DB->Delete((char*)&file_row+m_KeyOffset,m_KeySize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
+            if(err == MC_ERR_NOERROR)
+            {
+                err=m_SharedFilesToDelete->Add(&file_row.m_FileID);             // Deleted only after the row deletion is committed
+            }
+        }
+        else
+        {
+            err=m_DB->Write((char*)&file_row+m_KeyOffset,m_KeySize,(char*)&file_row+m_ValueOffset,m_ValueSize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
+        }
+        if(err)
+        {
+            return err;
+        }
+    }
+    
+    m_SharedFileCounts->Clear();
+    
+    return MC_ERR_NOERROR;
+}
+
+void mc_ChunkDB::DeleteSharedFiles(int committed)
+{
+    int row;
+    char FileName[MC_DCT_DB_MAX_PATH];    
+    mc_SubscriptionDBRow *subscription;
+    
+    if(committed && m_SharedFilesToDelete->GetCount())
+    {
+        subscription=(mc_SubscriptionDBRow *)m_Subscriptions->GetRow(0);
+        CloseFileMaps(0);
+        for(row=0;row<m_SharedFilesToDelete->GetCount();row++)
+        {
+            SetFileName(FileName,subscription,*(uint32_t*)m_SharedFilesToDelete->GetRow(row));
+            __US_DeleteFile(FileName);
+        }
+    }
+    
+    m_SharedFilesToDelete->Clear();
+}
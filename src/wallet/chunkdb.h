@@ -22,6 +22,7 @@
 #define MC_CDB_MAX_FILE_READ_BUFFER_SIZE 0x0100000                              // Maximal size of chunk pool before commit, 1MB
 #define MC_CDB_MAX_CHUNK_EXTRA_SIZE      1024 
 #define MC_CDB_MAX_MEMPOOL_SIZE          1024 
+#define MC_CDB_DEFAULT_FILE_MAPS         16                                     // Default number of open data files 
 
 #define MC_CDB_FLUSH_MODE_NONE        0x00000000
 #define MC_CDB_FLUSH_MODE_FILE        0x00000001
@@ -30,6 +31,7 @@
 
 #define MC_CFL_STORAGE_FLUSHED        0x01000000 
 #define MC_CFL_STORAGE_PURGED         0x02000000 
+#define MC_CFL_STORAGE_SHARED         0x04000000                                // Chunk data is kept in shared store, row (hash,0,0)
 
 #define MC_CFL_FORMAT_MASK            0x00000007 
 #define MC_CFL_SINGLE_CHUNK           0x00010000 
@@ -38,17 +40,21 @@
 
 typedef struct mc_SubscriptionFileDBRow
 {
-    uint32_t m_SubscriptionID;                                                  // Should be Zero
+    uint32_t m_Zero;                                                            // Should be Zero
     uint32_t m_RecordType;                                                      // Should be MC_CDB_TYPE_FILE    
+    int32_t  m_SubscriptionID;                                                  // Subscription ID, 0 - shared store
     uint32_t m_FileID;                                                          // File ID
     mc_TxEntity m_Entity;                                                       // Parent Entity
     uint32_t m_Size;                                                            // File size
     uint32_t m_StorageFlags;                                                    // Internal flags
-    uint32_t m_Count;                                                           // Total count
+    uint32_t m_Count;                                                           // Number of referenced chunks stored in the file
     uint32_t m_FirstTimestamp;                                                  // Timestamp of the first record
     uint32_t m_FirstOffset;                                                     // First data offset
     uint32_t m_LastTimeStamp;                                                   // Timestamp of the last record
     uint32_t m_LastOffset;                                                      // Last data file size
+    uint32_t m_Reserved1; 
+    uint32_t m_Reserved2; 
+    uint32_t m_Reserved3; 
     void Zero();
 } mc_SubscriptionFileDBRow;
 
@@ -120,6 +126,24 @@ typedef struct mc_ChunkDBRow
 } mc_ChunkDBRow;
 
 
+/** Open data file **/
+
+typedef struct mc_ChunkFileMap
+{
+    int32_t  m_SubscriptionID;                                                  // Subscription ID
+    uint32_t m_FileID;                                                          // Data file ID
+    int m_FileHan;                                                              // File handle
+    unsigned char *m_MapPtr;                                                    // Read-only mapping, NULL if file is read using file handle 
+    int64_t m_MapSize;                                                          // Mapping size
+    int64_t m_FileSize;                                                         // File size known to be covered by the mapping
+    uint64_t m_LastUsed;                                                        // Use counter value on last access, for LRU eviction
+    int m_PinCount;                                                             // Number of threads holding pointers into the mapping
+    int m_Retired;                                                              // Evicted or replaced, closed when not pinned
+    
+    void Zero();
+} mc_ChunkFileMap;
+
+
 /** Chunk DB **/
 
 typedef struct mc_ChunkDB
@@ -145,6 +169,15 @@ typedef struct mc_ChunkDB
     
     mc_Buffer *m_ThreadTmpScripts;
     int m_FeedPos;
+    
+    mc_Buffer *m_FileMaps;                                                      // Open data files (mc_ChunkFileMap*), active and retired
+    mc_Buffer *m_ThreadFileMapPins;                                             // Mapping pinned by the last read in this thread
+    int m_MaxFileMaps;                                                          // Maximal number of active open data files, 0 - disabled
+    uint64_t m_FileMapUseCounter;                                               
+    
+    int m_SharedStorage;                                                        // Store stream chunk data once, in shared store
+    mc_Buffer *m_SharedFileCounts;                                              // Pending changes in shared file reference counts
+    mc_Buffer *m_SharedFilesToDelete;                                           // Unreferenced shared files, deleted after commit
 
     void *m_Semaphore;                                                          // mc_TxDB object semaphore
     uint64_t m_LockedBy;                                                        // ID of the thread locking it
@@ -247,8 +280,24 @@ typedef struct mc_ChunkDB
                                   uint32_t fileid,
                                   uint32_t flush_mode);
     
+    mc_ChunkFileMap *GetFileMap(mc_SubscriptionDBRow *subscription,             // Returns open data file covering end_offset, NULL if not available
+                                  uint32_t fileid,
+                                  int64_t end_offset);
+    void PinFileMap(mc_ChunkFileMap *file_map);                                 // Pins mapping for this thread until its next read, NULL - unpins
+    void RetireFileMap(mc_ChunkFileMap *file_map);                              
+    void DeleteFileMap(mc_ChunkFileMap *file_map);                              
+    void CloseFileMaps(int32_t subscription_id);                                // Closes data files of subscription, -1 - all
+    
     int RestoreChunkIfNeeded(mc_ChunkDBRow *chunk_def);
     
+    int GetSharedChunkDef(mc_ChunkDBRow *chunk_def,                             // Returns shared store row for the hash
+                          const unsigned char *hash,
+                          int *mempool_row);
+    int AddSharedFileCount(uint32_t fileid,int32_t delta);                      // Adds pending change in shared file reference count
+    int ReleaseSharedChunk(mc_ChunkDBRow *chunk_def);                           // Decrements shared reference of subscription row
+    int UpdateSharedFiles();                                                    // Applies m_SharedFileCounts, collects unreferenced files
+    void DeleteSharedFiles(int committed);                                      // Deletes collected files if commit succeeded
+    
     int AddToFile(const void *chunk,                  
                           uint32_t size,
                           mc_SubscriptionDBRow *subscription,
@@ -20,6 +20,7 @@ extern mc_WalletTxs* pwalletTxsMain;
 #include "utils/util.h"
 #include "utils/utilmoneystr.h"
 #include "community/community.h"
+#include "core/init.h"
 
 #include <assert.h>
 
@@ -1485,6 +1486,113 @@ mc_TxImport *StartImport(CWallet *lpWallet,bool fOnlyUnsynced, bool fOnlySubscri
 
 /* MCHN END*/
 
+/**
+ * Adds transactions of one block to the import (and to the wallet in non-address-txs mode).
+ * err is the error of the previous blocks, transactions are not added to the import if it is set.
+ */
+static int ScanBlockForImport(CWallet *lpWallet,mc_TxImport *imp,CBlock& block,CBlockIndex* pindex,bool fUpdate,int err,int *ret)
+{
+    CDiskTxPos pos(pindex->GetBlockPos(), GetSizeOfCompactSize(block.vtx.size()));
+    int block_tx_index=0;
+    
+    BOOST_FOREACH(CTransaction& tx, block.vtx)
+    {
+        if(imp)
+        {
+            if(err == MC_ERR_NOERROR)
+            {
+                if(pindex->nHeight)                                             // Skip 0-block coinbase
+                {
+                    err=pwalletTxsMain->AddTx(imp,tx,pindex->nHeight,&pos,block_tx_index,pindex->GetBlockHash());
+                }
+                else
+                {
+                    pwalletTxsMain->AddExplorerTx(imp,tx,pindex->nHeight);
+                }
+            }
+        }
+        if(((mc_gState->m_WalletMode & MC_WMD_ADDRESS_TXS) == 0) || (mc_gState->m_WalletMode & MC_WMD_MAP_TXS))
+        {
+            if (lpWallet->AddToWalletIfInvolvingMe(tx, &block, fUpdate))
+                (*ret)++;
+        }
+        pos.nTxOffset += ::GetSerializeSize(tx, SER_DISK, CLIENT_VERSION);
+        block_tx_index++;
+    }
+    if(imp)
+    {
+        if(err == MC_ERR_NOERROR)
+        {
+            err=pEF->FED_EventChunksAvailable();
+            if(err)
+            {
+                LogPrintf("ERROR: Cannot write offchain items in block, error %d\n",err);
+            }
+            err=MC_ERR_NOERROR;
+        }
+        if(err == MC_ERR_NOERROR)
+        {
+            err=pwalletTxsMain->Commit(imp);
+            
+        }   
+        if(err == MC_ERR_NOERROR)
+        {
+            pwalletTxsMain->CleanUpAfterBlock(imp,pindex->nHeight,pindex->nHeight-1);
+        }                
+    }
+    
+    return err;
+}
+
+/**
+ * Replays mempool into the import and merges it with the chain, drops the import if err is set.
+ */
+static int FinishImport(mc_TxImport *imp,int err,uint32_t flags)
+{
+    if(err == MC_ERR_NOERROR)
+    {
+        LogPrint("wallet","wtxs: Replaying import mempool, %d items\n",mempool.hashList->m_Count);
+        for(int pos=0;pos<mempool.hashList->m_Count;pos++)
+        {
+            uint256 hash=*(uint256*)mempool.hashList->GetRow(pos);
+            if(mempool.exists(hash))
+            {
+                const CTransaction& tx = mempool.mapTx[hash].GetTx();
+                LogPrint("wallet","wtxs: Mempool tx: %s\n",hash.ToString().c_str());
+                pwalletTxsMain->AddTx(imp,tx,-1,NULL,-1,0);            
+            }
+        }
+        if(err == MC_ERR_NOERROR)
+        {
+            err=pEF->FED_EventChunksAvailable();
+            if(err)
+            {
+                LogPrintf("ERROR: Cannot write offchain items after mempool, error %d\n",err);
+            }
+            err=MC_ERR_NOERROR;
+        }
+        
+        pwalletTxsMain->WRPWriteLock();
+        if(fDebug)LogPrint("mcwrp","mcwrp: Synchronization for import started\n");
+
+        err=pwalletTxsMain->CompleteImport(imp,flags);
+
+        
+        pwalletTxsMain->WRPSync(1);
+
+        if(fDebug)LogPrint("mcwrp","mcwrp: Synchronization for import completed\n");
+        pwalletTxsMain->WRPWriteUnLock();
+
+    }
+    else
+    {
+        LogPrintf("Rescan failed with error %d\n",err);            
+        err=pwalletTxsMain->DropImport(imp);
+    }
+    
+    return err;
+}
+
 /**
  * Scan the block chain (starting in pindexStart) for transactions
  * from or to us. If fUpdate is true, found transactions that already
@@ -1545,54 +1653,7 @@ int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate,bo
             ReadBlockFromDisk(block, pindex);
             
 /* MCHN START */            
-            CDiskTxPos pos(pindex->GetBlockPos(), GetSizeOfCompactSize(block.vtx.size()));
-            int block_tx_index=0;
-            
-            BOOST_FOREACH(CTransaction& tx, block.vtx)
-            {
-                if(imp)
-                {
-                    if(err == MC_ERR_NOERROR)
-                    {
-                        if(pindex->nHeight)                                     // Skip 0-block coinbase
-                        {
-                            err=pwalletTxsMain->AddTx(imp,tx,pindex->nHeight,&pos,block_tx_index,pindex->GetBlockHash());
-                        }
-                        else
-                        {
-                            pwalletTxsMain->AddExplorerTx(imp,tx,pindex->nHeight);
-                        }
-                    }
-                }
-                if(((mc_gState->m_WalletMode & MC_WMD_ADDRESS_TXS) == 0) || (mc_gState->m_WalletMode & MC_WMD_MAP_TXS))
-                {
-                    if (AddToWalletIfInvolvingMe(tx, &block, fUpdate))
-                        ret++;
-                }
-                pos.nTxOffset += ::GetSerializeSize(tx, SER_DISK, CLIENT_VERSION);
-                block_tx_index++;
-            }
-            if(imp)
-            {
-                if(err == MC_ERR_NOERROR)
-                {
-                    err=pEF->FED_EventChunksAvailable();
-                    if(err)
-                    {
-                        LogPrintf("ERROR: Cannot write offchain items in block, error %d\n",err);
-                    }
-                    err=MC_ERR_NOERROR;
-                }
-                if(err == MC_ERR_NOERROR)
-                {
-                    err=pwalletTxsMain->Commit(imp);
-                    
-                }   
-                if(err == MC_ERR_NOERROR)
-                {
-                    pwalletTxsMain->CleanUpAfterBlock(imp,pindex->nHeight,pindex->nHeight-1);
-                }                
-            }
+            err=ScanBlockForImport(this,imp,block,pindex,fUpdate,err,&ret);
 /* MCHN END */            
             if(!fOnlyUnsynced)
             {
@@ -1610,66 +1671,522 @@ int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate,bo
         ShowProgress(_("Rescanning..."), 100); // hide progress dialog in GUI
         if(imp)
         {
-            if(err == MC_ERR_NOERROR)
+            err=FinishImport(imp,err,((pindexStart->nHeight > 0) && !fOnlySubscriptions) ? MC_EFL_NOT_IN_SYNC_AFTER_IMPORT : 0);
+        }
+        
+        if(err)
+        {
+            LogPrintf("Rescan failed with error %d\n",err);            
+            ret=-1;
+        }
+        else
+        {
+            if(!fOnlyUnsynced)
+            {
+                printf("Rescan complete\n\n");                
+            }
+            LogPrint("wallet","Rescan completed successfully\n");            
+        }
+    }
+    
+    return ret;
+}
+
+/* MCHN START */
+
+/**
+ * Background rescan. Prefetch threads read and deserialize blocks ahead of the
+ * rescan thread and do not take cs_main for disk reads. Relevance filtering stays in
+ * mc_WalletTxs::AddTx, which is called by the rescan thread under cs_main and cs_wallet,
+ * one block at a time.
+ */
+
+/** Reads block of the active chain at specific height, cs_main is held only for index lookup */
+
+static CBlock *ReadRescanBlock(int height)
+{
+    CBlockIndex *pindex=NULL;
+    CBlock *block;
+    
+    {
+        LOCK(cs_main);
+        if(height <= chainActive.Height())
+        {
+            pindex=chainActive[height];
+        }
+    }
+    if(pindex == NULL)
+    {
+        return NULL;
+    }
+    
+    block=new CBlock;
+    if(!ReadBlockFromDisk(*block,pindex))
+    {
+        delete block;
+        return NULL;
+    }
+    
+    return block;
+}
+
+struct CRescanPrefetcher
+{
+    boost::mutex mutex;
+    boost::condition_variable cond;
+    boost::thread_group threads;
+    std::map<int,CBlock*> mapBlocks;                                            // Prefetched blocks, NULL - not available
+    int nNextRead;
+    int nNextProcess;
+    int nWindow;
+    bool fStop;
+
+    void Start(int height,int thread_count,int window);
+    void Stop();
+    CBlock *Get(int height);
+    void Worker();
+};
+
+void CRescanPrefetcher::Start(int height,int thread_count,int window)
+{
+    nNextRead=height;
+    nNextProcess=height;
+    nWindow=window;
+    fStop=false;
+    for(int i=0;i<thread_count;i++)
+    {
+        threads.create_thread(boost::bind(&CRescanPrefetcher::Worker, this));
+    }
+}
+
+void CRescanPrefetcher::Stop()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        fStop=true;
+        cond.notify_all();
+    }
+    threads.interrupt_all();
+    threads.join_all();
+    for(std::map<int,CBlock*>::iterator it=mapBlocks.begin();it!=mapBlocks.end();it++)
+    {
+        if(it->second)
+        {
+            delete it->second;
+        }
+    }
+    mapBlocks.clear();
+}
+
+CBlock *CRescanPrefetcher::Get(int height)
+{
+    CBlock *block=NULL;
+    boost::unique_lock<boost::mutex> lock(mutex);
+    
+    while(!fStop && (mapBlocks.find(height) == mapBlocks.end()))
+    {
+        cond.wait(lock);
+    }
+    std::map<int,CBlock*>::iterator it=mapBlocks.find(height);
+    if(it != mapBlocks.end())
+    {
+        block=it->second;
+        mapBlocks.erase(it);
+    }
+    nNextProcess=height+1;
+    cond.notify_all();
+    
+    return block;
+}
+
+void CRescanPrefetcher::Worker()
+{
+    RenameThread("bitcoin-rscprefetch");
+    
+    try
+    {
+        while(true)
+        {
+            int height;
+            CBlock *block;
             {
-                LogPrint("wallet","wtxs: Replaying import mempool, %d items\n",mempool.hashList->m_Count);
-                for(int pos=0;pos<mempool.hashList->m_Count;pos++)
+                boost::unique_lock<boost::mutex> lock(mutex);
+                while(!fStop && (nNextRead >= nNextProcess+nWindow))
                 {
-                    uint256 hash=*(uint256*)mempool.hashList->GetRow(pos);
-                    if(mempool.exists(hash))
-                    {
-                        const CTransaction& tx = mempool.mapTx[hash].GetTx();
-                        LogPrint("wallet","wtxs: Mempool tx: %s\n",hash.ToString().c_str());
-                        pwalletTxsMain->AddTx(imp,tx,-1,NULL,-1,0);            
-                    }
+                    cond.wait(lock);
                 }
-                if(err == MC_ERR_NOERROR)
+                if(fStop)
                 {
-                    err=pEF->FED_EventChunksAvailable();
-                    if(err)
-                    {
-                        LogPrintf("ERROR: Cannot write offchain items after mempool, error %d\n",err);
-                    }
-                    err=MC_ERR_NOERROR;
+                    return;
                 }
-                
-                pwalletTxsMain->WRPWriteLock();
-                if(fDebug)LogPrint("mcwrp","mcwrp: Synchronization for import started\n");
+                height=nNextRead;
+                nNextRead++;
+            }
+            block=ReadRescanBlock(height);                                      // Block may be reorganized away, rescan thread will reread it
+            {
+                boost::unique_lock<boost::mutex> lock(mutex);
+                mapBlocks[height]=block;
+                cond.notify_all();
+            }
+        }
+    }
+    catch (boost::thread_interrupted)
+    {
+    }
+}
 
-                err=pwalletTxsMain->CompleteImport(imp,((pindexStart->nHeight > 0) && !fOnlySubscriptions) ? MC_EFL_NOT_IN_SYNC_AFTER_IMPORT : 0);
+static CCriticalSection cs_BackgroundRescan;
+static boost::thread *pBackgroundRescanThread=NULL;
+static CWalletRescanInfo BackgroundRescanInfo;
 
-                
-                pwalletTxsMain->WRPSync(1);
+void CWalletRescanInfo::Zero()
+{
+    fActive=false;
+    fCancelRequested=false;
+    fPending=false;
+    fPendingReaccept=false;
+    nPendingStartBlock=0;
+    nStartBlock=0;
+    nCurrentBlock=-1;
+    nChainBlock=-1;
+    nAttempts=0;
+    nError=MC_ERR_NOERROR;
+    nStartTime=0;
+    nEndTime=0;
+    strStatus="idle";
+}
 
-                if(fDebug)LogPrint("mcwrp","mcwrp: Synchronization for import completed\n");
-                pwalletTxsMain->WRPWriteUnLock();
+static bool BackgroundRescanCancelled()
+{
+    LOCK(cs_BackgroundRescan);
+    return BackgroundRescanInfo.fCancelRequested || ShutdownRequested();
+}
 
+/**
+ * One pass of the background rescan.
+ * Returns MC_ERR_NOERROR if import was completed (or there was nothing to import), MC_ERR_NOT_ALLOWED if cancelled,
+ * MC_ERR_OPERATION_NOT_SUPPORTED if import should be restarted because of reorganization.
+ */
+static int BackgroundRescanPass(CWallet *lpWallet,int start_block,bool fUpdate,bool fOnlySubscriptions)
+{
+    mc_TxImport *imp;
+    CRescanPrefetcher prefetcher;
+    uint256 hashLast=0;
+    int err,ret,height,first_height,thread_count,read_attempts;
+    int64_t nNow=GetTime();
+    bool fCompleted=false;
+    bool fReread=false;
+    
+    ret=0;
+    {
+        LOCK2(cs_main, lpWallet->cs_wallet);
+        
+        if(start_block > chainActive.Height())
+        {
+            start_block=chainActive.Height();
+        }
+        imp=StartImport(lpWallet,true,fOnlySubscriptions,start_block-1,&err);
+        if(imp == NULL)
+        {
+            if(err == MC_ERR_NOERROR)
+            {
+                LogPrint("wallet","No new entities, background rescan skipped\n");                
+            }
+            return err;
+        }
+        height=start_block;
+        if(height <= imp->m_Block)
+        {
+            height=imp->m_Block+1;
+        }
+        LOCK(cs_BackgroundRescan);
+        BackgroundRescanInfo.nStartBlock=height;
+        BackgroundRescanInfo.nCurrentBlock=height-1;
+        BackgroundRescanInfo.nChainBlock=chainActive.Height();
+    }
+    
+    LogPrintf("Background rescan: started from block %d, import %d\n",height,imp->m_ImportID);
+    
+    thread_count=GetArg("-rescanthreads",MC_RSC_DEFAULT_THREADS);
+    if(thread_count < 1)
+    {
+        thread_count=1;
+    }
+    if(thread_count > MC_RSC_MAX_THREADS)
+    {
+        thread_count=MC_RSC_MAX_THREADS;
+    }
+    
+    first_height=height;
+    read_attempts=0;
+    prefetcher.Start(height,thread_count,MC_RSC_PREFETCH_WINDOW);
+    
+    while(err == MC_ERR_NOERROR)
+    {
+        if(BackgroundRescanCancelled())
+        {
+            err=MC_ERR_NOT_ALLOWED;
+            break;
+        }
+        
+        CBlock *block=NULL;
+        if(!fReread)
+        {
+            block=prefetcher.Get(height);
+        }
+        if(block == NULL)                                                       // Prefetch failed or block was replaced, reading here, still without cs_main
+        {
+            block=ReadRescanBlock(height);
+        }
+        
+        fReread=false;
+        {
+            LOCK2(cs_main, lpWallet->cs_wallet);
+            CBlockIndex *pindex=chainActive[height];
+            
+                                                                                // Chain became shorter or already imported block was reorganized away
+            if( (pindex == NULL) ||
+                ((height > first_height) && (pindex->pprev->GetBlockHash() != hashLast)) )
+            {
+                err=MC_ERR_OPERATION_NOT_SUPPORTED;
+            }
+            else if( (block == NULL) || (block->GetHash() != pindex->GetBlockHash()) )
+            {
+                read_attempts++;                                                // Block was replaced after it was read, reading again after locks are released
+                if(read_attempts > MC_RSC_MAX_ATTEMPTS)
+                {
+                    err=(block == NULL) ? MC_ERR_INTERNAL_ERROR : MC_ERR_OPERATION_NOT_SUPPORTED;
+                }
+                fReread=true;
             }
             else
             {
-                LogPrintf("Rescan failed with error %d\n",err);            
-                err=pwalletTxsMain->DropImport(imp);
+                read_attempts=0;
+                err=ScanBlockForImport(lpWallet,imp,*block,pindex,fUpdate,err,&ret);
+                hashLast=pindex->GetBlockHash();
+                
+                {
+                    LOCK(cs_BackgroundRescan);
+                    BackgroundRescanInfo.nCurrentBlock=height;
+                    BackgroundRescanInfo.nChainBlock=chainActive.Height();
+                }
+                
+                                                                                // Import caught up with the tip, merging while still holding cs_main
+                if( (err == MC_ERR_NOERROR) && (height == chainActive.Height()) )
+                {
+                    err=FinishImport(imp,err,((start_block > 0) && !fOnlySubscriptions) ? MC_EFL_NOT_IN_SYNC_AFTER_IMPORT : 0);
+                    fCompleted=true;
+                }
             }
         }
         
-        if(err)
+        if(block)
         {
-            LogPrintf("Rescan failed with error %d\n",err);            
-            ret=-1;
+            delete block;
         }
-        else
+        
+        if(fCompleted)
         {
-            if(!fOnlyUnsynced)
+            break;
+        }
+        
+        if(fReread)
+        {
+            if(err == MC_ERR_INTERNAL_ERROR)
             {
-                printf("Rescan complete\n\n");                
+                LogPrintf("Background rescan: cannot read block %d\n",height);
             }
-            LogPrint("wallet","Rescan completed successfully\n");            
+            continue;
+        }
+        
+        height++;
+        if (GetTime() >= nNow + 60) 
+        {
+            nNow = GetTime();
+            LogPrintf("Background rescan: at block %d\n", height);
         }
     }
     
-    return ret;
+    prefetcher.Stop();
+    
+    if(!fCompleted)
+    {
+        LOCK2(cs_main, lpWallet->cs_wallet);
+        pwalletTxsMain->DropImport(imp);
+    }
+    
+    return err;
 }
 
+static void ThreadBackgroundRescan(CWallet *lpWallet,int start_block,bool fUpdate,bool fOnlySubscriptions,bool fReaccept)
+{
+    RenameThread("bitcoin-rescan");
+    
+    int err,attempts;
+    
+    while(true)
+    {
+        attempts=0;
+        err=BackgroundRescanPass(lpWallet,start_block,fUpdate,fOnlySubscriptions);
+        while( (err == MC_ERR_OPERATION_NOT_SUPPORTED) && (attempts < MC_RSC_MAX_ATTEMPTS) )
+        {
+            LogPrintf("Background rescan: chain reorganization, restarting\n");
+            attempts++;
+            {
+                LOCK(cs_BackgroundRescan);
+                BackgroundRescanInfo.nAttempts++;
+            }
+            err=BackgroundRescanPass(lpWallet,start_block,fUpdate,fOnlySubscriptions);
+        }
+        
+        if( (err == MC_ERR_NOERROR) && fReaccept )
+        {
+            lpWallet->ReacceptWalletTransactions();
+        }
+        
+        LOCK(cs_BackgroundRescan);
+        if(BackgroundRescanInfo.fPending && !ShutdownRequested())               // New entities were added during this pass, callers already returned success
+        {
+            if(err == MC_ERR_NOERROR)
+            {
+                start_block=BackgroundRescanInfo.nPendingStartBlock;
+                fReaccept=BackgroundRescanInfo.fPendingReaccept;
+            }
+            else                                                                // Entities of failed or cancelled pass are still not synced,
+            {                                                                   // pending pass imports them too
+                LogPrintf("Background rescan: previous pass ended with error %d, running pending pass\n",err);
+                start_block=std::min(start_block,BackgroundRescanInfo.nPendingStartBlock);
+                fReaccept |= BackgroundRescanInfo.fPendingReaccept;
+            }
+            BackgroundRescanInfo.fPending=false;
+            BackgroundRescanInfo.fPendingReaccept=false;
+            BackgroundRescanInfo.fCancelRequested=false;
+            continue;
+        }
+        
+        BackgroundRescanInfo.fActive=false;
+        BackgroundRescanInfo.fPending=false;
+        BackgroundRescanInfo.nError=err;
+        BackgroundRescanInfo.nEndTime=GetTime();
+        switch(err)
+        {
+            case MC_ERR_NOERROR:
+                BackgroundRescanInfo.strStatus="completed";
+                LogPrintf("Background rescan completed\n");
+                break;
+            case MC_ERR_NOT_ALLOWED:
+                BackgroundRescanInfo.strStatus="cancelled";
+                LogPrintf("Background rescan cancelled\n");
+                break;
+            default:
+                BackgroundRescanInfo.strStatus="failed";
+                LogPrintf("Background rescan failed with error %d\n",err);
+                break;
+        }
+        break;
+    }
+}
+
+bool StartBackgroundRescan(CWallet *lpWallet,int start_block,bool fUpdate,bool fOnlySubscriptions,bool fReaccept,std::string& strError)
+{
+    LOCK(cs_BackgroundRescan);
+    
+    if((mc_gState->m_WalletMode & MC_WMD_TXS) == 0)
+    {
+        strError="Background rescan is not supported with this wallet version";
+        return false;
+    }
+    
+    if(ShutdownRequested())
+    {
+        strError="Shutdown in progress";
+        return false;
+    }
+    
+    if(BackgroundRescanInfo.fActive)
+    {
+        if(BackgroundRescanInfo.fPending)
+        {
+            BackgroundRescanInfo.nPendingStartBlock=std::min(BackgroundRescanInfo.nPendingStartBlock,start_block);
+            BackgroundRescanInfo.fPendingReaccept |= fReaccept;
+        }
+        else
+        {
+            BackgroundRescanInfo.fPending=true;
+            BackgroundRescanInfo.nPendingStartBlock=start_block;
+            BackgroundRescanInfo.fPendingReaccept=fReaccept;
+        }
+        return true;
+    }
+    
+    if(pBackgroundRescanThread)
+    {
+        pBackgroundRescanThread->join();
+        delete pBackgroundRescanThread;
+        pBackgroundRescanThread=NULL;
+    }
+    
+    BackgroundRescanInfo.Zero();
+    BackgroundRescanInfo.fActive=true;
+    BackgroundRescanInfo.nStartBlock=start_block;
+    BackgroundRescanInfo.nStartTime=GetTime();
+    BackgroundRescanInfo.strStatus="running";
+    
+    pBackgroundRescanThread=new boost::thread(boost::bind(&ThreadBackgroundRescan,lpWallet,start_block,fUpdate,fOnlySubscriptions,fReaccept));
+    
+    return true;
+}
+
+bool CancelBackgroundRescan()
+{
+    LOCK(cs_BackgroundRescan);
+    
+    if(!BackgroundRescanInfo.fActive)
+    {
+        return false;
+    }
+    
+    BackgroundRescanInfo.fCancelRequested=true;
+    BackgroundRescanInfo.fPending=false;
+    
+    return true;
+}
+
+void StopBackgroundRescan()
+{
+    boost::thread *thread;
+    {
+        LOCK(cs_BackgroundRescan);
+        thread=pBackgroundRescanThread;
+        pBackgroundRescanThread=NULL;
+        if(BackgroundRescanInfo.fActive)
+        {
+            BackgroundRescanInfo.fCancelRequested=true;
+            BackgroundRescanInfo.fPending=false;
+        }
+    }
+    
+    if(thread)
+    {
+        thread->join();
+        delete thread;
+    }
+}
+
+bool IsBackgroundRescanActive()
+{
+    LOCK(cs_BackgroundRescan);
+    return BackgroundRescanInfo.fActive;
+}
+
+CWalletRescanInfo GetBackgroundRescanInfo()
+{
+    LOCK(cs_BackgroundRescan);
+    return BackgroundRescanInfo;
+}
+
+/* MCHN END */
+
 void CWallet::ReacceptWalletTransactions()
 {
     LOCK2(cs_main, cs_wallet);
@@ -76,6 +76,11 @@ struct mc_WalletTxs;
 #define MC_CSF_SIGN                     0x00000008
 #define MC_CSF_ALLOWED_COINS_ARE_MINE   0x00000010
 
+#define MC_RSC_DEFAULT_THREADS          4
+#define MC_RSC_MAX_THREADS              32
+#define MC_RSC_PREFETCH_WINDOW          32
+#define MC_RSC_MAX_ATTEMPTS             3
+
 struct mc_CoinAssetBufRow
 {
     unsigned char m_Asset[MC_AST_ASSET_FULLREF_BUF_SIZE];
@@ -1382,4 +1387,49 @@ private:
     std::vector<char> _ssExtra;
 };
 
+/* MCHN START */
+
+/**
+ * State of the background rescan, see StartBackgroundRescan().
+ */
+struct CWalletRescanInfo
+{
+    bool fActive;                                                               // Rescan thread is running
+    bool fCancelRequested;                                                      // cancelrescan was called
+    bool fPending;                                                              // Another pass requested while running
+    bool fPendingReaccept;                                                      // Pending pass should reaccept wallet transactions
+    int nPendingStartBlock;                                                     // Start block of the pending pass
+    int nStartBlock;                                                            // Start block of the current/last pass
+    int nCurrentBlock;                                                          // Last block merged into the import
+    int nChainBlock;                                                            // Active chain height seen by the rescan
+    int nAttempts;                                                              // Restarts caused by reorganizations
+    int nError;                                                                 // Last error
+    int64_t nStartTime;
+    int64_t nEndTime;
+    std::string strStatus;                                                      // idle/running/completed/cancelled/failed
+
+    CWalletRescanInfo()
+    {
+        Zero();
+    }
+
+    void Zero();
+};
+
+/**
+ * Rescans the chain for wallet entities which are not in sync (new subscriptions,
+ * imported addresses) in background thread. Blocks are read and deserialized by
+ * prefetch threads without cs_main, cs_main is taken only for merging one block
+ * into the import, so the live chain keeps advancing. Once the import catches up
+ * with the tip it is merged using CompleteImport. If the rescan is already running,
+ * another pass is scheduled after it.
+ */
+bool StartBackgroundRescan(CWallet *lpWallet,int start_block,bool fUpdate,bool fOnlySubscriptions,bool fReaccept,std::string& strError);
+bool CancelBackgroundRescan();
+void StopBackgroundRescan();
+bool IsBackgroundRescanActive();
+CWalletRescanInfo GetBackgroundRescanInfo();
+
+/* MCHN END */
+
 #endif // BITCOIN_WALLET_H
@@ -65,6 +65,143 @@ void mc_TxEntityRow::SwapPosBytes()
     ptr[2]=t;
 }
 
+void mc_TxEntityBlock::Zero()
+{
+    memset(this,0,sizeof(mc_TxEntityBlock));
+}
+
+void mc_TxEntityBlock::Init(mc_TxEntityRow *erow)
+{
+    Zero();
+    memcpy(&m_Entity,&(erow->m_Entity),sizeof(mc_TxEntity));
+    m_Generation=erow->m_Generation;
+    m_FirstPos=((erow->m_Pos-1)/MC_TDB_PACKED_BLOCK_ROWS)*MC_TDB_PACKED_BLOCK_ROWS+1;
+}
+
+int mc_TxEntityBlock::Contains(mc_TxEntityRow *erow)
+{
+    if(m_FirstPos == 0)
+    {
+        return 0;
+    }
+    if( (erow->m_Pos < m_FirstPos) || (erow->m_Pos >= m_FirstPos+MC_TDB_PACKED_BLOCK_ROWS) )
+    {
+        return 0;
+    }
+    if(erow->m_Generation != m_Generation)
+    {
+        return 0;
+    }
+    if(memcmp(&(erow->m_Entity),&m_Entity,sizeof(mc_TxEntity)))
+    {
+        return 0;
+    }
+    return 1;
+}
+
+/* Packed block format:
+ * 4 bytes - mask of present rows, followed by present rows in position order:
+ * txid, block (zigzag delta from previous row), flags, last subkey pos, temp pos - all varints
+ * Rows are ordered by chain position, so block delta is usually 0 or 1 byte varint  */
+
+static int64_t mc_TxZigZag(int64_t value)
+{
+    return (value >= 0) ? (value << 1) : (((-value) << 1) - 1);
+}
+
+static int64_t mc_TxUnZigZag(int64_t value)
+{
+    return (value & 1) ? -((value + 1) >> 1) : (value >> 1);
+}
+
+int mc_TxEntityBlock::Encode(unsigned char *ptr)
+{
+    int i,size,shift;
+    int prev_block;
+    mc_TxEntityRow *erow;
+    
+    mc_PutLE(ptr,&m_Mask,4);
+    size=4;
+    prev_block=0;
+    for(i=0;i<MC_TDB_PACKED_BLOCK_ROWS;i++)
+    {
+        if(m_Mask & ((uint32_t)1 << i))
+        {
+            erow=m_Rows+i;
+            memcpy(ptr+size,erow->m_TxId,MC_TDB_TXID_SIZE);
+            size+=MC_TDB_TXID_SIZE;
+            shift=mc_PutVarInt(ptr+size,MC_TDB_PACKED_MAX_VALUE_SIZE-size,mc_TxZigZag((int64_t)erow->m_Block-prev_block));
+            size+=shift;
+            shift=mc_PutVarInt(ptr+size,MC_TDB_PACKED_MAX_VALUE_SIZE-size,erow->m_Flags);
+            size+=shift;
+            shift=mc_PutVarInt(ptr+size,MC_TDB_PACKED_MAX_VALUE_SIZE-size,erow->m_LastSubKeyPos);
+            size+=shift;
+            shift=mc_PutVarInt(ptr+size,MC_TDB_PACKED_MAX_VALUE_SIZE-size,erow->m_TempPos);
+            size+=shift;
+            prev_block=erow->m_Block;
+        }
+    }
+    
+    return size;
+}
+
+int mc_TxEntityBlock::Decode(const unsigned char *ptr,int size,int max_row)
+{
+    int i,offset,shift;
+    int prev_block;
+    int64_t value[4];
+    int j;
+    mc_TxEntityRow *erow;
+    
+    if(size < 4)
+    {
+        return MC_ERR_CORRUPTED;
+    }
+    
+    m_Mask=(uint32_t)mc_GetLE((void*)ptr,4);
+    offset=4;
+    prev_block=0;
+    if( (max_row < 0) || (max_row >= MC_TDB_PACKED_BLOCK_ROWS) )
+    {
+        max_row=MC_TDB_PACKED_BLOCK_ROWS-1;
+    }
+    
+    for(i=0;i<=max_row;i++)
+    {
+        erow=m_Rows+i;
+        erow->Zero();
+        memcpy(&(erow->m_Entity),&m_Entity,sizeof(mc_TxEntity));
+        erow->m_Generation=m_Generation;
+        erow->m_Pos=m_FirstPos+i;
+        if(m_Mask & ((uint32_t)1 << i))
+        {
+            if(offset+MC_TDB_TXID_SIZE > size)
+            {
+                return MC_ERR_CORRUPTED;
+            }
+            memcpy(erow->m_TxId,ptr+offset,MC_TDB_TXID_SIZE);
+            offset+=MC_TDB_TXID_SIZE;
+            for(j=0;j<4;j++)
+            {
+                shift=0;
+                value[j]=mc_GetVarInt(ptr+offset,size-offset,-1,&shift);
+                if(shift == 0)
+                {
+                    return MC_ERR_CORRUPTED;
+                }
+                offset+=shift;
+            }
+            erow->m_Block=(int)(prev_block+mc_TxUnZigZag(value[0]));
+            erow->m_Flags=(uint32_t)value[1];
+            erow->m_LastSubKeyPos=(uint32_t)value[2];
+            erow->m_TempPos=(uint32_t)value[3];
+            prev_block=erow->m_Block;
+        }
+    }
+    
+    return MC_ERR_NOERROR;
+}
+
 
 void mc_TxEntityStat::Zero()
 {
@@ -213,7 +350,7 @@ int mc_TxEntityDB::Open()
     m_DB=new mc_Database;
     
     m_DB->SetOption("KeySize",0,m_KeySize);
-    m_DB->SetOption("ValueSize",0,m_ValueSize);
+    m_DB->SetOption("ValueSize",0,MC_TDB_PACKED_MAX_VALUE_SIZE);                // Per-thread read buffers should fit packed entity blocks
         
     return m_DB->Open(m_FileName,MC_OPT_DB_DATABASE_CREATE_IF_MISSING | MC_OPT_DB_DATABASE_TRANSACTIONAL | MC_OPT_DB_DATABASE_LEVELDB | MC_OPT_DB_DATABASE_THREAD_SAFE);
 }
@@ -259,6 +396,8 @@ void mc_TxDB::Zero()
     m_WRPRawMemPool=NULL;                                       
     m_WRPRawUpdatePool=NULL;                                     
     
+    m_EntityBlocks=NULL;
+    m_EntityBlockBuffer=NULL;
 }
 
 void mc_TxDB::LogString(const char *message)
@@ -481,7 +620,7 @@ int mc_TxDB::Initialize(const char *name,uint32_t mode)
     
     strcpy(m_Name,name);
     
-    m_Mode=mode;
+    m_Mode=mode - (mode & MC_WMD_PACKED_LISTS);                                 // Storage format is taken from the database or from -walletpackedlists on creation
     m_Database=new mc_TxEntityDB;
     
     mc_GetFullFileName(name,"wallet/txs","",MC_FOM_RELATIVE_TO_DATADIR | MC_FOM_CREATE_DIR,m_LobFileNamePrefix);
@@ -613,6 +752,11 @@ int mc_TxDB::Initialize(const char *name,uint32_t mode)
             }
         }
         
+        if(mc_gState->m_Params->GetOption("-walletpackedlists",(int64_t)0))     // Storage format is fixed when database is created
+        {
+            m_Mode |= MC_WMD_PACKED_LISTS;
+        }
+        
         m_DBStat.m_WalletVersion = 2;
         if(m_Mode & MC_WMD_FLAT_DAT_FILE)
         {
@@ -639,13 +783,25 @@ int mc_TxDB::Initialize(const char *name,uint32_t mode)
             return err;
         }                    
         
-        err=m_Database->m_DB->Commit(MC_OPT_DB_DATABASE_TRANSACTIONAL);
+        err=CommitDB();
         if(err)
         {
             return err;
         }
     }
     
+    if(m_Mode & MC_WMD_PACKED_LISTS)
+    {
+        m_EntityBlocks=new mc_Buffer;                                           // Key - entity with m_Pos set to the first position in block
+        err=m_EntityBlocks->Initialize(MC_TDB_ENTITY_KEY_SIZE,sizeof(mc_TxEntityBlock),MC_BUF_MODE_MAP);
+        m_EntityBlockBuffer=(unsigned char*)mc_New(MC_TDB_PACKED_MAX_VALUE_SIZE);
+        if(m_EntityBlockBuffer == NULL)
+        {
+            return MC_ERR_ALLOCATION;
+        }
+        LogString("Initialize: Packed entity lists");
+    }
+    
     m_MemPools[0]=new mc_Buffer;                                                // Key - entity with m_Pos set to 0 + txid
     err=m_MemPools[0]->Initialize(MC_TDB_ENTITY_KEY_SIZE+MC_TDB_TXID_SIZE,m_Database->m_TotalSize,MC_BUF_MODE_MAP);
     
@@ -719,7 +875,7 @@ int mc_TxDB::UpdateMode(uint32_t mode)
         return err;
     }                            
     
-    err=m_Database->m_DB->Commit(MC_OPT_DB_DATABASE_TRANSACTIONAL);
+    err=CommitDB();
     if(err)
     {
         return err;
@@ -780,6 +936,16 @@ int mc_TxDB::Destroy()
         __US_RWLockDestroy(m_WRPRWLock);
     }
 
+    if(m_EntityBlocks)
+    {
+        delete m_EntityBlocks;
+    }
+    
+    if(m_EntityBlockBuffer)
+    {
+        mc_Delete(m_EntityBlockBuffer);
+    }
+    
     Zero();
     
     return MC_ERR_NOERROR;    
@@ -889,6 +1055,257 @@ int mc_TxDB::FlushDataFile(uint32_t fileid)
     return MC_ERR_NOERROR;
 }
 
+/* Entity row storage. In MC_WMD_PACKED_LISTS mode rows with the same entity and generation are grouped 
+ * into blocks of MC_TDB_PACKED_BLOCK_ROWS consecutive positions stored as single DB row.
+ * Reads always see committed data, like unpacked reads. Writes are collected in m_EntityBlocks 
+ * and written on CommitDB  */
+
+int mc_TxDB::ReadEntityBlock(mc_TxEntityBlock *block)
+{
+    int err,value_len;
+    unsigned char *ptr;
+    mc_TxEntityRow krow;
+    
+    krow.Zero();
+    memcpy(&krow,block,MC_TDB_ENTITY_KEY_SIZE);
+    krow.SwapPosBytes();
+    
+    ptr=(unsigned char*)m_Database->m_DB->Read((char*)&krow+m_Database->m_KeyOffset,m_Database->m_KeySize,&value_len,0,&err);
+    if(err)
+    {
+        return err;
+    }
+    
+    if(ptr == NULL)
+    {
+        block->m_Mask=0;
+        return MC_ERR_NOERROR;
+    }
+    
+    err=block->Decode(ptr,value_len,-1);
+    if(err)
+    {
+        LogString("Error: ReadEntityBlock: corrupted block");
+    }
+    
+    return err;
+}
+
+unsigned char *mc_TxDB::ReadEntityRow(mc_TxEntityRow *erow,mc_TxEntityBlock *block,int *err)
+{
+    int value_len;
+    uint32_t row;
+    unsigned char *ptr;
+    mc_TxEntityBlock single;
+    mc_TxEntityRow krow;
+    
+    if(m_EntityBlocks == NULL)
+    {
+        return (unsigned char*)m_Database->m_DB->Read((char*)erow+m_Database->m_KeyOffset,m_Database->m_KeySize,&value_len,0,err);
+    }
+    
+    *err=MC_ERR_NOERROR;
+    ptr=NULL;
+    erow->SwapPosBytes();
+    
+    if(erow->m_Pos == 0)                                                        // Not a list row, not packed
+    {
+        erow->SwapPosBytes();
+        return (unsigned char*)m_Database->m_DB->Read((char*)erow+m_Database->m_KeyOffset,m_Database->m_KeySize,&value_len,0,err);
+    }
+    
+    if(block)                                                                   // Range read, whole block is decoded once
+    {
+        if(block->Contains(erow) == 0)
+        {
+            block->Init(erow);
+            *err=ReadEntityBlock(block);
+            if(*err)
+            {
+                block->Zero();
+                erow->SwapPosBytes();
+                return NULL;
+            }
+        }
+        row=erow->m_Pos-block->m_FirstPos;
+        if(block->m_Mask & ((uint32_t)1 << row))
+        {
+            ptr=(unsigned char*)(block->m_Rows+row)+m_Database->m_ValueOffset;
+        }
+        erow->SwapPosBytes();
+        return ptr;
+    }
+    
+    single.Init(erow);                                                          // Single row read, only rows up to requested are decoded
+    row=erow->m_Pos-single.m_FirstPos;
+    erow->SwapPosBytes();
+    
+    krow.Zero();
+    memcpy(&krow,&single,MC_TDB_ENTITY_KEY_SIZE);
+    krow.SwapPosBytes();
+    
+    ptr=(unsigned char*)m_Database->m_DB->Read((char*)&krow+m_Database->m_KeyOffset,m_Database->m_KeySize,&value_len,0,err);
+    if( (*err != MC_ERR_NOERROR) || (ptr == NULL) )
+    {
+        return NULL;
+    }
+    
+    *err=single.Decode(ptr,value_len,row);
+    if(*err)
+    {
+        LogString("Error: ReadEntityRow: corrupted block");
+        return NULL;
+    }
+    
+    if((single.m_Mask & ((uint32_t)1 << row)) == 0)
+    {
+        return NULL;
+    }
+    
+    memcpy(ptr,(unsigned char*)(single.m_Rows+row)+m_Database->m_ValueOffset,m_Database->m_ValueSize);    // DB read buffer is large enough, caller gets the same pointer semantics as mc_Database::Read
+    
+    return ptr;
+}
+
+mc_TxEntityBlock *mc_TxDB::GetModifiedEntityBlock(mc_TxEntityRow *erow,int *err)
+{
+    int row;
+    mc_TxEntityBlock block;
+    
+    block.Init(erow);
+    row=m_EntityBlocks->Seek(&block);
+    if(row >= 0)
+    {
+        return (mc_TxEntityBlock*)m_EntityBlocks->GetRow(row);
+    }
+    
+    *err=ReadEntityBlock(&block);
+    if(*err)
+    {
+        return NULL;
+    }
+    
+    *err=m_EntityBlocks->Add(&block,(unsigned char*)&block+MC_TDB_ENTITY_KEY_SIZE);
+    if(*err)
+    {
+        return NULL;
+    }
+    
+    return (mc_TxEntityBlock*)m_EntityBlocks->GetRow(m_EntityBlocks->GetCount()-1);
+}
+
+int mc_TxDB::WriteEntityRow(mc_TxEntityRow *erow)
+{
+    int err;
+    uint32_t row;
+    mc_TxEntityBlock *block;
+    
+    if(m_EntityBlocks == NULL)
+    {
+        return m_Database->m_DB->Write((char*)erow+m_Database->m_KeyOffset,m_Database->m_KeySize,(char*)erow+m_Database->m_ValueOffset,m_Database->m_ValueSize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
+    }
+    
+    err=MC_ERR_NOERROR;
+    erow->SwapPosBytes();
+    if(erow->m_Pos == 0)
+    {
+        erow->SwapPosBytes();
+        return m_Database->m_DB->Write((char*)erow+m_Database->m_KeyOffset,m_Database->m_KeySize,(char*)erow+m_Database->m_ValueOffset,m_Database->m_ValueSize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
+    }
+    
+    block=GetModifiedEntityBlock(erow,&err);
+    if(block)
+    {
+        row=erow->m_Pos-block->m_FirstPos;
+        memcpy(block->m_Rows+row,erow,sizeof(mc_TxEntityRow));
+        block->m_Mask |= (uint32_t)1 << row;
+    }
+    erow->SwapPosBytes();
+    
+    return err;
+}
+
+int mc_TxDB::DeleteEntityRow(mc_TxEntityRow *erow)
+{
+    int err;
+    uint32_t row;
+    mc_TxEntityBlock *block;
+    
+    if(m_EntityBlocks == NULL)
+    {
+        return m_Database->m_DB->Delete((char*)erow+m_Database->m_KeyOffset,m_Database->m_KeySize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
+    }
+    
+    err=MC_ERR_NOERROR;
+    erow->SwapPosBytes();
+    if(erow->m_Pos == 0)
+    {
+        erow->SwapPosBytes();
+        return m_Database->m_DB->Delete((char*)erow+m_Database->m_KeyOffset,m_Database->m_KeySize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
+    }
+    
+    block=GetModifiedEntityBlock(erow,&err);
+    if(block)
+    {
+        row=erow->m_Pos-block->m_FirstPos;
+        block->m_Mask &= ~((uint32_t)1 << row);
+    }
+    erow->SwapPosBytes();
+    
+    return err;
+}
+
+int mc_TxDB::FlushEntityBlocks()
+{
+    int i,err,size;
+    mc_TxEntityBlock *block;
+    mc_TxEntityRow krow;
+    
+    if(m_EntityBlocks == NULL)
+    {
+        return MC_ERR_NOERROR;
+    }
+    
+    err=MC_ERR_NOERROR;
+    for(i=0;i<m_EntityBlocks->GetCount();i++)
+    {
+        block=(mc_TxEntityBlock*)m_EntityBlocks->GetRow(i);
+        krow.Zero();
+        memcpy(&krow,block,MC_TDB_ENTITY_KEY_SIZE);
+        krow.SwapPosBytes();
+        if(block->m_Mask)
+        {
+            size=block->Encode(m_EntityBlockBuffer);
+            err=m_Database->m_DB->Write((char*)&krow+m_Database->m_KeyOffset,m_Database->m_KeySize,(char*)m_EntityBlockBuffer,size,MC_OPT_DB_DATABASE_TRANSACTIONAL);
+        }
+        else
+        {
+            err=m_Database->m_DB->Delete((char*)&krow+m_Database->m_KeyOffset,m_Database->m_KeySize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
+        }
+        if(err)
+        {
+            break;
+        }
+    }
+    
+    m_EntityBlocks->Clear();
+    
+    return err;
+}
+
+int mc_TxDB::CommitDB()
+{
+    int err;
+    
+    err=FlushEntityBlocks();
+    if(err)
+    {
+        return err;
+    }
+    
+    return m_Database->m_DB->Commit(MC_OPT_DB_DATABASE_TRANSACTIONAL);
+}
+
 
 int mc_TxDB::AddToFile(const unsigned char *tx,
                           uint32_t txsize,
@@ -989,7 +1406,7 @@ int mc_TxDB::AddEntity(mc_TxImport *import,mc_TxEntity *entity,uint32_t flags)
             goto exitlbl;
         }                    
 
-        err=m_Database->m_DB->Commit(MC_OPT_DB_DATABASE_TRANSACTIONAL);
+        err=CommitDB();
         if(err)
         {
             goto exitlbl;
@@ -1220,7 +1637,7 @@ int mc_TxDB::DecrementSubKey(
         erow.m_Generation=stat->m_Generation;
         erow.m_Pos=1;
         erow.SwapPosBytes();
-        ptr=(unsigned char*)m_Database->m_DB->Read((char*)&erow+m_Database->m_KeyOffset,m_Database->m_KeySize,&value_len,0,&err);
+        ptr=ReadEntityRow(&erow,NULL,&err);
         erow.SwapPosBytes();
         if(err)
         {
@@ -1315,7 +1732,7 @@ int mc_TxDB::IncrementSubKey(
             erow.m_Generation=stat->m_Generation;
             erow.m_Pos=1;
             erow.SwapPosBytes();
-            ptr=(unsigned char*)m_Database->m_DB->Read((char*)&erow+m_Database->m_KeyOffset,m_Database->m_KeySize,&value_len,0,&err);
+            ptr=ReadEntityRow(&erow,NULL,&err);
             erow.SwapPosBytes();
             if(err)
             {
@@ -2067,7 +2484,7 @@ int mc_TxDB::SaveTxFlag(const unsigned char *hash,uint32_t flag,int set_flag)
         return err;
     }                            
 
-    err=m_Database->m_DB->Commit(MC_OPT_DB_DATABASE_TRANSACTIONAL);
+    err=CommitDB();
     if(err)
     {
         return err;
@@ -2423,7 +2840,7 @@ int mc_TxDB::Commit(mc_TxImport *import)
                     erow.m_Generation=lperow->m_Generation;
                     erow.m_Pos=1;
                     erow.SwapPosBytes();
-                    ptr=(unsigned char*)m_Database->m_DB->Read((char*)&erow+m_Database->m_KeyOffset,m_Database->m_KeySize,&value_len,0,&err);
+                    ptr=ReadEntityRow(&erow,NULL,&err);
                     erow.SwapPosBytes();
                     if(err)
                     {
@@ -2442,7 +2859,7 @@ int mc_TxDB::Commit(mc_TxImport *import)
                         memcpy((char*)&erow+m_Database->m_ValueOffset,ptr,m_Database->m_ValueSize);
                         erow.m_LastSubKeyPos=lperow->m_LastSubKeyPos;
                         erow.SwapPosBytes();
-                        err=m_Database->m_DB->Write((char*)&erow+m_Database->m_KeyOffset,m_Database->m_KeySize,(char*)&erow+m_Database->m_ValueOffset,m_Database->m_ValueSize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
+                        err=WriteEntityRow(&erow);
                         erow.SwapPosBytes();
                     }
                 }
@@ -2450,7 +2867,7 @@ int mc_TxDB::Commit(mc_TxImport *import)
             lperow->m_Pos=lperow->m_TempPos;                                    // m_Pos in mempool was 0 - to support search by TxID  in mempool
             lperow->m_TempPos=0;
             lperow->SwapPosBytes();
-            err=m_Database->m_DB->Write((char*)lperow+m_Database->m_KeyOffset,m_Database->m_KeySize,(char*)lperow+m_Database->m_ValueOffset,m_Database->m_ValueSize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
+            err=WriteEntityRow(lperow);
             lperow->SwapPosBytes();
             if(err)
             {
@@ -2513,7 +2930,7 @@ int mc_TxDB::Commit(mc_TxImport *import)
     }
     FlushDataFile(m_DBStat.m_LastFileID);
 
-    err=m_Database->m_DB->Commit(MC_OPT_DB_DATABASE_TRANSACTIONAL);
+    err=CommitDB();
     if(err)
     {
         goto exitlbl;
@@ -2637,7 +3054,7 @@ int mc_TxDB::RollBack(mc_TxImport *import,int block)
                 erow.m_Generation=lperow->m_Generation;
                 erow.m_Pos=j+1;
                 erow.SwapPosBytes();
-                err=m_Database->m_DB->Delete((char*)&erow+m_Database->m_KeyOffset,m_Database->m_KeySize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
+                err=DeleteEntityRow(&erow);
                 erow.SwapPosBytes();
                 if(err)
                 {
@@ -2651,7 +3068,7 @@ int mc_TxDB::RollBack(mc_TxImport *import,int block)
                 erow.m_Generation=lperow->m_Generation;
                 erow.m_Pos=1;
                 erow.SwapPosBytes();
-                ptr=(unsigned char*)m_Database->m_DB->Read((char*)&erow+m_Database->m_KeyOffset,m_Database->m_KeySize,&value_len,0,&err);
+                ptr=ReadEntityRow(&erow,NULL,&err);
                 erow.SwapPosBytes();
                 if(err)
                 {
@@ -2665,7 +3082,7 @@ int mc_TxDB::RollBack(mc_TxImport *import,int block)
                 memcpy((char*)&erow+m_Database->m_ValueOffset,ptr,m_Database->m_ValueSize);                    
                 erow.m_LastSubKeyPos=lperow->m_LastSubKeyPos;
                 erow.SwapPosBytes();
-                err=m_Database->m_DB->Write((char*)&erow+m_Database->m_KeyOffset,m_Database->m_KeySize,(char*)&erow+m_Database->m_ValueOffset,m_Database->m_ValueSize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
+                err=WriteEntityRow(&erow);
                 erow.SwapPosBytes();
                 if(err)
                 {
@@ -2706,7 +3123,7 @@ int mc_TxDB::RollBack(mc_TxImport *import,int block)
             {
                 erow.m_Pos=pos;
                 erow.SwapPosBytes();
-                ptr=(unsigned char*)m_Database->m_DB->Read((char*)&erow+m_Database->m_KeyOffset,m_Database->m_KeySize,&value_len,0,&err);
+                ptr=ReadEntityRow(&erow,NULL,&err);
                 erow.SwapPosBytes();
                 if(err)
                 {
@@ -2719,7 +3136,7 @@ int mc_TxDB::RollBack(mc_TxImport *import,int block)
                     if(erow.m_Block > block)
                     {
                         erow.SwapPosBytes();
-                        err=m_Database->m_DB->Delete((char*)&erow+m_Database->m_KeyOffset,m_Database->m_KeySize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
+                        err=DeleteEntityRow(&erow);
                         erow.SwapPosBytes();
                         pos--;
                         stat->m_LastPos=pos;
@@ -2779,7 +3196,7 @@ int mc_TxDB::RollBack(mc_TxImport *import,int block)
         }                            
     }
     
-    err=m_Database->m_DB->Commit(MC_OPT_DB_DATABASE_TRANSACTIONAL);
+    err=CommitDB();
     if(err)
     {
         goto exitlbl;
@@ -2841,7 +3258,7 @@ int mc_TxDB::GetLastItem(
         erow->m_Generation=generation;
         erow->m_Pos=1;
         erow->SwapPosBytes();
-        ptr=(unsigned char*)m_Database->m_DB->Read((char*)erow+m_Database->m_KeyOffset,m_Database->m_KeySize,&value_len,0,&err);
+        ptr=ReadEntityRow(erow,NULL,&err);
         erow->SwapPosBytes();
         if(ptr)
         {
@@ -2867,7 +3284,7 @@ int mc_TxDB::GetLastItem(
     if(in_mempool == 0)
     {
         erow->SwapPosBytes();
-        ptr=(unsigned char*)m_Database->m_DB->Read((char*)erow+m_Database->m_KeyOffset,m_Database->m_KeySize,&value_len,0,&err);
+        ptr=ReadEntityRow(erow,NULL,&err);
         erow->SwapPosBytes();
         if(err)
         {
@@ -2932,7 +3349,7 @@ int mc_TxDB::GetRow(
     err=MC_ERR_NOERROR;
 
     erow->SwapPosBytes();
-    ptr=(unsigned char*)m_Database->m_DB->Read((char*)erow+m_Database->m_KeyOffset,m_Database->m_KeySize,&value_len,0,&err);
+    ptr=ReadEntityRow(erow,NULL,&err);
     erow->SwapPosBytes();
     if(err)
     {
@@ -2979,7 +3396,7 @@ int mc_TxDB::WRPGetRow(
     err=MC_ERR_NOERROR;
 
     erow->SwapPosBytes();
-    ptr=(unsigned char*)m_Database->m_DB->Read((char*)erow+m_Database->m_KeyOffset,m_Database->m_KeySize,&value_len,0,&err);
+    ptr=ReadEntityRow(erow,NULL,&err);
     erow->SwapPosBytes();
     if(err)
     {
@@ -3026,6 +3443,7 @@ int mc_TxDB::GetList(
 {
     int first,last,i;
     mc_TxEntityRow erow;
+    mc_TxEntityBlock block;                                                     // Decoded block cache for MC_WMD_PACKED_LISTS
     mc_TxEntityRow *lpEnt;
     mc_Buffer *mempool;
     int value_len; 
@@ -3082,13 +3500,14 @@ int mc_TxDB::GetList(
     memcpy(&erow.m_Entity,&(stat->m_Entity),sizeof(mc_TxEntity));
     erow.m_Generation=stat->m_Generation;
     mprow=-1;
+    block.Zero();
     for(i=first;i<=last;i++)
     {
         erow.m_Pos=i;        
         if(erow.m_Pos <= stat->m_LastClearedPos)                                // Database rows
         {
             erow.SwapPosBytes();
-            ptr=(unsigned char*)m_Database->m_DB->Read((char*)&erow+m_Database->m_KeyOffset,m_Database->m_KeySize,&value_len,0,&err);
+            ptr=ReadEntityRow(&erow,&block,&err);
             erow.SwapPosBytes();
             if(err)
             {
@@ -3157,6 +3576,7 @@ int mc_TxDB::WRPGetList(
 {
     int first,last,i,confirmed;
     mc_TxEntityRow erow;
+    mc_TxEntityBlock block;                                                     // Decoded block cache for MC_WMD_PACKED_LISTS
     mc_TxEntityRow *lpEnt;
     mc_Buffer *mempool;
     int value_len; 
@@ -3212,13 +3632,14 @@ int mc_TxDB::WRPGetList(
     memcpy(&erow.m_Entity,entity,sizeof(mc_TxEntity));
     erow.m_Generation=generation;
     mprow=-1;
+    block.Zero();
     for(i=first;i<=last;i++)
     {
         erow.m_Pos=i;
         if((int)erow.m_Pos <= confirmed)                                // Database rows
         {
             erow.SwapPosBytes();
-            ptr=(unsigned char*)m_Database->m_DB->Read((char*)&erow+m_Database->m_KeyOffset,m_Database->m_KeySize,&value_len,0,&err);
+            ptr=ReadEntityRow(&erow,&block,&err);
             erow.SwapPosBytes();
             if(err)
             {
@@ -3287,6 +3708,7 @@ int mc_TxDB::GetList(
 {
     int first,last,i,confirmed;
     mc_TxEntityRow erow;
+    mc_TxEntityBlock block;                                                     // Decoded block cache for MC_WMD_PACKED_LISTS
     mc_TxEntityRow *lpEnt;
     mc_Buffer *mempool;
     int value_len; 
@@ -3338,13 +3760,14 @@ int mc_TxDB::GetList(
     memcpy(&erow.m_Entity,entity,sizeof(mc_TxEntity));
     erow.m_Generation=generation;
     mprow=-1;
+    block.Zero();
     for(i=first;i<=last;i++)
     {
         erow.m_Pos=i;
         if((int)erow.m_Pos <= confirmed)                                // Database rows
         {
             erow.SwapPosBytes();
-            ptr=(unsigned char*)m_Database->m_DB->Read((char*)&erow+m_Database->m_KeyOffset,m_Database->m_KeySize,&value_len,0,&err);
+            ptr=ReadEntityRow(&erow,&block,&err);
             erow.SwapPosBytes();
             if(err)
             {
@@ -3563,7 +3986,7 @@ int mc_TxDB::WRPGetListSize(mc_TxEntity *entity,int generation,int *confirmed)
             erow.m_Generation=generation;
             erow.m_Pos=1;
             erow.SwapPosBytes();
-            ptr=(unsigned char*)m_Database->m_DB->Read((char*)&erow+m_Database->m_KeyOffset,m_Database->m_KeySize,&value_len,0,&err);
+            ptr=ReadEntityRow(&erow,NULL,&err);
             erow.SwapPosBytes();
             if(err)
             {
@@ -3616,7 +4039,7 @@ int mc_TxDB::GetListSize(mc_TxEntity *entity,int generation,int *confirmed)
             erow.m_Generation=generation;
             erow.m_Pos=1;
             erow.SwapPosBytes();
-            ptr=(unsigned char*)m_Database->m_DB->Read((char*)&erow+m_Database->m_KeyOffset,m_Database->m_KeySize,&value_len,0,&err);
+            ptr=ReadEntityRow(&erow,NULL,&err);
             erow.SwapPosBytes();
             if(err)
             {
@@ -3720,14 +4143,18 @@ int mc_TxDB::TransferSubKey(mc_TxEntityStat *lpChainEntStat,const mc_TxEntityRow
                 subkey_erow.m_Pos=i+1;
                 subkey_erow.m_Generation=lpChainEntStat->m_Generation;
                 subkey_erow.SwapPosBytes();
-                subkey_ptr=(unsigned char*)m_Database->m_DB->Read((char*)&subkey_erow+m_Database->m_KeyOffset,m_Database->m_KeySize,&value_len,0,&err);
+                subkey_ptr=ReadEntityRow(&subkey_erow,NULL,&err);
+                if(subkey_ptr)
+                {
+                    memcpy((char*)&subkey_erow+m_Database->m_ValueOffset,subkey_ptr,m_Database->m_ValueSize);
+                }
                 subkey_erow.m_Generation=(m_Imports+slot)->m_ImportID;         // Change generation when writing to DB
-                err=m_Database->m_DB->Write((char*)&subkey_erow+m_Database->m_KeyOffset,m_Database->m_KeySize,(char*)subkey_ptr,m_Database->m_ValueSize,MC_OPT_DB_DATABASE_TRANSACTIONAL);                        
+                err=WriteEntityRow(&subkey_erow);                        
                 subkey_erow.SwapPosBytes();
                 transferred_subkeys++;
                 if(transferred_subkeys >= 1000)
                 {
-                    m_Database->m_DB->Commit(MC_OPT_DB_DATABASE_TRANSACTIONAL);                    
+                    CommitDB();                    
                     transferred_subkeys=0;
                 }
             }
@@ -3812,7 +4239,7 @@ mc_TxImport *mc_TxDB::StartImport(mc_Buffer *lpEntities,int block,int *err)
                         erow.m_Pos=pos;
                         erow.SwapPosBytes();
                         erow.m_Generation=lpChainEntStat->m_Generation;
-                        ptr=(unsigned char*)m_Database->m_DB->Read((char*)&erow+m_Database->m_KeyOffset,m_Database->m_KeySize,&value_len,0,err);
+                        ptr=ReadEntityRow(&erow,NULL,err);
 
                         if(ptr)
                         {
@@ -3820,7 +4247,7 @@ mc_TxImport *mc_TxDB::StartImport(mc_Buffer *lpEntities,int block,int *err)
                         }
 
                         erow.m_Generation=(m_Imports+slot)->m_ImportID;         // Change generation when writing to DB
-                        *err=m_Database->m_DB->Write((char*)&erow+m_Database->m_KeyOffset,m_Database->m_KeySize,(char*)ptr,m_Database->m_ValueSize,MC_OPT_DB_DATABASE_TRANSACTIONAL);                        
+                        *err=WriteEntityRow(&erow);                        
                         erow.SwapPosBytes();
                         
                                 
@@ -3838,7 +4265,7 @@ mc_TxImport *mc_TxDB::StartImport(mc_Buffer *lpEntities,int block,int *err)
                         
                         if(((pos+1) % 1000) == 0)
                         {
-                            m_Database->m_DB->Commit(MC_OPT_DB_DATABASE_TRANSACTIONAL);                    
+                            CommitDB();                    
                         }
                     }
                     if(lpChainEntStat->m_LastClearedPos < lpChainEntStat->m_LastPos)
@@ -3853,7 +4280,7 @@ mc_TxImport *mc_TxDB::StartImport(mc_Buffer *lpEntities,int block,int *err)
                                 erow.m_Pos=lperow->m_TempPos;
                                 erow.m_Generation=(m_Imports+slot)->m_ImportID;
                                 erow.SwapPosBytes();
-                                *err=m_Database->m_DB->Write((char*)&erow+m_Database->m_KeyOffset,m_Database->m_KeySize,(char*)&erow+m_Database->m_ValueOffset,m_Database->m_ValueSize,MC_OPT_DB_DATABASE_TRANSACTIONAL);
+                                *err=WriteEntityRow(&erow);
                                 erow.SwapPosBytes();
                                 count++;
                                 *err=TransferSubKey(lpChainEntStat,erow,slot);
@@ -3890,7 +4317,7 @@ mc_TxImport *mc_TxDB::StartImport(mc_Buffer *lpEntities,int block,int *err)
         goto exitlbl;
     }                            
         
-    *err=m_Database->m_DB->Commit(MC_OPT_DB_DATABASE_TRANSACTIONAL);
+    *err=CommitDB();
     if(*err)
     {
         goto exitlbl;
@@ -3990,6 +4417,24 @@ int mc_TxDB::Unsubscribe(mc_Buffer* lpEntities)
         return MC_ERR_NOERROR;
     }
     
+    for(i=1;i<MC_TDB_MAX_IMPORTS;i++)                                           // Entity in running import would be resubscribed by CompleteImport
+    {
+        if((m_Imports+i)->m_Entities)
+        {
+            for(j=0;j<lpEntities->GetCount();j++)
+            {
+                if((m_Imports+i)->FindEntity((mc_TxEntity*)lpEntities->GetRow(j)) >= 0)
+                {
+                    sprintf_hex(enthex,((mc_TxEntity*)lpEntities->GetRow(j))->m_EntityID,MC_TDB_ENTITY_ID_SIZE);
+                    sprintf(msg,"Cannot unsubscribe from entity (%08X, %s), it is being imported in import %d",
+                            ((mc_TxEntity*)lpEntities->GetRow(j))->m_EntityType,enthex,(m_Imports+i)->m_ImportID);
+                    LogString(msg);
+                    return MC_ERR_NOT_ALLOWED;
+                }
+            }
+        }
+    }
+    
     Dump("Before Unsubscribe");
     
     deleted_items=0;
@@ -4014,7 +4459,7 @@ int mc_TxDB::Unsubscribe(mc_Buffer* lpEntities)
                 {
                     case MC_TET_STREAM_KEY:
                     case MC_TET_STREAM_PUBLISHER:
-                        ptr=(unsigned char*)m_Database->m_DB->Read((char*)&erow+m_Database->m_KeyOffset,m_Database->m_KeySize,&value_len,0,&err);
+                        ptr=ReadEntityRow(&erow,NULL,&err);
                         if(err == MC_ERR_NOERROR)
                         {
                             if(ptr)
@@ -4032,12 +4477,12 @@ int mc_TxDB::Unsubscribe(mc_Buffer* lpEntities)
                             {
                                 subkey_erow.m_Pos=i+1;
                                 subkey_erow.SwapPosBytes();
-                                m_Database->m_DB->Delete((char*)&subkey_erow+m_Database->m_KeyOffset,m_Database->m_KeySize,MC_OPT_DB_DATABASE_TRANSACTIONAL);        
+                                DeleteEntityRow(&subkey_erow);        
                                 subkey_erow.SwapPosBytes();
                                 deleted_items++;
                                 if(deleted_items >= 1000)
                                 {
-                                    m_Database->m_DB->Commit(MC_OPT_DB_DATABASE_TRANSACTIONAL);                    
+                                    CommitDB();                    
                                     deleted_items=0;
                                 }
                             }
@@ -4045,13 +4490,13 @@ int mc_TxDB::Unsubscribe(mc_Buffer* lpEntities)
                         break;
                 }
                 
-                m_Database->m_DB->Delete((char*)&erow+m_Database->m_KeyOffset,m_Database->m_KeySize,MC_OPT_DB_DATABASE_TRANSACTIONAL);        
+                DeleteEntityRow(&erow);        
                 erow.SwapPosBytes();
                 deleted_items++;
                 
                 if(deleted_items >= 1000)
                 {
-                    m_Database->m_DB->Commit(MC_OPT_DB_DATABASE_TRANSACTIONAL);                    
+                    CommitDB();                    
                     deleted_items=0;
                 }
             }
@@ -4117,7 +4562,7 @@ int mc_TxDB::Unsubscribe(mc_Buffer* lpEntities)
     
     if(deleted_items)
     {
-        err=m_Database->m_DB->Commit(MC_OPT_DB_DATABASE_TRANSACTIONAL);                    
+        err=CommitDB();                    
         deleted_items=0;                
     }    
 
@@ -4294,7 +4739,7 @@ int mc_TxDB::CompleteImport(mc_TxImport *import,uint32_t flags)
     }                
 
     
-    err=m_Database->m_DB->Commit(MC_OPT_DB_DATABASE_TRANSACTIONAL);
+    err=CommitDB();
     if(err)
     {
         goto exitlbl;
@@ -4445,7 +4890,7 @@ int mc_TxDB::CompleteImport(mc_TxImport *import,uint32_t flags)
                 {
                     case MC_TET_STREAM_KEY:
                     case MC_TET_STREAM_PUBLISHER:
-                        ptr=(unsigned char*)m_Database->m_DB->Read((char*)&erow+m_Database->m_KeyOffset,m_Database->m_KeySize,&value_len,0,&err);
+                        ptr=ReadEntityRow(&erow,NULL,&err);
                         if(err == MC_ERR_NOERROR)
                         {
                             if(ptr)
@@ -4463,12 +4908,12 @@ int mc_TxDB::CompleteImport(mc_TxImport *import,uint32_t flags)
                             {
                                 subkey_erow.m_Pos=i+1;
                                 subkey_erow.SwapPosBytes();
-                                m_Database->m_DB->Delete((char*)&subkey_erow+m_Database->m_KeyOffset,m_Database->m_KeySize,MC_OPT_DB_DATABASE_TRANSACTIONAL);        
+                                DeleteEntityRow(&subkey_erow);        
                                 subkey_erow.SwapPosBytes();
                                 deleted_items++;
                                 if(deleted_items >= 1000)
                                 {
-                                    m_Database->m_DB->Commit(MC_OPT_DB_DATABASE_TRANSACTIONAL);                    
+                                    CommitDB();                    
                                     deleted_items=0;
                                 }
                             }
@@ -4476,19 +4921,19 @@ int mc_TxDB::CompleteImport(mc_TxImport *import,uint32_t flags)
                         break;
                 }
                 
-                m_Database->m_DB->Delete((char*)&erow+m_Database->m_KeyOffset,m_Database->m_KeySize,MC_OPT_DB_DATABASE_TRANSACTIONAL);        
+                DeleteEntityRow(&erow);        
                 erow.SwapPosBytes();
                 deleted_items++;
                 
                 if(deleted_items >= 1000)
                 {
-                    m_Database->m_DB->Commit(MC_OPT_DB_DATABASE_TRANSACTIONAL);                    
+                    CommitDB();                    
                     deleted_items=0;
                 }
             }
             if(deleted_items)
             {
-                m_Database->m_DB->Commit(MC_OPT_DB_DATABASE_TRANSACTIONAL);                    
+                CommitDB();                    
                 deleted_items=0;                
             }
         }
@@ -4589,7 +5034,7 @@ int mc_TxDB::DropImport(mc_TxImport *import)
         goto exitlbl;
     }                
     
-    err=m_Database->m_DB->Commit(MC_OPT_DB_DATABASE_TRANSACTIONAL);
+    err=CommitDB();
     if(err)
     {
         goto exitlbl;
@@ -4613,7 +5058,7 @@ int mc_TxDB::DropImport(mc_TxImport *import)
             {
                 case MC_TET_STREAM_KEY:
                 case MC_TET_STREAM_PUBLISHER:
-                    ptr=(unsigned char*)m_Database->m_DB->Read((char*)&erow+m_Database->m_KeyOffset,m_Database->m_KeySize,&value_len,0,&err);
+                    ptr=ReadEntityRow(&erow,NULL,&err);
                     if(err == MC_ERR_NOERROR)
                     {
                         if(ptr)
@@ -4631,30 +5076,30 @@ int mc_TxDB::DropImport(mc_TxImport *import)
                         {
                             subkey_erow.m_Pos=i+1;
                             subkey_erow.SwapPosBytes();
-                            m_Database->m_DB->Delete((char*)&subkey_erow+m_Database->m_KeyOffset,m_Database->m_KeySize,MC_OPT_DB_DATABASE_TRANSACTIONAL);        
+                            DeleteEntityRow(&subkey_erow);        
                             subkey_erow.SwapPosBytes();
                             deleted_items++;
                             if(deleted_items >= 1000)
                             {
-                                m_Database->m_DB->Commit(MC_OPT_DB_DATABASE_TRANSACTIONAL);                    
+                                CommitDB();                    
                                 deleted_items=0;
                             }
                         }
                     }
                     break;
             }
-            m_Database->m_DB->Delete((char*)&erow+m_Database->m_KeyOffset,m_Database->m_KeySize,MC_OPT_DB_DATABASE_TRANSACTIONAL);        
+            DeleteEntityRow(&erow);        
             erow.SwapPosBytes();
             commit_required=1;
             if(((pos+1) % 1000) == 0)
             {
-                m_Database->m_DB->Commit(MC_OPT_DB_DATABASE_TRANSACTIONAL);                    
+                CommitDB();                    
                 commit_required=0;
             }
         }
         if(commit_required)
         {
-            m_Database->m_DB->Commit(MC_OPT_DB_DATABASE_TRANSACTIONAL);                    
+            CommitDB();                    
             commit_required=0;                
         }
     }    
@@ -14,6 +14,8 @@
 #define MC_TDB_GENERATION_SIZE        4
 #define MC_TDB_POS_SIZE               4
 #define MC_TDB_ROW_SIZE              80
+#define MC_TDB_PACKED_BLOCK_ROWS     32
+#define MC_TDB_PACKED_MAX_VALUE_SIZE (4+MC_TDB_PACKED_BLOCK_ROWS*(MC_TDB_TXID_SIZE+36))
 
 #define MC_TDB_MAX_IMPORTS           16
 
@@ -132,6 +134,23 @@ typedef struct mc_TxEntityRow
     void SwapPosBytes();                                                            
 } mc_TxEntityRow;
 
+/** Block of consecutive entity rows stored as single packed DB row, in-memory **/
+
+typedef struct mc_TxEntityBlock
+{
+    mc_TxEntity m_Entity;                                                       // Entity
+    int m_Generation;                                                           // Generation of entity data
+    uint32_t m_FirstPos;                                                        // position of the first row in block, 1-based, same layout as mc_TxEntityRow key
+    uint32_t m_Mask;                                                            // Bit i is set if row m_FirstPos+i is present
+    uint32_t m_Reserved;
+    mc_TxEntityRow m_Rows[MC_TDB_PACKED_BLOCK_ROWS];                            // Decoded rows
+    void Zero();
+    void Init(mc_TxEntityRow *erow);                                            // Sets block key for row, m_Pos of erow should not be swapped
+    int Contains(mc_TxEntityRow *erow);                                         // Returns 1 if row belongs to this block
+    int Decode(const unsigned char *ptr,int size,int max_row);                  // Decodes rows up to max_row (inclusive), -1 - all rows
+    int Encode(unsigned char *ptr);                                             // Returns packed size, ptr should have MC_TDB_PACKED_MAX_VALUE_SIZE bytes
+} mc_TxEntityBlock;
+
 /** Entity stats - last position, etc. In-memory structure **/
 
 typedef struct mc_TxEntityStat
@@ -294,6 +313,9 @@ typedef struct mc_TxDB
     mc_Buffer *m_WRPMemPool;                                                   // Read mc_TxEntityRow mempool
     mc_Buffer *m_WRPRawMemPool;                                                // Read mc_TxDefRow mempool
     mc_Buffer *m_WRPRawUpdatePool;                                             // Read Updated txs mempool
+    
+    mc_Buffer *m_EntityBlocks;                                                  // MC_WMD_PACKED_LISTS, modified mc_TxEntityBlock's not written to DB yet
+    unsigned char *m_EntityBlockBuffer;                                         // MC_WMD_PACKED_LISTS, encoding buffer
         
     mc_TxDB()
     {
@@ -486,6 +508,17 @@ typedef struct mc_TxDB
     
     int FlushDataFile(uint32_t fileid);
     
+    unsigned char *ReadEntityRow(                                               // Reads entity row value, returns NULL if not found, like mc_Database::Read 
+                  mc_TxEntityRow *erow,                                         // Row, m_Pos should be swapped
+                  mc_TxEntityBlock *block,                                      // Decoded block cache for range reads, may be NULL
+                  int *err);
+    int WriteEntityRow(mc_TxEntityRow *erow);                                   // Writes entity row, m_Pos should be swapped
+    int DeleteEntityRow(mc_TxEntityRow *erow);                                  // Deletes entity row, m_Pos should be swapped
+    int ReadEntityBlock(mc_TxEntityBlock *block);                               // Reads and decodes packed block, key should be set
+    mc_TxEntityBlock *GetModifiedEntityBlock(mc_TxEntityRow *erow,int *err);    // Returns block from m_EntityBlocks, reads it if needed
+    int FlushEntityBlocks();                                                    // Writes modified blocks to DB transaction
+    int CommitDB();                                                             // Flushes modified blocks and commits DB transaction
+    
     void LogString(const char *message);
     
     int WRPReadLock();